@@ -0,0 +1,19 @@
+#version 330 core
+// Half resolution: what is brighter than the threshold, 2x2 box filtered.
+out vec4 FragColor;
+
+in vec2 vUv;
+
+uniform sampler2D uHdr;     // full resolution
+uniform float uThreshold;
+
+void main() {
+    vec2 texel = 1.0 / vec2(textureSize(uHdr, 0));
+    // four bilinear taps cover the 4x4 full-res pixels around this one
+    vec3 c = 0.25 * (texture(uHdr, vUv + texel * vec2(-1.0, -1.0)).rgb +
+                     texture(uHdr, vUv + texel * vec2( 1.0, -1.0)).rgb +
+                     texture(uHdr, vUv + texel * vec2(-1.0,  1.0)).rgb +
+                     texture(uHdr, vUv + texel * vec2( 1.0,  1.0)).rgb);
+    float luma = max(c.r, max(c.g, c.b));
+    FragColor = vec4(c * (max(luma - uThreshold, 0.0) / max(luma, 1.0e-4)), 1.0);
+}
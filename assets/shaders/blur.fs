@@ -0,0 +1,16 @@
+#version 330 core
+// One direction of a 9-tap Gaussian, in five bilinear taps.
+out vec4 FragColor;
+
+in vec2 vUv;
+
+uniform sampler2D uSrc;
+uniform vec2 uDirection;    // (1, 0) or (0, 1)
+
+void main() {
+    vec2 step = uDirection / vec2(textureSize(uSrc, 0));
+    vec3 c = texture(uSrc, vUv).rgb * 0.2270270270;
+    c += (texture(uSrc, vUv + step * 1.3846153846).rgb + texture(uSrc, vUv - step * 1.3846153846).rgb) * 0.3162162162;
+    c += (texture(uSrc, vUv + step * 3.2307692308).rgb + texture(uSrc, vUv - step * 3.2307692308).rgb) * 0.0702702703;
+    FragColor = vec4(c, 1.0);
+}
@@ -0,0 +1,5 @@
+#version 330 core
+// Depth pre-pass with lit_shader.vs: only depth is written.
+
+void main() {
+}
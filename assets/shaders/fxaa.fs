@@ -0,0 +1,39 @@
+#version 330 core
+// FXAA in the style of Lottes' FXAA 3.11 console version: blur along the
+// local edge direction where luma contrast is high. Luma comes in alpha.
+out vec4 FragColor;
+
+in vec2 vUv;
+
+uniform sampler2D uColor;
+
+const float EDGE_THRESHOLD = 0.125;
+const float EDGE_THRESHOLD_MIN = 0.0312;
+const float REDUCE_MUL = 1.0 / 8.0;
+const float REDUCE_MIN = 1.0 / 128.0;
+const float SPAN_MAX = 8.0;
+
+void main() {
+    vec4 m = texture(uColor, vUv);
+    float lumaNW = textureOffset(uColor, vUv, ivec2(-1, -1)).a;
+    float lumaNE = textureOffset(uColor, vUv, ivec2( 1, -1)).a;
+    float lumaSW = textureOffset(uColor, vUv, ivec2(-1,  1)).a;
+    float lumaSE = textureOffset(uColor, vUv, ivec2( 1,  1)).a;
+    float lumaMin = min(m.a, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+    float lumaMax = max(m.a, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+    if (lumaMax - lumaMin < max(EDGE_THRESHOLD_MIN, lumaMax * EDGE_THRESHOLD)) {
+        FragColor = vec4(m.rgb, 1.0);
+        return;
+    }
+
+    vec2 dir = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));
+    float reduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25 * REDUCE_MUL, REDUCE_MIN);
+    float rcpDirMin = 1.0 / (min(abs(dir.x), abs(dir.y)) + reduce);
+    dir = clamp(dir * rcpDirMin, -SPAN_MAX, SPAN_MAX) / vec2(textureSize(uColor, 0));
+
+    vec3 a = 0.5 * (texture(uColor, vUv + dir * (1.0 / 3.0 - 0.5)).rgb +
+                    texture(uColor, vUv + dir * (2.0 / 3.0 - 0.5)).rgb);
+    vec3 b = a * 0.5 + 0.25 * (texture(uColor, vUv - dir * 0.5).rgb + texture(uColor, vUv + dir * 0.5).rgb);
+    float lumaB = dot(b, vec3(0.299, 0.587, 0.114));
+    FragColor = vec4(lumaB < lumaMin || lumaB > lumaMax ? a : b, 1.0);
+}
@@ -0,0 +1,44 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 vWorldPos;
+in vec2 vUv;
+flat in vec4 vCells01;
+flat in vec4 vCells23;
+flat in vec4 vWeights;
+flat in vec4 vRotation;
+flat in vec3 vColor;
+
+layout (std140) uniform Camera {
+    mat4 uView;
+    mat4 uProj;
+    vec3 uViewPos;
+};
+
+uniform sampler2D uAtlas;
+uniform float uGrid;
+uniform vec3 uLightPos;
+uniform vec3 uLightColor;
+
+vec4 view_sample(vec2 cell) {
+    return texture(uAtlas, (cell + vUv) / uGrid);
+}
+
+void main() {
+    vec4 s = view_sample(vCells01.xy) * vWeights.x + view_sample(vCells01.zw) * vWeights.y
+           + view_sample(vCells23.xy) * vWeights.z + view_sample(vCells23.zw) * vWeights.w;
+    if (s.a < 0.5) discard;
+
+    vec3 n = s.rgb / s.a * 2.0 - 1.0;
+    vec3 N = normalize(n + 2.0 * cross(vRotation.xyz, cross(vRotation.xyz, n) + vRotation.w * n));
+    vec3 L = normalize(uLightPos - vWorldPos);
+
+    // same terms as lit_shader.fs
+    vec3 ambient = 0.15 * uLightColor;
+    vec3 diffuse = max(dot(N, L), 0.0) * uLightColor;
+    vec3 V = normalize(uViewPos - vWorldPos);
+    vec3 H = normalize(L + V);
+    vec3 specular = 0.6 * pow(max(dot(N, H), 0.0), 64.0) * uLightColor;
+
+    FragColor = vec4((ambient + diffuse + specular) * vColor, 1.0);
+}
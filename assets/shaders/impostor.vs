@@ -0,0 +1,69 @@
+#version 330 core
+
+// written once per frame, see scene_upload_camera
+layout (std140) uniform Camera {
+    mat4 uView;
+    mat4 uProj;
+    vec3 uViewPos;
+};
+
+// CMD_IMPOSTOR_BATCH instances of CMD_IMPOSTOR_VEC4S each (cmdbuffer.h):
+// center + bounding radius, rotation quaternion, color
+uniform vec4 uInstances[48 * 3];
+uniform float uGrid;
+
+out vec3 vWorldPos;
+out vec2 vUv;
+flat out vec4 vCells01;     // atlas cells of the two lower views
+flat out vec4 vCells23;
+flat out vec4 vWeights;
+flat out vec4 vRotation;
+flat out vec3 vColor;
+
+vec3 rotate(vec4 q, vec3 v) {
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+vec2 sign_not_zero(vec2 v) {
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// same mapping as oct_decode in impostor.cpp
+vec2 oct_encode(vec3 d) {
+    d /= abs(d.x) + abs(d.y) + abs(d.z);
+    vec2 p = d.xz;
+    if (d.y < 0.0) p = (1.0 - abs(p.yx)) * sign_not_zero(p);
+    return p * 0.5 + 0.5;
+}
+
+void main() {
+    vec4 center = uInstances[gl_InstanceID * 3];
+    vec4 q = uInstances[gl_InstanceID * 3 + 1];
+    vColor = uInstances[gl_InstanceID * 3 + 2].rgb;
+    vRotation = q;
+
+    // view direction in object space, and the basis the bake used for it
+    vec4 qInv = vec4(-q.xyz, q.w);
+    vec3 d = normalize(rotate(qInv, uViewPos - center.xyz));
+    vec3 up = abs(d.y) > 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+    vec3 right = normalize(cross(up, d));
+    up = cross(d, right);
+
+    // the four views around d, bilinearly weighted
+    vec2 g = oct_encode(d) * uGrid - 0.5;
+    vec2 base = floor(g);
+    vec2 f = g - base;
+    vec2 c0 = clamp(base, vec2(0.0), vec2(uGrid - 1.0));
+    vec2 c1 = clamp(base + vec2(1.0, 0.0), vec2(0.0), vec2(uGrid - 1.0));
+    vec2 c2 = clamp(base + vec2(0.0, 1.0), vec2(0.0), vec2(uGrid - 1.0));
+    vec2 c3 = clamp(base + vec2(1.0, 1.0), vec2(0.0), vec2(uGrid - 1.0));
+    vCells01 = vec4(c0, c1);
+    vCells23 = vec4(c2, c3);
+    vWeights = vec4((1.0 - f.x) * (1.0 - f.y), f.x * (1.0 - f.y), (1.0 - f.x) * f.y, f.x * f.y);
+
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    vUv = corner * 0.5 + 0.5;
+    vec3 offset = rotate(q, right * corner.x + up * corner.y) * center.w;
+    vWorldPos = center.xyz + offset;
+    gl_Position = uProj * uView * vec4(vWorldPos, 1.0);
+}
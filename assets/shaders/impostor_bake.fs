@@ -0,0 +1,9 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 vNormal;
+
+// object-space normal, alpha marks coverage
+void main() {
+    FragColor = vec4(normalize(vNormal) * 0.5 + 0.5, 1.0);
+}
@@ -0,0 +1,13 @@
+#version 330 core
+layout (location=0) in vec3 aPos;
+layout (location=1) in vec3 aNormal;
+
+// one view of the atlas, see impostor.cpp
+uniform mat4 uViewProj;
+
+out vec3 vNormal;
+
+void main() {
+    vNormal = aNormal;
+    gl_Position = uViewProj * vec4(aPos, 1.0);
+}
@@ -0,0 +1,42 @@
+#version 430 core
+// lit_shader.vs for the GPU-driven path: per-object data comes from the
+// buffers gpucull.comp fills instead of uniforms.
+layout (location=0) in vec3 aPos;
+layout (location=1) in vec3 aNormal;
+layout (location=2) in uint aObject;    // instanced, offset by baseInstance
+layout (location=3) in float aAo;
+
+layout (std140) uniform Camera {
+    mat4 uView;
+    mat4 uProj;
+    vec3 uViewPos;
+};
+
+struct Instance {
+    vec4 position;
+    vec4 rotation;
+    vec4 prevPosition;
+    vec4 prevRotation;
+    vec4 scale;
+    vec4 color;
+    uint mesh;
+    uint pad0, pad1, pad2;
+};
+
+layout (std430, binding = 0) readonly buffer Instances { Instance instances[]; };
+layout (std430, binding = 4) readonly buffer Models { mat4 models[]; };
+
+out vec3 vWorldPos;
+out vec3 vNormal;
+out vec3 vColor;
+out float vAo;
+
+void main() {
+    mat4 model = models[aObject];
+    vec4 world = model * vec4(aPos, 1.0);
+    vWorldPos = world.xyz;
+    vNormal = mat3(transpose(inverse(model))) * aNormal;
+    vColor = instances[aObject].color.rgb;
+    vAo = aAo;
+    gl_Position = uProj * uView * world;
+}
@@ -3,11 +3,17 @@ out vec4 FragColor;
 
 in vec3 vWorldPos;
 in vec3 vNormal;
+in vec3 vColor;    // shared with lit_indirect.vs
+in float vAo;      // baked ambient occlusion, 1 when unbaked
+
+layout (std140) uniform Camera {
+    mat4 uView;
+    mat4 uProj;
+    vec3 uViewPos;
+};
 
 uniform vec3 uLightPos;
-uniform vec3 uViewPos;
 
-uniform vec3 uObjectColor;
 uniform vec3 uLightColor;
 
 void main() {
@@ -16,7 +22,7 @@ void main() {
 
     // ambient
     float ambientStrength = 0.15;
-    vec3 ambient = ambientStrength * uLightColor;
+    vec3 ambient = ambientStrength * vAo * uLightColor;
 
     // diffuse
     float diff = max(dot(N, L), 0.0);
@@ -29,6 +35,6 @@ void main() {
     float specStrength = 0.6;
     vec3 specular = specStrength * spec * uLightColor;
 
-    vec3 color = (ambient + diffuse + specular) * uObjectColor;
+    vec3 color = (ambient + diffuse + specular) * vColor;
     FragColor = vec4(color, 1.0);
 }
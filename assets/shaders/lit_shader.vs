@@ -1,13 +1,25 @@
 #version 330 core
 layout (location=0) in vec3 aPos;
 layout (location=1) in vec3 aNormal;
+layout (location=3) in float aAo;     // baked, see meshcache.h
+
+// written once per frame, see scene_upload_camera
+layout (std140) uniform Camera {
+    mat4 uView;
+    mat4 uProj;
+    vec3 uViewPos;
+};
 
 uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uProj;
+uniform vec3 uObjectColor;
 
 out vec3 vWorldPos;
 out vec3 vNormal;
+out vec3 vColor;
+out float vAo;
+
+// the depth pre-pass shares this shader and must match it exactly
+invariant gl_Position;
 
 void main() {
     vec4 world = uModel * vec4(aPos, 1.0);
@@ -16,5 +28,8 @@ void main() {
     // correct normal transform
     vNormal = mat3(transpose(inverse(uModel))) * aNormal;
 
+    vColor = uObjectColor;
+    vAo = aAo;
+
     gl_Position = uProj * uView * world;
 }
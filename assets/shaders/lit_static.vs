@@ -0,0 +1,33 @@
+#version 330 core
+layout (location=0) in vec3 aPos;       // world space, see staticbatch.h
+layout (location=1) in vec3 aNormal;
+layout (location=2) in vec3 aColor;
+layout (location=3) in float aAo;
+
+// written once per frame, see scene_upload_camera
+layout (std140) uniform Camera {
+    mat4 uView;
+    mat4 uProj;
+    vec3 uViewPos;
+};
+
+uniform mat4 uModel;        // identity
+uniform vec3 uObjectColor;  // white
+
+out vec3 vWorldPos;
+out vec3 vNormal;
+out vec3 vColor;
+out float vAo;
+
+// same expression as lit_shader.vs, so the depth pre-pass matches
+invariant gl_Position;
+
+void main() {
+    vec4 world = uModel * vec4(aPos, 1.0);
+    vWorldPos = world.xyz;
+    vNormal = mat3(uModel) * aNormal;
+    vColor = uObjectColor * aColor;
+    vAo = aAo;
+
+    gl_Position = uProj * uView * world;
+}
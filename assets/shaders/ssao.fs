@@ -0,0 +1,61 @@
+#version 330 core
+// Half resolution ambient occlusion from the depth buffer. Also writes the
+// view space depth of each half-res pixel for ssao_upsample.fs.
+layout (location = 0) out float Ao;
+layout (location = 1) out float ViewZ;
+
+in vec2 vUv;
+
+uniform sampler2D uDepth;   // full resolution
+uniform mat4 uProj;
+uniform mat4 uInvProj;
+uniform float uRadius;      // view space
+uniform float uStrength;
+
+const int SAMPLES = 12;
+
+vec3 view_pos(vec2 uv) {
+    float d = texture(uDepth, uv).r;
+    vec4 p = uInvProj * vec4(vec3(uv, d) * 2.0 - 1.0, 1.0);
+    return p.xyz / p.w;
+}
+
+void main() {
+    if (texture(uDepth, vUv).r >= 1.0) {
+        // background
+        Ao = 1.0;
+        ViewZ = -1.0e6;
+        return;
+    }
+    vec3 P = view_pos(vUv);
+    ViewZ = P.z;
+
+    // normal from whichever neighbours are closer, so edges don't bleed
+    vec2 texel = 1.0 / vec2(textureSize(uDepth, 0));
+    vec3 dx0 = P - view_pos(vUv - vec2(texel.x, 0.0)), dx1 = view_pos(vUv + vec2(texel.x, 0.0)) - P;
+    vec3 dy0 = P - view_pos(vUv - vec2(0.0, texel.y)), dy1 = view_pos(vUv + vec2(0.0, texel.y)) - P;
+    vec3 dx = abs(dx0.z) < abs(dx1.z) ? dx0 : dx1;
+    vec3 dy = abs(dy0.z) < abs(dy1.z) ? dy0 : dy1;
+    vec3 N = normalize(cross(dx, dy));
+    vec3 T = normalize(cross(abs(N.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0), N));
+    vec3 B = cross(N, T);
+
+    // spiral over the hemisphere, turned per pixel by interleaved gradient noise
+    float angle = 6.2831853 * fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+    float occlusion = 0.0;
+    for (int i = 0; i < SAMPLES; i++) {
+        float t = (float(i) + 0.5) / float(SAMPLES);
+        float phi = float(i) * 2.3999632 + angle;
+        float cz = 1.0 - t;
+        float sz = sqrt(1.0 - cz * cz);
+        vec3 k = vec3(cos(phi) * sz, sin(phi) * sz, cz) * mix(0.1, 1.0, t * t);
+        vec3 S = P + (T * k.x + B * k.y + N * k.z) * uRadius;
+
+        vec4 clip = uProj * vec4(S, 1.0);
+        vec2 uv = clip.xy / clip.w * 0.5 + 0.5;
+        float sceneZ = view_pos(uv).z;
+        float range = smoothstep(0.0, 1.0, uRadius / abs(P.z - sceneZ));
+        occlusion += (sceneZ >= S.z + 0.02 * uRadius ? 1.0 : 0.0) * range;
+    }
+    Ao = clamp(1.0 - uStrength * occlusion / float(SAMPLES), 0.0, 1.0);
+}
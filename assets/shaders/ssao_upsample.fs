@@ -0,0 +1,39 @@
+#version 330 core
+// Depth-aware upsample of the half resolution occlusion: a 4x4 blur over
+// the half-res pixels around this one, ignoring those at another depth.
+out float Ao;
+
+in vec2 vUv;
+
+uniform sampler2D uAo;      // half resolution
+uniform sampler2D uAoZ;     // its view space depth
+uniform sampler2D uDepth;   // full resolution
+uniform mat4 uInvProj;
+
+void main() {
+    float d = texture(uDepth, vUv).r;
+    if (d >= 1.0) {
+        Ao = 1.0;
+        return;
+    }
+    vec4 p = uInvProj * vec4(vec3(vUv, d) * 2.0 - 1.0, 1.0);
+    float z = p.z / p.w;
+
+    ivec2 size = textureSize(uAo, 0);
+    vec2 c = vUv * vec2(size) - 0.5;
+    ivec2 base = ivec2(floor(c)) - 1;
+    vec2 f = c - floor(c);
+    float sum = 0.0, weights = 0.0;
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            ivec2 at = clamp(base + ivec2(x, y), ivec2(0), size - 1);
+            vec2 offset = vec2(x, y) - 1.0 - f;
+            float spatial = exp(-0.5 * dot(offset, offset));
+            float tz = texelFetch(uAoZ, at, 0).r;
+            float w = spatial * exp(-abs(tz - z) * 32.0 / max(abs(z), 0.001)) + 1.0e-5;
+            sum += texelFetch(uAo, at, 0).r * w;
+            weights += w;
+        }
+    }
+    Ao = sum / weights;
+}
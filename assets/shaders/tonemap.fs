@@ -0,0 +1,31 @@
+#version 330 core
+// HDR scene color to display range, with occlusion and bloom applied first.
+out vec4 FragColor;
+
+in vec2 vUv;
+
+uniform sampler2D uHdr;
+uniform sampler2D uAo;      // full resolution
+uniform sampler2D uBloom;   // half resolution
+uniform bool uUseAo;
+uniform bool uUseBloom;
+uniform float uBloomStrength;
+uniform float uExposure;
+uniform int uOperator;      // Tonemapper in postprocess.h
+uniform bool uLumaAlpha;    // for fxaa.fs
+
+vec3 aces(vec3 x) {
+    // Narkowicz's fit of the ACES filmic curve
+    return clamp((x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14), 0.0, 1.0);
+}
+
+void main() {
+    vec3 c = texture(uHdr, vUv).rgb;
+    if (uUseAo) c *= texture(uAo, vUv).r;
+    if (uUseBloom) c += uBloomStrength * texture(uBloom, vUv).rgb;
+    c *= uExposure;
+    if (uOperator == 1) c = c / (1.0 + c);
+    else if (uOperator == 2) c = aces(c);
+    c = clamp(c, 0.0, 1.0);
+    FragColor = vec4(c, uLumaAlpha ? dot(c, vec3(0.299, 0.587, 0.114)) : 1.0);
+}
@@ -0,0 +1,30 @@
+#version 450
+// lit_shader.fs for the Vulkan backend (vkbackend.h), white light
+layout (location=0) in vec3 vWorldPos;
+layout (location=1) in vec3 vNormal;
+layout (location=2) in vec3 vColor;
+layout (location=3) in float vAo;
+
+layout (location=0) out vec4 FragColor;
+
+layout (std140, set=0, binding=0) uniform Camera {
+    mat4 uView;
+    mat4 uProj;
+    vec4 uViewPos;
+    vec4 uLightPos;
+};
+
+void main() {
+    vec3 N = normalize(vNormal);
+    vec3 L = normalize(uLightPos.xyz - vWorldPos);
+
+    float ambient = 0.15 * vAo;
+    float diff = max(dot(N, L), 0.0);
+
+    // Blinn-Phong
+    vec3 V = normalize(uViewPos.xyz - vWorldPos);
+    vec3 H = normalize(L + V);
+    float spec = 0.6 * pow(max(dot(N, H), 0.0), 64.0);
+
+    FragColor = vec4((ambient + diff + spec) * vColor, 1.0);
+}
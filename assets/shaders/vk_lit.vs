@@ -0,0 +1,41 @@
+#version 450
+// lit_shader.vs for the Vulkan backend (vkbackend.h), mesh layout
+layout (location=0) in vec3 aPos;
+layout (location=1) in vec3 aNormal;
+layout (location=3) in float aAo;
+
+layout (std140, set=0, binding=0) uniform Camera {
+    mat4 uView;
+    mat4 uProj;
+    vec4 uViewPos;
+    vec4 uLightPos;
+};
+
+struct Draw {
+    mat4 model;
+    vec4 color;
+};
+
+// one per draw, picked by its first instance
+layout (std430, set=0, binding=1) readonly buffer Draws {
+    Draw uDraws[];
+};
+
+layout (location=0) out vec3 vWorldPos;
+layout (location=1) out vec3 vNormal;
+layout (location=2) out vec3 vColor;
+layout (location=3) out float vAo;
+
+void main() {
+    Draw d = uDraws[gl_InstanceIndex];
+    vec4 world = d.model * vec4(aPos, 1.0);
+    vWorldPos = world.xyz;
+    vNormal = mat3(transpose(inverse(d.model))) * aNormal;
+    vColor = d.color.rgb;
+    vAo = aAo;
+
+    // GL's projection: depth from -1..1 to Vulkan's 0..1. y stays up, so
+    // image rows come out bottom first like GL's
+    gl_Position = uProj * uView * world;
+    gl_Position.z = 0.5 * (gl_Position.z + gl_Position.w);
+}
@@ -0,0 +1,39 @@
+#version 450
+// lit_static.vs for the Vulkan backend (vkbackend.h), batch layout
+layout (location=0) in vec3 aPos;       // world space, see staticbatch.h
+layout (location=1) in vec3 aNormal;
+layout (location=2) in vec3 aColor;
+layout (location=3) in float aAo;
+
+layout (std140, set=0, binding=0) uniform Camera {
+    mat4 uView;
+    mat4 uProj;
+    vec4 uViewPos;
+    vec4 uLightPos;
+};
+
+struct Draw {
+    mat4 model;     // identity
+    vec4 color;     // white
+};
+
+layout (std430, set=0, binding=1) readonly buffer Draws {
+    Draw uDraws[];
+};
+
+layout (location=0) out vec3 vWorldPos;
+layout (location=1) out vec3 vNormal;
+layout (location=2) out vec3 vColor;
+layout (location=3) out float vAo;
+
+void main() {
+    Draw d = uDraws[gl_InstanceIndex];
+    vec4 world = d.model * vec4(aPos, 1.0);
+    vWorldPos = world.xyz;
+    vNormal = mat3(d.model) * aNormal;
+    vColor = d.color.rgb * aColor;
+    vAo = aAo;
+
+    gl_Position = uProj * uView * world;
+    gl_Position.z = 0.5 * (gl_Position.z + gl_Position.w);
+}
@@ -0,0 +1,70 @@
+# Headless frame-time regression suite (-DMYGL_PERF_TESTS=ON, then ctest).
+#
+# Each case plays a recorded camera path over a reference scene with
+# `mygl --play`, rendering through Mesa llvmpipe in a hidden window (under
+# xvfb-run when it's installed), and compares per-frame CPU submit time, GPU
+# time, allocation counts and image hashes against a stored baseline with
+# perfcompare. A case with no baseline yet records one and is reported as
+# skipped, since nothing was compared; no baselines are checked in, so the
+# first run on each machine only records.
+#
+# Timings are only comparable on the machine that recorded the baseline; set
+# MYGL_PERF_BASELINE_DIR per machine and MYGL_PERF_UPDATE_BASELINES=ON to
+# re-record after an intended change.
+
+set(MYGL_PERF_BASELINE_DIR ${CMAKE_SOURCE_DIR}/perf/baselines CACHE PATH
+    "Where perf baselines are read from and recorded to")
+set(MYGL_PERF_TOLERANCE 15 CACHE STRING
+    "Allowed slowdown of median/p95 timings, in percent")
+set(MYGL_PERF_ALLOC_TOLERANCE 0 CACHE STRING
+    "Allowed growth of per-frame heap allocations, in percent")
+set(MYGL_PERF_ALLOC_SLACK 2 CACHE STRING
+    "Per-frame heap allocations the candidate may add regardless of the percentage")
+option(MYGL_PERF_UPDATE_BASELINES "Overwrite baselines with the next run" OFF)
+
+find_program(XVFB_RUN xvfb-run)
+
+# mygl_perf_case(<name> <camera path> [mygl args...])
+function(mygl_perf_case name path)
+    string(REPLACE ";" "|" args "${ARGN}")
+    add_test(NAME perf_${name}
+        COMMAND ${CMAKE_COMMAND}
+            -DNAME=${name}
+            -DMYGL=$<TARGET_FILE:mygl>
+            -DPERFCOMPARE=$<TARGET_FILE:perfcompare>
+            -DWORKDIR=$<TARGET_FILE_DIR:mygl>
+            -DCAMERA_PATH=${CMAKE_SOURCE_DIR}/perf/paths/${path}
+            -DARGS=${args}
+            -DOUT_DIR=${CMAKE_BINARY_DIR}/perf
+            -DBASELINE_DIR=${MYGL_PERF_BASELINE_DIR}
+            -DTOLERANCE=${MYGL_PERF_TOLERANCE}
+            -DALLOC_TOLERANCE=${MYGL_PERF_ALLOC_TOLERANCE}
+            -DALLOC_SLACK=${MYGL_PERF_ALLOC_SLACK}
+            -DUPDATE=${MYGL_PERF_UPDATE_BASELINES}
+            -DXVFB_RUN=${XVFB_RUN}
+            -P ${CMAKE_SOURCE_DIR}/perf/runperf.cmake)
+    set_tests_properties(perf_${name} PROPERTIES
+        LABELS perf
+        TIMEOUT 900
+        RUN_SERIAL ON
+        ENVIRONMENT "LIBGL_ALWAYS_SOFTWARE=1;GALLIUM_DRIVER=llvmpipe")
+    if(NOT CMAKE_VERSION VERSION_LESS 3.16)
+        set_tests_properties(perf_${name} PROPERTIES SKIP_REGULAR_EXPRESSION "nothing was compared")
+    endif()
+endfunction()
+
+mygl_perf_case(default_orbit  default_orbit.cam  assets/scenes/default.scn)
+mygl_perf_case(grid_10k       grid_flyover.cam   --generate 10000 --layout grid)
+mygl_perf_case(clusters_100k  clusters_dolly.cam --generate 100000 --layout clustered --motion)
+
+# The same scene through the CPU rasterizer; against grid_10k it is the
+# software backend's throughput next to llvmpipe's:
+#   perfcompare perf/grid_10k.csv perf/grid_10k_software.csv
+mygl_perf_case(grid_10k_software grid_flyover.cam --generate 10000 --layout grid --software)
+
+# GL against Vulkan on the 100k-object scene, submit_ms being the CPU cost
+# of the draws (MYGL_VULKAN builds; lavapipe via VK_ICD_FILENAMES):
+#   perfcompare perf/clusters_100k.csv perf/clusters_100k_vulkan.csv
+if(MYGL_VULKAN)
+    mygl_perf_case(clusters_100k_vulkan clusters_dolly.cam --generate 100000 --layout clustered --motion --vulkan)
+endif()
@@ -0,0 +1,37 @@
+# Runs one perf case; see perf.cmake. Invoked by ctest with cmake -P.
+
+string(REPLACE "|" ";" ARGS "${ARGS}")
+file(MAKE_DIRECTORY ${OUT_DIR})
+set(out ${OUT_DIR}/${NAME}.csv)
+set(baseline ${BASELINE_DIR}/${NAME}.csv)
+
+set(cmd ${MYGL} ${ARGS} --headless --play ${CAMERA_PATH} --play-out ${out} --hash-every 30)
+if(XVFB_RUN)
+    set(cmd ${XVFB_RUN} -a ${cmd})
+endif()
+execute_process(COMMAND ${cmd} WORKING_DIRECTORY ${WORKDIR} RESULT_VARIABLE rc)
+if(NOT rc EQUAL 0)
+    message(FATAL_ERROR "${NAME}: playback failed (${rc})")
+endif()
+
+if(UPDATE OR NOT EXISTS ${baseline})
+    file(MAKE_DIRECTORY ${BASELINE_DIR})
+    if(UPDATE)
+        set(why "re-recorded")
+    else()
+        set(why "no baseline yet, recorded")
+    endif()
+    configure_file(${out} ${baseline} COPYONLY)
+    message(WARNING "${NAME}: ${why} ${baseline}; nothing was compared")
+    return()
+endif()
+
+execute_process(
+    COMMAND ${PERFCOMPARE} ${baseline} ${out}
+            --threshold ${TOLERANCE}
+            --tolerance allocs=${ALLOC_TOLERANCE}
+            --slack allocs=${ALLOC_SLACK}
+    RESULT_VARIABLE rc)
+if(NOT rc EQUAL 0)
+    message(FATAL_ERROR "${NAME}: slower than or different from ${baseline}")
+endif()
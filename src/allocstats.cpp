@@ -0,0 +1,31 @@
+#include "allocstats.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<uint64_t> g_allocations{0};
+
+uint64_t allocstats_count()
+{
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+// The array and nothrow forms default to calling this one, and the matching
+// deletes end up in the ones below.
+void* operator new(std::size_t bytes)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(bytes ? bytes : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
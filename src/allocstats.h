@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstdint>
+
+// Number of heap allocations made through global operator new since start-up.
+// Cheap enough to leave on; the perf suite reports it per frame so a change
+// that starts allocating in the render loop shows up as a regression.
+uint64_t allocstats_count();
@@ -0,0 +1,228 @@
+#include "aobake.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "gpuresources.h"
+#include "meshcache.h"
+
+static const uint32_t AO_LEAF_TRIANGLES = 4;
+static const int AO_TASK_VERTICES = 64;     // distinct vertices per job task
+static const int AO_STACK = 64;             // median splits stay far shallower
+
+struct BvhNode
+{
+    glm::vec3 lo, hi;
+    uint32_t first;     // leaf: first entry of tris; inner: the right child, the left one follows this node
+    uint32_t count;     // triangles, 0 for inner nodes
+};
+
+struct Bvh
+{
+    std::vector<BvhNode> nodes;
+    std::vector<uint32_t> tris;         // triangle numbers, each leaf owns a range
+    std::vector<glm::vec3> corners;     // three per triangle
+};
+
+struct AoBakeJob
+{
+    const Bvh *bvh;
+    std::vector<std::array<float, 6>> points;   // distinct position + normal pairs
+    std::vector<float> ao;
+    int rays;
+    float maxDistance;
+    float epsilon;      // origin offset and nearest hit, against self-intersection
+};
+
+// Median split along the widest axis of the triangle centroids.
+static uint32_t build_node(Bvh *bvh, const std::vector<glm::vec3> &centroids, uint32_t first, uint32_t count)
+{
+    const uint32_t index = (uint32_t)bvh->nodes.size();
+    bvh->nodes.emplace_back();
+    glm::vec3 lo(INFINITY), hi(-INFINITY), clo(INFINITY), chi(-INFINITY);
+    for (uint32_t i = first; i < first + count; i++) {
+        const uint32_t t = bvh->tris[i];
+        for (int k = 0; k < 3; k++) {
+            lo = glm::min(lo, bvh->corners[3 * t + k]);
+            hi = glm::max(hi, bvh->corners[3 * t + k]);
+        }
+        clo = glm::min(clo, centroids[t]);
+        chi = glm::max(chi, centroids[t]);
+    }
+    if (count <= AO_LEAF_TRIANGLES) {
+        bvh->nodes[index] = {lo, hi, first, count};
+        return index;
+    }
+
+    const glm::vec3 extent = chi - clo;
+    const int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+    const uint32_t half = count / 2;
+    auto begin = bvh->tris.begin() + first;
+    std::nth_element(begin, begin + half, begin + count, [&centroids, axis](uint32_t a, uint32_t b) {
+        return centroids[a][axis] < centroids[b][axis];
+    });
+    build_node(bvh, centroids, first, half);
+    const uint32_t right = build_node(bvh, centroids, first + half, count - half);
+    bvh->nodes[index] = {lo, hi, right, 0};
+    return index;
+}
+
+static bool hit_box(const BvhNode &n, glm::vec3 o, glm::vec3 invD, float tMax)
+{
+    const glm::vec3 t0 = (n.lo - o) * invD, t1 = (n.hi - o) * invD;
+    const glm::vec3 tn = glm::min(t0, t1), tf = glm::max(t0, t1);
+    const float enter = std::max(std::max(tn.x, tn.y), std::max(tn.z, 0.0f));
+    const float exit = std::min(std::min(tf.x, tf.y), std::min(tf.z, tMax));
+    return enter <= exit;
+}
+
+// Möller-Trumbore, both sides.
+static bool hit_triangle(const glm::vec3 *c, glm::vec3 o, glm::vec3 d, float tMin, float tMax)
+{
+    const glm::vec3 e1 = c[1] - c[0], e2 = c[2] - c[0];
+    const glm::vec3 p = glm::cross(d, e2);
+    const float det = glm::dot(e1, p);
+    if (std::fabs(det) < 1e-12f) return false;
+    const float inv = 1.0f / det;
+    const glm::vec3 s = o - c[0];
+    const float u = glm::dot(s, p) * inv;
+    if (u < 0.0f || u > 1.0f) return false;
+    const glm::vec3 q = glm::cross(s, e1);
+    const float v = glm::dot(d, q) * inv;
+    if (v < 0.0f || u + v > 1.0f) return false;
+    const float t = glm::dot(e2, q) * inv;
+    return t > tMin && t < tMax;
+}
+
+// Any hit, not the nearest.
+static bool occluded(const Bvh *bvh, glm::vec3 o, glm::vec3 d, float tMin, float tMax)
+{
+    glm::vec3 invD;
+    for (int k = 0; k < 3; k++) invD[k] = 1.0f / (std::fabs(d[k]) > 1e-12f ? d[k] : 1e-12f);
+    uint32_t stack[AO_STACK];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const uint32_t index = stack[--top];
+        const BvhNode &n = bvh->nodes[index];
+        if (!hit_box(n, o, invD, tMax)) continue;
+        if (n.count) {
+            for (uint32_t i = n.first; i < n.first + n.count; i++) {
+                if (hit_triangle(&bvh->corners[3 * bvh->tris[i]], o, d, tMin, tMax)) return true;
+            }
+        } else if (top + 2 <= AO_STACK) {
+            stack[top++] = n.first;
+            stack[top++] = index + 1;
+        }
+    }
+    return false;
+}
+
+static float radical_inverse(uint32_t bits)
+{
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return bits * 2.3283064365386963e-10f;
+}
+
+static float hash_unit(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x * 2.3283064365386963e-10f;
+}
+
+static void bake_task(void *context, int task)
+{
+    AoBakeJob *job = (AoBakeJob*)context;
+    const int end = std::min((task + 1) * AO_TASK_VERTICES, (int)job->points.size());
+    for (int i = task * AO_TASK_VERTICES; i < end; i++) {
+        const float *pt = job->points[i].data();
+        const glm::vec3 p(pt[0], pt[1], pt[2]);
+        glm::vec3 n(pt[3], pt[4], pt[5]);
+        const float len = glm::length(n);
+        if (len < 1e-6f) {
+            job->ao[i] = 1.0f;
+            continue;
+        }
+        n = n / len;
+        const glm::vec3 t = glm::normalize(glm::cross(std::fabs(n.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f)
+                                                                             : glm::vec3(1.0f, 0.0f, 0.0f), n));
+        const glm::vec3 b = glm::cross(n, t);
+        const glm::vec3 origin = p + n * job->epsilon;
+
+        // Hammersley points shifted per vertex (Cranley-Patterson rotation),
+        // mapped to a cosine-weighted hemisphere
+        const float shiftU = hash_unit(2 * i + 1), shiftV = hash_unit(2 * i + 2);
+        int open = 0;
+        for (int r = 0; r < job->rays; r++) {
+            const float u = std::fmod((r + 0.5f) / job->rays + shiftU, 1.0f);
+            const float v = std::fmod(radical_inverse(r) + shiftV, 1.0f);
+            const float phi = 6.2831853f * u, s = std::sqrt(v);
+            const glm::vec3 d = t * (s * std::cos(phi)) + b * (s * std::sin(phi)) + n * std::sqrt(1.0f - v);
+            if (!occluded(job->bvh, origin, d, job->epsilon, job->maxDistance)) open++;
+        }
+        job->ao[i] = (float)open / job->rays;
+    }
+}
+
+void aobake_run(JobPool *jobs, float *vertices, int vertexCount, int rays, AoBakeStats *stats)
+{
+    const int triangles = vertexCount / 3;
+    if (triangles == 0 || rays <= 0) return;
+    auto t0 = std::chrono::steady_clock::now();
+
+    Bvh bvh;
+    std::vector<glm::vec3> centroids(triangles);
+    bvh.corners.resize((size_t)triangles * 3);
+    bvh.tris.resize(triangles);
+    glm::vec3 lo(INFINITY), hi(-INFINITY);
+    for (int t = 0; t < triangles; t++) {
+        for (int k = 0; k < 3; k++) {
+            const float *v = vertices + (size_t)(3 * t + k) * MESH_VERTEX_FLOATS;
+            bvh.corners[3 * t + k] = glm::vec3(v[0], v[1], v[2]);
+            lo = glm::min(lo, bvh.corners[3 * t + k]);
+            hi = glm::max(hi, bvh.corners[3 * t + k]);
+        }
+        centroids[t] = (bvh.corners[3 * t] + bvh.corners[3 * t + 1] + bvh.corners[3 * t + 2]) / 3.0f;
+        bvh.tris[t] = t;
+    }
+    bvh.nodes.reserve(2 * triangles);
+    build_node(&bvh, centroids, 0, triangles);
+
+    // corners shared by flat faces bake once; occlusion isn't known yet, so
+    // only position and normal are compared
+    AoBakeJob job;
+    std::vector<uint32_t> pointOf, firsts;
+    meshcache_weld(vertices, vertexCount, 6, &pointOf, &firsts);
+    job.points.resize(firsts.size());
+    for (size_t p = 0; p < firsts.size(); p++)
+        std::copy_n(vertices + (size_t)firsts[p] * MESH_VERTEX_FLOATS, 6, job.points[p].begin());
+    const float diagonal = glm::length(hi - lo);
+    job.bvh = &bvh;
+    job.ao.resize(job.points.size());
+    job.rays = rays;
+    job.maxDistance = 0.5f * diagonal;
+    job.epsilon = std::max(1e-4f * diagonal, 1e-6f);
+
+    const int tasks = ((int)job.points.size() + AO_TASK_VERTICES - 1) / AO_TASK_VERTICES;
+    if (jobs) jobs_run(jobs, tasks, bake_task, &job);
+    else for (int t = 0; t < tasks; t++) bake_task(&job, t);
+
+    for (int v = 0; v < vertexCount; v++)
+        vertices[(size_t)v * MESH_VERTEX_FLOATS + MESH_VERTEX_FLOATS - 1] = job.ao[pointOf[v]];
+    stats->vertices += (int)job.points.size();
+    stats->rays += (uint64_t)job.points.size() * rays;
+    stats->seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+#include "jobs.h"
+
+// Per-vertex ambient occlusion, baked on the CPU. Each distinct position +
+// normal pair casts cosine-weighted rays over its hemisphere against a BVH
+// of the mesh's own triangles; its occlusion is the fraction that escape
+// within half the mesh's bounding box diagonal. Ray directions come from a
+// Hammersley set turned per vertex, so the same mesh always bakes the same.
+
+struct AoBakeStats
+{
+    int vertices;       // distinct ones, each baked once
+    uint64_t rays;
+    double seconds;
+};
+
+// `vertices` are triangles in the mesh layout (gpuresources.h); fills the
+// occlusion float of each. Runs on `jobs`, or on the calling thread if it
+// is null. Adds to `stats`.
+void aobake_run(JobPool *jobs, float *vertices, int vertexCount, int rays, AoBakeStats *stats);
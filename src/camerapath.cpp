@@ -0,0 +1,54 @@
+#include "camerapath.h"
+
+#include <cstdio>
+
+void camerapath_record(CameraPath *path, const OrbitCamera *camera)
+{
+    path->keys.push_back({camera->target, camera->distance, camera->yaw, camera->pitch});
+}
+
+void camerapath_apply(const CameraPath *path, size_t frame, OrbitCamera *camera)
+{
+    if (path->keys.empty()) return;
+    const CameraKey &k = path->keys[frame < path->keys.size() ? frame : path->keys.size() - 1];
+    camera->target = k.target;
+    camera->distance = k.distance;
+    camera->yaw = k.yaw;
+    camera->pitch = k.pitch;
+    orbitcamera_invalidate(camera);
+}
+
+bool camerapath_save(const CameraPath *path, const std::string &file)
+{
+    FILE *f = std::fopen(file.c_str(), "w");
+    if (!f) return false;
+    std::fprintf(f, "camerapath 1\ndt %.17g\n", path->dt);
+    for (const CameraKey &k : path->keys) {
+        std::fprintf(f, "%.9g %.9g %.9g %.9g %.9g %.9g\n",
+            k.target.x, k.target.y, k.target.z, k.distance, k.yaw, k.pitch);
+    }
+    return std::fclose(f) == 0;
+}
+
+bool camerapath_load(CameraPath *path, const std::string &file)
+{
+    FILE *f = std::fopen(file.c_str(), "r");
+    if (!f) return false;
+
+    CameraPath loaded;
+    int version = 0;
+    bool ok = std::fscanf(f, "camerapath %d dt %lf", &version, &loaded.dt) == 2 && version == 1 && loaded.dt > 0.0;
+    CameraKey k;
+    while (ok && std::fscanf(f, "%f %f %f %f %f %f",
+               &k.target.x, &k.target.y, &k.target.z, &k.distance, &k.yaw, &k.pitch) == 6) {
+        loaded.keys.push_back(k);
+    }
+    ok = ok && std::feof(f);
+    std::fclose(f);
+    if (!ok) {
+        std::fprintf(stderr, "%s: not a camera path\n", file.c_str());
+        return false;
+    }
+    *path = std::move(loaded);
+    return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+#include "orbitcamera.h"
+
+// Recorded camera flythrough for repeatable perf runs: one OrbitCamera state
+// per frame, played back one key per frame with time advancing by a fixed
+// `dt`, so every run renders exactly the same frames regardless of how fast
+// the machine is.
+//
+// File format (text, floats round-trip exactly):
+//
+//   camerapath 1
+//   dt <seconds>
+//   <target x y z> <distance> <yaw> <pitch>      one line per frame
+
+struct CameraKey
+{
+    glm::vec3 target;
+    float distance;
+    float yaw;
+    float pitch;
+};
+
+struct CameraPath
+{
+    std::vector<CameraKey> keys;
+    double dt = 1.0 / 60.0;
+};
+
+void camerapath_record(CameraPath *path, const OrbitCamera *camera);
+
+// Frames past the end hold the last key.
+void camerapath_apply(const CameraPath *path, size_t frame, OrbitCamera *camera);
+
+bool camerapath_save(const CameraPath *path, const std::string &file);
+
+bool camerapath_load(CameraPath *path, const std::string &file);
@@ -0,0 +1,252 @@
+#include "cmdbuffer.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#include "occlusion.h"
+
+void cmdlist_reset(CmdList *list, int bufferCount)
+{
+    if ((int)list->buffers.size() < bufferCount) list->buffers.resize(bufferCount);
+    for (CmdBuffer &cb : list->buffers) {
+        cb.used = 0;
+        cb.segments.clear();
+    }
+}
+
+void cmdbuffer_begin_segment(CmdBuffer *cb, uint64_t key, GLuint prog, GLuint vbo, GLuint ebo)
+{
+    cmdbuffer_finish(cb);
+    cb->segments.push_back({key, (uint32_t)cb->used, (uint32_t)cb->used, prog, vbo, ebo});
+}
+
+void cmdbuffer_finish(CmdBuffer *cb)
+{
+    if (!cb->segments.empty()) cb->segments.back().end = (uint32_t)cb->used;
+}
+
+void cmdbuffer_push(CmdBuffer *cb, CmdType type, const void *payload, size_t bytes)
+{
+    const size_t need = cb->used + sizeof(uint32_t) + bytes;
+    if (need > cb->bytes.size()) cb->bytes.resize(std::max(need, cb->bytes.size() * 2));
+    unsigned char *dst = cb->bytes.data() + cb->used;
+    const uint32_t header = type;
+    std::memcpy(dst, &header, sizeof(header));
+    std::memcpy(dst + sizeof(header), payload, bytes);
+    cb->used = need;
+}
+
+void cmdbuffer_draw_impostors(CmdBuffer *cb, GLuint atlas, const glm::vec4 *instances, int count)
+{
+    const CmdDrawImpostors c = {atlas, count};
+    const size_t data = (size_t)count * CMD_IMPOSTOR_VEC4S * sizeof(glm::vec4);
+    cmdbuffer_push(cb, CMD_DRAW_IMPOSTORS, &c, sizeof(c));
+    if (cb->used + data > cb->bytes.size()) cb->bytes.resize(std::max(cb->used + data, cb->bytes.size() * 2));
+    std::memcpy(cb->bytes.data() + cb->used, instances, data);
+    cb->used += data;
+}
+
+size_t cmdbuffer_impostor_bytes(const CmdDrawImpostors *c)
+{
+    return sizeof(*c) + (size_t)c->count * CMD_IMPOSTOR_VEC4S * sizeof(glm::vec4);
+}
+
+size_t cmdlist_bytes(const CmdList *list)
+{
+    size_t bytes = 0;
+    for (const CmdBuffer &cb : list->buffers) bytes += cb.used;
+    return bytes;
+}
+
+void cmdlist_sort(CmdList *list)
+{
+    list->order.clear();
+    for (uint32_t b = 0; b < list->buffers.size(); b++) {
+        const std::vector<CmdSegment> &segments = list->buffers[b].segments;
+        for (uint32_t s = 0; s < segments.size(); s++) list->order.push_back({segments[s].key, b, s});
+    }
+    // buffers hold consecutive ranges of the scene, so ties keep scene order
+    std::sort(list->order.begin(), list->order.end(), [](const CmdSegmentRef &a, const CmdSegmentRef &b) {
+        if (a.key != b.key) return a.key < b.key;
+        if (a.buffer != b.buffer) return a.buffer < b.buffer;
+        return a.segment < b.segment;
+    });
+}
+
+// Positions only: binds and per-draw data other than the model matrix are
+// skipped, and so are objects the occlusion culler holds back.
+static void replay_depth(const CmdList *list, GLuint depthProg, CmdVertexArrayFn vertexArray, void *user,
+                         OcclusionCuller *occlusion)
+{
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glUseProgram(depthProg);
+    const GLint locModel = glGetUniformLocation(depthProg, "uModel");
+    GLuint vao = 0;
+    const CmdDrawData *data = nullptr;
+    for (const CmdSegmentRef &ref : list->order) {
+        const CmdBuffer &cb = list->buffers[ref.buffer];
+        const CmdSegment &seg = cb.segments[ref.segment];
+        const unsigned char *p = cb.bytes.data() + seg.begin;
+        const unsigned char *end = cb.bytes.data() + seg.end;
+        while (p < end) {
+            uint32_t type;
+            std::memcpy(&type, p, sizeof(type));
+            p += sizeof(type);
+            switch (type) {
+            case CMD_BIND_PROGRAM:
+                p += sizeof(CmdBindProgram);
+                break;
+            case CMD_BIND_GEOMETRY: {
+                const CmdBindGeometry *c = (const CmdBindGeometry*)p;
+                GLuint v = vertexArray ? vertexArray(user, *c) : c->vao;
+                if (v != vao) {
+                    vao = v;
+                    glBindVertexArray(vao);
+                }
+                p += sizeof(*c);
+                break;
+            }
+            case CMD_DRAW_DATA:
+                data = (const CmdDrawData*)p;
+                glUniformMatrix4fv(locModel, 1, GL_FALSE, glm::value_ptr(data->model));
+                p += sizeof(*data);
+                break;
+            case CMD_DRAW: {
+                const CmdDraw *c = (const CmdDraw*)p;
+                if (!occlusion || !occlusion_hidden(occlusion, data->object))
+                    glDrawArrays(GL_TRIANGLES, c->first, c->count);
+                p += sizeof(*c);
+                break;
+            }
+            case CMD_DRAW_INDEXED: {
+                const CmdDrawIndexed *c = (const CmdDrawIndexed*)p;
+                glDrawElements(GL_TRIANGLES, c->count, GL_UNSIGNED_INT, (void*)((size_t)c->first * sizeof(uint32_t)));
+                p += sizeof(*c);
+                break;
+            }
+            case CMD_DRAW_IMPOSTORS:
+                p += cmdbuffer_impostor_bytes((const CmdDrawImpostors*)p);
+                break;
+            default:
+                p = end;
+                break;
+            }
+        }
+    }
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+void cmdlist_replay(CmdList *list, glm::vec3 lightPos, CmdVertexArrayFn vertexArray, void *user,
+                    OcclusionCuller *occlusion, GLuint depthProg)
+{
+    cmdlist_sort(list);
+    if (depthProg) {
+        replay_depth(list, depthProg, vertexArray, user, occlusion);
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+    }
+
+    const glm::vec3 lightColor(1.0f, 1.0f, 1.0f);
+    GLuint prog = 0, vao = 0;
+    GLint locModel = -1, locObjCol = -1, locInstances = -1;
+    const CmdBindGeometry *geometry = nullptr;
+    const CmdDrawData *data = nullptr;
+    for (const CmdSegmentRef &ref : list->order) {
+        const CmdBuffer &cb = list->buffers[ref.buffer];
+        const CmdSegment &seg = cb.segments[ref.segment];
+        const unsigned char *p = cb.bytes.data() + seg.begin;
+        const unsigned char *end = cb.bytes.data() + seg.end;
+        while (p < end) {
+            uint32_t type;
+            std::memcpy(&type, p, sizeof(type));
+            p += sizeof(type);
+            switch (type) {
+            case CMD_BIND_PROGRAM: {
+                const CmdBindProgram *c = (const CmdBindProgram*)p;
+                if (c->prog != prog) {
+                    // uniforms are program state, so locations and light go with it
+                    prog = c->prog;
+                    glUseProgram(prog);
+                    locModel = glGetUniformLocation(prog, "uModel");
+                    locObjCol = glGetUniformLocation(prog, "uObjectColor");
+                    locInstances = glGetUniformLocation(prog, "uInstances");
+                    glUniform3fv(glGetUniformLocation(prog, "uLightPos"), 1, glm::value_ptr(lightPos));
+                    glUniform3fv(glGetUniformLocation(prog, "uLightColor"), 1, glm::value_ptr(lightColor));
+                }
+                p += sizeof(*c);
+                break;
+            }
+            case CMD_BIND_GEOMETRY: {
+                const CmdBindGeometry *c = (const CmdBindGeometry*)p;
+                geometry = c;
+                GLuint v = vertexArray ? vertexArray(user, *c) : c->vao;
+                if (v != vao) {
+                    vao = v;
+                    glBindVertexArray(vao);
+                }
+                p += sizeof(*c);
+                break;
+            }
+            case CMD_DRAW_DATA: {
+                const CmdDrawData *c = (const CmdDrawData*)p;
+                data = c;
+                glUniformMatrix4fv(locModel, 1, GL_FALSE, glm::value_ptr(c->model));
+                glUniform3fv(locObjCol, 1, glm::value_ptr(c->color));
+                p += sizeof(*c);
+                break;
+            }
+            case CMD_DRAW: {
+                const CmdDraw *c = (const CmdDraw*)p;
+                if (!occlusion) {
+                    glDrawArrays(GL_TRIANGLES, c->first, c->count);
+                } else if (occlusion_hidden(occlusion, data->object)) {
+                    occlusion_defer(occlusion, {prog, locModel, locObjCol, vao, geometry->boundsMin,
+                                                geometry->boundsMax, data, *c, 0});
+                } else {
+                    GLuint query = occlusion_visible_query(occlusion, data->object);
+                    if (query) glBeginQuery(GL_ANY_SAMPLES_PASSED, query);
+                    glDrawArrays(GL_TRIANGLES, c->first, c->count);
+                    if (query) glEndQuery(GL_ANY_SAMPLES_PASSED);
+                }
+                p += sizeof(*c);
+                break;
+            }
+            case CMD_DRAW_INDEXED: {
+                const CmdDrawIndexed *c = (const CmdDrawIndexed*)p;
+                glDrawElements(GL_TRIANGLES, c->count, GL_UNSIGNED_INT, (void*)((size_t)c->first * sizeof(uint32_t)));
+                p += sizeof(*c);
+                break;
+            }
+            case CMD_DRAW_IMPOSTORS: {
+                const CmdDrawImpostors *c = (const CmdDrawImpostors*)p;
+                if (depthProg) {
+                    glDepthFunc(GL_LESS);
+                    glDepthMask(GL_TRUE);
+                }
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, c->atlas);
+                glUniform4fv(locInstances, c->count * CMD_IMPOSTOR_VEC4S, (const float*)(c + 1));
+                glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, c->count);
+                if (depthProg) {
+                    glDepthFunc(GL_EQUAL);
+                    glDepthMask(GL_FALSE);
+                }
+                p += cmdbuffer_impostor_bytes(c);
+                break;
+            }
+            default:
+                p = end;
+                break;
+            }
+        }
+    }
+    if (depthProg) {
+        // held-back objects are missing from the pre-pass depth
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
+    if (occlusion) occlusion_flush(occlusion);
+    glBindVertexArray(0);
+}
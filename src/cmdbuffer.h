@@ -0,0 +1,154 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "gpuresources.h"
+
+struct OcclusionCuller;
+
+// Draw commands recorded into plain byte arenas by any thread and replayed
+// by the one that owns the GL context.
+//
+// A buffer is a sequence of segments, each starting with the state it needs
+// (program, geometry) followed by per-draw data and draws. Every segment has
+// a sort key; replay merges the segments of all buffers in a list by key, so
+// threads can record disjoint ranges of the scene independently and still
+// be drawn grouped by state, in the same order whatever the thread count.
+//
+// Commands name resources by handle and also carry the GL names resolved
+// at record time, so replay never touches the resource pools.
+
+enum CmdType : uint32_t
+{
+    CMD_BIND_PROGRAM,
+    CMD_BIND_GEOMETRY,
+    CMD_DRAW_DATA,      // per-draw uniforms for the draws that follow
+    CMD_DRAW,
+    CMD_DRAW_INDEXED,   // static batches; never held back by occlusion
+    CMD_DRAW_IMPOSTORS, // instanced quads, see impostor.h
+};
+
+struct CmdBindProgram
+{
+    ProgramHandle program;
+    GLuint prog;
+};
+
+struct CmdBindGeometry
+{
+    MeshHandle mesh;
+    GLuint vao;         // only valid in the context that created the mesh
+    GLuint vbo;
+    GLuint ebo;         // 0 unless indexed
+    int32_t stride;     // floats per vertex
+    glm::vec3 boundsMin, boundsMax;     // model space, for occlusion proxies
+};
+
+struct CmdDrawData
+{
+    glm::mat4 model;
+    glm::vec3 color;
+    uint32_t object;    // scene index, keys per-object occlusion state
+};
+
+struct CmdDraw
+{
+    int32_t first;
+    int32_t count;
+};
+
+struct CmdDrawIndexed
+{
+    int32_t first;      // in indices
+    int32_t count;
+};
+
+// Followed by `count` instances of CMD_IMPOSTOR_VEC4S vec4s: center and
+// bounding radius, rotation quaternion, color. They are uploaded as a
+// uniform array, so a draw takes at most CMD_IMPOSTOR_BATCH of them.
+struct CmdDrawImpostors
+{
+    GLuint atlas;
+    int32_t count;
+};
+
+constexpr int CMD_IMPOSTOR_VEC4S = 3;
+constexpr int CMD_IMPOSTOR_BATCH = 48;  // matches uInstances in impostor.vs
+
+struct CmdSegment
+{
+    uint64_t key;
+    uint32_t begin, end;    // byte range in the buffer
+    GLuint prog, vbo, ebo;  // what it binds, for keeping them alive
+};
+
+struct CmdBuffer
+{
+    std::vector<unsigned char> bytes;   // grows, never shrinks
+    size_t used;
+    std::vector<CmdSegment> segments;
+    std::vector<std::pair<uint64_t, uint32_t>> scratch;  // for recorders, kept between frames
+};
+
+struct CmdSegmentRef
+{
+    uint64_t key;
+    uint32_t buffer;
+    uint32_t segment;
+};
+
+// One frame's commands: a buffer per recording task.
+struct CmdList
+{
+    std::vector<CmdBuffer> buffers;
+    std::vector<CmdSegmentRef> order;   // replay scratch
+};
+
+// Empties the list and makes sure it has `bufferCount` buffers. Keeps the
+// memory, so steady-state recording doesn't allocate.
+void cmdlist_reset(CmdList *list, int bufferCount);
+
+void cmdbuffer_begin_segment(CmdBuffer *cb, uint64_t key, GLuint prog, GLuint vbo, GLuint ebo = 0);
+
+// Closes the last segment; call once recording into the buffer is done.
+void cmdbuffer_finish(CmdBuffer *cb);
+
+void cmdbuffer_push(CmdBuffer *cb, CmdType type, const void *payload, size_t bytes);
+
+inline void cmdbuffer_bind_program(CmdBuffer *cb, const CmdBindProgram &c) { cmdbuffer_push(cb, CMD_BIND_PROGRAM, &c, sizeof(c)); }
+inline void cmdbuffer_bind_geometry(CmdBuffer *cb, const CmdBindGeometry &c) { cmdbuffer_push(cb, CMD_BIND_GEOMETRY, &c, sizeof(c)); }
+inline void cmdbuffer_draw_data(CmdBuffer *cb, const CmdDrawData &c) { cmdbuffer_push(cb, CMD_DRAW_DATA, &c, sizeof(c)); }
+inline void cmdbuffer_draw(CmdBuffer *cb, const CmdDraw &c) { cmdbuffer_push(cb, CMD_DRAW, &c, sizeof(c)); }
+inline void cmdbuffer_draw_indexed(CmdBuffer *cb, const CmdDrawIndexed &c) { cmdbuffer_push(cb, CMD_DRAW_INDEXED, &c, sizeof(c)); }
+
+// `instances` holds count * CMD_IMPOSTOR_VEC4S vec4s, count <= CMD_IMPOSTOR_BATCH.
+void cmdbuffer_draw_impostors(CmdBuffer *cb, GLuint atlas, const glm::vec4 *instances, int count);
+
+// Payload of a CMD_DRAW_IMPOSTORS, its instances included.
+size_t cmdbuffer_impostor_bytes(const CmdDrawImpostors *c);
+
+size_t cmdlist_bytes(const CmdList *list);
+
+// Fills list->order with every segment, by key. Replay does this itself;
+// other consumers of a list call it first.
+void cmdlist_sort(CmdList *list);
+
+// Maps geometry to a vertex array in the replaying context. Null means the
+// recorded vao is valid there.
+typedef GLuint (*CmdVertexArrayFn)(void *user, const CmdBindGeometry &geometry);
+
+// Executes every segment of the list in key order, skipping binds of state
+// that is already current. lightPos is set on each program as it is bound.
+// With an occlusion culler, draws of objects it believes hidden are held
+// back and issued at the end behind occlusion tests (see occlusion.h).
+// A non-zero depthProg first draws everything with it and color writes
+// off, then shades with GL_EQUAL, so each pixel is shaded about once.
+// Impostors aren't in the pre-pass and depth test as usual.
+void cmdlist_replay(CmdList *list, glm::vec3 lightPos, CmdVertexArrayFn vertexArray, void *user,
+                    OcclusionCuller *occlusion = nullptr, GLuint depthProg = 0);
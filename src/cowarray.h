@@ -0,0 +1,150 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Array stored as fixed-size chunks behind shared_ptrs. Copying a CowArray
+// only copies the chunk pointers, so a snapshot of a whole column is
+// O(chunks). The first write to a chunk that is still shared with a snapshot
+// clones that one chunk; everything else stays shared.
+//
+// Snapshots are only ever taken on the owning thread, so once use_count()
+// reads 1 no other thread can get the chunk back. That read is relaxed, so
+// an acquire fence follows it: paired with the release in the snapshot's
+// last decrement, it orders the other thread's reads of the chunk before
+// the owner's in-place writes. A snapshot that is being released
+// concurrently can at worst cause one unnecessary clone.
+
+constexpr size_t COW_CHUNK_SIZE = 4096;
+
+template <typename T>
+struct CowArray
+{
+    typedef std::array<T, COW_CHUNK_SIZE> Chunk;
+
+    std::vector<std::shared_ptr<Chunk>> chunks;
+    size_t size = 0;
+};
+
+// Makes `c` exclusive to the owner, cloning it if a snapshot still shares it.
+template <typename T>
+inline void cow_unshare(std::shared_ptr<typename CowArray<T>::Chunk> *c)
+{
+    if (c->use_count() > 1) *c = std::make_shared<typename CowArray<T>::Chunk>(**c);
+    else std::atomic_thread_fence(std::memory_order_acquire);
+}
+
+template <typename T>
+inline const T& cow_get(const CowArray<T> &a, size_t i)
+{
+    return (*a.chunks[i / COW_CHUNK_SIZE])[i % COW_CHUNK_SIZE];
+}
+
+template <typename T>
+inline T& cow_mut(CowArray<T> *a, size_t i)
+{
+    std::shared_ptr<typename CowArray<T>::Chunk> &c = a->chunks[i / COW_CHUNK_SIZE];
+    cow_unshare<T>(&c);
+    return (*c)[i % COW_CHUNK_SIZE];
+}
+
+inline size_t cow_chunk_count(size_t size)
+{
+    return (size + COW_CHUNK_SIZE - 1) / COW_CHUNK_SIZE;
+}
+
+// Contiguous elements [c * COW_CHUNK_SIZE, +cow_chunk_len) for hot loops that
+// shouldn't pay a divide per element.
+template <typename T>
+inline const T* cow_chunk_data(const CowArray<T> &a, size_t c)
+{
+    return a.chunks[c]->data();
+}
+
+template <typename T>
+inline size_t cow_chunk_len(const CowArray<T> &a, size_t c)
+{
+    size_t begin = c * COW_CHUNK_SIZE;
+    return a.size - begin < COW_CHUNK_SIZE ? a.size - begin : COW_CHUNK_SIZE;
+}
+
+// Writable counterpart of cow_chunk_data; unshares the chunk once up front.
+template <typename T>
+inline T* cow_chunk_mut(CowArray<T> *a, size_t c)
+{
+    std::shared_ptr<typename CowArray<T>::Chunk> &chunk = a->chunks[c];
+    cow_unshare<T>(&chunk);
+    return chunk->data();
+}
+
+template <typename T>
+void cow_push(CowArray<T> *a, const T &value)
+{
+    if (a->size % COW_CHUNK_SIZE == 0 && a->size / COW_CHUNK_SIZE == a->chunks.size())
+        a->chunks.push_back(std::make_shared<typename CowArray<T>::Chunk>());
+    a->size++;
+    cow_mut(a, a->size - 1) = value;
+}
+
+// Moves the last element into `i` and shrinks by one.
+template <typename T>
+void cow_swap_remove(CowArray<T> *a, size_t i)
+{
+    size_t last = a->size - 1;
+    if (i != last) cow_mut(a, i) = cow_get(*a, last);
+    cow_mut(a, last) = T();
+    a->size = last;
+    if (a->chunks.size() > cow_chunk_count(a->size)) a->chunks.pop_back();
+}
+
+// Replaces the contents with fresh, unshared chunks.
+template <typename T>
+void cow_assign(CowArray<T> *a, const T *src, size_t n)
+{
+    a->chunks.clear();
+    a->chunks.reserve(cow_chunk_count(n));
+    for (size_t begin = 0; begin < n; begin += COW_CHUNK_SIZE) {
+        auto chunk = std::make_shared<typename CowArray<T>::Chunk>();
+        size_t len = n - begin < COW_CHUNK_SIZE ? n - begin : COW_CHUNK_SIZE;
+        for (size_t k = 0; k < len; k++) (*chunk)[k] = src[begin + k];
+        a->chunks.push_back(std::move(chunk));
+    }
+    a->size = n;
+}
+
+// Replaces the contents with `n` default elements in fresh, unshared chunks.
+template <typename T>
+void cow_reset(CowArray<T> *a, size_t n)
+{
+    a->chunks.clear();
+    for (size_t c = 0; c < cow_chunk_count(n); c++)
+        a->chunks.push_back(std::make_shared<typename CowArray<T>::Chunk>());
+    a->size = n;
+}
+
+// Copies src's values into dst's own chunks, allocating only those dst
+// lacks or shares, so a column can be double-buffered without sharing
+// chunks with it.
+template <typename T>
+void cow_copy_values(CowArray<T> *dst, const CowArray<T> &src)
+{
+    const size_t chunks = cow_chunk_count(src.size);
+    dst->chunks.resize(chunks);
+    dst->size = src.size;
+    for (size_t c = 0; c < chunks; c++) {
+        if (!dst->chunks[c]) dst->chunks[c] = std::make_shared<typename CowArray<T>::Chunk>();
+        T *out = cow_chunk_mut(dst, c);
+        const T *in = cow_chunk_data(src, c);
+        for (size_t k = 0; k < cow_chunk_len(src, c); k++) out[k] = in[k];
+    }
+}
+
+template <typename T>
+void cow_clear(CowArray<T> *a)
+{
+    a->chunks.clear();
+    a->size = 0;
+}
@@ -0,0 +1,396 @@
+#include "framegraph.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+struct FormatInfo
+{
+    GLenum format, type;
+    int bytes;
+    bool depth, stencil;
+};
+
+static FormatInfo format_info(GLenum internalFormat)
+{
+    switch (internalFormat) {
+    case GL_DEPTH24_STENCIL8:    return {GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, 4, true, true};
+    case GL_DEPTH_COMPONENT32F:  return {GL_DEPTH_COMPONENT, GL_FLOAT, 4, true, false};
+    case GL_DEPTH_COMPONENT24:   return {GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 4, true, false};
+    case GL_RGBA16F:             return {GL_RGBA, GL_HALF_FLOAT, 8, false, false};
+    case GL_RGBA32F:             return {GL_RGBA, GL_FLOAT, 16, false, false};
+    case GL_R11F_G11F_B10F:      return {GL_RGB, GL_FLOAT, 4, false, false};
+    case GL_R32F:                return {GL_RED, GL_FLOAT, 4, false, false};
+    case GL_RG16F:               return {GL_RG, GL_HALF_FLOAT, 4, false, false};
+    case GL_R8:                  return {GL_RED, GL_UNSIGNED_BYTE, 1, false, false};
+    default:                     return {GL_RGBA, GL_UNSIGNED_BYTE, 4, false, false};
+    }
+}
+
+static size_t desc_bytes(const FgTextureDesc &d)
+{
+    return (size_t)d.w * d.h * format_info(d.format).bytes;
+}
+
+static bool same_desc(const FgTextureDesc &a, const FgTextureDesc &b)
+{
+    return a.w == b.w && a.h == b.h && a.format == b.format;
+}
+
+void framegraph_initialize(FrameGraph *fg, GpuResources *gpu)
+{
+    fg->gpu = gpu;
+    fg->frame = 0;
+    fg->passCount = 0;
+    for (FgTimestamps &ts : fg->timestamps) glGenQueries(2 * FRAMEGRAPH_MAX_TIMED, ts.queries);
+    fg->nextTimestamps = 0;
+}
+
+void framegraph_reset(FrameGraph *fg)
+{
+    fg->frame++;
+    fg->passCount = 0;
+    fg->textures.clear();
+    fg->order.clear();
+}
+
+FgTexture framegraph_create_texture(FrameGraph *fg, const char *name, FgTextureDesc desc)
+{
+    fg->textures.push_back({name, desc, 0, -1, -1, -1});
+    return (FgTexture)fg->textures.size() - 1;
+}
+
+FgTexture framegraph_import_texture(FrameGraph *fg, const char *name, GLuint tex, FgTextureDesc desc)
+{
+    fg->textures.push_back({name, desc, tex, -1, -1, -1});
+    return (FgTexture)fg->textures.size() - 1;
+}
+
+int framegraph_add_pass(FrameGraph *fg, const char *name, FramePassFn fn, void *user)
+{
+    if (fg->passCount == (int)fg->passes.size()) fg->passes.emplace_back();
+    FgPass &p = fg->passes[fg->passCount];
+    p.name = name;
+    p.fn = fn;
+    p.user = user;
+    p.sideEffects = false;
+    p.kept = false;
+    p.reads.clear();
+    p.writes.clear();
+    return fg->passCount++;
+}
+
+void framegraph_read(FrameGraph *fg, int pass, FgTexture tex)
+{
+    fg->passes[pass].reads.push_back(tex);
+}
+
+void framegraph_write(FrameGraph *fg, int pass, FgTexture tex)
+{
+    fg->passes[pass].writes.push_back(tex);
+}
+
+void framegraph_side_effects(FrameGraph *fg, int pass)
+{
+    fg->passes[pass].sideEffects = true;
+}
+
+GLuint framegraph_texture(const FrameGraph *fg, FgTexture tex)
+{
+    const FgTextureInfo &t = fg->textures[tex];
+    if (t.imported) return t.imported;
+    return t.physical >= 0 ? fg->pool[t.physical].tex : 0;
+}
+
+static bool contains(const std::vector<FgTexture> &list, FgTexture tex)
+{
+    return std::find(list.begin(), list.end(), tex) != list.end();
+}
+
+// Kept: side effects, imported writes, and the writers of whatever a kept
+// pass reads, transitively.
+static void cull_passes(FrameGraph *fg)
+{
+    for (int p = 0; p < fg->passCount; p++) {
+        FgPass &pass = fg->passes[p];
+        pass.kept = pass.sideEffects;
+        for (FgTexture t : pass.writes) pass.kept |= fg->textures[t].imported != 0;
+    }
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (int p = 0; p < fg->passCount; p++) {
+            if (!fg->passes[p].kept) continue;
+            for (FgTexture t : fg->passes[p].reads) {
+                for (int w = 0; w < fg->passCount; w++) {
+                    FgPass &writer = fg->passes[w];
+                    if (writer.kept || w == p || !contains(writer.writes, t)) continue;
+                    writer.kept = true;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+// b has to run after a: a writes what b reads, or both write the same
+// texture and a was declared first.
+static bool depends_on(const FrameGraph *fg, int b, int a)
+{
+    const FgPass &pa = fg->passes[a], &pb = fg->passes[b];
+    for (FgTexture t : pa.writes) {
+        if (contains(pb.reads, t) && !contains(pb.writes, t)) return true;
+        if (contains(pb.writes, t) && a < b) return true;
+    }
+    return false;
+}
+
+static void order_passes(FrameGraph *fg)
+{
+    std::vector<char> &scheduled = fg->scheduled;
+    scheduled.assign(fg->passCount, 0);
+    int remaining = 0;
+    for (int p = 0; p < fg->passCount; p++) remaining += fg->passes[p].kept;
+    while (remaining > 0) {
+        int next = -1, fallback = -1;
+        for (int p = 0; p < fg->passCount && next < 0; p++) {
+            if (!fg->passes[p].kept || scheduled[p]) continue;
+            if (fallback < 0) fallback = p;
+            bool ready = true;
+            for (int q = 0; q < fg->passCount && ready; q++) {
+                if (q != p && fg->passes[q].kept && !scheduled[q] && depends_on(fg, p, q)) ready = false;
+            }
+            if (ready) next = p;
+        }
+        if (next < 0) {
+            std::cerr << "frame graph: cycle at pass " << fg->passes[fallback].name << ", using declaration order\n";
+            next = fallback;
+        }
+        scheduled[next] = 1;
+        fg->order.push_back(next);
+        remaining--;
+    }
+}
+
+static int acquire_pooled(FrameGraph *fg, const FgTextureDesc &desc, int firstUse)
+{
+    for (int i = 0; i < (int)fg->pool.size(); i++) {
+        FgPooledTexture &pt = fg->pool[i];
+        if (same_desc(pt.desc, desc) && pt.busyUntil < firstUse) return i;
+    }
+    const FormatInfo fi = format_info(desc.format);
+    FgPooledTexture pt = {};
+    pt.desc = desc;
+    glGenTextures(1, &pt.tex);
+    glBindTexture(GL_TEXTURE_2D, pt.tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, desc.format, desc.w, desc.h, 0, fi.format, fi.type, nullptr);
+    // single level, so filtering must not ask for mipmaps
+    const GLint filter = fi.depth ? GL_NEAREST : GL_LINEAR;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    gpuresources_track(fg->gpu, GPU_RESOURCE_TEXTURE, pt.tex, desc_bytes(desc));
+    fg->pool.push_back(pt);
+    return (int)fg->pool.size() - 1;
+}
+
+// Lifetimes in execution order, then pool slots by first use, so a slot
+// goes to the next texture that starts after its current one ends.
+static void assign_textures(FrameGraph *fg)
+{
+    for (int k = 0; k < (int)fg->order.size(); k++) {
+        const FgPass &pass = fg->passes[fg->order[k]];
+        for (const std::vector<FgTexture> *list : {&pass.reads, &pass.writes}) {
+            for (FgTexture t : *list) {
+                FgTextureInfo &info = fg->textures[t];
+                if (info.firstUse < 0) info.firstUse = k;
+                info.lastUse = k;
+            }
+        }
+    }
+
+    std::vector<FgTexture> &transients = fg->transients;
+    transients.clear();
+    for (FgTexture t = 0; t < fg->textures.size(); t++) {
+        const FgTextureInfo &info = fg->textures[t];
+        if (!info.imported && info.firstUse >= 0) transients.push_back(t);
+    }
+    std::sort(transients.begin(), transients.end(), [fg](FgTexture a, FgTexture b) {
+        return fg->textures[a].firstUse < fg->textures[b].firstUse;
+    });
+    for (FgPooledTexture &pt : fg->pool) pt.busyUntil = -1;
+    for (FgTexture t : transients) {
+        FgTextureInfo &info = fg->textures[t];
+        info.physical = acquire_pooled(fg, info.desc, info.firstUse);
+        fg->pool[info.physical].busyUntil = info.lastUse;
+        fg->pool[info.physical].lastFrame = fg->frame;
+    }
+
+    FrameGraphStats &st = fg->stats;
+    st.transients = (int)transients.size();
+    for (int k = 0; k < (int)fg->order.size(); k++) {
+        size_t live = 0;
+        for (FgTexture t : transients) {
+            const FgTextureInfo &info = fg->textures[t];
+            if (info.firstUse <= k && k <= info.lastUse) live += desc_bytes(info.desc);
+        }
+        st.peakBytes = std::max(st.peakBytes, live);
+    }
+    for (FgTexture t : transients) st.unaliasedBytes += desc_bytes(fg->textures[t].desc);
+    for (const FgTextureInfo &info : fg->textures) {
+        if (info.imported && info.firstUse >= 0) st.importedBytes += desc_bytes(info.desc);
+    }
+}
+
+static GLuint pass_framebuffer(FrameGraph *fg, const FgPass &pass, int *w, int *h)
+{
+    FgFramebuffer key = {};
+    for (FgTexture t : pass.writes) {
+        const FgTextureInfo &info = fg->textures[t];
+        *w = info.desc.w;
+        *h = info.desc.h;
+        if (format_info(info.desc.format).depth) key.depth = framegraph_texture(fg, t);
+        else if (key.colorCount < FRAMEGRAPH_MAX_COLORS) key.colors[key.colorCount++] = framegraph_texture(fg, t);
+    }
+    for (FgFramebuffer &fb : fg->framebuffers) {
+        if (fb.depth == key.depth && fb.colorCount == key.colorCount &&
+            std::equal(fb.colors, fb.colors + fb.colorCount, key.colors)) {
+            fb.lastFrame = fg->frame;
+            return fb.fbo;
+        }
+    }
+
+    glGenFramebuffers(1, &key.fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, key.fbo);
+    GLenum buffers[FRAMEGRAPH_MAX_COLORS];
+    for (int i = 0; i < key.colorCount; i++) {
+        buffers[i] = GL_COLOR_ATTACHMENT0 + i;
+        glFramebufferTexture2D(GL_FRAMEBUFFER, buffers[i], GL_TEXTURE_2D, key.colors[i], 0);
+    }
+    if (key.colorCount) glDrawBuffers(key.colorCount, buffers);
+    else glDrawBuffer(GL_NONE);
+    if (key.depth) {
+        bool stencil = false;
+        for (FgTexture t : pass.writes) {
+            const FormatInfo fi = format_info(fg->textures[t].desc.format);
+            if (fi.depth) stencil = fi.stencil;
+        }
+        glFramebufferTexture2D(GL_FRAMEBUFFER, stencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT,
+                               GL_TEXTURE_2D, key.depth, 0);
+    }
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) std::cerr << "frame graph: pass " << pass.name << " framebuffer incomplete: " << status << "\n";
+    gpuresources_track(fg->gpu, GPU_RESOURCE_FRAMEBUFFER, key.fbo);
+    key.lastFrame = fg->frame;
+    fg->framebuffers.push_back(key);
+    return key.fbo;
+}
+
+static bool framebuffer_uses(const FgFramebuffer &fb, GLuint tex)
+{
+    return fb.depth == tex || std::find(fb.colors, fb.colors + fb.colorCount, tex) != fb.colors + fb.colorCount;
+}
+
+// Framebuffers not bound this frame may name imported textures that have
+// been released since, whose names could come back for new ones, so they
+// only live one frame unused. Pooled textures get longer.
+static void trim(FrameGraph *fg)
+{
+    auto fbEnd = std::remove_if(fg->framebuffers.begin(), fg->framebuffers.end(), [fg](const FgFramebuffer &fb) {
+        if (fb.lastFrame >= fg->frame) return false;
+        gpuresources_release(fg->gpu, GPU_RESOURCE_FRAMEBUFFER, fb.fbo);
+        return true;
+    });
+    fg->framebuffers.erase(fbEnd, fg->framebuffers.end());
+
+    auto poolEnd = std::remove_if(fg->pool.begin(), fg->pool.end(), [fg](const FgPooledTexture &pt) {
+        if (pt.lastFrame + FRAMEGRAPH_POOL_FRAMES >= fg->frame) return false;
+        for (FgFramebuffer &fb : fg->framebuffers) {
+            if (framebuffer_uses(fb, pt.tex)) fb.lastFrame = -1;
+        }
+        gpuresources_release(fg->gpu, GPU_RESOURCE_TEXTURE, pt.tex);
+        return true;
+    });
+    fg->pool.erase(poolEnd, fg->pool.end());
+    fbEnd = std::remove_if(fg->framebuffers.begin(), fg->framebuffers.end(), [fg](const FgFramebuffer &fb) {
+        if (fb.lastFrame >= 0) return false;
+        gpuresources_release(fg->gpu, GPU_RESOURCE_FRAMEBUFFER, fb.fbo);
+        return true;
+    });
+    fg->framebuffers.erase(fbEnd, fg->framebuffers.end());
+}
+
+// Blocks if the GPU is still GPU_TIMER_LATENCY frames behind, like the ring
+// in gputimer.cpp.
+static void read_timestamps(FrameGraph *fg, FgTimestamps *ts)
+{
+    fg->passTimes.clear();
+    for (int i = 0; i < ts->count; i++) {
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(ts->queries[2 * i], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(ts->queries[2 * i + 1], GL_QUERY_RESULT, &end);
+        const double ms = (end - begin) / 1.0e6;
+        auto it = std::find_if(fg->passTimes.begin(), fg->passTimes.end(), [ts, i](const FgPassTime &pt) {
+            return std::strcmp(pt.name, ts->names[i]) == 0;
+        });
+        if (it == fg->passTimes.end()) fg->passTimes.push_back({ts->names[i], ms, 1});
+        else {
+            it->ms += ms;
+            it->passes++;
+        }
+    }
+    ts->count = 0;
+}
+
+void framegraph_execute(FrameGraph *fg)
+{
+    fg->stats = FrameGraphStats{};
+    fg->stats.passes = fg->passCount;
+    cull_passes(fg);
+    order_passes(fg);
+    fg->stats.culled = fg->passCount - (int)fg->order.size();
+    assign_textures(fg);
+
+    FgTimestamps *ts = nullptr;
+    if (fg->timing) {
+        ts = &fg->timestamps[fg->nextTimestamps];
+        if (ts->count) read_timestamps(fg, ts);
+        fg->nextTimestamps = (fg->nextTimestamps + 1) % GPU_TIMER_LATENCY;
+    } else {
+        for (FgTimestamps &t : fg->timestamps) t.count = 0;
+        fg->passTimes.clear();
+    }
+
+    for (int p : fg->order) {
+        const FgPass &pass = fg->passes[p];
+        if (!pass.writes.empty()) {
+            int w = 1, h = 1;
+            glBindFramebuffer(GL_FRAMEBUFFER, pass_framebuffer(fg, pass, &w, &h));
+            glViewport(0, 0, w, h);
+        }
+        const bool timed = ts && ts->count < FRAMEGRAPH_MAX_TIMED;
+        if (timed) glQueryCounter(ts->queries[2 * ts->count], GL_TIMESTAMP);
+        pass.fn(fg, pass.user);
+        if (timed) {
+            glQueryCounter(ts->queries[2 * ts->count + 1], GL_TIMESTAMP);
+            ts->names[ts->count++] = pass.name;
+        }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    trim(fg);
+    fg->stats.pooled = (int)fg->pool.size();
+    for (const FgPooledTexture &pt : fg->pool) fg->stats.pooledBytes += desc_bytes(pt.desc);
+}
+
+void framegraph_shutdown(FrameGraph *fg)
+{
+    for (const FgFramebuffer &fb : fg->framebuffers) gpuresources_release(fg->gpu, GPU_RESOURCE_FRAMEBUFFER, fb.fbo);
+    for (const FgPooledTexture &pt : fg->pool) gpuresources_release(fg->gpu, GPU_RESOURCE_TEXTURE, pt.tex);
+    for (FgTimestamps &ts : fg->timestamps) glDeleteQueries(2 * FRAMEGRAPH_MAX_TIMED, ts.queries);
+    fg->framebuffers.clear();
+    fg->pool.clear();
+    fg->passes.clear();
+    fg->passCount = 0;
+}
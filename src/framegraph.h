@@ -0,0 +1,160 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "gpuresources.h"
+#include "gputimer.h"
+
+// Frame graph: every frame the GPU passes are declared up front with the
+// textures they read and write, then compiled and run in one go.
+//
+// Compiling culls passes nobody needs: a pass is kept when it writes an
+// imported texture (one that outlives the frame, such as what the UI
+// shows), is marked with side effects, or writes something a kept pass
+// reads. The kept passes run in dependency order, ties going to the order
+// they were declared in. Transient textures only live from their first to
+// their last kept use, and ones with the same size and format whose
+// lifetimes don't overlap share a GL texture from a pool that persists
+// across frames; pooled textures nobody used for a while are freed.
+//
+// A pass that writes textures runs with a framebuffer of them bound
+// (colors in write order, plus depth) and the viewport set to their size.
+//
+// With timing on, every kept pass is bracketed by GL_TIMESTAMP queries
+// (they don't conflict with an open GL_TIME_ELAPSED span) and passTimes
+// holds the GPU time per pass name, GPU_TIMER_LATENCY frames late.
+
+typedef uint32_t FgTexture;     // index into this frame's textures
+
+constexpr int FRAMEGRAPH_MAX_COLORS = 4;
+constexpr int FRAMEGRAPH_POOL_FRAMES = 60;  // unused pooled textures are freed after this many frames
+constexpr int FRAMEGRAPH_MAX_TIMED = 32;    // passes timed per frame, later ones aren't
+
+struct FrameGraph;
+
+typedef void (*FramePassFn)(FrameGraph *fg, void *user);
+
+struct FgTextureDesc
+{
+    int w, h;
+    GLenum format;      // sized internal format
+};
+
+struct FgTextureInfo
+{
+    const char *name;
+    FgTextureDesc desc;
+    GLuint imported;            // 0 for transient
+    int firstUse, lastUse;      // execution order, -1 while unused
+    int physical;               // pool slot of a transient, -1 if none
+};
+
+struct FgPass
+{
+    const char *name;
+    FramePassFn fn;
+    void *user;
+    bool sideEffects;
+    bool kept;
+    std::vector<FgTexture> reads;
+    std::vector<FgTexture> writes;
+};
+
+struct FgPooledTexture
+{
+    GLuint tex;
+    FgTextureDesc desc;
+    int64_t lastFrame;      // last frame a pass used it
+    int busyUntil;          // this frame: last execution slot of its current user
+};
+
+struct FgFramebuffer
+{
+    GLuint fbo;
+    GLuint colors[FRAMEGRAPH_MAX_COLORS];
+    int colorCount;
+    GLuint depth;
+    int64_t lastFrame;
+};
+
+// Summed over the passes of one frame that share the name.
+struct FgPassTime
+{
+    const char *name;
+    double ms;
+    int passes;
+};
+
+struct FgTimestamps
+{
+    int count;      // passes timed, 0 if the slot is free
+    const char *names[FRAMEGRAPH_MAX_TIMED];
+    GLuint queries[2 * FRAMEGRAPH_MAX_TIMED];   // before and after each pass
+};
+
+struct FrameGraphStats
+{
+    int passes;
+    int culled;
+    int transients;             // transient textures in use this frame
+    int pooled;                 // GL textures behind them
+    size_t peakBytes;           // most transient memory live at any point this frame
+    size_t unaliasedBytes;      // what the transients would take without sharing
+    size_t pooledBytes;         // GL memory of the pool
+    size_t importedBytes;
+};
+
+struct FrameGraph
+{
+    GpuResources *gpu;
+    int64_t frame;
+    std::vector<FgPass> passes;     // kept between frames for their vectors
+    int passCount;
+    std::vector<FgTextureInfo> textures;
+    std::vector<int> order;         // kept passes, execution order
+    std::vector<char> scheduled;    // compile scratch, kept so frames don't allocate
+    std::vector<FgTexture> transients;
+    std::vector<FgPooledTexture> pool;
+    std::vector<FgFramebuffer> framebuffers;
+    FrameGraphStats stats = {};
+
+    bool timing = false;
+    FgTimestamps timestamps[GPU_TIMER_LATENCY] = {};
+    int nextTimestamps;
+    std::vector<FgPassTime> passTimes;  // in execution order
+};
+
+void framegraph_initialize(FrameGraph *fg, GpuResources *gpu);
+
+// Starts declaring a new frame.
+void framegraph_reset(FrameGraph *fg);
+
+// Transient texture; only valid inside the passes of this frame.
+FgTexture framegraph_create_texture(FrameGraph *fg, const char *name, FgTextureDesc desc);
+
+// Texture owned by someone else. Writing it counts as a result of the frame.
+FgTexture framegraph_import_texture(FrameGraph *fg, const char *name, GLuint tex, FgTextureDesc desc);
+
+// `user` must stay valid until framegraph_execute returns, `name` until the
+// graph is shut down (pass timings keep it), so use a literal.
+int framegraph_add_pass(FrameGraph *fg, const char *name, FramePassFn fn, void *user);
+
+void framegraph_read(FrameGraph *fg, int pass, FgTexture tex);
+
+void framegraph_write(FrameGraph *fg, int pass, FgTexture tex);
+
+// Keeps the pass even if nothing reads what it writes (e.g. it fills a
+// buffer or texture outside the graph).
+void framegraph_side_effects(FrameGraph *fg, int pass);
+
+// Culls, orders, assigns pooled textures and runs the kept passes. Leaves
+// the default framebuffer bound.
+void framegraph_execute(FrameGraph *fg);
+
+// GL texture behind `tex`. Inside a pass that reads or writes it only.
+GLuint framegraph_texture(const FrameGraph *fg, FgTexture tex);
+
+void framegraph_shutdown(FrameGraph *fg);
@@ -0,0 +1,20 @@
+#include "frustum.h"
+
+void frustum_from_matrix(Frustum *frustum, const glm::mat4 &m)
+{
+    // Gribb/Hartmann: each plane is row 3 +/- row 0..2 (glm is column-major)
+    glm::vec4 row[4];
+    for (int r = 0; r < 4; r++) row[r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+
+    frustum->planes[0] = row[3] + row[0];   // left
+    frustum->planes[1] = row[3] - row[0];   // right
+    frustum->planes[2] = row[3] + row[1];   // bottom
+    frustum->planes[3] = row[3] - row[1];   // top
+    frustum->planes[4] = row[3] + row[2];   // near
+    frustum->planes[5] = row[3] - row[2];   // far
+
+    for (int i = 0; i < 6; i++) {
+        glm::vec4 p = frustum->planes[i];
+        frustum->planes[i] = p / glm::length(glm::vec3(p));
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// View frustum as six inward-facing planes (xyz = unit normal, w = distance),
+// extracted from a projection * view matrix.
+struct Frustum
+{
+    glm::vec4 planes[6];
+};
+
+void frustum_from_matrix(Frustum *frustum, const glm::mat4 &viewProj);
+
+inline bool frustum_sphere_visible(const Frustum *frustum, glm::vec3 center, float radius)
+{
+    for (int i = 0; i < 6; i++) {
+        const glm::vec4 &p = frustum->planes[i];
+        if (p.x * center.x + p.y * center.y + p.z * center.z + p.w < -radius) return false;
+    }
+    return true;
+}
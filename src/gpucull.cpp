@@ -0,0 +1,380 @@
+#include "gpucull.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include "shader.h"
+
+static const GLuint CULL_GROUP_SIZE = 64;
+static const GLuint HIZ_GROUP_SIZE = 8;
+
+struct GpuDrawCommand
+{
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t first;
+    uint32_t baseInstance;
+};
+
+static void delete_programs(GpuCuller *gc)
+{
+    GLuint *progs[] = {&gc->cullProg, &gc->compactProg, &gc->scatterProg, &gc->hizProg, &gc->drawProg};
+    for (GLuint *p : progs) {
+        if (*p) glDeleteProgram(*p);
+        *p = 0;
+    }
+}
+
+// All of them or none: if one fails, gc keeps the programs it had.
+static bool load_programs(GpuCuller *gc)
+{
+    GLuint progs[] = {
+        createComputeProgram("assets/shaders/gpucull.comp", "#define CULL_PASS\n"),
+        createComputeProgram("assets/shaders/gpucull.comp", "#define COMPACT_PASS\n"),
+        createComputeProgram("assets/shaders/gpucull.comp", "#define SCATTER_PASS\n"),
+        createComputeProgram("assets/shaders/hiz.comp", ""),
+        createProgram("assets/shaders/lit_indirect.vs", "assets/shaders/lit_shader.fs"),
+    };
+    bool ok = true;
+    for (GLuint p : progs) ok = ok && p;
+    if (!ok) {
+        for (GLuint p : progs) {
+            if (p) glDeleteProgram(p);
+        }
+        return false;
+    }
+    delete_programs(gc);
+    gc->cullProg = progs[0];
+    gc->compactProg = progs[1];
+    gc->scatterProg = progs[2];
+    gc->hizProg = progs[3];
+    gc->drawProg = progs[4];
+    bindUniformBlock(gc->drawProg, "Camera", CAMERA_BLOCK_BINDING);
+    return true;
+}
+
+void gpucull_initialize(GpuCuller *gc)
+{
+    gc->available = GLAD_GL_VERSION_4_3 != 0;
+    gc->drawCount = GLAD_GL_VERSION_4_6 != 0;
+    if (!gc->available) return;
+    if (!load_programs(gc)) {
+        gc->available = false;
+        return;
+    }
+
+    GLuint *buffers[] = {&gc->geometryVbo, &gc->meshBuf, &gc->countBuf, &gc->commandBuf, &gc->drawBuf,
+                         &gc->paramBuf, &gc->readbackBuf, &gc->instanceBuf, &gc->slotBuf, &gc->modelBuf,
+                         &gc->indexBuf};
+    for (GLuint *b : buffers) glGenBuffers(1, b);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, gc->paramBuf);
+    glBufferData(GL_COPY_WRITE_BUFFER, 2 * sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, gc->readbackBuf);
+    glBufferData(GL_COPY_WRITE_BUFFER, 2 * sizeof(uint32_t), nullptr, GL_STREAM_READ);
+
+    // the lit program's layout, plus the visible object index per instance
+    glGenVertexArrays(1, &gc->vao);
+    glBindVertexArray(gc->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, gc->geometryVbo);
+    gpuresources_vertex_layout(MESH_VERTEX_FLOATS);
+    glBindBuffer(GL_ARRAY_BUFFER, gc->indexBuf);
+    glVertexAttribIPointer(2, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void*)0);
+    glVertexAttribDivisor(2, 1);
+    glEnableVertexAttribArray(2);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void gpucull_reload_shaders(GpuCuller *gc)
+{
+    if (!gc->available) return;
+    load_programs(gc);
+}
+
+// Copies every mesh into the shared vertex buffer if the pool changed since
+// the last call. Returns true if it did, which renumbers the mesh slots.
+static bool sync_meshes(GpuCuller *gc, GpuResources *gpu)
+{
+    const ResourcePool<Mesh, MeshTag> &pool = gpu->meshes;
+    bool same = pool.items.size() == gc->meshHandles.size();
+    for (uint32_t i = 0; same && i < pool.items.size(); i++)
+        same = pool_handle_at(&pool, i) == gc->meshHandles[i] && pool.items[i].vbo == gc->meshVbos[i];
+    if (same) return false;
+
+    gc->meshHandles.clear();
+    gc->meshVbos.clear();
+    gc->meshSlot.clear();
+    std::vector<GpuCullMesh> table;
+    size_t vertices = 0;
+    for (uint32_t i = 0; i < pool.items.size(); i++) {
+        const Mesh &m = pool.items[i];
+        // static batches have another layout and no objects refer to them;
+        // evicted meshes draw nothing until restored, which resyncs
+        const int count = m.ebo || !m.resident ? 0 : m.vertexCount;
+        gc->meshSlot[pool_handle_at(&pool, i).value] = i;
+        gc->meshHandles.push_back(pool_handle_at(&pool, i));
+        gc->meshVbos.push_back(m.vbo);
+        table.push_back({(uint32_t)vertices, (uint32_t)count, m.radius, 0});
+        vertices += count;
+    }
+
+    const size_t stride = MESH_VERTEX_FLOATS * sizeof(float);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, gc->geometryVbo);
+    glBufferData(GL_COPY_WRITE_BUFFER, std::max<size_t>(vertices, 1) * stride, nullptr, GL_STATIC_DRAW);
+    for (uint32_t i = 0; i < pool.items.size(); i++) {
+        if (!table[i].count) continue;
+        glBindBuffer(GL_COPY_READ_BUFFER, pool.items[i].vbo);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, (GLintptr)table[i].first * stride,
+                            (GLsizeiptr)table[i].count * stride);
+    }
+
+    const size_t n = std::max<size_t>(table.size(), 1);
+    table.resize(n);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, gc->meshBuf);
+    glBufferData(GL_COPY_WRITE_BUFFER, n * sizeof(GpuCullMesh), table.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, gc->countBuf);
+    glBufferData(GL_COPY_WRITE_BUFFER, n * sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, gc->commandBuf);
+    glBufferData(GL_COPY_WRITE_BUFFER, n * sizeof(GpuDrawCommand), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, gc->drawBuf);
+    glBufferData(GL_COPY_WRITE_BUFFER, n * sizeof(GpuDrawCommand), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return true;
+}
+
+static void grow(GpuCuller *gc, size_t objects)
+{
+    if (objects <= gc->capacity) return;
+    gc->capacity = std::max(objects, std::max<size_t>(gc->capacity * 2, 1024));
+    const struct { GLuint buffer; size_t stride; } sizes[] = {
+        {gc->instanceBuf, sizeof(GpuCullInstance)},
+        {gc->slotBuf, sizeof(uint32_t)},
+        {gc->modelBuf, sizeof(glm::mat4)},
+        {gc->indexBuf, sizeof(uint32_t)},
+    };
+    for (const auto &s : sizes) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, s.buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, gc->capacity * s.stride, nullptr, GL_DYNAMIC_DRAW);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    gpucull_forget(gc);     // the new stores are empty
+}
+
+template <typename T>
+static bool same_chunk(const CowArray<T> &now, const CowArray<T> &then, size_t c)
+{
+    return c < then.chunks.size() && now.chunks[c] == then.chunks[c] && cow_chunk_len(now, c) == cow_chunk_len(then, c);
+}
+
+// Re-uploads the chunks of objects that changed since the last call.
+static void upload_objects(GpuCuller *gc, const Scene *scene)
+{
+    const SceneObjects *o = &scene->objects;
+    const size_t n = scene_object_count(scene);
+    grow(gc, n);
+
+    // without a previous tick, interpolating against the current transform
+    // is a no-op
+    const bool prev = scene->prevPosition.size == n;
+    const CowArray<glm::vec3> &prevPosition = prev ? scene->prevPosition : o->position;
+    const CowArray<glm::vec3> &prevRotation = prev ? scene->prevRotation : o->rotation;
+
+    GpuCullColumns *up = &gc->uploaded;
+    gc->stats.uploadedChunks = 0;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, gc->instanceBuf);
+    for (size_t c = 0; c < cow_chunk_count(n); c++) {
+        if (same_chunk(o->mesh, up->mesh, c) && same_chunk(o->position, up->position, c) &&
+            same_chunk(o->rotation, up->rotation, c) && same_chunk(o->scale, up->scale, c) &&
+            same_chunk(o->color, up->color, c) && same_chunk(prevPosition, up->prevPosition, c) &&
+            same_chunk(prevRotation, up->prevRotation, c))
+            continue;
+
+        const size_t len = cow_chunk_len(o->position, c);
+        const MeshHandle *mesh = cow_chunk_data(o->mesh, c);
+        const glm::vec3 *position = cow_chunk_data(o->position, c);
+        const glm::vec3 *rotation = cow_chunk_data(o->rotation, c);
+        const glm::vec3 *scale = cow_chunk_data(o->scale, c);
+        const glm::vec3 *color = cow_chunk_data(o->color, c);
+        const glm::vec3 *lastPosition = cow_chunk_data(prevPosition, c);
+        const glm::vec3 *lastRotation = cow_chunk_data(prevRotation, c);
+        gc->staging.resize(len);
+        for (size_t k = 0; k < len; k++) {
+            GpuCullInstance &g = gc->staging[k];
+            auto slot = gc->meshSlot.find(mesh[k].value);
+            g.position = glm::vec4(position[k], 1.0f);
+            g.rotation = glm::vec4(rotation[k], 0.0f);
+            g.prevPosition = glm::vec4(lastPosition[k], 1.0f);
+            g.prevRotation = glm::vec4(lastRotation[k], 0.0f);
+            g.scale = glm::vec4(scale[k], 0.0f);
+            g.color = glm::vec4(color[k], 1.0f);
+            g.mesh = slot != gc->meshSlot.end() ? slot->second : UINT32_MAX;
+        }
+        glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)(c * COW_CHUNK_SIZE * sizeof(GpuCullInstance)),
+                        (GLsizeiptr)(len * sizeof(GpuCullInstance)), gc->staging.data());
+        gc->stats.uploadedChunks++;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    up->mesh = o->mesh;
+    up->position = o->position;
+    up->rotation = o->rotation;
+    up->scale = o->scale;
+    up->color = o->color;
+    up->prevPosition = prevPosition;
+    up->prevRotation = prevRotation;
+    gc->count = n;
+}
+
+// Picks up the visible and draw counts of an earlier frame once the GPU is
+// done with them. Never waits.
+static void read_stats(GpuCuller *gc)
+{
+    if (!gc->statsFence) return;
+    GLenum r = glClientWaitSync(gc->statsFence, 0, 0);
+    if (r != GL_ALREADY_SIGNALED && r != GL_CONDITION_SATISFIED) return;
+    glDeleteSync(gc->statsFence);
+    gc->statsFence = nullptr;
+    uint32_t params[2];
+    glBindBuffer(GL_COPY_READ_BUFFER, gc->readbackBuf);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(params), params);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    gc->stats.draws = params[0];
+    gc->stats.visible = params[1];
+}
+
+void gpucull_draw(GpuCuller *gc, Scene *scene)
+{
+    read_stats(gc);
+    if (sync_meshes(gc, scene->gpu)) gpucull_forget(gc);
+    upload_objects(gc, scene);
+    const GLuint objects = (GLuint)gc->count;
+    const GLuint meshes = (GLuint)gc->meshHandles.size();
+    gc->stats.meshes = (int)meshes;
+    if (!objects || !meshes) return;
+
+    // in the binding order of gpucull.comp
+    const GLuint buffers[] = {gc->instanceBuf, gc->meshBuf, gc->countBuf, gc->slotBuf, gc->modelBuf,
+                              gc->commandBuf, gc->drawBuf, gc->paramBuf, gc->indexBuf};
+    for (GLuint b = 0; b < sizeof(buffers) / sizeof(buffers[0]); b++)
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, b, buffers[b]);
+    const uint32_t zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, gc->countBuf);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+    const OrbitCamera *cam = &scene->orbitCamera;
+    const bool hiz = gc->hiz && gc->hizValid;
+    glUseProgram(gc->cullProg);
+    glUniform1ui(glGetUniformLocation(gc->cullProg, "uCount"), objects);
+    glUniform1ui(glGetUniformLocation(gc->cullProg, "uMeshCount"), meshes);
+    glUniform1f(glGetUniformLocation(gc->cullProg, "uAlpha"), scene->simAlpha);
+    glUniform4fv(glGetUniformLocation(gc->cullProg, "uPlanes"), 6, glm::value_ptr(cam->frustum.planes[0]));
+    glUniform1i(glGetUniformLocation(gc->cullProg, "uHizEnabled"), hiz);
+    glUniformMatrix4fv(glGetUniformLocation(gc->cullProg, "uHizViewProj"), 1, GL_FALSE, glm::value_ptr(gc->hizViewProj));
+    glUniform1i(glGetUniformLocation(gc->cullProg, "uHiz"), 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, hiz ? gc->hizTex : 0);
+    glDispatchCompute((objects + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glUseProgram(gc->compactProg);
+    glUniform1ui(glGetUniformLocation(gc->compactProg, "uMeshCount"), meshes);
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glUseProgram(gc->scatterProg);
+    glUniform1ui(glGetUniformLocation(gc->scatterProg, "uCount"), objects);
+    glDispatchCompute((objects + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+    glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    const glm::vec3 lightColor(1.0f, 1.0f, 1.0f);
+    glUseProgram(gc->drawProg);
+    glUniform3fv(glGetUniformLocation(gc->drawProg, "uLightPos"), 1, glm::value_ptr(scene->animLight));
+    glUniform3fv(glGetUniformLocation(gc->drawProg, "uLightColor"), 1, glm::value_ptr(lightColor));
+    glBindVertexArray(gc->vao);
+    if (gc->drawCount) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, gc->drawBuf);
+        glBindBuffer(GL_PARAMETER_BUFFER, gc->paramBuf);
+        glMultiDrawArraysIndirectCount(GL_TRIANGLES, nullptr, 0, (GLsizei)meshes, 0);
+        glBindBuffer(GL_PARAMETER_BUFFER, 0);
+    } else {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, gc->commandBuf);
+        glMultiDrawArraysIndirect(GL_TRIANGLES, nullptr, (GLsizei)meshes, 0);
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+
+    if (!gc->statsFence) {
+        glBindBuffer(GL_COPY_READ_BUFFER, gc->paramBuf);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, gc->readbackBuf);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, 2 * sizeof(uint32_t));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        gc->statsFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
+
+static void create_pyramid(GpuCuller *gc, int w, int h)
+{
+    if (gc->hizTex) glDeleteTextures(1, &gc->hizTex);
+    gc->depthW = w;
+    gc->depthH = h;
+
+    // level 0 is half the depth buffer; the pass that fills it does the
+    // first reduction
+    const int w0 = std::max(1, w / 2), h0 = std::max(1, h / 2);
+    gc->hizLevels = 1 + (int)std::floor(std::log2((double)std::max(w0, h0)));
+    glGenTextures(1, &gc->hizTex);
+    glBindTexture(GL_TEXTURE_2D, gc->hizTex);
+    glTexStorage2D(GL_TEXTURE_2D, gc->hizLevels, GL_R32F, w0, h0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void gpucull_build_hiz(GpuCuller *gc, GLuint depth, int w, int h, const glm::mat4 &viewProj)
+{
+    gc->hizValid = false;
+    if (!gc->available || !gc->hiz) return;
+    if (w != gc->depthW || h != gc->depthH) create_pyramid(gc, w, h);
+
+    glUseProgram(gc->hizProg);
+    glUniform1i(glGetUniformLocation(gc->hizProg, "uSrc"), 0);
+    GLint locLevel = glGetUniformLocation(gc->hizProg, "uSrcLevel");
+    glActiveTexture(GL_TEXTURE0);
+    for (int level = 0; level < gc->hizLevels; level++) {
+        // each level reads the one before it, the first reads depth
+        glBindTexture(GL_TEXTURE_2D, level == 0 ? depth : gc->hizTex);
+        glUniform1i(locLevel, level == 0 ? 0 : level - 1);
+        glBindImageTexture(0, gc->hizTex, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        const int w = std::max(1, (gc->depthW / 2) >> level), h = std::max(1, (gc->depthH / 2) >> level);
+        glDispatchCompute((w + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, (h + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    gc->hizViewProj = viewProj;
+    gc->hizValid = true;
+}
+
+void gpucull_forget(GpuCuller *gc)
+{
+    gc->uploaded = GpuCullColumns();
+}
+
+void gpucull_shutdown(GpuCuller *gc)
+{
+    if (!gc->available) return;
+    delete_programs(gc);
+    gpucull_forget(gc);
+    if (gc->statsFence) glDeleteSync(gc->statsFence);
+    gc->statsFence = nullptr;
+    GLuint buffers[] = {gc->geometryVbo, gc->meshBuf, gc->countBuf, gc->commandBuf, gc->drawBuf, gc->paramBuf,
+                        gc->readbackBuf, gc->instanceBuf, gc->slotBuf, gc->modelBuf, gc->indexBuf};
+    glDeleteBuffers(sizeof(buffers) / sizeof(buffers[0]), buffers);
+    glDeleteVertexArrays(1, &gc->vao);
+    if (gc->hizTex) glDeleteTextures(1, &gc->hizTex);
+    *gc = GpuCuller();
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "scene.h"
+
+// GPU-driven scene pass for GL 4.3+ contexts: visibility is decided by
+// compute shaders and the draws come from buffers they write, so the CPU
+// cost of a frame doesn't grow with the object count.
+//
+//   cull     one thread per object: interpolates its transform, tests its
+//            bounding sphere against the frustum and last frame's Hi-Z
+//            pyramid, and for survivors writes the model matrix and takes
+//            a slot in its mesh's visible count
+//   compact  one thread: turns the counts into a DrawArraysIndirectCommand
+//            per mesh (base instances are a prefix sum) and appends the
+//            non-empty ones to a compacted list with a draw count
+//   scatter  one thread per object: writes the visible object indices into
+//            their mesh's range, which the vertex shader reads back as an
+//            instanced attribute offset by baseInstance
+//
+// The compacted list feeds glMultiDrawArraysIndirectCount on GL 4.6; on
+// 4.3-4.5 the per-mesh list is drawn with glMultiDrawArraysIndirect and
+// empty commands cost nothing. Meshes are non-indexed, so there are no
+// element commands. Every mesh is copied into one shared vertex buffer so
+// a single multi-draw covers the scene.
+//
+// Per-object data lives in a GPU buffer that is only re-uploaded for chunks
+// of the scene's columns that changed: the culler keeps copies of the
+// columns, so a write anywhere in a chunk unshares it (see cowarray.h) and
+// the pointer no longer matches. Every object is drawn with the lit
+// program; per-object programs are ignored on this path.
+//
+// Hi-Z: after the pass, the depth buffer is reduced into a max-depth mip
+// chain. The next frame tests against it with the matrices it was drawn
+// with, so an object that was hidden last frame can show up one frame late.
+
+struct GpuCullInstance
+{
+    glm::vec4 position;
+    glm::vec4 rotation;         // degrees
+    glm::vec4 prevPosition;     // as of the last simulation tick
+    glm::vec4 prevRotation;
+    glm::vec4 scale;
+    glm::vec4 color;
+    uint32_t mesh;              // slot in the culler's mesh table
+    uint32_t pad[3];
+};
+
+struct GpuCullMesh
+{
+    uint32_t first;     // in the shared vertex buffer
+    uint32_t count;
+    float radius;
+    uint32_t pad;
+};
+
+// Column chunks as of the last upload, compared by pointer.
+struct GpuCullColumns
+{
+    CowArray<MeshHandle> mesh;
+    CowArray<glm::vec3> position;
+    CowArray<glm::vec3> rotation;
+    CowArray<glm::vec3> scale;
+    CowArray<glm::vec3> color;
+    CowArray<glm::vec3> prevPosition;
+    CowArray<glm::vec3> prevRotation;
+};
+
+struct GpuCullStats
+{
+    int meshes;
+    int uploadedChunks;     // this frame
+    uint32_t visible;       // read back when ready, a frame or more late
+    uint32_t draws;
+};
+
+struct GpuCuller
+{
+    bool available = false;     // GL 4.3: compute, SSBOs, multi-draw indirect
+    bool drawCount = false;     // GL 4.6: glMultiDrawArraysIndirectCount
+    bool enabled = false;
+    bool hiz = true;
+
+    GLuint cullProg = 0, compactProg = 0, scatterProg = 0, hizProg = 0, drawProg = 0;
+
+    // meshes, rebuilt when the pool changes or one is evicted or restored
+    std::vector<MeshHandle> meshHandles;
+    std::vector<GLuint> meshVbos;
+    std::unordered_map<uint32_t, uint32_t> meshSlot;   // handle value -> slot
+    GLuint vao = 0, geometryVbo = 0;
+    GLuint meshBuf = 0, countBuf = 0, commandBuf = 0, drawBuf = 0, paramBuf = 0;
+    GLuint readbackBuf = 0;     // copy of paramBuf for stats, read once fenced
+
+    // objects
+    size_t capacity = 0;
+    size_t count = 0;
+    GpuCullColumns uploaded;
+    std::vector<GpuCullInstance> staging;
+    GLuint instanceBuf = 0, slotBuf = 0, modelBuf = 0, indexBuf = 0;
+
+    // depth pyramid from the last pass
+    GLuint hizTex = 0;
+    int depthW = 0, depthH = 0, hizLevels = 0;
+    bool hizValid = false;
+    glm::mat4 hizViewProj;
+
+    GLsync statsFence = nullptr;
+    GpuCullStats stats = {};
+};
+
+// Checks the context version and builds the programs. Leaves `available`
+// false (and does nothing else) below GL 4.3.
+void gpucull_initialize(GpuCuller *gc);
+
+void gpucull_reload_shaders(GpuCuller *gc);
+
+// Uploads what changed, culls on the GPU and draws into the bound
+// framebuffer. The scene's camera block must be current.
+void gpucull_draw(GpuCuller *gc, Scene *scene);
+
+// Builds the Hi-Z pyramid for the next frame from a w x h depth texture
+// (read directly, not copied), as seen through `viewProj`.
+void gpucull_build_hiz(GpuCuller *gc, GLuint depth, int w, int h, const glm::mat4 &viewProj);
+
+// Drops the copies of the scene's columns, so writes stop unsharing chunks
+// while the CPU path draws. The next gpucull_draw uploads everything.
+void gpucull_forget(GpuCuller *gc);
+
+void gpucull_shutdown(GpuCuller *gc);
@@ -0,0 +1,446 @@
+#include "gpuresources.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+static void destroy_gl_object(GpuResourceKind kind, GLuint name)
+{
+    switch (kind) {
+    case GPU_RESOURCE_BUFFER:       glDeleteBuffers(1, &name); break;
+    case GPU_RESOURCE_VERTEX_ARRAY: glDeleteVertexArrays(1, &name); break;
+    case GPU_RESOURCE_PROGRAM:      glDeleteProgram(name); break;
+    case GPU_RESOURCE_TEXTURE:      glDeleteTextures(1, &name); break;
+    case GPU_RESOURCE_RENDERBUFFER: glDeleteRenderbuffers(1, &name); break;
+    case GPU_RESOURCE_FRAMEBUFFER:  glDeleteFramebuffers(1, &name); break;
+    default: break;
+    }
+}
+
+static void destroy_batch(GpuResources *res, GpuPendingBatch *batch)
+{
+    for (const GpuPendingDelete &d : batch->items) {
+        destroy_gl_object(d.kind, d.name);
+        res->stats.pending[d.kind]--;
+        res->stats.pendingBytes[d.kind] -= d.bytes;
+        res->stats.destroyed++;
+    }
+    if (batch->fence) glDeleteSync(batch->fence);
+    batch->items.clear();
+    batch->fence = 0;
+}
+
+const char* gpuresources_kind_name(GpuResourceKind kind)
+{
+    switch (kind) {
+    case GPU_RESOURCE_BUFFER:       return "buffers";
+    case GPU_RESOURCE_VERTEX_ARRAY: return "vertex arrays";
+    case GPU_RESOURCE_PROGRAM:      return "programs";
+    case GPU_RESOURCE_TEXTURE:      return "textures";
+    case GPU_RESOURCE_RENDERBUFFER: return "renderbuffers";
+    case GPU_RESOURCE_FRAMEBUFFER:  return "framebuffers";
+    default:                        return "?";
+    }
+}
+
+void gpuresources_initialize(GpuResources *res)
+{
+    for (int k = 0; k < GPU_RESOURCE_KIND_COUNT; k++) {
+        res->refs[k].clear();
+        res->stats.live[k] = 0;
+        res->stats.liveBytes[k] = 0;
+        res->stats.pending[k] = 0;
+        res->stats.pendingBytes[k] = 0;
+    }
+    res->stats.destroyed = 0;
+    res->released.clear();
+    res->inFlight.clear();
+
+    res->meshes = {};
+    res->programs = {};
+    res->renderTargets = {};
+    res->meshByName.clear();
+
+    // glad fills GLAD_GL_VERSION_x_y from the version the context actually
+    // reports, which is usually higher than the 3.3 we ask for.
+    res->immutableStorage = GLAD_GL_VERSION_4_4 != 0;
+}
+
+void gpuresources_shutdown(GpuResources *res)
+{
+    gpuresources_end_frame(res);
+    glFinish();
+    while (!res->inFlight.empty()) {
+        destroy_batch(res, &res->inFlight.front());
+        res->inFlight.pop_front();
+    }
+
+    for (int k = 0; k < GPU_RESOURCE_KIND_COUNT; k++) {
+        if (!res->refs[k].empty()) {
+            std::cerr << "GPU resources: " << res->refs[k].size() << " "
+                      << gpuresources_kind_name((GpuResourceKind)k) << " still referenced at shutdown\n";
+        }
+        for (auto &it : res->refs[k])
+            destroy_gl_object((GpuResourceKind)k, it.first);
+        res->refs[k].clear();
+        res->stats.live[k] = 0;
+        res->stats.liveBytes[k] = 0;
+    }
+
+    res->meshes = {};
+    res->programs = {};
+    res->renderTargets = {};
+    res->meshByName.clear();
+}
+
+GLuint gpuresources_create_static_buffer(
+    GpuResources *res,
+    GLenum target,
+    const void *data,
+    size_t bytes)
+{
+    // glBufferStorage rejects a zero size; an empty OBJ still makes a mesh
+    if (bytes == 0) return 0;
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(target, buffer);
+    if (res->immutableStorage) {
+        // no access flags: the driver is free to keep it in VRAM for good
+        glBufferStorage(target, (GLsizeiptr)bytes, data, 0);
+    } else {
+        glBufferData(target, (GLsizeiptr)bytes, data, GL_STATIC_DRAW);
+    }
+    gpuresources_track(res, GPU_RESOURCE_BUFFER, buffer, bytes);
+    return buffer;
+}
+
+void gpuresources_track(GpuResources *res, GpuResourceKind kind, GLuint name, size_t bytes)
+{
+    if (name == 0) return;
+
+    GpuResourceRef &ref = res->refs[kind][name];
+    if (ref.refs > 0) {
+        // tracking the same object twice just adds a reference
+        ref.refs++;
+        return;
+    }
+    ref.refs = 1;
+    ref.bytes = bytes;
+    res->stats.live[kind]++;
+    res->stats.liveBytes[kind] += bytes;
+}
+
+void gpuresources_retain(GpuResources *res, GpuResourceKind kind, GLuint name)
+{
+    if (name == 0) return;
+
+    auto it = res->refs[kind].find(name);
+    if (it == res->refs[kind].end()) {
+        std::cerr << "GPU resources: retain of untracked " << gpuresources_kind_name(kind) << " " << name << "\n";
+        return;
+    }
+    it->second.refs++;
+}
+
+void gpuresources_release(GpuResources *res, GpuResourceKind kind, GLuint name)
+{
+    if (name == 0) return;
+
+    auto it = res->refs[kind].find(name);
+    if (it == res->refs[kind].end()) {
+        std::cerr << "GPU resources: release of untracked " << gpuresources_kind_name(kind) << " " << name << "\n";
+        return;
+    }
+    if (--it->second.refs > 0) return;
+
+    size_t bytes = it->second.bytes;
+    res->refs[kind].erase(it);
+    res->stats.live[kind]--;
+    res->stats.liveBytes[kind] -= bytes;
+
+    res->released.push_back({kind, name, bytes});
+    res->stats.pending[kind]++;
+    res->stats.pendingBytes[kind] += bytes;
+}
+
+void gpuresources_begin_frame(GpuResources *res)
+{
+    // Batches are fenced in submission order, so stop at the first one the
+    // GPU hasn't reached yet. A zero timeout never blocks.
+    while (!res->inFlight.empty()) {
+        GpuPendingBatch &batch = res->inFlight.front();
+        GLenum r = glClientWaitSync(batch.fence, 0, 0);
+        if (r != GL_ALREADY_SIGNALED && r != GL_CONDITION_SATISFIED) break;
+        destroy_batch(res, &batch);
+        res->inFlight.pop_front();
+    }
+}
+
+void gpuresources_end_frame(GpuResources *res)
+{
+    if (res->released.empty()) return;
+
+    GpuPendingBatch batch;
+    batch.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    batch.items.swap(res->released);
+    res->inFlight.push_back(std::move(batch));
+}
+
+static MeshHandle create_mesh(
+    GpuResources *res,
+    const std::string &name,
+    const float *vertices,
+    int vertexCount,
+    int stride,
+    const uint32_t *indices,
+    int indexCount)
+{
+    Mesh mesh;
+    mesh.name = name;
+    mesh.vertexCount = vertexCount;
+    mesh.indexCount = indexCount;
+    mesh.stride = stride;
+    mesh.radius = 0.0f;
+    mesh.boundsMin = glm::vec3(vertexCount ? INFINITY : 0.0f);
+    mesh.boundsMax = glm::vec3(vertexCount ? -INFINITY : 0.0f);
+    for (int v = 0; v < vertexCount; v++) {
+        const float *p = vertices + v * stride;
+        mesh.radius = std::max(mesh.radius, p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        mesh.boundsMin = glm::min(mesh.boundsMin, glm::vec3(p[0], p[1], p[2]));
+        mesh.boundsMax = glm::max(mesh.boundsMax, glm::vec3(p[0], p[1], p[2]));
+    }
+    mesh.radius = std::sqrt(mesh.radius);
+    mesh.bytes = (size_t)vertexCount * stride * sizeof(float);
+    mesh.refs = 1;
+    mesh.resident = true;
+
+    glGenVertexArrays(1, &mesh.vao);
+    gpuresources_track(res, GPU_RESOURCE_VERTEX_ARRAY, mesh.vao);
+    glBindVertexArray(mesh.vao);
+    mesh.vbo = gpuresources_create_static_buffer(res, GL_ARRAY_BUFFER, vertices, mesh.bytes);
+    mesh.ebo = 0;
+    if (indices) {
+        // element buffer binding is vertex array state
+        mesh.ebo = gpuresources_create_static_buffer(res, GL_ELEMENT_ARRAY_BUFFER, indices,
+                                                     (size_t)indexCount * sizeof(uint32_t));
+        mesh.bytes += (size_t)indexCount * sizeof(uint32_t);
+    }
+
+    if (mesh.vbo) gpuresources_vertex_layout(stride);
+    glBindVertexArray(0);
+
+    MeshHandle h = pool_insert(&res->meshes, mesh);
+    if (!name.empty()) res->meshByName[name] = h;
+    return h;
+}
+
+void gpuresources_vertex_layout(int stride)
+{
+    const GLsizei bytesPerVertex = stride * sizeof(float);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, bytesPerVertex, (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, bytesPerVertex, (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    if (stride == BATCH_VERTEX_FLOATS) {
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, bytesPerVertex, (void*)(6 * sizeof(float)));
+        glEnableVertexAttribArray(2);
+    }
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, bytesPerVertex, (void*)((stride - 1) * sizeof(float)));
+    glEnableVertexAttribArray(3);
+}
+
+MeshHandle gpuresources_create_mesh(
+    GpuResources *res,
+    const std::string &name,
+    const float *vertices,
+    int vertexCount)
+{
+    return create_mesh(res, name, vertices, vertexCount, MESH_VERTEX_FLOATS, nullptr, 0);
+}
+
+MeshHandle gpuresources_create_indexed_mesh(
+    GpuResources *res,
+    const float *vertices,
+    int vertexCount,
+    const uint32_t *indices,
+    int indexCount)
+{
+    return create_mesh(res, std::string(), vertices, vertexCount, BATCH_VERTEX_FLOATS, indices, indexCount);
+}
+
+MeshHandle gpuresources_find_mesh(GpuResources *res, const std::string &name)
+{
+    auto it = res->meshByName.find(name);
+    return it == res->meshByName.end() ? MeshHandle() : it->second;
+}
+
+Mesh* gpuresources_mesh(GpuResources *res, MeshHandle h)
+{
+    return pool_get(&res->meshes, h);
+}
+
+size_t gpuresources_evict_mesh(GpuResources *res, MeshHandle h)
+{
+    Mesh *m = pool_get(&res->meshes, h);
+    if (!m || !m->resident || m->ebo || m->name.empty()) return 0;
+    // deferred like any release, so lists recorded before this still replay
+    gpuresources_release(res, GPU_RESOURCE_BUFFER, m->vbo);
+    gpuresources_release(res, GPU_RESOURCE_VERTEX_ARRAY, m->vao);
+    m->vbo = m->vao = 0;
+    m->resident = false;
+    return m->bytes;
+}
+
+bool gpuresources_restore_mesh(GpuResources *res, MeshHandle h, const float *vertices, int vertexCount)
+{
+    Mesh *m = pool_get(&res->meshes, h);
+    if (!m || m->resident || vertexCount != m->vertexCount) return false;
+    glGenVertexArrays(1, &m->vao);
+    gpuresources_track(res, GPU_RESOURCE_VERTEX_ARRAY, m->vao);
+    glBindVertexArray(m->vao);
+    m->vbo = gpuresources_create_static_buffer(res, GL_ARRAY_BUFFER, vertices, m->bytes);
+    if (m->vbo) gpuresources_vertex_layout(m->stride);
+    glBindVertexArray(0);
+    m->resident = true;
+    return true;
+}
+
+ProgramHandle gpuresources_create_program(GpuResources *res, GLuint prog)
+{
+    gpuresources_track(res, GPU_RESOURCE_PROGRAM, prog);
+    return pool_insert(&res->programs, Program{prog, 1});
+}
+
+Program* gpuresources_program(GpuResources *res, ProgramHandle h)
+{
+    return pool_get(&res->programs, h);
+}
+
+void gpuresources_swap_program(GpuResources *res, ProgramHandle h, GLuint prog)
+{
+    Program *p = pool_get(&res->programs, h);
+    if (!p || !prog) return;
+    gpuresources_track(res, GPU_RESOURCE_PROGRAM, prog);
+    gpuresources_release(res, GPU_RESOURCE_PROGRAM, p->prog);
+    p->prog = prog;
+}
+
+static void create_render_target_objects(GpuResources *res, RenderTarget *rt)
+{
+    glGenFramebuffers(1, &rt->fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, rt->fbo);
+
+    // color texture
+    glGenTextures(1, &rt->color);
+    glBindTexture(GL_TEXTURE_2D, rt->color);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, rt->w, rt->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, rt->color, 0);
+
+    // depth buffer
+    if (rt->hasDepth) {
+        glGenRenderbuffers(1, &rt->depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, rt->depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, rt->w, rt->h);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rt->depth);
+    }
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Render target incomplete: " << status << "\n";
+    }
+
+    size_t pixels = (size_t)rt->w * rt->h;
+    gpuresources_track(res, GPU_RESOURCE_FRAMEBUFFER, rt->fbo);
+    gpuresources_track(res, GPU_RESOURCE_TEXTURE, rt->color, pixels * 4);
+    if (rt->depth) gpuresources_track(res, GPU_RESOURCE_RENDERBUFFER, rt->depth, pixels * 4);
+}
+
+static void release_render_target_objects(GpuResources *res, RenderTarget *rt)
+{
+    gpuresources_release(res, GPU_RESOURCE_RENDERBUFFER, rt->depth);
+    gpuresources_release(res, GPU_RESOURCE_TEXTURE, rt->color);
+    gpuresources_release(res, GPU_RESOURCE_FRAMEBUFFER, rt->fbo);
+    rt->fbo = rt->color = rt->depth = 0;
+}
+
+RenderTargetHandle gpuresources_create_render_target(GpuResources *res, int w, int h, bool depth)
+{
+    RenderTarget rt = {};
+    rt.hasDepth = depth;
+    rt.w = w;
+    rt.h = h;
+    rt.refs = 1;
+    if (w > 0 && h > 0) create_render_target_objects(res, &rt);
+    return pool_insert(&res->renderTargets, rt);
+}
+
+RenderTarget* gpuresources_render_target(GpuResources *res, RenderTargetHandle h)
+{
+    return pool_get(&res->renderTargets, h);
+}
+
+void gpuresources_resize_render_target(GpuResources *res, RenderTargetHandle h, int w, int hgt)
+{
+    RenderTarget *rt = pool_get(&res->renderTargets, h);
+    if (!rt || w <= 0 || hgt <= 0) return;
+
+    // if same size and already created, do nothing
+    if (rt->fbo != 0 && rt->w == w && rt->h == hgt) return;
+
+    // deferred: this usually runs in the middle of the ImGui frame and the
+    // previous frame may still be sampling the old color texture
+    release_render_target_objects(res, rt);
+    rt->w = w;
+    rt->h = hgt;
+    create_render_target_objects(res, rt);
+}
+
+void gpuresources_retain(GpuResources *res, MeshHandle h, int count)
+{
+    if (Mesh *m = pool_get(&res->meshes, h)) m->refs += count;
+}
+
+void gpuresources_retain(GpuResources *res, ProgramHandle h, int count)
+{
+    if (Program *p = pool_get(&res->programs, h)) p->refs += count;
+}
+
+void gpuresources_retain(GpuResources *res, RenderTargetHandle h, int count)
+{
+    if (RenderTarget *rt = pool_get(&res->renderTargets, h)) rt->refs += count;
+}
+
+void gpuresources_release(GpuResources *res, MeshHandle h)
+{
+    Mesh *m = pool_get(&res->meshes, h);
+    if (!m || --m->refs > 0) return;
+
+    gpuresources_release(res, GPU_RESOURCE_BUFFER, m->vbo);
+    if (m->ebo) gpuresources_release(res, GPU_RESOURCE_BUFFER, m->ebo);
+    gpuresources_release(res, GPU_RESOURCE_VERTEX_ARRAY, m->vao);
+    auto it = res->meshByName.find(m->name);
+    if (it != res->meshByName.end() && it->second == h) res->meshByName.erase(it);
+    pool_remove(&res->meshes, h);
+}
+
+void gpuresources_release(GpuResources *res, ProgramHandle h)
+{
+    Program *p = pool_get(&res->programs, h);
+    if (!p || --p->refs > 0) return;
+
+    gpuresources_release(res, GPU_RESOURCE_PROGRAM, p->prog);
+    pool_remove(&res->programs, h);
+}
+
+void gpuresources_release(GpuResources *res, RenderTargetHandle h)
+{
+    RenderTarget *rt = pool_get(&res->renderTargets, h);
+    if (!rt || --rt->refs > 0) return;
+
+    release_render_target_objects(res, rt);
+    pool_remove(&res->renderTargets, h);
+}
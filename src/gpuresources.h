@@ -0,0 +1,218 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "handles.h"
+
+// Every GL object the engine creates goes through here so that it can be
+// shared (ref-counted) and destroyed without stalling the driver: releasing
+// the last reference only queues the name, and the actual glDelete* happens
+// once a fence inserted after the last frame that could have used it has
+// signalled.
+//
+// On top of the raw GL names sit dense pools of meshes, programs and render
+// targets addressed by generational handles. Engine code only ever stores
+// handles, so a resource can be shared, swapped in place (shader reload) or
+// destroyed without leaving dangling GLuints behind.
+
+enum GpuResourceKind
+{
+    GPU_RESOURCE_BUFFER,
+    GPU_RESOURCE_VERTEX_ARRAY,
+    GPU_RESOURCE_PROGRAM,
+    GPU_RESOURCE_TEXTURE,
+    GPU_RESOURCE_RENDERBUFFER,
+    GPU_RESOURCE_FRAMEBUFFER,
+    GPU_RESOURCE_KIND_COUNT
+};
+
+struct GpuResourceRef
+{
+    int refs;
+    size_t bytes;
+};
+
+struct GpuPendingDelete
+{
+    GpuResourceKind kind;
+    GLuint name;
+    size_t bytes;
+};
+
+struct GpuPendingBatch
+{
+    GLsync fence;
+    std::vector<GpuPendingDelete> items;
+};
+
+struct GpuResourceStats
+{
+    int live[GPU_RESOURCE_KIND_COUNT];
+    size_t liveBytes[GPU_RESOURCE_KIND_COUNT];
+    int pending[GPU_RESOURCE_KIND_COUNT];
+    size_t pendingBytes[GPU_RESOURCE_KIND_COUNT];
+    uint64_t destroyed;
+};
+
+struct MeshTag;
+struct ProgramTag;
+struct RenderTargetTag;
+typedef Handle<MeshTag> MeshHandle;
+typedef Handle<ProgramTag> ProgramHandle;
+typedef Handle<RenderTargetTag> RenderTargetHandle;
+
+// Vertex layouts in floats: position, normal and baked ambient occlusion
+// for meshes (see meshcache.h); position, normal, color and occlusion for
+// static batches. Occlusion is always the last float, attribute 3.
+constexpr int MESH_VERTEX_FLOATS = 7;
+constexpr int BATCH_VERTEX_FLOATS = 10;
+
+// Interleaved triangles in the mesh layout, or indexed vertices in the
+// batch layout for static batches (see staticbatch.h).
+struct Mesh
+{
+    std::string name;   // source path, meshes are shared by name
+    GLuint vao, vbo;
+    GLuint ebo;         // 0 unless indexed
+    int vertexCount;
+    int indexCount;
+    int stride;         // floats per vertex
+    float radius;       // bounding sphere around the model origin
+    glm::vec3 boundsMin, boundsMax;
+    size_t bytes;
+    int refs;
+    bool resident;      // false while evicted: vao and vbo are 0, the rest is kept
+};
+
+struct Program
+{
+    GLuint prog;
+    int refs;
+};
+
+// Color texture + depth/stencil renderbuffer. Color-only targets leave depth
+// to whoever draws into them, e.g. the frame graph (see framegraph.h).
+struct RenderTarget
+{
+    GLuint fbo;
+    GLuint color;
+    GLuint depth;       // 0 for color-only targets
+    bool hasDepth;
+    int w, h;
+    int refs;
+};
+
+struct GpuResources
+{
+    bool immutableStorage;  // glBufferStorage available (GL 4.4+)
+
+    ResourcePool<Mesh, MeshTag> meshes;
+    ResourcePool<Program, ProgramTag> programs;
+    ResourcePool<RenderTarget, RenderTargetTag> renderTargets;
+    std::unordered_map<std::string, MeshHandle> meshByName;
+
+    std::unordered_map<GLuint, GpuResourceRef> refs[GPU_RESOURCE_KIND_COUNT];
+    std::vector<GpuPendingDelete> released;   // released this frame, not fenced yet
+    std::deque<GpuPendingBatch> inFlight;     // fenced, waiting for the GPU
+
+    GpuResourceStats stats;
+};
+
+const char* gpuresources_kind_name(GpuResourceKind kind);
+
+void gpuresources_initialize(GpuResources *res);
+
+// Deletes everything still queued (after a glFinish) and reports leaks.
+void gpuresources_shutdown(GpuResources *res);
+
+// Immutable, GPU-only buffer for data that never changes after upload.
+// Falls back to glBufferData(GL_STATIC_DRAW) on contexts older than 4.4.
+// The returned buffer is tracked with one reference; 0 when `bytes` is 0.
+GLuint gpuresources_create_static_buffer(
+    GpuResources *res,
+    GLenum target,
+    const void *data,
+    size_t bytes);
+
+// Start tracking an object created elsewhere, with one reference.
+void gpuresources_track(GpuResources *res, GpuResourceKind kind, GLuint name, size_t bytes = 0);
+
+void gpuresources_retain(GpuResources *res, GpuResourceKind kind, GLuint name);
+
+// Drops a reference; on the last one the object is queued for deferred deletion.
+void gpuresources_release(GpuResources *res, GpuResourceKind kind, GLuint name);
+
+// Non-blocking: destroys the batches whose fences have already signalled.
+void gpuresources_begin_frame(GpuResources *res);
+
+// Fences everything released during this frame.
+void gpuresources_end_frame(GpuResources *res);
+
+// --- pooled resources -------------------------------------------------------
+// create_* return a handle holding one reference; lookups return nullptr for
+// stale or null handles. A mesh without vertices (missing or empty OBJ) gets
+// a vertex array but no buffers and draws nothing.
+
+MeshHandle gpuresources_create_mesh(
+    GpuResources *res,
+    const std::string &name,
+    const float *vertices,
+    int vertexCount);
+
+// Unnamed mesh of pre-transformed vertices in the batch layout, drawn with
+// 32-bit indices.
+MeshHandle gpuresources_create_indexed_mesh(
+    GpuResources *res,
+    const float *vertices,
+    int vertexCount,
+    const uint32_t *indices,
+    int indexCount);
+
+// Attribute pointers of the layout with `stride` floats per vertex, for the
+// bound GL_ARRAY_BUFFER, into the bound vertex array.
+void gpuresources_vertex_layout(int stride);
+
+// Existing mesh with this name (reference NOT added), or a null handle.
+MeshHandle gpuresources_find_mesh(GpuResources *res, const std::string &name);
+
+Mesh* gpuresources_mesh(GpuResources *res, MeshHandle h);
+
+// Releases the buffers of a named, non-indexed mesh but keeps its handle,
+// name and bounds, for the residency manager (see residency.h). Holders
+// must skip it until it is restored. Returns the bytes freed.
+size_t gpuresources_evict_mesh(GpuResources *res, MeshHandle h);
+
+// Uploads an evicted mesh's vertices again, in the mesh layout.
+bool gpuresources_restore_mesh(GpuResources *res, MeshHandle h, const float *vertices, int vertexCount);
+
+ProgramHandle gpuresources_create_program(GpuResources *res, GLuint prog);
+
+Program* gpuresources_program(GpuResources *res, ProgramHandle h);
+
+// Hot-swap: every holder of `h` sees `prog` from now on; the old program is
+// released through the deferred queue. A 0 `prog` (failed reload) keeps the
+// old one.
+void gpuresources_swap_program(GpuResources *res, ProgramHandle h, GLuint prog);
+
+RenderTargetHandle gpuresources_create_render_target(GpuResources *res, int w, int h, bool depth = true);
+
+RenderTarget* gpuresources_render_target(GpuResources *res, RenderTargetHandle h);
+
+// Recreates the attachments if the size changed. Handles stay valid.
+void gpuresources_resize_render_target(GpuResources *res, RenderTargetHandle h, int w, int hgt);
+
+void gpuresources_retain(GpuResources *res, MeshHandle h, int count = 1);
+void gpuresources_retain(GpuResources *res, ProgramHandle h, int count = 1);
+void gpuresources_retain(GpuResources *res, RenderTargetHandle h, int count = 1);
+
+void gpuresources_release(GpuResources *res, MeshHandle h);
+void gpuresources_release(GpuResources *res, ProgramHandle h);
+void gpuresources_release(GpuResources *res, RenderTargetHandle h);
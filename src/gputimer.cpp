@@ -0,0 +1,55 @@
+#include "gputimer.h"
+
+static void read_slot(GpuTimer *timer, int slot)
+{
+    GLuint64 value = 0;
+    glGetQueryObjectui64v(timer->queries[slot], GL_QUERY_RESULT, &value);
+    const double ms = timer->target == GL_TIME_ELAPSED ? value / 1.0e6 : 0.0;
+    timer->done.push_back({timer->frame[slot], ms, value});
+    timer->frame[slot] = -1;
+}
+
+void gputimer_initialize(GpuTimer *timer, GLenum target)
+{
+    timer->target = target;
+    glGenQueries(GPU_TIMER_LATENCY, timer->queries);
+    for (int i = 0; i < GPU_TIMER_LATENCY; i++) timer->frame[i] = -1;
+    timer->next = 0;
+    timer->done.clear();
+}
+
+void gputimer_shutdown(GpuTimer *timer)
+{
+    glDeleteQueries(GPU_TIMER_LATENCY, timer->queries);
+}
+
+void gputimer_begin(GpuTimer *timer, int64_t frame)
+{
+    // the ring wrapped before anyone collected this one
+    if (timer->frame[timer->next] >= 0) read_slot(timer, timer->next);
+    glBeginQuery(timer->target, timer->queries[timer->next]);
+    timer->frame[timer->next] = frame;
+}
+
+void gputimer_end(GpuTimer *timer)
+{
+    glEndQuery(timer->target);
+    timer->next = (timer->next + 1) % GPU_TIMER_LATENCY;
+}
+
+void gputimer_collect(GpuTimer *timer, bool wait, std::vector<GpuTiming> *out)
+{
+    // queries finish in submission order, starting from the oldest slot
+    for (int k = 0; k < GPU_TIMER_LATENCY; k++) {
+        int slot = (timer->next + k) % GPU_TIMER_LATENCY;
+        if (timer->frame[slot] < 0) continue;
+        if (!wait) {
+            GLint available = 0;
+            glGetQueryObjectiv(timer->queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) break;
+        }
+        read_slot(timer, slot);
+    }
+    out->insert(out->end(), timer->done.begin(), timer->done.end());
+    timer->done.clear();
+}
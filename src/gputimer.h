@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+// GPU time of one span per frame, measured with GL_TIME_ELAPSED queries.
+// Results arrive a few frames late; the queries rotate through a small ring
+// so reading them never stalls the pipeline unless asked to. Any other
+// query target with a single result works the same way, e.g. the pipeline
+// statistics counters of GL 4.6.
+
+constexpr int GPU_TIMER_LATENCY = 4;
+
+struct GpuTiming
+{
+    int64_t frame;
+    double ms;          // GL_TIME_ELAPSED only
+    uint64_t value;     // raw result
+};
+
+struct GpuTimer
+{
+    GLenum target;
+    GLuint queries[GPU_TIMER_LATENCY];
+    int64_t frame[GPU_TIMER_LATENCY];   // frame being timed, -1 if free
+    int next;
+    std::vector<GpuTiming> done;        // read back, not yet collected
+};
+
+void gputimer_initialize(GpuTimer *timer, GLenum target = GL_TIME_ELAPSED);
+
+void gputimer_shutdown(GpuTimer *timer);
+
+// Only one span can be open at a time, and collect must not be called while
+// one is.
+void gputimer_begin(GpuTimer *timer, int64_t frame);
+void gputimer_end(GpuTimer *timer);
+
+// Appends every finished timing to `out`, oldest first. With `wait`, blocks
+// until all outstanding queries have finished.
+void gputimer_collect(GpuTimer *timer, bool wait, std::vector<GpuTiming> *out);
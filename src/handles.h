@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Typed 32-bit generational handle: the low 20 bits index a slot in a
+// ResourcePool, the high 12 bits are the slot's generation at the time the
+// handle was issued. Removing an item bumps the slot generation, so a stale
+// handle is detected with one compare. 0 is never issued and means "none".
+template <typename Tag>
+struct Handle
+{
+    uint32_t value = 0;
+
+    bool operator==(Handle o) const { return value == o.value; }
+    bool operator!=(Handle o) const { return value != o.value; }
+};
+
+constexpr uint32_t HANDLE_INDEX_BITS = 20;
+constexpr uint32_t HANDLE_INDEX_MASK = (1u << HANDLE_INDEX_BITS) - 1;
+constexpr uint32_t HANDLE_GENERATION_MASK = (1u << (32 - HANDLE_INDEX_BITS)) - 1;
+
+template <typename Tag>
+inline uint32_t handle_index(Handle<Tag> h) { return h.value & HANDLE_INDEX_MASK; }
+
+template <typename Tag>
+inline uint32_t handle_generation(Handle<Tag> h) { return h.value >> HANDLE_INDEX_BITS; }
+
+template <typename Tag>
+inline bool handle_is_null(Handle<Tag> h) { return h.value == 0; }
+
+// Items live densely in `items` (swap-and-pop on removal) so walking every
+// resource, e.g. for streaming or eviction, is a linear scan. Handles go
+// through the sparse `slots` table, which never moves.
+template <typename T, typename Tag>
+struct ResourcePool
+{
+    struct Slot
+    {
+        uint32_t dense;
+        uint32_t generation;
+    };
+
+    std::vector<T> items;
+    std::vector<uint32_t> itemSlot;   // dense index -> slot index
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+};
+
+template <typename T, typename Tag>
+Handle<Tag> pool_insert(ResourcePool<T, Tag> *pool, T item)
+{
+    uint32_t slot;
+    if (!pool->freeSlots.empty()) {
+        slot = pool->freeSlots.back();
+        pool->freeSlots.pop_back();
+    } else {
+        slot = (uint32_t)pool->slots.size();
+        if (slot > HANDLE_INDEX_MASK) return Handle<Tag>();
+        pool->slots.push_back({0, 1});
+    }
+
+    pool->slots[slot].dense = (uint32_t)pool->items.size();
+    pool->items.push_back(std::move(item));
+    pool->itemSlot.push_back(slot);
+
+    Handle<Tag> h;
+    h.value = (pool->slots[slot].generation << HANDLE_INDEX_BITS) | slot;
+    return h;
+}
+
+template <typename T, typename Tag>
+T* pool_get(ResourcePool<T, Tag> *pool, Handle<Tag> h)
+{
+    uint32_t slot = handle_index(h);
+    if (h.value == 0 || slot >= pool->slots.size()) return nullptr;
+    const auto &s = pool->slots[slot];
+    if (s.generation != handle_generation(h)) return nullptr;
+    return &pool->items[s.dense];
+}
+
+template <typename T, typename Tag>
+bool pool_remove(ResourcePool<T, Tag> *pool, Handle<Tag> h)
+{
+    if (!pool_get(pool, h)) return false;
+
+    uint32_t slot = handle_index(h);
+    uint32_t dense = pool->slots[slot].dense;
+    uint32_t last = (uint32_t)pool->items.size() - 1;
+    if (dense != last) {
+        pool->items[dense] = std::move(pool->items[last]);
+        pool->itemSlot[dense] = pool->itemSlot[last];
+        pool->slots[pool->itemSlot[dense]].dense = dense;
+    }
+    pool->items.pop_back();
+    pool->itemSlot.pop_back();
+
+    // generation 0 is skipped so a live handle can never be 0
+    uint32_t gen = (pool->slots[slot].generation + 1) & HANDLE_GENERATION_MASK;
+    pool->slots[slot].generation = gen ? gen : 1;
+    pool->freeSlots.push_back(slot);
+    return true;
+}
+
+// Handle for the item currently stored at `dense` in pool->items.
+template <typename T, typename Tag>
+Handle<Tag> pool_handle_at(const ResourcePool<T, Tag> *pool, uint32_t dense)
+{
+    uint32_t slot = pool->itemSlot[dense];
+    Handle<Tag> h;
+    h.value = (pool->slots[slot].generation << HANDLE_INDEX_BITS) | slot;
+    return h;
+}
@@ -0,0 +1,255 @@
+#include "impostor.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+#include "scene.h"
+#include "shader.h"
+
+static const char IMPOSTOR_MAGIC[8] = {'M', 'Y', 'G', 'L', 'I', 'M', 'P', 0};
+static const uint32_t IMPOSTOR_VERSION = 1;
+static const int IMPOSTOR_SIZE = IMPOSTOR_GRID * IMPOSTOR_CELL;
+
+// Cache file: this header, then the atlas as RGBA8 rows, bottom first.
+struct ImpostorFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t grid, cell;
+    uint32_t vertexCount;
+    int64_t sourceTime;     // the OBJ's modification time when baked
+};
+
+// Unit direction for a point of the octahedral square (0..1), y up. Same
+// mapping as oct_encode in impostor.vs.
+static glm::vec3 oct_decode(glm::vec2 uv)
+{
+    glm::vec2 p = uv * 2.0f - 1.0f;
+    glm::vec3 d(p.x, 1.0f - std::fabs(p.x) - std::fabs(p.y), p.y);
+    if (d.y < 0.0f) {
+        float x = (1.0f - std::fabs(d.z)) * (d.x >= 0.0f ? 1.0f : -1.0f);
+        float z = (1.0f - std::fabs(d.x)) * (d.z >= 0.0f ? 1.0f : -1.0f);
+        d.x = x;
+        d.z = z;
+    }
+    return glm::normalize(d);
+}
+
+static GLuint load_draw_program()
+{
+    GLuint prog = createProgram("assets/shaders/impostor.vs", "assets/shaders/impostor.fs");
+    if (!prog) return 0;
+    bindUniformBlock(prog, "Camera", CAMERA_BLOCK_BINDING);
+    // constant for the program's lifetime, so set once here
+    glUseProgram(prog);
+    glUniform1i(glGetUniformLocation(prog, "uAtlas"), 0);
+    glUniform1f(glGetUniformLocation(prog, "uGrid"), (float)IMPOSTOR_GRID);
+    glUseProgram(0);
+    return prog;
+}
+
+static GLuint load_bake_program()
+{
+    return createProgram("assets/shaders/impostor_bake.vs", "assets/shaders/impostor_bake.fs");
+}
+
+void impostor_initialize(Impostors *imp, GpuResources *gpu)
+{
+    imp->drawProg = gpuresources_create_program(gpu, load_draw_program());
+    imp->bakeProg = load_bake_program();
+    gpuresources_track(gpu, GPU_RESOURCE_PROGRAM, imp->bakeProg);
+    glGenVertexArrays(1, &imp->vao);
+    gpuresources_track(gpu, GPU_RESOURCE_VERTEX_ARRAY, imp->vao);
+}
+
+void impostor_reload_shaders(Impostors *imp, GpuResources *gpu)
+{
+    gpuresources_swap_program(gpu, imp->drawProg, load_draw_program());
+    const GLuint bake = load_bake_program();
+    if (!bake) return;
+    gpuresources_release(gpu, GPU_RESOURCE_PROGRAM, imp->bakeProg);
+    imp->bakeProg = bake;
+    gpuresources_track(gpu, GPU_RESOURCE_PROGRAM, imp->bakeProg);
+}
+
+static std::string cache_path(const Impostors *imp, const std::string &meshPath)
+{
+    std::string name = meshPath;
+    for (char &c : name) {
+        if (c == '/' || c == '\\' || c == ':') c = '_';
+    }
+    return imp->cacheDir + "/" + name + ".imp";
+}
+
+static int64_t source_time(const std::string &path)
+{
+    std::error_code ec;
+    auto t = std::filesystem::last_write_time(path, ec);
+    return ec ? 0 : (int64_t)t.time_since_epoch().count();
+}
+
+static GLuint create_atlas_texture(GpuResources *gpu, const void *pixels)
+{
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, IMPOSTOR_SIZE, IMPOSTOR_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    // deeper mips would blend neighbouring views together
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 3);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    if (pixels) glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    gpuresources_track(gpu, GPU_RESOURCE_TEXTURE, tex, (size_t)IMPOSTOR_SIZE * IMPOSTOR_SIZE * 4 * 4 / 3);
+    return tex;
+}
+
+static GLuint load_cached(GpuResources *gpu, const std::string &file, const Mesh *mesh, int64_t sourceTime)
+{
+    FILE *f = std::fopen(file.c_str(), "rb");
+    if (!f) return 0;
+    ImpostorFileHeader header;
+    std::vector<unsigned char> pixels((size_t)IMPOSTOR_SIZE * IMPOSTOR_SIZE * 4);
+    bool ok = std::fread(&header, sizeof(header), 1, f) == 1
+           && std::memcmp(header.magic, IMPOSTOR_MAGIC, sizeof(IMPOSTOR_MAGIC)) == 0
+           && header.version == IMPOSTOR_VERSION
+           && header.grid == IMPOSTOR_GRID && header.cell == IMPOSTOR_CELL
+           && header.vertexCount == (uint32_t)mesh->vertexCount
+           && header.sourceTime == sourceTime
+           && std::fread(pixels.data(), 1, pixels.size(), f) == pixels.size();
+    std::fclose(f);
+    return ok ? create_atlas_texture(gpu, pixels.data()) : 0;
+}
+
+static void save_cached(const std::string &file, const Mesh *mesh, int64_t sourceTime, const std::vector<unsigned char> &pixels)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(file).parent_path(), ec);
+    FILE *f = std::fopen(file.c_str(), "wb");
+    if (!f) {
+        std::cerr << "Can't write impostor cache " << file << "\n";
+        return;
+    }
+    ImpostorFileHeader header = {};
+    std::memcpy(header.magic, IMPOSTOR_MAGIC, sizeof(header.magic));
+    header.version = IMPOSTOR_VERSION;
+    header.grid = IMPOSTOR_GRID;
+    header.cell = IMPOSTOR_CELL;
+    header.vertexCount = (uint32_t)mesh->vertexCount;
+    header.sourceTime = sourceTime;
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1
+           && std::fwrite(pixels.data(), 1, pixels.size(), f) == pixels.size();
+    if ((std::fclose(f) != 0) || !ok) std::remove(file.c_str());
+}
+
+// Renders the mesh from every view of the grid into a new atlas. Each view
+// is an orthographic camera framing the bounding sphere, with the same
+// right/up basis impostor.vs builds for the quad.
+static GLuint bake(Impostors *imp, GpuResources *gpu, const Mesh *mesh, std::vector<unsigned char> *pixels)
+{
+    GLuint tex = create_atlas_texture(gpu, nullptr);
+    if (!imp->fbo) {
+        glGenFramebuffers(1, &imp->fbo);
+        glGenRenderbuffers(1, &imp->depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, imp->depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, IMPOSTOR_SIZE, IMPOSTOR_SIZE);
+        gpuresources_track(gpu, GPU_RESOURCE_FRAMEBUFFER, imp->fbo);
+        gpuresources_track(gpu, GPU_RESOURCE_RENDERBUFFER, imp->depth, (size_t)IMPOSTOR_SIZE * IMPOSTOR_SIZE * 4);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, imp->fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, imp->depth);
+    glViewport(0, 0, IMPOSTOR_SIZE, IMPOSTOR_SIZE);
+    // Baking can run after a post pass or a depth-equal replay, so don't
+    // inherit whatever depth state the frame left behind.
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glUseProgram(imp->bakeProg);
+    const GLint locViewProj = glGetUniformLocation(imp->bakeProg, "uViewProj");
+    glBindVertexArray(mesh->vao);
+    const float r = std::max(mesh->radius, 1e-4f);
+    for (int j = 0; j < IMPOSTOR_GRID; j++) {
+        for (int i = 0; i < IMPOSTOR_GRID; i++) {
+            glm::vec3 d = oct_decode(glm::vec2((i + 0.5f) / IMPOSTOR_GRID, (j + 0.5f) / IMPOSTOR_GRID));
+            glm::vec3 up = std::fabs(d.y) > 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+            glm::mat4 view = glm::lookAt(d * (2.0f * r), glm::vec3(0.0f), up);
+            glm::mat4 proj = glm::ortho(-r, r, -r, r, r, 3.0f * r);
+            glm::mat4 viewProj = proj * view;
+            glUniformMatrix4fv(locViewProj, 1, GL_FALSE, glm::value_ptr(viewProj));
+            glViewport(i * IMPOSTOR_CELL, j * IMPOSTOR_CELL, IMPOSTOR_CELL, IMPOSTOR_CELL);
+            glDrawArrays(GL_TRIANGLES, 0, mesh->vertexCount);
+        }
+    }
+    glBindVertexArray(0);
+
+    pixels->resize((size_t)IMPOSTOR_SIZE * IMPOSTOR_SIZE * 4);
+    glReadPixels(0, 0, IMPOSTOR_SIZE, IMPOSTOR_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, pixels->data());
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return tex;
+}
+
+void impostor_prepare(Scene *scene)
+{
+    Impostors *imp = &scene->impostors;
+    if (!imp->enabled) return;
+
+    const ResourcePool<Mesh, MeshTag> &meshes = scene->gpu->meshes;
+    std::vector<unsigned char> pixels;
+    const int atlases = imp->stats.atlases;
+    for (uint32_t i = 0; i < meshes.items.size(); i++) {
+        const Mesh &m = meshes.items[i];
+        const MeshHandle h = pool_handle_at(&meshes, i);
+        // static batches are never drawn per object; evicted meshes bake
+        // once restored
+        if (m.ebo || m.name.empty() || !m.vertexCount || !m.resident || imp->meshAtlas.count(h.value)) continue;
+
+        auto it = imp->atlases.find(m.name);
+        if (it == imp->atlases.end()) {
+            const std::string file = cache_path(imp, m.name);
+            const int64_t sourceTime = source_time(m.name);
+            GLuint tex = load_cached(scene->gpu, file, &m, sourceTime);
+            if (!tex) {
+                tex = bake(imp, scene->gpu, &m, &pixels);
+                save_cached(file, &m, sourceTime, pixels);
+                imp->stats.baked++;
+            }
+            it = imp->atlases.emplace(m.name, tex).first;
+            imp->stats.atlases++;
+        }
+        imp->meshAtlas[h.value] = it->second;
+    }
+    // the render thread samples them from its own context
+    if (imp->stats.atlases != atlases) glFlush();
+}
+
+void impostor_shutdown(Impostors *imp, GpuResources *gpu)
+{
+    for (const auto &a : imp->atlases) gpuresources_release(gpu, GPU_RESOURCE_TEXTURE, a.second);
+    imp->atlases.clear();
+    imp->meshAtlas.clear();
+    gpuresources_release(gpu, imp->drawProg);
+    gpuresources_release(gpu, GPU_RESOURCE_PROGRAM, imp->bakeProg);
+    gpuresources_release(gpu, GPU_RESOURCE_VERTEX_ARRAY, imp->vao);
+    if (imp->fbo) {
+        gpuresources_release(gpu, GPU_RESOURCE_FRAMEBUFFER, imp->fbo);
+        gpuresources_release(gpu, GPU_RESOURCE_RENDERBUFFER, imp->depth);
+    }
+    imp->fbo = imp->depth = 0;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "gpuresources.h"
+
+struct Scene;
+
+// Octahedral impostors: every mesh is rendered once, orthographically, from
+// IMPOSTOR_GRID x IMPOSTOR_GRID directions spread over the sphere by an
+// octahedral mapping, into one atlas of object-space normals and coverage.
+// Objects whose projected size drops below switchPixels are drawn as a
+// single camera-facing quad instead, shaded like the lit program from the
+// normals of the four views nearest the actual view direction, blended.
+//
+// Atlases are written to cacheDir keyed by mesh path and reused while the
+// source file is unchanged. They live until shutdown, so recorded commands
+// can name them by GL texture without holding references.
+
+constexpr int IMPOSTOR_GRID = 8;    // views per atlas side
+constexpr int IMPOSTOR_CELL = 64;   // pixels per view
+
+struct ImpostorStats
+{
+    int atlases;
+    int baked;      // this session; the rest came from the cache
+};
+
+struct Impostors
+{
+    bool enabled = false;
+    float switchPixels = 24.0f;     // projected diameter below which objects switch
+    std::string cacheDir = "impostor_cache";
+
+    ProgramHandle drawProg;
+    GLuint bakeProg = 0;
+    GLuint fbo = 0, depth = 0;
+    GLuint vao = 0;                 // attribute-less, corners come from gl_VertexID
+
+    std::unordered_map<std::string, GLuint> atlases;    // by mesh path
+    std::unordered_map<uint32_t, GLuint> meshAtlas;     // MeshHandle value -> atlas
+    ImpostorStats stats = {};
+};
+
+void impostor_initialize(Impostors *imp, GpuResources *gpu);
+
+void impostor_reload_shaders(Impostors *imp, GpuResources *gpu);
+
+// Call once per frame on the main thread, outside any pass: loads or bakes
+// atlases for meshes that don't have one yet. Does nothing while disabled.
+// Leaves the default framebuffer bound.
+void impostor_prepare(Scene *scene);
+
+// Atlas for a mesh, 0 if there is none (yet).
+inline GLuint impostor_atlas(const Impostors *imp, MeshHandle mesh)
+{
+    auto it = imp->meshAtlas.find(mesh.value);
+    return it == imp->meshAtlas.end() ? 0 : it->second;
+}
+
+void impostor_shutdown(Impostors *imp, GpuResources *gpu);
@@ -0,0 +1,73 @@
+#include "jobs.h"
+
+#include <algorithm>
+
+// Takes tasks of the current run until there are none left. Called with the
+// lock held, returns with it held.
+static void drain(JobPool *pool, std::unique_lock<std::mutex> &lock)
+{
+    while (pool->nextTask < pool->taskCount) {
+        const int task = pool->nextTask++;
+        lock.unlock();
+        pool->fn(pool->context, task);
+        lock.lock();
+        if (--pool->pending == 0) pool->finished.notify_all();
+    }
+}
+
+static void worker_loop(JobPool *pool)
+{
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    unsigned seen = pool->run;
+    for (;;) {
+        pool->wake.wait(lock, [pool, seen]() { return pool->quit || pool->run != seen; });
+        if (pool->quit) return;
+        seen = pool->run;
+        drain(pool, lock);
+    }
+}
+
+void jobs_initialize(JobPool *pool, int workers)
+{
+    if (workers < 0) workers = std::max(0, (int)std::thread::hardware_concurrency() - 1);
+    pool->quit = false;
+    pool->fn = nullptr;
+    pool->context = nullptr;
+    pool->taskCount = 0;
+    pool->nextTask = 0;
+    pool->pending = 0;
+    pool->run = 0;
+    for (int i = 0; i < workers; i++) pool->workers.emplace_back(worker_loop, pool);
+}
+
+void jobs_shutdown(JobPool *pool)
+{
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->quit = true;
+    }
+    pool->wake.notify_all();
+    for (std::thread &t : pool->workers) t.join();
+    pool->workers.clear();
+}
+
+void jobs_run(JobPool *pool, int taskCount, JobFn fn, void *context)
+{
+    if (taskCount <= 0) return;
+    if (taskCount == 1 || pool->workers.empty()) {
+        for (int t = 0; t < taskCount; t++) fn(context, t);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    pool->fn = fn;
+    pool->context = context;
+    pool->taskCount = taskCount;
+    pool->nextTask = 0;
+    pool->pending = taskCount;
+    pool->run++;
+    pool->wake.notify_all();
+
+    drain(pool, lock);
+    pool->finished.wait(lock, [pool]() { return pool->pending == 0; });
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for data-parallel loops. The calling thread
+// takes part in every run, so a pool of N workers runs N + 1 tasks at once.
+
+typedef void (*JobFn)(void *context, int task);
+
+struct JobPool
+{
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    bool quit;
+
+    // current run
+    JobFn fn;
+    void *context;
+    int taskCount;
+    int nextTask;
+    int pending;        // tasks not finished yet
+    unsigned run;       // bumped per run so sleeping workers notice it
+};
+
+// workers < 0: one less than the hardware threads.
+void jobs_initialize(JobPool *pool, int workers = -1);
+
+void jobs_shutdown(JobPool *pool);
+
+// Threads that take part in a run, including the caller.
+inline int jobs_thread_count(const JobPool *pool) { return (int)pool->workers.size() + 1; }
+
+// Calls fn(context, t) for every t in [0, taskCount) across the pool and
+// returns once all of them have. Doesn't allocate. Runs don't nest, and
+// only one thread at a time may start them.
+void jobs_run(JobPool *pool, int taskCount, JobFn fn, void *context);
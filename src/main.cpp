@@ -17,425 +17,808 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/euler_angles.hpp>
 #include "orbitcamera.h"
+#include "gpuresources.h"
+#include "scene.h"
+#include "scenefile.h"
+#include "undo.h"
+#include "scenegen.h"
+#include "camerapath.h"
+#include "simulation.h"
+#include "renderthread.h"
+#include "occlusion.h"
+#include "gpucull.h"
+#include "staticbatch.h"
+#include "impostor.h"
+#include "framegraph.h"
+#include "postprocess.h"
+#include "swraster.h"
+#include "vkbackend.h"
+#include "residency.h"
+#include "gputimer.h"
+#include "allocstats.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <glm/gtc/quaternion.hpp>
 
-static int fix_obj_index(int idx, int count) {
-    // OBJ:  1..count  (positive)
-    //       -1..-count (negative, relative to end)
-    // We return 0-based index, or -1 if invalid/zero.
-    if (idx > 0) return idx - 1;
-    if (idx < 0) return count + idx;   // e.g. -1 => last element
-    return -1;
+static void glfw_error_callback(int err, const char* msg) {
+  std::cerr << "GLFW error " << err << ": " << msg << "\n";
 }
 
-static std::vector<float> load_obj(const std::string& path)
-{
-    std::vector<float> out;   // flat list: px py pz nx ny nz, triangulated
-    std::vector<float> verts; // flat xyzxyz...
-    std::vector<float> norms; // flat xyzxyz...
-
-    std::ifstream file(path);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open OBJ file: " << path << "\n";
-        return out;
-    }
-
-    auto parse_tok = [&](const std::string& t) -> std::pair<int,int> {
-        // returns (vi, ni) as 0-based indices; ni = -1 if missing
-        int vi_raw = 0, ni_raw = 0;
-
-        // Token formats:
-        // v
-        // v/vt
-        // v//vn
-        // v/vt/vn
-        //
-        // We only care about v and vn.
-        size_t s1 = t.find('/');
-        if (s1 == std::string::npos) {
-            vi_raw = std::stoi(t);
-        } else {
-            vi_raw = std::stoi(t.substr(0, s1));
-
-            size_t s2 = t.find('/', s1 + 1);
-            if (s2 != std::string::npos) {
-                // there is a vn field (maybe empty between //)
-                if (s2 + 1 < t.size()) {
-                    std::string vn_part = t.substr(s2 + 1);
-                    if (!vn_part.empty())
-                        ni_raw = std::stoi(vn_part);
-                }
-            }
-            // if only v/vt, no normal
-        }
-
-        int vcount = static_cast<int>(verts.size() / 3);
-        int ncount = static_cast<int>(norms.size() / 3);
-
-        int vi = fix_obj_index(vi_raw, vcount);
-        int ni = (ni_raw != 0) ? fix_obj_index(ni_raw, ncount) : -1;
-
-        return {vi, ni};
-    };
+// Mouse motion collected by the GLFW callbacks between frames. It is applied
+// to the camera right before the scene pass (late latching) rather than at
+// the top of the frame, so the view reflects input that arrived while the UI
+// was being built.
+struct CameraInput {
+    double lastX, lastY;
+    bool haveLast;
+    double dx, dy;          // accumulated while the right button is held
+    double firstEventTime;  // arrival of the oldest unapplied motion, < 0 if none
+};
+static CameraInput g_cameraInput = {0.0, 0.0, false, 0.0, 0.0, -1.0};
+
+static void cursor_pos_callback(GLFWwindow* window, double x, double y) {
+  CameraInput *in = &g_cameraInput;
+  if (in->haveLast && glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS) {
+    in->dx += x - in->lastX;
+    in->dy += y - in->lastY;
+    if (in->firstEventTime < 0.0) in->firstEventTime = glfwGetTime();
+  }
+  in->lastX = x;
+  in->lastY = y;
+  in->haveLast = true;
+}
 
-    std::string line;
-    while (std::getline(file, line)) {
-        if (line.empty() || line[0] == '#')
-            continue;
+// Applies the accumulated motion to the camera. Returns when the oldest of it
+// arrived, or -1 if there was none.
+static double ApplyCameraInput(OrbitCamera *cam)
+{
+  CameraInput *in = &g_cameraInput;
+  double arrived = in->firstEventTime;
+  if (in->dx != 0.0 || in->dy != 0.0)
+    orbitcamera_rotate(cam, (float)in->dx, (float)-in->dy);
+  in->dx = in->dy = 0.0;
+  in->firstEventTime = -1.0;
+  return arrived;
+}
 
-        // trim leading whitespace
-        size_t start = 0;
-        while (start < line.size() && std::isspace(static_cast<unsigned char>(line[start])))
-            ++start;
-        if (start >= line.size() || line[start] == '#')
-            continue;
+// Workers that record the scene's command buffers, and the list the main
+// thread records into when it draws the scene itself.
+static JobPool g_jobs;
+static CmdList g_sceneCommands;
+static OcclusionCuller g_occlusion;     // of the main context
+static GpuCuller g_gpuCull;             // main context only, draws inline
+static StaticBatcher g_staticBatch;
+static FrameGraph g_frameGraph;         // main context scene passes
+static PostProcess g_post;              // main context only, like the frame graph
+static SoftwareRasterizer g_software;   // replaces the scene pass's draws when enabled
+static VulkanBackend g_vulkan;          // replays the main view's list instead of GL
+static MeshResidency g_residency;       // mesh buffers under --mesh-budget
+
+// Top and side views next to the Scene window, each with its own camera and
+// target. Open ones are culled in the same pass as the main view and
+// recorded in the same run of the pool (see scene_cull_views).
+struct ExtraView {
+    const char *name;
+    bool open;
+    bool shown;             // window not collapsed or hidden this frame
+    OrbitCamera camera;
+    RenderTargetHandle target;
+    SceneViewport view;
+    CmdList commands;
+};
+constexpr int EXTRA_VIEW_COUNT = 2;
+static ExtraView g_extraViews[EXTRA_VIEW_COUNT] = {{"Top"}, {"Side"}};
 
-        std::istringstream iss(line.substr(start));
-        std::string type;
-        iss >> type;
+// Looks at the main camera's target from above or from its right, orthographic.
+static void ResetExtraView(int index, const OrbitCamera *main)
+{
+    OrbitCamera *cam = &g_extraViews[index].camera;
+    *cam = *main;
+    cam->orthographic = true;
+    cam->yaw = index == 0 ? main->yaw : main->yaw + glm::radians(90.0f);
+    cam->pitch = index == 0 ? glm::radians(89.0f) : 0.0f;
+    orbitcamera_invalidate(cam);
+}
 
-        if (type == "v") {
-            float x, y, z;
-            if (iss >> x >> y >> z) {
-                verts.push_back(x);
-                verts.push_back(y);
-                verts.push_back(z);
-            }
-        }
-        else if (type == "vn") {
-            float x, y, z;
-            if (iss >> x >> y >> z) {
-                norms.push_back(x);
-                norms.push_back(y);
-                norms.push_back(z);
-            }
-        }
-        else if (type == "f") {
-            std::vector<std::string> face;
-            std::string tok;
-            while (iss >> tok)
-                face.push_back(tok);
-
-            if (face.size() < 3)
-                continue;
-
-            // fan triangulation: (0, i, i+1)
-            auto [v0i, n0i] = parse_tok(face[0]);
-            if (v0i < 0) continue;
-
-            for (size_t i = 1; i + 1 < face.size(); ++i) {
-                auto [v1i, n1i] = parse_tok(face[i]);
-                auto [v2i, n2i] = parse_tok(face[i + 1]);
-                if (v1i < 0 || v2i < 0) continue;
-
-                const int vis[3] = { v0i, v1i, v2i };
-                const int nis[3] = { n0i, n1i, n2i };
-
-                for (int k = 0; k < 3; ++k) {
-                    int vo = vis[k] * 3;
-                    float px = verts[vo + 0];
-                    float py = verts[vo + 1];
-                    float pz = verts[vo + 2];
-
-                    float nx = 0.f, ny = 0.f, nz = 0.f;
-                    if (nis[k] >= 0) {
-                        int no = nis[k] * 3;
-                        if (no + 2 < (int)norms.size()) {
-                            nx = norms[no + 0];
-                            ny = norms[no + 1];
-                            nz = norms[no + 2];
-                        }
-                    }
-
-                    out.push_back(px);
-                    out.push_back(py);
-                    out.push_back(pz);
-                    out.push_back(nx);
-                    out.push_back(ny);
-                    out.push_back(nz);
-                }
-            }
-        }
+static bool ExtraViewsOpen()
+{
+    for (const ExtraView &ev : g_extraViews) {
+        if (ev.open) return true;
     }
-
-    return out;
+    return false;
 }
 
-static std::string read_text_file(const std::string& path) {
-    std::ifstream in(path);
-    std::stringstream ss;
-    ss << in.rdbuf();
-    return ss.str();
+// The main view followed by every open and shown extra one, with the
+// target and command list of each. Returns how many.
+static int CollectViews(Scene *scene, RenderTarget *mainTarget, SceneViewport **views, RenderTarget **targets,
+                        CmdList **lists)
+{
+    views[0] = &scene->view;
+    targets[0] = mainTarget;
+    lists[0] = &g_sceneCommands;
+    int count = 1;
+    for (ExtraView &ev : g_extraViews) {
+        if (!ev.open || !ev.shown) continue;
+        views[count] = &ev.view;
+        targets[count] = gpuresources_render_target(scene->gpu, ev.target);
+        lists[count] = &ev.commands;
+        count++;
+    }
+    return count;
 }
 
-static void glfw_error_callback(int err, const char* msg) {
-  std::cerr << "GLFW error " << err << ": " << msg << "\n";
+// Once per frame, after the mesh pools have changed for the frame: the
+// views as last culled decide which meshes are in use. The GPU-driven path
+// culls where the CPU can't see, so it keeps every mesh.
+static void UpdateResidency(Scene *scene)
+{
+    const SceneViewport *views[1 + EXTRA_VIEW_COUNT] = {&scene->view};
+    int count = 1;
+    for (const ExtraView &ev : g_extraViews) {
+        if (ev.open && ev.shown) views[count++] = &ev.view;
+    }
+    residency_update(&g_residency, scene, views, count, g_gpuCull.enabled);
 }
 
-static GLuint compileShader(GLenum type, const char* src) {
-  GLuint s = glCreateShader(type);
-  glShaderSource(s, 1, &src, nullptr);
-  glCompileShader(s);
-
-  GLint ok = 0;
-  glGetShaderiv(s, GL_COMPILE_STATUS, &ok);
-  if (!ok) {
-    GLint len = 0;
-    glGetShaderiv(s, GL_INFO_LOG_LENGTH, &len);
-    std::string log(len, '\0');
-    glGetShaderInfoLog(s, len, nullptr, log.data());
-    std::cerr << "Shader compile error:\n" << log << "\n";
-  }
-  return s;
-}
+// CPU cost of the scene pass, shown in the Generator panel and written by --bench.
+struct RenderStats {
+    double frameMs;
+    double cullMs;
+    double recordMs;    // command buffers, across the job pool
+    double submitMs;    // replaying them
+    double gpuMs;       // scene pass only, arrives a few frames late
+    size_t visible;
+    OcclusionStats occlusion;
+    uint64_t fragments; // fragment shader invocations, when counted
+    size_t targetBytes; // render targets at the frame graph's peak, transient and imported
+    SwRasterStats software; // summed over views, when the software rasterizer draws
+};
 
-static GLuint linkProgram(GLuint vs, GLuint fs) {
-  GLuint p = glCreateProgram();
-  glAttachShader(p, vs);
-  glAttachShader(p, fs);
-  glLinkProgram(p);
-
-  GLint ok = 0;
-  glGetProgramiv(p, GL_LINK_STATUS, &ok);
-  if (!ok) {
-    GLint len = 0;
-    glGetProgramiv(p, GL_INFO_LOG_LENGTH, &len);
-    std::string log(len, '\0');
-    glGetProgramInfoLog(p, len, nullptr, log.data());
-    std::cerr << "Program link error:\n" << log << "\n";
-  }
+// One view's scene pass in the frame graph, on the stack until it has run.
+struct ScenePass {
+    Scene *scene;
+    SceneViewport *view;
+    CmdList *list;          // null: the GPU-driven path draws it
+    bool occlusion;
+    FgTexture color;        // what the pass draws: the target, or HDR for post-processing
+    FgTexture depth;
+    int w, h;
+    RenderStats *stats;
+};
 
-  glDetachShader(p, vs);
-  glDetachShader(p, fs);
-  glDeleteShader(vs);
-  glDeleteShader(fs);
-  return p;
+static void RunScenePass(FrameGraph *fg, void *user)
+{
+    ScenePass *p = (ScenePass*)user;
+    const OrbitCamera *cam = p->view->camera;
+    glEnable(GL_DEPTH_TEST);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    scene_upload_camera(p->scene, cam);
+
+    double t0 = glfwGetTime();
+    if (g_software.enabled) {
+        // the CPU's image replaces the color; depth stays cleared
+        swraster_draw(&g_software, p->scene, cam, p->w, p->h);
+        glBindTexture(GL_TEXTURE_2D, framegraph_texture(fg, p->color));
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, p->w, p->h, GL_RGBA, GL_UNSIGNED_BYTE, g_software.color.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        p->stats->submitMs += (glfwGetTime() - t0) * 1000.0;
+        p->stats->visible += g_software.stats.objects;
+        p->stats->software.triangles += g_software.stats.triangles;
+        p->stats->software.binned += g_software.stats.binned;
+        p->stats->software.pixels += g_software.stats.pixels;
+        p->stats->software.setupMs += g_software.stats.setupMs;
+        p->stats->software.rasterMs += g_software.stats.rasterMs;
+        return;
+    }
+    if (g_vulkan.enabled && p->list && p->view == &p->scene->view) {
+        // drawn offscreen a frame ahead of what is shown; depth stays cleared
+        const void *pixels = vkbackend_draw(&g_vulkan, p->scene, cam, p->list, p->w, p->h);
+        if (pixels) {
+            glBindTexture(GL_TEXTURE_2D, framegraph_texture(fg, p->color));
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, p->w, p->h, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+        p->stats->submitMs += (glfwGetTime() - t0) * 1000.0;
+        p->stats->visible += p->view->visible.size();
+        return;
+    }
+    if (!p->list) {
+        // visibility never comes back to the CPU: cull covers uploads and
+        // dispatches, submit the Hi-Z build
+        gpucull_draw(&g_gpuCull, p->scene);
+        p->stats->cullMs += (glfwGetTime() - t0) * 1000.0;
+        p->stats->visible += g_gpuCull.stats.visible;
+        return;
+    }
+    OcclusionCuller *occ = nullptr;
+    if (p->occlusion) {
+        occ = &g_occlusion;
+        occlusion_begin_frame(occ, cam->position, cam->nearClip, p->scene->renumbered);
+    }
+    cmdlist_replay(p->list, p->scene->animLight, nullptr, nullptr, occ, scene_depth_program(p->scene));
+    if (occ) p->stats->occlusion = occ->stats;
+    p->stats->submitMs += (glfwGetTime() - t0) * 1000.0;
+    p->stats->visible += p->view->visible.size();
 }
 
-static GLuint createProgram(std::string vsPath, std::string fsPath){
-    std::string vsString = read_text_file(vsPath);
-    const char* vsSrc = vsString.c_str();
-    std::string fsString = read_text_file(fsPath);
-    const char* fsSrc = fsString.c_str();
-    return linkProgram(compileShader(GL_VERTEX_SHADER, vsSrc),
-                              compileShader(GL_FRAGMENT_SHADER, fsSrc));
+// Reads the main view's depth, the pyramid outlives the frame.
+static void RunHiZPass(FrameGraph *fg, void *user)
+{
+    ScenePass *p = (ScenePass*)user;
+    double t0 = glfwGetTime();
+    gpucull_build_hiz(&g_gpuCull, framegraph_texture(fg, p->depth), p->w, p->h, p->view->camera->viewProj);
+    p->stats->submitMs += (glfwGetTime() - t0) * 1000.0;
 }
 
-struct RenderObj{
-    std::string name;
-    GLuint prog;
-    GLuint vao, vbo;
-    int vertex_count;
-    glm::vec3 position;
-    glm::vec3 rotation;
-    glm::vec3 scale;
-    glm::vec3 color;
-};
-
-struct SceneFBO {
-    GLuint fbo = 0;
-    GLuint color = 0;
-    GLuint depth = 0;
-    int w = 0, h = 0;
-};
+// Draws views[v] into targets[v] through the frame graph; depth buffers are
+// transient, so views of the same size share one. views[0] is the main
+// view: only it gets occlusion culling (the culler's history is per object,
+// not per view) and the GPU-driven path; the others always take the CPU
+// one. Timings and the visible count cover all views.
+static void RenderSceneViews(Scene *scene, SceneViewport *const *views, RenderTarget *const *targets,
+                             CmdList *const *lists, int count, RenderStats *stats)
+{
+    for (int v = 0; v < count; v++) {
+        orbitcamera_update(views[v]->camera, (float)targets[v]->w / (float)targets[v]->h);
+        views[v]->height = targets[v]->h;
+    }
 
-struct Scene{
-    GLuint prog;
-    std::vector<RenderObj> renderObjs;
-    OrbitCamera orbitCamera;
-    glm::vec3 lightPos;
-    glm::vec3 animLight;
-    int selected;
-};
+    stats->cullMs = stats->recordMs = stats->submitMs = 0.0;
+    stats->visible = 0;
+    stats->occlusion = OcclusionStats{};
+    stats->software = SwRasterStats{};
+    // the Vulkan backend draws the main view from its CPU-recorded list
+    const int first = g_gpuCull.enabled && !g_vulkan.enabled ? 1 : 0;
+    if (!first) gpucull_forget(&g_gpuCull);
+    if (g_software.enabled) {
+        // nothing is recorded, but picking and residency still read every
+        // view's visible list
+        double t0 = glfwGetTime();
+        scene_cull_views(scene, views, count);
+        stats->cullMs = (glfwGetTime() - t0) * 1000.0;
+    } else if (first < count) {
+        double t0 = glfwGetTime();
+        scene_cull_views(scene, views + first, count - first);
+        double t1 = glfwGetTime();
+        scene_record_views(scene, &g_jobs, views + first, lists + first, count - first);
+        stats->cullMs = (t1 - t0) * 1000.0;
+        stats->recordMs = (glfwGetTime() - t1) * 1000.0;
+    }
 
-static glm::mat4 renderobject_model(RenderObj *renderObj){
-    glm::mat4 trans = glm::translate(glm::mat4(1.0), renderObj->position);
-    glm::vec3 eulerRad = glm::radians(renderObj->rotation);
-    glm::mat4 rot = glm::eulerAngleXYZ(eulerRad.x, eulerRad.y, eulerRad.z);
-    glm::mat4 scale = glm::scale(glm::mat4(1.0), renderObj->scale);
-    return trans * rot * scale;
+    FrameGraph *fg = &g_frameGraph;
+    framegraph_reset(fg);
+    ScenePass passes[1 + EXTRA_VIEW_COUNT];
+    PostView post[1 + EXTRA_VIEW_COUNT];
+    for (int v = 0; v < count; v++) {
+        const RenderTarget *t = targets[v];
+        const FgTexture color = framegraph_import_texture(fg, "view color", t->color, {t->w, t->h, GL_RGBA8});
+        const FgTexture depth = framegraph_create_texture(fg, "view depth", {t->w, t->h, GL_DEPTH24_STENCIL8});
+        // with post-processing the scene draws HDR and the chain writes the target
+        const FgTexture drawn = g_post.enabled ? framegraph_create_texture(fg, "view hdr", {t->w, t->h, GL_RGBA16F})
+                                               : color;
+        passes[v] = {scene, views[v], v < first ? nullptr : lists[v], v == 0 && g_occlusion.enabled, drawn, depth,
+                     t->w, t->h, stats};
+        const int pass = framegraph_add_pass(fg, "scene", RunScenePass, &passes[v]);
+        framegraph_write(fg, pass, drawn);
+        framegraph_write(fg, pass, depth);
+        if (g_post.enabled)
+            postprocess_add_passes(&g_post, &post[v], fg, drawn, depth, color, views[v]->camera->proj);
+    }
+    if (first) {
+        // also runs with Hi-Z off, to drop the stale pyramid
+        const int pass = framegraph_add_pass(fg, "hi-z", RunHiZPass, &passes[0]);
+        framegraph_read(fg, pass, passes[0].depth);
+        framegraph_side_effects(fg, pass);
+    }
+    framegraph_execute(fg);
+    stats->targetBytes = fg->stats.peakBytes + fg->stats.importedBytes;
 }
 
-static void create_render_object(Scene *scene, std::string modelPath, glm::vec3 position, glm::vec3 rotation, glm::vec3 scale, glm::vec3 color){
-    std::vector<float> vertices = load_obj(modelPath);
-    GLuint vao=0, vbo=0;
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    RenderObj renderObj;
-    renderObj.name = modelPath;
-    renderObj.prog = scene->prog;
-    renderObj.vao = vao;
-    renderObj.vbo = vbo;
-    renderObj.vertex_count = vertices.size() / 6;
-    renderObj.position = position;
-    renderObj.rotation = rotation;
-    renderObj.scale = scale;
-    renderObj.color = color;
-    scene->renderObjs.push_back(renderObj);
-}
+static void InitImGui(GLFWwindow* window)
+{
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
 
-static void render_object(RenderObj *renderObj, glm::mat4 view, glm::mat4 proj, glm::vec3 lightPos, glm::vec3 camPos){
-    glUseProgram(renderObj->prog);
-    const GLint locModel = glGetUniformLocation(renderObj->prog, "uModel");
-    const GLint locView  = glGetUniformLocation(renderObj->prog, "uView");
-    const GLint locProj  = glGetUniformLocation(renderObj->prog, "uProj");
-    const GLint locLightPos = glGetUniformLocation(renderObj->prog, "uLightPos");
-    const GLint locViewPos  = glGetUniformLocation(renderObj->prog, "uViewPos");
-    const GLint locObjCol   = glGetUniformLocation(renderObj->prog, "uObjectColor");
-    const GLint locLightCol = glGetUniformLocation(renderObj->prog, "uLightColor");
-
-    glm::mat4 model = renderobject_model(renderObj);
-    glUniformMatrix4fv(locModel, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(locView,  1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(locProj,  1, GL_FALSE, glm::value_ptr(proj));
-
-    glUniform3fv(locLightPos, 1, glm::value_ptr(lightPos));
-    glUniform3fv(locViewPos,  1, glm::value_ptr(camPos));
-
-    glm::vec3 lightColor (1.0f, 1.0f, 1.0f);
-    glUniform3fv(locObjCol,   1, glm::value_ptr(renderObj->color));
-    glUniform3fv(locLightCol, 1, glm::value_ptr(lightColor));
-
-    glBindVertexArray(renderObj->vao);
-    glDrawArrays(GL_TRIANGLES, 0, renderObj->vertex_count);
-}
+    // Enable docking + multi-viewport (requires docking branch or new enough ImGui)
+    io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
+    io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;
 
-static void delete_object(RenderObj renderObj){
-    glDeleteProgram(renderObj.prog);
-    glDeleteBuffers(1, &renderObj.vbo);
-    glDeleteVertexArrays(1, &renderObj.vao);
-}
+    ImGui::StyleColorsDark();
 
-static void create_scene(Scene* scene){
-    scene->prog = createProgram("assets/shaders/lit_shader.vs", "assets/shaders/lit_shader.fs");
-    scene->selected = 0;
-    orbitcamera_initialize(&scene->orbitCamera);
-    create_render_object(
-        scene,
-        "assets/models/Planet.obj",
-        glm::vec3(-1.0,0.0,0.0),
-        glm::vec3(0.0, 0.0, 0.0),
-        glm::vec3(0.2,0.2,0.2),
-        glm::vec3(0.9f, 0.55f, 0.2f));
-
-    create_render_object(
-        scene,
-        "assets/models/funnything.obj",
-        glm::vec3(1.0,0.0,0.0),
-        glm::vec3(0.0, 0.0, 0.0),
-        glm::vec3(0.2,0.2,0.2),
-        glm::vec3(0.2f, 0.55f, 0.9f));
-
-    create_render_object(
-        scene,
-        "assets/models/buildings.obj",
-        glm::vec3(0.0,-0.6,0.0),
-        glm::vec3(0.0, 0.0, 0.0),
-        glm::vec3(0.2,0.2,0.2),
-        glm::vec3(0.2f, 0.9f, 0.2f));
-
-    scene->lightPos = glm::vec3(1.2f, 1.5f, 1.0f);
+    ImGui_ImplGlfw_InitForOpenGL(window, true);
+    ImGui_ImplOpenGL3_Init("#version 330");
 }
 
-static void delete_scene(Scene* scene){
-    for(int i = 0;i < scene->renderObjs.size(); i++){
-        delete_object(scene->renderObjs[i]);
-    }
+static void destroyImGui()
+{
+    ImGui_ImplOpenGL3_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext();
 }
 
-static void CreateOrResizeSceneFBO(SceneFBO *s, int w, int h)
+static void DrawResourceStats(Scene *scene)
 {
-    if (w <= 0 || h <= 0) return;
-
-    // if same size and already created, do nothing
-    if (s->fbo != 0 && s->w == w && s->h == h) return;
+    GpuResources *gpu = scene->gpu;
+    ImGui::Begin("Resources");
+    if (ImGui::Button("Reload shaders")) {
+        // objects hold the program handle, so swapping in place is enough
+        scene_reload_shaders(scene);
+        gpucull_reload_shaders(&g_gpuCull);
+        postprocess_reload_shaders(&g_post, gpu);
+    }
+    ImGui::Text("buffer storage: %s", gpu->immutableStorage ? "immutable (glBufferStorage)" : "glBufferData");
+    if (ImGui::BeginTable("gpu_resources", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("kind");
+        ImGui::TableSetupColumn("live");
+        ImGui::TableSetupColumn("live KiB");
+        ImGui::TableSetupColumn("pending");
+        ImGui::TableSetupColumn("pending KiB");
+        ImGui::TableHeadersRow();
+        for (int k = 0; k < GPU_RESOURCE_KIND_COUNT; k++) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(gpuresources_kind_name((GpuResourceKind)k));
+            ImGui::TableNextColumn(); ImGui::Text("%d", gpu->stats.live[k]);
+            ImGui::TableNextColumn(); ImGui::Text("%.1f", gpu->stats.liveBytes[k] / 1024.0);
+            ImGui::TableNextColumn(); ImGui::Text("%d", gpu->stats.pending[k]);
+            ImGui::TableNextColumn(); ImGui::Text("%.1f", gpu->stats.pendingBytes[k] / 1024.0);
+        }
+        ImGui::EndTable();
+    }
+    ImGui::Text("fenced batches in flight: %d", (int)gpu->inFlight.size());
+    ImGui::Text("pools: %d meshes, %d programs, %d render targets",
+        (int)gpu->meshes.items.size(), (int)gpu->programs.items.size(), (int)gpu->renderTargets.items.size());
+    ImGui::Text("destroyed: %llu", (unsigned long long)gpu->stats.destroyed);
+    const MeshCacheStats *mc = &scene->meshCache.stats;
+    ImGui::SeparatorText("Mesh cache");
+    ImGui::Text("%d meshes from cache, %d baked with %d rays per vertex", mc->hits, mc->baked, scene->meshCache.aoRays);
+    if (mc->ao.seconds > 0.0) {
+        ImGui::Text("%d vertices, %.2f Mrays in %.2f s: %.2f Mrays/s on %d threads", mc->ao.vertices,
+            mc->ao.rays / 1.0e6, mc->ao.seconds, mc->ao.rays / 1.0e6 / mc->ao.seconds, jobs_thread_count(&g_jobs));
+    }
+    const FrameGraphStats *fs = &g_frameGraph.stats;
+    const double mib = 1024.0 * 1024.0;
+    MeshResidency *mr = &g_residency;
+    const ResidencyStats *rs = &mr->stats;
+    ImGui::SeparatorText("Mesh residency");
+    int budgetMiB = (int)(mr->budget >> 20);
+    if (ImGui::InputInt("budget (MiB, 0 = none)", &budgetMiB)) mr->budget = (size_t)std::max(budgetMiB, 0) << 20;
+    int uploadKiB = (int)(mr->uploadBudget >> 10);
+    if (ImGui::SliderInt("uploads (KiB/frame)", &uploadKiB, 64, 65536, "%d", ImGuiSliderFlags_Logarithmic))
+        mr->uploadBudget = (size_t)uploadKiB << 10;
+    ImGui::Text("%d resident, %.1f MiB; %d evicted, %.1f MiB", rs->resident, rs->residentBytes / mib, rs->evicted,
+        rs->evictedBytes / mib);
+    ImGui::Text("%d loading, %.1f KiB uploaded this frame, last read %.2f ms", rs->loading,
+        rs->uploadedBytes / 1024.0, rs->loadMs);
+    ImGui::Text("%llu evictions, %llu restores", (unsigned long long)rs->evictions,
+        (unsigned long long)rs->restores);
+    if (rs->overBudget) ImGui::TextUnformatted("over budget: every resident mesh is in view");
+    ImGui::SeparatorText("Frame graph");
+    ImGui::Text("%d passes, %d culled", fs->passes, fs->culled);
+    ImGui::Text("%d transient targets on %d textures", fs->transients, fs->pooled);
+    ImGui::Text("peak %.1f MiB (%.1f MiB unaliased), pool %.1f MiB", fs->peakBytes / mib,
+        fs->unaliasedBytes / mib, fs->pooledBytes / mib);
+    ImGui::Text("imported %.1f MiB", fs->importedBytes / mib);
+    ImGui::End();
+}
 
-    // destroy old
-    if (s->depth) glDeleteRenderbuffers(1, &s->depth);
-    if (s->color) glDeleteTextures(1, &s->color);
-    if (s->fbo)   glDeleteFramebuffers(1, &s->fbo);
+// UI state that outlives a single frame.
+struct EditorState {
+    char scenePath[512];
+    SceneSaver saver;
+    UndoJournal undo;
+    int undoBudgetMiB;
+    SceneGen gen;
+    RenderStats stats;
+    GpuTimer gpuTimer;
+    GpuTimer fragmentCounter;   // GL 4.6 pipeline statistics only
+    bool countFragments;
+    int64_t frame;
+
+    char flythroughPath[512];
+    CameraPath flythrough;
+    bool recording;
+    bool playing;
+    size_t playFrame;
+
+    OrbitCamera *dragCamera;    // the right mouse button turns this one, picked on press
+    bool lateLatch;             // apply mouse input just before the scene pass
+    bool measureLatency;        // glFinish after every present to time it
+    double latchedInput;        // arrival of the input applied this frame, < 0 if none
+    double presentedInput;      // arrival of the input in the frame presented, < 0 if none
+    bool latencyThreaded;       // samples were taken through the render thread
+    float latencyMs[120];       // input arrival -> present finished, ring
+    int latencyCount;
+    int latencyNext;
+
+    Simulation sim;
+
+    bool renderThreaded;        // wanted; applied between frames
+    RenderThread renderThread;
+    GLFWwindow *sceneSampler;   // context of the window showing the scene
+};
 
-    s->w = w; s->h = h;
+// One inspector field. Drags are journaled as a single entry per drag; the
+// entry is closed at the end of the frame once nothing is active.
+static void InspectorField(Scene *scene, EditorState *editor, const char *label, UndoProperty property, float speed)
+{
+    CowArray<glm::vec3> *column = property == UNDO_POSITION ? &scene->objects.position
+                                : property == UNDO_ROTATION ? &scene->objects.rotation
+                                : property == UNDO_SCALE    ? &scene->objects.scale
+                                :                             &scene->objects.color;
+    const size_t sel = scene->selected;
+    const glm::vec3 before = cow_get(*column, sel);
+    glm::vec3 value = before;
+    bool changed = property == UNDO_COLOR ? ImGui::ColorEdit3(label, &value.x)
+                                          : ImGui::DragFloat3(label, &value.x, speed);
+    if (changed) {
+        undo_begin_edit(&editor->undo, scene, property, (uint32_t)sel, before);
+        cow_mut(column, sel) = value;
+    }
+}
 
-    glGenFramebuffers(1, &s->fbo);
-    glBindFramebuffer(GL_FRAMEBUFFER, s->fbo);
+static void DrawEditPanel(Scene *scene, EditorState *editor)
+{
+    UndoJournal *undo = &editor->undo;
+    ImGui::Begin("Edit");
+    ImGui::BeginDisabled(undo_count(undo) == 0 && !undo->editOpen);
+    if (ImGui::Button("Undo")) undo_undo(undo, scene);
+    ImGui::EndDisabled();
+    ImGui::SameLine();
+    ImGui::BeginDisabled(undo_redo_count(undo) == 0);
+    if (ImGui::Button("Redo")) undo_redo(undo, scene);
+    ImGui::EndDisabled();
+    ImGui::SameLine();
+    ImGui::Text("%zu / %zu", undo_count(undo), undo_redo_count(undo));
+
+    ImGui::Text("journal %.2f / %.2f MiB", undo_used_bytes(undo) / (1024.0 * 1024.0),
+        undo_budget(undo) / (1024.0 * 1024.0));
+    ImGui::InputInt("budget (MiB)", &editor->undoBudgetMiB);
+    if (editor->undoBudgetMiB < 1) editor->undoBudgetMiB = 1;
+    if ((size_t)editor->undoBudgetMiB << 20 != undo_budget(undo)) {
+        ImGui::SameLine();
+        if (ImGui::Button("Apply")) undo_initialize(undo, (size_t)editor->undoBudgetMiB << 20);
+    }
 
-    // color texture
-    glGenTextures(1, &s->color);
-    glBindTexture(GL_TEXTURE_2D, s->color);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, s->color, 0);
+    // Moves every object at once; one journal entry however many there are.
+    ImGui::SeparatorText("All objects");
+    static glm::vec3 offset(0.0f, 1.0f, 0.0f);
+    ImGui::DragFloat3("offset", &offset.x, 0.01f);
+    if (ImGui::Button("Offset all") && scene_object_count(scene) > 0) {
+        undo_end_edit(undo, scene);
+        const uint32_t n = (uint32_t)scene_object_count(scene);
+        std::vector<uint32_t> indices(n);
+        std::vector<glm::vec3> before(n), after(n);
+        for (uint32_t i = 0; i < n; i++) {
+            indices[i] = i;
+            before[i] = cow_get(scene->objects.position, i);
+            after[i] = before[i] + offset;
+            cow_mut(&scene->objects.position, i) = after[i];
+        }
+        undo_push(undo, UNDO_POSITION, indices.data(), before.data(), after.data(), n);
+    }
+    ImGui::End();
+}
 
-    // depth buffer
-    glGenRenderbuffers(1, &s->depth);
-    glBindRenderbuffer(GL_RENDERBUFFER, s->depth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, w, h);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, s->depth);
+static void DrawSceneFilePanel(Scene *scene, EditorState *editor)
+{
+    ImGui::Begin("Scene File");
+    ImGui::InputText("path", editor->scenePath, sizeof(editor->scenePath));
+    ImGui::TextDisabled(".scn = text, .scnb = binary");
+
+    bool saving = editor->saver.busy.load();
+    ImGui::BeginDisabled(saving);
+    if (ImGui::Button("Save")) {
+        scenesaver_start(&editor->saver, scene, editor->scenePath);
+    }
+    ImGui::EndDisabled();
+    ImGui::SameLine();
+    if (ImGui::Button("Load")) {
+        if (scene_load_file(scene, editor->scenePath)) {
+            undo_clear(&editor->undo);
+            editor->gen.baseHeight.clear();
+        }
+    }
 
-    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (saving) {
+        ImGui::Text("saving %s ...", editor->saver.path.c_str());
+    } else if (!editor->saver.path.empty()) {
+        ImGui::Text("%s %s (snapshot %.3f ms, write %.1f ms)", editor->saver.ok ? "saved" : "FAILED to save",
+            editor->saver.path.c_str(), editor->saver.snapshotSeconds * 1000.0, editor->saver.seconds * 1000.0);
+    }
 
-    if (status != GL_FRAMEBUFFER_COMPLETE) {
-        std::cerr << "Scene FBO incomplete: " << status << "\n";
+    ImGui::SeparatorText("Autosave");
+    float interval = (float)editor->saver.autosaveInterval;
+    if (ImGui::DragFloat("interval (s)", &interval, 1.0f, 0.0f, 3600.0f, "%.0f")) {
+        editor->saver.autosaveInterval = interval;
     }
+    ImGui::TextDisabled("0 disables; writes %s", editor->saver.autosavePath.c_str());
+    ImGui::End();
 }
 
-static void RenderSceneToFBO(SceneFBO *s, Scene *scene)
+static void DrawGeneratorPanel(Scene *scene, EditorState *editor)
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, s->fbo);
-    glViewport(0, 0, s->w, s->h);
+    SceneGenParams *p = &editor->gen.params;
+    ImGui::Begin("Generator");
+    int count = (int)p->count;
+    if (ImGui::InputInt("count", &count, 1000, 100000)) p->count = (uint32_t)std::max(count, 0);
+    int layout = p->layout;
+    const char *layouts[SCENEGEN_LAYOUT_COUNT];
+    for (int i = 0; i < SCENEGEN_LAYOUT_COUNT; i++) layouts[i] = scenegen_layout_name((SceneGenLayout)i);
+    if (ImGui::Combo("layout", &layout, layouts, SCENEGEN_LAYOUT_COUNT)) p->layout = (SceneGenLayout)layout;
+    ImGui::DragFloat("spacing", &p->spacing, 0.1f, 0.1f, 100.0f);
+    int seed = (int)p->seed;
+    if (ImGui::InputInt("seed", &seed)) p->seed = (uint32_t)seed;
+    ImGui::Checkbox("motion", &p->motion);
+    ImGui::SameLine();
+    ImGui::Checkbox("static", &p->markStatic);
+    if (ImGui::Button("Generate")) {
+        undo_clear(&editor->undo);
+        scenegen_generate(&editor->gen, scene);
+        scenegen_frame_camera(&editor->gen, scene);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Frame camera")) scenegen_frame_camera(&editor->gen, scene);
+
+    const RenderStats *st = &editor->stats;
+    ImGui::SeparatorText("Scene pass");
+    ImGui::Text("objects %zu, visible %zu", scene_object_count(scene), st->visible);
+    ImGui::Text("frame %.2f ms  cull %.3f ms  record %.3f ms  submit %.3f ms", st->frameMs, st->cullMs, st->recordMs,
+        st->submitMs);
+    ImGui::Text("recording on %d threads", jobs_thread_count(&g_jobs));
+    ImGui::Text("gpu %.3f ms", st->gpuMs);
+    ImGui::Checkbox("front-to-back", &scene->sortFrontToBack);
+    ImGui::SameLine();
+    ImGui::Checkbox("depth pre-pass", &scene->depthPrepass);
+    if (GLAD_GL_VERSION_4_6) {
+        ImGui::Checkbox("count fragment shader invocations", &editor->countFragments);
+        if (editor->countFragments) ImGui::Text("fragments shaded %llu", (unsigned long long)st->fragments);
+    } else {
+        ImGui::TextDisabled("fragment counts need GL 4.6 pipeline statistics");
+    }
+    ImGui::Checkbox("static batching", &scene->staticBatching);
+    if (scene->staticBatching) {
+        const StaticBatchStats *sb = &g_staticBatch.stats;
+        ImGui::Text("%d chunks (%zu drawn) hold %u objects, %.1f MiB", sb->chunks, scene->view.visibleChunks.size(),
+            sb->objects, sb->bytes / (1024.0 * 1024.0));
+        ImGui::Text("%s, last bake %.1f ms", sb->building ? "baking" : "idle", sb->buildMs);
+        if (g_gpuCull.enabled) ImGui::TextDisabled("GPU-driven culling draws static objects one by one");
+    }
+    ImGui::Checkbox("impostors", &scene->impostors.enabled);
+    if (scene->impostors.enabled) {
+        ImGui::SliderFloat("switch below (px)", &scene->impostors.switchPixels, 1.0f, 256.0f, "%.0f");
+        const ImpostorStats *is = &scene->impostors.stats;
+        ImGui::Text("%d atlases (%d baked), %zu impostors drawn", is->atlases, is->baked,
+            scene->view.visibleImpostors.size());
+        if (g_gpuCull.enabled) ImGui::TextDisabled("GPU-driven culling draws full meshes only");
+    }
+    ImGui::Checkbox("occlusion culling", &g_occlusion.enabled);
+    if (g_occlusion.enabled) {
+        ImGui::Text("box tested %d, culled %d, visible queries %d", st->occlusion.tested, st->occlusion.culled,
+            st->occlusion.visibleQueries);
+    }
+    if (g_gpuCull.available) {
+        ImGui::Checkbox("GPU-driven culling", &g_gpuCull.enabled);
+        if (g_gpuCull.enabled) {
+            ImGui::SameLine();
+            ImGui::Checkbox("Hi-Z", &g_gpuCull.hiz);
+            ImGui::Text("%d meshes, %u draws, %d chunks uploaded, %s", g_gpuCull.stats.meshes, g_gpuCull.stats.draws,
+                g_gpuCull.stats.uploadedChunks,
+                g_gpuCull.drawCount ? "glMultiDrawArraysIndirectCount" : "glMultiDrawArraysIndirect");
+        }
+    } else {
+        ImGui::TextDisabled("GPU-driven culling needs GL 4.3");
+    }
+    ImGui::Checkbox("software rasterizer", &g_software.enabled);
+    if (g_software.enabled) {
+        const SwRasterStats *sw = &st->software;
+        const double ms = sw->setupMs + sw->rasterMs;
+        ImGui::Text("%d triangles in %llu tile bins, %.2f Mpixels shaded", sw->triangles,
+            (unsigned long long)sw->binned, sw->pixels / 1.0e6);
+        ImGui::Text("setup %.3f ms  raster %.3f ms: %.1f Mtris/s on %d threads", sw->setupMs, sw->rasterMs,
+            ms > 0.0 ? sw->triangles / ms / 1000.0 : 0.0, jobs_thread_count(&g_jobs));
+        ImGui::TextDisabled("full meshes only: no static chunks, impostors or occlusion culling");
+    }
+    if (g_vulkan.available) {
+        ImGui::Checkbox("Vulkan", &g_vulkan.enabled);
+        if (g_vulkan.enabled) {
+            const VkBackendStats *vs = &g_vulkan.stats;
+            ImGui::SameLine();
+            ImGui::TextUnformatted(g_vulkan.device.c_str());
+            ImGui::Text("%d draws from %d secondary command buffers", vs->draws, vs->secondaries);
+            ImGui::Text("record %.3f ms  submit %.3f ms  wait %.3f ms", vs->recordMs, vs->submitMs, vs->waitMs);
+            ImGui::Text("%d meshes, %.1f MiB on the device", vs->meshes, vs->meshBytes / (1024.0 * 1024.0));
+            ImGui::TextDisabled("main view only, a frame late; no impostors, occlusion or pre-pass");
+        }
+    } else {
+        ImGui::TextDisabled("Vulkan: start with --vulkan, in a MYGL_VULKAN build with a 1.2 device");
+    }
+    ImGui::Text("views");
+    for (int i = 0; i < EXTRA_VIEW_COUNT; i++) {
+        ImGui::SameLine();
+        ImGui::Checkbox(g_extraViews[i].name, &g_extraViews[i].open);
+    }
+    ImGui::Checkbox("render thread", &editor->renderThreaded);
+    if (g_gpuCull.enabled && editor->renderThreaded)
+        ImGui::TextDisabled("GPU-driven culling draws on the main thread");
+    else if (ExtraViewsOpen() && editor->renderThreaded)
+        ImGui::TextDisabled("more than one view draws on the main thread");
+    else if (g_post.enabled && editor->renderThreaded)
+        ImGui::TextDisabled("post-processing runs on the main thread");
+    else if (g_software.enabled && editor->renderThreaded)
+        ImGui::TextDisabled("the software rasterizer runs on the main thread's job pool");
+    else if (g_vulkan.enabled && editor->renderThreaded)
+        ImGui::TextDisabled("Vulkan records on the main thread's job pool");
+    if (editor->renderThread.running)
+        ImGui::TextDisabled("submit and gpu are the render thread's, one frame behind");
+    ImGui::End();
+}
 
-    glEnable(GL_DEPTH_TEST);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+static void DrawFlythroughPanel(Scene *scene, EditorState *editor)
+{
+    ImGui::Begin("Flythrough");
+    ImGui::InputText("path", editor->flythroughPath, sizeof(editor->flythroughPath));
 
-    glViewport(0, 0, s->w, s->h);
+    ImGui::BeginDisabled(editor->playing);
+    if (ImGui::Button(editor->recording ? "Stop" : "Record")) {
+        if (editor->recording) {
+            camerapath_save(&editor->flythrough, editor->flythroughPath);
+        } else {
+            editor->flythrough.keys.clear();
+        }
+        editor->recording = !editor->recording;
+    }
+    ImGui::EndDisabled();
+    ImGui::SameLine();
+    ImGui::BeginDisabled(editor->recording);
+    if (ImGui::Button(editor->playing ? "Stop playback" : "Play")) {
+        editor->playing = !editor->playing && camerapath_load(&editor->flythrough, editor->flythroughPath);
+        editor->playFrame = 0;
+    }
+    ImGui::EndDisabled();
 
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    const CameraPath *path = &editor->flythrough;
+    if (editor->recording) ImGui::Text("recording, %zu frames", path->keys.size());
+    else if (editor->playing) ImGui::Text("frame %zu / %zu", editor->playFrame, path->keys.size());
+    else ImGui::Text("%zu frames, %.1f s at a fixed %.0f Hz", path->keys.size(), path->keys.size() * path->dt, 1.0 / path->dt);
+    ImGui::TextDisabled("for timings run: mygl <scene> --play %s", editor->flythroughPath);
+    ImGui::End();
+}
 
-    glm::vec3 camPos = orbitcamera_position(&scene->orbitCamera);
-    glm::mat4 view = orbitcamera_view(&scene->orbitCamera);
-    glm::mat4 proj = orbitcamera_proj(&scene->orbitCamera, (float)s->w / (float)s->h);
-    for(int i = 0; i < scene->renderObjs.size(); i++){
-        render_object(&scene->renderObjs[i], view, proj, scene->animLight, camPos);
+static void DrawLatencyPanel(EditorState *editor)
+{
+    ImGui::Begin("Input latency");
+    ImGui::Checkbox("late-latch camera input", &editor->lateLatch);
+    if (ImGui::Checkbox("measure (adds glFinish per frame)", &editor->measureLatency)) {
+        editor->latencyCount = 0;
+        editor->latencyNext = 0;
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (editor->measureLatency) {
+        if (editor->latencyCount == 0) {
+            ImGui::TextDisabled("drag with the right mouse button in the scene");
+        } else {
+            float sum = 0.0f, lo = 1e9f, hi = 0.0f;
+            for (int i = 0; i < editor->latencyCount; i++) {
+                sum += editor->latencyMs[i];
+                lo = std::min(lo, editor->latencyMs[i]);
+                hi = std::max(hi, editor->latencyMs[i]);
+            }
+            ImGui::Text("input -> present: avg %.1f ms, min %.1f, max %.1f (%d frames)",
+                sum / editor->latencyCount, lo, hi, editor->latencyCount);
+            ImGui::PlotLines("##latency", editor->latencyMs, editor->latencyCount, editor->latencyNext % editor->latencyCount,
+                nullptr, 0.0f, hi, ImVec2(0, 60));
+        }
+        ImGui::TextDisabled("from the first mouse event applied to a frame until\nthat frame's swap has completed on the GPU");
+        if (editor->latencyThreaded)
+            ImGui::TextDisabled("render thread: the input of the snapshot shown,\nwhich was recorded the frame before");
+        else
+            ImGui::TextDisabled("main thread: the input of the frame just drawn");
+    }
+    ImGui::End();
 }
 
-static void InitImGui(GLFWwindow* window)
+static void DrawSimulationPanel(Scene *scene, EditorState *editor)
 {
-    IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
-    ImGuiIO& io = ImGui::GetIO();
-
-    // Enable docking + multi-viewport (requires docking branch or new enough ImGui)
-    io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
-    io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;
+    Simulation *sim = &editor->sim;
+    ImGui::Begin("Simulation");
+    int hz = (int)(1.0 / sim->step + 0.5);
+    if (ImGui::SliderInt("rate (Hz)", &hz, 10, 240)) {
+        sim->step = 1.0 / hz;
+        sim->accumulator = std::min(sim->accumulator, sim->step);
+    }
+    ImGui::SliderInt("max ticks per frame", &sim->maxStepsPerFrame, 1, 32);
+    ImGui::Checkbox("interpolate", &sim->interpolate);
+    ImGui::Text("t %.2f s, %llu ticks, %d this frame, alpha %.2f", sim->current.time,
+        (unsigned long long)sim->ticks, sim->ticksLastFrame, scene->simAlpha);
+    if (sim->droppedSeconds > 0.0) ImGui::Text("fell behind, %.2f s skipped", sim->droppedSeconds);
+    ImGui::End();
+}
 
-    ImGui::StyleColorsDark();
+static void DrawPostProcessPanel()
+{
+    PostProcess *pp = &g_post;
+    ImGui::Begin("Post-processing");
+    ImGui::Checkbox("enabled", &pp->enabled);
+    static const char *const tonemappers[] = {"clamp", "Reinhard", "ACES"};
+    ImGui::Combo("tonemap", &pp->tonemapper, tonemappers, 3);
+    ImGui::SliderFloat("exposure", &pp->exposure, 0.1f, 4.0f, "%.2f");
+    ImGui::Checkbox("FXAA", &pp->fxaa);
+    ImGui::Checkbox("SSAO (half res)", &pp->ssao);
+    if (pp->ssao) {
+        ImGui::SliderFloat("radius", &pp->ssaoRadius, 0.05f, 4.0f, "%.2f");
+        ImGui::SliderFloat("strength", &pp->ssaoStrength, 0.0f, 2.0f, "%.2f");
+    }
+    ImGui::Checkbox("bloom (half res)", &pp->bloom);
+    if (pp->bloom) {
+        ImGui::SliderFloat("threshold", &pp->bloomThreshold, 0.0f, 4.0f, "%.2f");
+        ImGui::SliderFloat("bloom strength", &pp->bloomStrength, 0.0f, 1.0f, "%.2f");
+        ImGui::SliderInt("blur rounds", &pp->bloomBlurs, 1, POST_MAX_BLURS);
+    }
 
-    ImGui_ImplGlfw_InitForOpenGL(window, true);
-    ImGui_ImplOpenGL3_Init("#version 330");
+    ImGui::SeparatorText("GPU time per pass");
+    ImGui::Checkbox("time passes", &g_frameGraph.timing);
+    if (g_frameGraph.timing && ImGui::BeginTable("pass_times", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("pass");
+        ImGui::TableSetupColumn("count");
+        ImGui::TableSetupColumn("ms");
+        ImGui::TableHeadersRow();
+        for (const FgPassTime &pt : g_frameGraph.passTimes) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(pt.name);
+            ImGui::TableNextColumn(); ImGui::Text("%d", pt.passes);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", pt.ms);
+        }
+        ImGui::EndTable();
+    }
+    if (g_frameGraph.timing && g_frameGraph.passTimes.empty())
+        ImGui::TextDisabled("the render thread's scene pass isn't timed here");
+    ImGui::End();
 }
 
-static void destroyImGui()
+// Windows of the open extra views. Their targets are sized here and drawn
+// later with the Scene window's; clicks pick from their last cull.
+static void DrawExtraViews(Scene *scene, EditorState *editor)
 {
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
+    for (int i = 0; i < EXTRA_VIEW_COUNT; i++) {
+        ExtraView *ev = &g_extraViews[i];
+        ev->shown = false;
+        if (!ev->open) continue;
+        if (!ImGui::Begin(ev->name, &ev->open)) {
+            ImGui::End();
+            continue;
+        }
+        if (ImGui::Checkbox("orthographic", &ev->camera.orthographic)) orbitcamera_invalidate(&ev->camera);
+        ImGui::SameLine();
+        if (ImGui::Button("Reset")) ResetExtraView(i, &scene->orbitCamera);
+        if (ImGui::IsWindowHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Right))
+            editor->dragCamera = &ev->camera;
+
+        ImVec2 avail = ImGui::GetContentRegionAvail();
+        gpuresources_resize_render_target(scene->gpu, ev->target, std::max((int)avail.x, 1), std::max((int)avail.y, 1));
+        const RenderTarget *t = gpuresources_render_target(scene->gpu, ev->target);
+        ImGui::Image((ImTextureID)(intptr_t)t->color, avail, ImVec2(0, 1), ImVec2(1, 0));
+        ev->shown = true;
+
+        if (ImGui::IsItemHovered() && ImGui::GetIO().MouseWheel != 0.0f)
+            orbitcamera_zoom(&ev->camera, ImGui::GetIO().MouseWheel);
+        const ImVec2 imageMin = ImGui::GetItemRectMin();
+        const ImVec2 imageSize = ImGui::GetItemRectSize();
+        if (ImGui::IsItemClicked(ImGuiMouseButton_Left) && imageSize.x > 0 && imageSize.y > 0) {
+            ImVec2 mouse = ImGui::GetMousePos();
+            glm::vec2 ndc((mouse.x - imageMin.x) / imageSize.x * 2.0f - 1.0f,
+                          1.0f - (mouse.y - imageMin.y) / imageSize.y * 2.0f);
+            glm::vec3 origin, dir;
+            orbitcamera_ray(&ev->camera, ndc, &origin, &dir);
+            scene->selected = scene_pick(scene, &ev->view, origin, dir);
+        }
+        ImGui::End();
+    }
 }
 
-static void RenderImGuiFrame(GLFWwindow* window, Scene *scene, SceneFBO *s)
+static void RenderImGuiFrame(GLFWwindow* window, Scene *scene, RenderTargetHandle sceneTarget, EditorState *editor)
 {
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
@@ -467,31 +850,102 @@ static void RenderImGuiFrame(GLFWwindow* window, Scene *scene, SceneFBO *s)
     ImGui::End();
 
     ImGui::Begin("Inspector");
-    RenderObj *o = &scene->renderObjs[scene->selected];
-    ImGui::DragFloat3("position", &o->position.x, 0.01f);
-    ImGui::DragFloat3("rotation", &o->rotation.x, 1.0);
-    ImGui::DragFloat3("scale", &o->scale.x, 0.01f);
-    ImGui::ColorEdit3("color", &o->color.x);
+    if (scene->selected >= 0) {
+        // edit a copy and only write back on change, so merely showing the
+        // inspector doesn't unshare chunks held by an autosave snapshot
+        InspectorField(scene, editor, "position", UNDO_POSITION, 0.01f);
+        InspectorField(scene, editor, "rotation", UNDO_ROTATION, 1.0f);
+        InspectorField(scene, editor, "scale", UNDO_SCALE, 0.01f);
+        InspectorField(scene, editor, "color", UNDO_COLOR, 0.0f);
+        // not journaled: undo entries only hold transforms and colors
+        bool isStatic = cow_get(scene->objects.isStatic, scene->selected) != 0;
+        if (ImGui::Checkbox("static", &isStatic)) cow_mut(&scene->objects.isStatic, scene->selected) = isStatic;
+        if (ImGui::Button("Delete")) {
+            // journal entries address objects by index
+            undo_clear(&editor->undo);
+            remove_render_object(scene, scene->selected);
+        }
+    }
     ImGui::End();
 
+    DrawResourceStats(scene);
+    DrawSceneFilePanel(scene, editor);
+    DrawEditPanel(scene, editor);
+    DrawGeneratorPanel(scene, editor);
+    DrawFlythroughPanel(scene, editor);
+    DrawLatencyPanel(editor);
+    DrawSimulationPanel(scene, editor);
+    DrawPostProcessPanel();
+
     ImGui::Begin("Hierarchy");
-    for(int i=0;i<scene->renderObjs.size();i++){
-        if(ImGui::Button(scene->renderObjs[i].name.c_str())){
-            scene->selected = i;
+    // only the rows in view are submitted, generated scenes can be huge
+    ImGuiListClipper clipper;
+    clipper.Begin((int)scene_object_count(scene));
+    while (clipper.Step()) {
+        for(int i=clipper.DisplayStart;i<clipper.DisplayEnd;i++){
+            ImGui::PushID(i);
+            if(ImGui::Button(cow_get(scene->objects.name, i).c_str())){
+                scene->selected = i;
+            }
+            ImGui::PopID();
         }
     }
     ImGui::End();
 
+    // before the Scene window, which draws them along with its own view
+    DrawExtraViews(scene, editor);
+
     ImGui::Begin("Scene");
+    if (ImGui::IsWindowHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Right))
+        editor->dragCamera = &scene->orbitCamera;
 
     ImVec2 avail = ImGui::GetContentRegionAvail();
     int w = (int)avail.x;
     int h = (int)avail.y;
 
-    CreateOrResizeSceneFBO(s, w, h);
-    RenderSceneToFBO(s, scene);
+    if (editor->lateLatch) {
+        // pick up motion that arrived while the UI above was built; the
+        // backends only queue ImGui events, so polling mid-frame is safe
+        glfwPollEvents();
+        double arrived = ApplyCameraInput(editor->dragCamera);
+        if (arrived >= 0.0) editor->latchedInput = arrived;
+    }
+    GLuint sceneTexture;
+    if (editor->renderThread.running) {
+        // shows the previous snapshot while the render thread draws this one
+        RenderThread *rt = &editor->renderThread;
+        rt->occlusion = g_occlusion.enabled;
+        rt->countFragments = editor->countFragments;
+        rt->latchedInput = editor->latchedInput;
+        renderthread_submit(rt, scene, &g_jobs, editor->frame, w, h, &editor->stats.cullMs, &editor->stats.recordMs);
+        editor->stats.visible = scene->view.visible.size();
+        renderthread_stats(rt, &editor->stats.submitMs, &editor->stats.gpuMs, &editor->stats.occlusion,
+                           &editor->stats.fragments);
+        sceneTexture = renderthread_display_texture(rt);
+        editor->presentedInput = renderthread_display_input(rt);
+        editor->sceneSampler = (GLFWwindow*)ImGui::GetWindowViewport()->PlatformHandle;
+    } else {
+        editor->presentedInput = editor->latchedInput;
+        gpuresources_resize_render_target(scene->gpu, sceneTarget, w, h);
+        RenderTarget *s = gpuresources_render_target(scene->gpu, sceneTarget);
+        SceneViewport *views[1 + EXTRA_VIEW_COUNT];
+        RenderTarget *targets[1 + EXTRA_VIEW_COUNT];
+        CmdList *lists[1 + EXTRA_VIEW_COUNT];
+        const int count = CollectViews(scene, s, views, targets, lists);
+        const bool counting = editor->countFragments && GLAD_GL_VERSION_4_6;
+        gputimer_begin(&editor->gpuTimer, editor->frame);
+        if (counting) gputimer_begin(&editor->fragmentCounter, editor->frame);
+        RenderSceneViews(scene, views, targets, lists, count, &editor->stats);
+        if (counting) gputimer_end(&editor->fragmentCounter);
+        gputimer_end(&editor->gpuTimer);
+        sceneTexture = s->color;
+    }
 
-    ImGui::Image((ImTextureID)(intptr_t)s->color, avail, ImVec2(0, 1), ImVec2(1, 0));
+    if (sceneTexture) ImGui::Image((ImTextureID)(intptr_t)sceneTexture, avail, ImVec2(0, 1), ImVec2(1, 0));
+    else ImGui::Dummy(avail);
+    const bool imageClicked = ImGui::IsItemClicked(ImGuiMouseButton_Left);
+    const ImVec2 imageMin = ImGui::GetItemRectMin();
+    const ImVec2 imageSize = ImGui::GetItemRectSize();
 
     ImGuizmo::BeginFrame();
     ImGuizmo::SetDrawlist();
@@ -503,24 +957,52 @@ static void RenderImGuiFrame(GLFWwindow* window, Scene *scene, SceneFBO *s)
         ImGui::GetWindowHeight()
     );
 
-    glm::mat4 view = orbitcamera_view(&scene->orbitCamera);
-    glm::mat4 proj = orbitcamera_proj(&scene->orbitCamera, (float)s->w / (float)s->h);
-    glm::mat4 model = renderobject_model(&scene->renderObjs[scene->selected]);
-
-    if(ImGuizmo::Manipulate(
-        glm::value_ptr(view),
-        glm::value_ptr(proj),
-        ImGuizmo::TRANSLATE,
-        ImGuizmo::LOCAL,
-        glm::value_ptr(model)
-    )){
-        scene->renderObjs[scene->selected].position = glm::vec3(model[3]);
+    // cached by the scene pass for this frame's aspect
+    OrbitCamera *cam = &scene->orbitCamera;
+    glm::mat4 view = cam->view;
+    glm::mat4 proj = cam->proj;
+    if (imageClicked && !ImGuizmo::IsOver() && imageSize.x > 0 && imageSize.y > 0) {
+        ImVec2 mouse = ImGui::GetMousePos();
+        glm::vec2 ndc((mouse.x - imageMin.x) / imageSize.x * 2.0f - 1.0f,
+                      1.0f - (mouse.y - imageMin.y) / imageSize.y * 2.0f);
+        glm::vec3 origin, dir;
+        orbitcamera_ray(cam, ndc, &origin, &dir);
+        if (g_gpuCull.enabled) scene_cull(scene);   // the GPU's result stays there
+        scene->selected = scene_pick(scene, &scene->view, origin, dir);
+    }
+    if (scene->selected >= 0) {
+        glm::mat4 model = renderobject_model(&scene->objects, scene->selected);
+
+        if(ImGuizmo::Manipulate(
+            glm::value_ptr(view),
+            glm::value_ptr(proj),
+            ImGuizmo::TRANSLATE,
+            ImGuizmo::LOCAL,
+            glm::value_ptr(model)
+        )){
+            glm::vec3 before = cow_get(scene->objects.position, scene->selected);
+            undo_begin_edit(&editor->undo, scene, UNDO_POSITION, (uint32_t)scene->selected, before);
+            cow_mut(&scene->objects.position, scene->selected) = glm::vec3(model[3]);
+        }
     }
 
     ImGui::End();
 
+    ImGuiIO &keys = ImGui::GetIO();
+    if (!ImGui::IsAnyItemActive() && !ImGuizmo::IsUsing()) {
+        undo_end_edit(&editor->undo, scene);
+        if (keys.KeyCtrl && !keys.WantTextInput) {
+            if (ImGui::IsKeyPressed(ImGuiKey_Y) || (keys.KeyShift && ImGui::IsKeyPressed(ImGuiKey_Z)))
+                undo_redo(&editor->undo, scene);
+            else if (ImGui::IsKeyPressed(ImGuiKey_Z))
+                undo_undo(&editor->undo, scene);
+        }
+    }
+
     // Render
     ImGui::Render();
+    const bool sceneThreaded = editor->renderThread.running;
+    if (sceneThreaded) renderthread_acquire(&editor->renderThread, editor->sceneSampler);
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
     auto io = ImGui::GetIO();
@@ -531,11 +1013,416 @@ static void RenderImGuiFrame(GLFWwindow* window, Scene *scene, SceneFBO *s)
         ImGui::RenderPlatformWindowsDefault();
         glfwMakeContextCurrent(backup);
     }
+    if (sceneThreaded) renderthread_release(&editor->renderThread, editor->sceneSampler);
 
 }
 
-double lastXPos = 0, lastYPos = 0;
-int main() {
+struct LaunchOptions {
+    const char *scenePath = "assets/scenes/default.scn";
+    bool generate = false;
+    SceneGenParams gen;
+    bool bench = false;
+    int benchFrames = 300;          // per object count
+    double benchSeconds = 10.0;     // per object count, whichever ends first
+    const char *benchOut = "bench.csv";
+    const char *recordPath = nullptr;   // record a flythrough in the editor, saved on exit
+    const char *playPath = nullptr;     // play a flythrough, write timings, exit
+    const char *playOut = "playback.csv";
+    int hashEvery = 0;                  // --play: hash the image every N frames
+    bool headless = false;              // hidden window, for automated runs
+    double simHz = 60.0;                // editor simulation rate
+    bool renderThread = true;           // editor scene pass on its own thread
+    bool occlusion = false;             // hardware occlusion culling
+    bool gpuCull = false;               // compute culling + indirect draws
+    bool depthPrepass = false;
+    bool frontToBack = true;
+    bool staticBatching = false;
+    bool impostors = false;
+    bool post = false;                  // tonemap + FXAA chain after the scene pass
+    bool software = false;              // scene pass drawn by the CPU rasterizer
+    bool vulkan = false;                // main view drawn through the Vulkan backend
+    int aoRays = 64;                    // baked per mesh vertex, 0 for none
+    int views = 1;                      // main view plus up to EXTRA_VIEW_COUNT others
+    int meshBudgetMiB = 0;              // GPU memory for OBJ meshes, 0 for no limit
+};
+
+static void PrintUsage(const char *exe)
+{
+    std::cerr << "usage: " << exe << " [scene.scn|scene.scnb] [options]\n"
+                 "  --generate N        replace the scene with N generated objects\n"
+                 "  --layout L          grid | random | clustered\n"
+                 "  --spacing S         distance between neighbours\n"
+                 "  --seed S\n"
+                 "  --motion            animate generated objects\n"
+                 "  --static            generate static objects (unless they move)\n"
+                 "  --bench             sweep 1k..1M generated objects, then exit\n"
+                 "  --bench-frames N    frames measured per object count\n"
+                 "  --bench-seconds S   time limit per object count\n"
+                 "  --bench-out FILE    CSV results (default bench.csv)\n"
+                 "  --record FILE       record the camera every frame, saved on exit\n"
+                 "  --play FILE         play a recorded camera path, then exit\n"
+                 "  --play-out FILE     per-frame CSV timings (default playback.csv)\n"
+                 "  --hash-every N      with --play, also hash the rendered image every N frames\n"
+                 "  --sim-hz HZ         simulation rate in the editor (default 60)\n"
+                 "  --no-render-thread  draw the editor's scene on the main thread\n"
+                 "  --occlusion         cull hidden objects with occlusion queries\n"
+                 "  --gpu-cull          cull and draw from compute shaders (GL 4.3+)\n"
+                 "  --depth-prepass     lay down depth before shading, then test GL_EQUAL\n"
+                 "  --static-batching   draw static objects from pre-transformed merged chunks\n"
+                 "  --impostors         draw distant objects as octahedral impostor billboards\n"
+                 "  --post              post-process: tonemap and FXAA, SSAO and bloom from the panel\n"
+                 "  --software          draw the scene with the tiled CPU rasterizer, not GL\n"
+                 "  --vulkan            draw the main view through Vulkan (MYGL_VULKAN builds)\n"
+                 "  --ao-rays N         rays per vertex for baked ambient occlusion (default 64, 0 off)\n"
+                 "  --mesh-budget MB    evict meshes out of view past this much GPU memory (default no limit)\n"
+                 "  --views N           also draw the top (2) and side (3) views, culled together\n"
+                 "  --no-front-to-back  draw in state order only, not nearest first\n"
+                 "  --headless          don't show the window\n";
+}
+
+static bool ParseArgs(int argc, char** argv, LaunchOptions *opt)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool takesValue = arg == "--generate" || arg == "--layout" || arg == "--spacing" || arg == "--seed" ||
+                          arg == "--bench-frames" || arg == "--bench-seconds" || arg == "--bench-out" ||
+                          arg == "--record" || arg == "--play" || arg == "--play-out" || arg == "--hash-every" ||
+                          arg == "--sim-hz" || arg == "--views" || arg == "--ao-rays" ||
+                          arg == "--mesh-budget";
+        if (takesValue && !value) {
+            std::cerr << arg << " needs a value\n";
+            return false;
+        }
+        if (arg == "--generate") {
+            opt->generate = true;
+            opt->gen.count = (uint32_t)std::strtoul(value, nullptr, 10);
+        } else if (arg == "--layout") {
+            if (!scenegen_parse_layout(value, &opt->gen.layout)) {
+                std::cerr << "unknown layout " << value << "\n";
+                return false;
+            }
+        } else if (arg == "--spacing") {
+            opt->gen.spacing = std::strtof(value, nullptr);
+        } else if (arg == "--seed") {
+            opt->gen.seed = (uint32_t)std::strtoul(value, nullptr, 10);
+        } else if (arg == "--motion") {
+            opt->gen.motion = true;
+        } else if (arg == "--static") {
+            opt->gen.markStatic = true;
+        } else if (arg == "--bench") {
+            opt->bench = true;
+        } else if (arg == "--bench-frames") {
+            opt->benchFrames = std::max(1, std::atoi(value));
+        } else if (arg == "--bench-seconds") {
+            opt->benchSeconds = std::strtod(value, nullptr);
+        } else if (arg == "--bench-out") {
+            opt->benchOut = value;
+        } else if (arg == "--record") {
+            opt->recordPath = value;
+        } else if (arg == "--play") {
+            opt->playPath = value;
+        } else if (arg == "--play-out") {
+            opt->playOut = value;
+        } else if (arg == "--hash-every") {
+            opt->hashEvery = std::max(0, std::atoi(value));
+        } else if (arg == "--sim-hz") {
+            opt->simHz = std::strtod(value, nullptr);
+            if (!(opt->simHz >= 1.0 && opt->simHz <= 1000.0)) {
+                std::cerr << "--sim-hz must be between 1 and 1000\n";
+                return false;
+            }
+        } else if (arg == "--no-render-thread") {
+            opt->renderThread = false;
+        } else if (arg == "--gpu-cull") {
+            opt->gpuCull = true;
+        } else if (arg == "--occlusion") {
+            opt->occlusion = true;
+        } else if (arg == "--depth-prepass") {
+            opt->depthPrepass = true;
+        } else if (arg == "--static-batching") {
+            opt->staticBatching = true;
+        } else if (arg == "--impostors") {
+            opt->impostors = true;
+        } else if (arg == "--post") {
+            opt->post = true;
+        } else if (arg == "--software") {
+            opt->software = true;
+        } else if (arg == "--vulkan") {
+            opt->vulkan = true;
+        } else if (arg == "--ao-rays") {
+            opt->aoRays = std::max(0, std::atoi(value));
+        } else if (arg == "--mesh-budget") {
+            opt->meshBudgetMiB = std::max(0, std::atoi(value));
+        } else if (arg == "--views") {
+            opt->views = std::atoi(value);
+            if (opt->views < 1 || opt->views > 1 + EXTRA_VIEW_COUNT) {
+                std::cerr << "--views must be between 1 and " << 1 + EXTRA_VIEW_COUNT << "\n";
+                return false;
+            }
+        } else if (arg == "--no-front-to-back") {
+            opt->frontToBack = false;
+        } else if (arg == "--headless") {
+            opt->headless = true;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            std::cerr << "unknown option " << arg << "\n";
+            return false;
+        } else {
+            opt->scenePath = argv[i];
+            continue;
+        }
+        if (takesValue) i++;
+    }
+    return true;
+}
+
+// Scene pass straight to the window, without the editor UI. Open extra views
+// are drawn too, at the same size, but only the main one is shown. Returns
+// the target it rendered into.
+static RenderTarget* RenderSceneToWindow(GLFWwindow *window, Scene *scene, RenderTargetHandle target, GpuTimer *timer,
+                                int64_t frame, RenderStats *stats)
+{
+    int w, h;
+    glfwGetFramebufferSize(window, &w, &h);
+    w = std::max(w, 1);
+    h = std::max(h, 1);
+    gpuresources_resize_render_target(scene->gpu, target, w, h);
+    for (ExtraView &ev : g_extraViews) {
+        if (ev.open) gpuresources_resize_render_target(scene->gpu, ev.target, w, h);
+    }
+    RenderTarget *rt = gpuresources_render_target(scene->gpu, target);
+    SceneViewport *views[1 + EXTRA_VIEW_COUNT];
+    RenderTarget *targets[1 + EXTRA_VIEW_COUNT];
+    CmdList *lists[1 + EXTRA_VIEW_COUNT];
+    const int count = CollectViews(scene, rt, views, targets, lists);
+
+    gputimer_begin(timer, frame);
+    RenderSceneViews(scene, views, targets, lists, count, stats);
+    gputimer_end(timer);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, rt->fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, rt->w, rt->h, 0, 0, rt->w, rt->h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return rt;
+}
+
+// FNV-1a over the color attachment, to check that an optimisation renders
+// exactly the same image. Stalls until the GPU has finished the frame.
+static uint64_t HashRenderTarget(const RenderTarget *rt)
+{
+    std::vector<unsigned char> pixels((size_t)rt->w * rt->h * 4);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, rt->fbo);
+    glReadPixels(0, 0, rt->w, rt->h, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char b : pixels) {
+        hash ^= b;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Renders generated scenes of growing size straight to the window, without
+// the editor UI, and writes average frame, cull and submit times per size.
+static bool RunBenchmark(GLFWwindow *window, Scene *scene, RenderTargetHandle target, const LaunchOptions *opt)
+{
+    static const uint32_t COUNTS[] = {1000, 3000, 10000, 30000, 100000, 300000, 1000000};
+    static const int WARMUP_FRAMES = 10;
+
+    FILE *csv = std::fopen(opt->benchOut, "w");
+    if (!csv) {
+        std::cerr << "can't write " << opt->benchOut << "\n";
+        return false;
+    }
+    std::fprintf(csv, "objects,layout,motion,frames,frame_ms,cull_ms,record_ms,submit_ms,gpu_ms,visible\n");
+    std::printf("%10s %8s %10s %10s %10s %10s %10s %10s\n", "objects", "frames", "frame ms", "cull ms", "record ms",
+        "submit ms", "gpu ms", "visible");
+
+    glfwSwapInterval(0);
+    GpuTimer timer;
+    gputimer_initialize(&timer);
+    std::vector<GpuTiming> gpuTimes;
+    SceneGen gen;
+    gen.params = opt->gen;
+    for (uint32_t count : COUNTS) {
+        gen.params.count = count;
+        scenegen_generate(&gen, scene);
+        scenegen_frame_camera(&gen, scene);
+        for (int v = 0; v < EXTRA_VIEW_COUNT; v++) ResetExtraView(v, &scene->orbitCamera);
+        staticbatch_finish(&g_staticBatch, scene);
+        impostor_prepare(scene);
+
+        RenderStats sum = {};
+        int frames = 0;
+        double start = 0.0;
+        for (int f = 0; f < WARMUP_FRAMES + opt->benchFrames; f++) {
+            if (f == WARMUP_FRAMES) start = glfwGetTime();
+            double t0 = glfwGetTime();
+            glfwPollEvents();
+            if (glfwWindowShouldClose(window)) break;
+            gpuresources_begin_frame(scene->gpu);
+
+            simulation_evaluate(scene, &gen, t0);
+            staticbatch_update(&g_staticBatch, scene);
+            impostor_prepare(scene);
+            UpdateResidency(scene);
+            RenderStats stats;
+            // warmup frames get a negative id so their GPU times are dropped
+            RenderSceneToWindow(window, scene, target, &timer, f < WARMUP_FRAMES ? -1 - f : f, &stats);
+
+            gpuresources_end_frame(scene->gpu);
+            glfwSwapBuffers(window);
+
+            if (f < WARMUP_FRAMES) continue;
+            sum.frameMs += (glfwGetTime() - t0) * 1000.0;
+            sum.cullMs += stats.cullMs;
+            sum.recordMs += stats.recordMs;
+            sum.submitMs += stats.submitMs;
+            sum.visible += stats.visible;
+            frames++;
+            if (glfwGetTime() - start > opt->benchSeconds) break;
+        }
+        if (frames == 0) break;
+
+        gpuTimes.clear();
+        gputimer_collect(&timer, true, &gpuTimes);
+        int gpuFrames = 0;
+        for (const GpuTiming &g : gpuTimes) {
+            if (g.frame < 0) continue;
+            sum.gpuMs += g.ms;
+            gpuFrames++;
+        }
+        sum.gpuMs /= std::max(gpuFrames, 1);
+
+        std::fprintf(csv, "%u,%s,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%zu\n", count, scenegen_layout_name(gen.params.layout),
+            gen.params.motion ? 1 : 0, frames, sum.frameMs / frames, sum.cullMs / frames, sum.recordMs / frames,
+            sum.submitMs / frames, sum.gpuMs, sum.visible / frames);
+        std::printf("%10u %8d %10.3f %10.3f %10.3f %10.3f %10.3f %10zu\n", count, frames, sum.frameMs / frames,
+            sum.cullMs / frames, sum.recordMs / frames, sum.submitMs / frames, sum.gpuMs, sum.visible / frames);
+        std::fflush(stdout);
+    }
+    gputimer_shutdown(&timer);
+    std::fclose(csv);
+    std::cout << "wrote " << opt->benchOut << "\n";
+    return true;
+}
+
+// Plays a recorded camera path one key per frame with a fixed timestep and
+// writes per-frame CPU and GPU timings, heap allocations and (optionally)
+// image hashes; compare two runs with perfcompare.
+static bool RunPlayback(GLFWwindow *window, Scene *scene, SceneGen *gen, RenderTargetHandle target, const LaunchOptions *opt)
+{
+    CameraPath path;
+    if (!camerapath_load(&path, opt->playPath)) return false;
+
+    glfwSwapInterval(0);
+    GpuTimer timer;
+    gputimer_initialize(&timer);
+    std::vector<RenderStats> frames;
+    std::vector<uint64_t> allocs;
+    std::vector<uint64_t> hashes;   // 0 = not hashed
+    frames.reserve(path.keys.size());
+    allocs.reserve(path.keys.size());
+    hashes.reserve(path.keys.size());
+    std::vector<GpuTiming> gpuTimes;
+    gpuTimes.reserve(path.keys.size());
+    staticbatch_finish(&g_staticBatch, scene);
+    impostor_prepare(scene);
+
+    for (size_t f = 0; f < path.keys.size(); f++) {
+        double t0 = glfwGetTime();
+        uint64_t allocs0 = allocstats_count();
+        glfwPollEvents();
+        if (glfwWindowShouldClose(window)) break;
+        gpuresources_begin_frame(scene->gpu);
+
+        camerapath_apply(&path, f, &scene->orbitCamera);
+        for (int v = 0; v < EXTRA_VIEW_COUNT; v++) ResetExtraView(v, &scene->orbitCamera);
+        simulation_evaluate(scene, gen, f * path.dt);
+        staticbatch_update(&g_staticBatch, scene);
+        impostor_prepare(scene);
+        UpdateResidency(scene);
+        RenderStats stats = {};
+        RenderTarget *rt = RenderSceneToWindow(window, scene, target, &timer, (int64_t)f, &stats);
+
+        gpuresources_end_frame(scene->gpu);
+        glfwSwapBuffers(window);
+        stats.frameMs = (glfwGetTime() - t0) * 1000.0;
+        frames.push_back(stats);
+        gputimer_collect(&timer, false, &gpuTimes);
+        allocs.push_back(allocstats_count() - allocs0);
+
+        // after the timings, so the readback stall isn't counted
+        bool hash = opt->hashEvery > 0 && (f % opt->hashEvery == 0 || f + 1 == path.keys.size());
+        hashes.push_back(hash ? HashRenderTarget(rt) : 0);
+    }
+    gputimer_collect(&timer, true, &gpuTimes);
+    gputimer_shutdown(&timer);
+    for (const GpuTiming &g : gpuTimes) {
+        if ((size_t)g.frame < frames.size()) frames[g.frame].gpuMs = g.ms;
+    }
+
+    FILE *csv = std::fopen(opt->playOut, "w");
+    if (!csv) {
+        std::cerr << "can't write " << opt->playOut << "\n";
+        return false;
+    }
+    // '#' lines say what was measured; perfcompare checks they match
+    std::fprintf(csv, "# path %s\n", opt->playPath);
+    if (opt->generate) {
+        std::fprintf(csv, "# scene generated %u %s seed %u%s\n", opt->gen.count, scenegen_layout_name(opt->gen.layout),
+            opt->gen.seed, opt->gen.motion ? " motion" : "");
+    } else {
+        std::fprintf(csv, "# scene %s\n", opt->scenePath);
+    }
+    std::fprintf(csv, "# objects %zu\n", scene_object_count(scene));
+    if (g_occlusion.enabled) std::fprintf(csv, "# occlusion culling\n");
+    if (g_gpuCull.enabled) std::fprintf(csv, "# gpu-driven culling\n");
+    if (scene->depthPrepass) std::fprintf(csv, "# depth pre-pass\n");
+    if (scene->staticBatching) std::fprintf(csv, "# static batching\n");
+    if (scene->impostors.enabled) std::fprintf(csv, "# impostors below %.0f px\n", scene->impostors.switchPixels);
+    if (opt->views > 1) std::fprintf(csv, "# views %d\n", opt->views);
+    if (g_post.enabled) std::fprintf(csv, "# post-processing\n");
+    if (g_software.enabled) std::fprintf(csv, "# software rasterizer\n");
+    if (g_vulkan.enabled) std::fprintf(csv, "# vulkan %s\n", g_vulkan.device.c_str());
+    if (g_residency.budget) std::fprintf(csv, "# mesh budget %zu MiB\n", g_residency.budget >> 20);
+    if (!scene->sortFrontToBack) std::fprintf(csv, "# state order only\n");
+    std::fprintf(csv, "frame,frame_ms,cull_ms,record_ms,submit_ms,gpu_ms,visible,allocs,rt_peak_kib,image_hash\n");
+    double cpu = 0.0, gpu = 0.0, swMs = 0.0;
+    uint64_t swTriangles = 0, swPixels = 0;
+    for (size_t f = 0; f < frames.size(); f++) {
+        const RenderStats &st = frames[f];
+        std::fprintf(csv, "%zu,%.4f,%.4f,%.4f,%.4f,%.4f,%zu,%llu,%zu,", f, st.frameMs, st.cullMs, st.recordMs,
+            st.submitMs, st.gpuMs, st.visible, (unsigned long long)allocs[f], st.targetBytes / 1024);
+        if (hashes[f]) std::fprintf(csv, "%016llx", (unsigned long long)hashes[f]);
+        std::fputc('\n', csv);
+        cpu += st.frameMs;
+        gpu += st.gpuMs;
+        swMs += st.software.setupMs + st.software.rasterMs;
+        swTriangles += st.software.triangles;
+        swPixels += st.software.pixels;
+    }
+    std::fclose(csv);
+
+    size_t n = std::max(frames.size(), (size_t)1);
+    std::printf("played %zu / %zu frames: frame %.3f ms, gpu %.3f ms on average; wrote %s\n",
+        frames.size(), path.keys.size(), cpu / n, gpu / n, opt->playOut);
+    if (swMs > 0.0) {
+        std::printf("software rasterizer: %.1f Mtris/s, %.1f Mpixels/s shaded on %d threads\n",
+            swTriangles / swMs / 1000.0, swPixels / swMs / 1000.0, jobs_thread_count(&g_jobs));
+    }
+    return frames.size() == path.keys.size();
+}
+
+int main(int argc, char** argv) {
+  LaunchOptions options;
+  if (!ParseArgs(argc, argv, &options)) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
   glfwSetErrorCallback(glfw_error_callback);
   if (!glfwInit()) return 1;
 
@@ -543,6 +1430,7 @@ int main() {
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  if (options.headless) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
   GLFWwindow* window = glfwCreateWindow(1280, 720, "Models", nullptr, nullptr);
   if (!window) {
@@ -561,50 +1449,205 @@ int main() {
 
   glEnable(GL_DEPTH_TEST);
 
-  SceneFBO s;
-  CreateOrResizeSceneFBO(&s, 1000, 800);
+  GpuResources gpu;
+  gpuresources_initialize(&gpu);
+  jobs_initialize(&g_jobs);
+  g_occlusion.enabled = options.occlusion;
+  gpucull_initialize(&g_gpuCull);
+  if (options.gpuCull && !g_gpuCull.available)
+      std::cerr << "GPU-driven culling needs GL 4.3, using the CPU path\n";
+  g_gpuCull.enabled = options.gpuCull && g_gpuCull.available;
+  framegraph_initialize(&g_frameGraph, &gpu);
+  postprocess_initialize(&g_post, &gpu);
+  g_post.enabled = options.post;
+  swraster_initialize(&g_software, &g_jobs);
+  g_software.enabled = options.software;
+  if (options.vulkan) vkbackend_initialize(&g_vulkan, &g_jobs);
+  if (options.vulkan && !g_vulkan.available) std::cerr << "Vulkan backend unavailable, drawing with GL\n";
+  g_vulkan.enabled = options.vulkan && g_vulkan.available;
+  g_residency.budget = (size_t)options.meshBudgetMiB << 20;
+
+  RenderTargetHandle sceneTarget = gpuresources_create_render_target(&gpu, 1000, 800, false);
   Scene scene;
-  create_scene(&scene);
+  create_scene(&scene, &gpu);
+  scene.depthPrepass = options.depthPrepass;
+  scene.sortFrontToBack = options.frontToBack;
+  scene.staticBatching = options.staticBatching;
+  scene.impostors.enabled = options.impostors;
+  scene.meshCache.aoRays = options.aoRays;
+  scene.meshCache.jobs = &g_jobs;
+  for (int v = 0; v < EXTRA_VIEW_COUNT; v++) {
+    ExtraView *ev = &g_extraViews[v];
+    ev->target = gpuresources_create_render_target(&gpu, 1, 1, false);
+    ev->view.camera = &ev->camera;
+    ev->view.height = 1;
+    ev->open = ev->shown = v + 1 < options.views;
+  }
 
-  glUseProgram(scene.prog);
+  SceneGen gen;
+  gen.params = options.gen;
+  if (!options.bench) {
+    if (options.generate) {
+      scenegen_generate(&gen, &scene);
+      scenegen_frame_camera(&gen, &scene);
+    } else {
+      scene_load_file(&scene, options.scenePath);
+    }
+  }
+  for (int v = 0; v < EXTRA_VIEW_COUNT; v++) ResetExtraView(v, &scene.orbitCamera);
+
+  if (options.bench || options.playPath) {
+    bool ok = options.bench ? RunBenchmark(window, &scene, sceneTarget, &options)
+                            : RunPlayback(window, &scene, &gen, sceneTarget, &options);
+    staticbatch_shutdown(&g_staticBatch, &scene);
+    residency_shutdown(&g_residency);
+    delete_scene(&scene);
+    gpuresources_release(&gpu, sceneTarget);
+    for (ExtraView &ev : g_extraViews) gpuresources_release(&gpu, ev.target);
+    occlusion_shutdown(&g_occlusion);
+    gpucull_shutdown(&g_gpuCull);
+    postprocess_shutdown(&g_post, &gpu);
+    swraster_shutdown(&g_software);
+    vkbackend_shutdown(&g_vulkan);
+    framegraph_shutdown(&g_frameGraph);
+    gpuresources_shutdown(&gpu);
+    jobs_shutdown(&g_jobs);
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return ok ? 0 : 1;
+  }
 
+  EditorState editor;
+  editor.saver.lastAutosave = glfwGetTime();
+  editor.undoBudgetMiB = 16;
+  undo_initialize(&editor.undo, (size_t)editor.undoBudgetMiB << 20);
+  std::strncpy(editor.scenePath, options.scenePath, sizeof(editor.scenePath) - 1);
+  editor.scenePath[sizeof(editor.scenePath) - 1] = '\0';
+  editor.gen = std::move(gen);
+  editor.stats = {};
+  gputimer_initialize(&editor.gpuTimer);
+  if (GLAD_GL_VERSION_4_6) gputimer_initialize(&editor.fragmentCounter, GL_FRAGMENT_SHADER_INVOCATIONS);
+  editor.countFragments = false;
+  editor.frame = 0;
+  const char *flythroughPath = options.recordPath ? options.recordPath : "flythrough.cam";
+  std::strncpy(editor.flythroughPath, flythroughPath, sizeof(editor.flythroughPath) - 1);
+  editor.flythroughPath[sizeof(editor.flythroughPath) - 1] = '\0';
+  editor.recording = options.recordPath != nullptr;
+  editor.playing = false;
+  editor.playFrame = 0;
+
+  editor.dragCamera = &scene.orbitCamera;
+  editor.lateLatch = true;
+  editor.measureLatency = false;
+  editor.latchedInput = -1.0;
+  editor.presentedInput = -1.0;
+  editor.latencyThreaded = false;
+  editor.latencyCount = 0;
+  editor.latencyNext = 0;
+
+  // before InitImGui, whose backend chains to callbacks installed earlier
+  glfwSetCursorPosCallback(window, cursor_pos_callback);
   InitImGui(window);
-  float rotation = 0;
+  editor.renderThreaded = options.renderThread;
+  g_frameGraph.timing = true;
+  editor.sceneSampler = window;
+  editor.sim.step = 1.0 / options.simHz;
+  simulation_initialize(&editor.sim, &scene);
+  double lastFrame = glfwGetTime();
+  double frameSeconds = 0.0;
 
   while (!glfwWindowShouldClose(window)) {
     glfwPollEvents();
+    gpuresources_begin_frame(&gpu);
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
       glfwSetWindowShouldClose(window, GLFW_TRUE);
-    float t = (float)glfwGetTime();
 
-    if(glfwGetKey(window, GLFW_KEY_LEFT)){
-        rotation -= 0.01;
+    editor.latchedInput = -1.0;
+    editor.presentedInput = -1.0;
+    if (!editor.lateLatch) editor.latchedInput = ApplyCameraInput(editor.dragCamera);
+    // per second rather than per frame, so zoom speed doesn't follow the frame rate
+    if(glfwGetKey(window, GLFW_KEY_EQUAL)){
+        orbitcamera_zoom(&scene.orbitCamera, 6.0f * (float)frameSeconds);
     }
-    if(glfwGetKey(window, GLFW_KEY_RIGHT)){
-        rotation += 0.01;
+    if(glfwGetKey(window, GLFW_KEY_MINUS)){
+        orbitcamera_zoom(&scene.orbitCamera, -6.0f * (float)frameSeconds);
     }
-    double xpos, ypos;
-    glfwGetCursorPos(window, &xpos, &ypos);
-
-    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS)
-    {
-        orbitcamera_rotate(&scene.orbitCamera, xpos - lastXPos, -(ypos - lastYPos));
+    if (editor.playing) {
+        // one key per rendered frame, like --play
+        camerapath_apply(&editor.flythrough, editor.playFrame, &scene.orbitCamera);
+        if (++editor.playFrame >= editor.flythrough.keys.size()) editor.playing = false;
     }
-    if(glfwGetKey(window, GLFW_KEY_EQUAL)){
-        orbitcamera_zoom(&scene.orbitCamera, 0.1);
+    simulation_advance(&editor.sim, &scene, &editor.gen, frameSeconds);
+    scenesaver_autosave(&editor.saver, &scene, glfwGetTime());
+    staticbatch_update(&g_staticBatch, &scene);
+    impostor_prepare(&scene);
+    UpdateResidency(&scene);
+    // the GPU-driven path keeps its buffers in the main context, and the
+    // render thread draws a single view
+    const bool threaded = editor.renderThreaded && !g_gpuCull.enabled && !ExtraViewsOpen() && !g_post.enabled &&
+                          !g_software.enabled && !g_vulkan.enabled;
+    if (threaded && !editor.renderThread.running) {
+        if (!renderthread_start(&editor.renderThread, window, &gpu)) {
+            std::cerr << "Can't create the render thread's context, rendering on the main thread\n";
+            editor.renderThreaded = false;
+        }
+    } else if (!threaded && editor.renderThread.running) {
+        renderthread_stop(&editor.renderThread);
     }
-    if(glfwGetKey(window, GLFW_KEY_MINUS)){
-        orbitcamera_zoom(&scene.orbitCamera, -0.1);
+    RenderImGuiFrame(window, &scene, sceneTarget, &editor);
+    // the camera as it was rendered, input included
+    if (editor.recording) camerapath_record(&editor.flythrough, &scene.orbitCamera);
+    gpuresources_end_frame(&gpu);
+    glfwSwapBuffers(window);
+
+    if (editor.measureLatency && editor.renderThread.running != editor.latencyThreaded) {
+        // the two paths present different frames, don't mix their samples
+        editor.latencyThreaded = editor.renderThread.running;
+        editor.latencyCount = 0;
+        editor.latencyNext = 0;
+    }
+    if (editor.measureLatency && editor.presentedInput >= 0.0) {
+        // with vsync the swap only completes at the flip, so this is close
+        // to when the frame reached the screen
+        glFinish();
+        editor.latencyMs[editor.latencyNext] = (float)((glfwGetTime() - editor.presentedInput) * 1000.0);
+        editor.latencyNext = (editor.latencyNext + 1) % 120;
+        editor.latencyCount = std::min(editor.latencyCount + 1, 120);
     }
-    float aspect = (s.h == 0) ? 1.0f : (float)s.w / (float)s.h;
-    scene.animLight = scene.lightPos + glm::vec3(std::cos(t) * 0.4f, 0.0f, std::sin(t) * 0.4f);
 
-    RenderImGuiFrame(window, &scene, &s);
-    lastXPos = xpos;
-    lastYPos = ypos;
-    glfwSwapBuffers(window);
+    double now = glfwGetTime();
+    frameSeconds = now - lastFrame;
+    editor.stats.frameMs = frameSeconds * 1000.0;
+    lastFrame = now;
+
+    std::vector<GpuTiming> gpuTimes;
+    gputimer_collect(&editor.gpuTimer, false, &gpuTimes);
+    if (!gpuTimes.empty()) editor.stats.gpuMs = gpuTimes.back().ms;
+    if (GLAD_GL_VERSION_4_6) {
+        gpuTimes.clear();
+        gputimer_collect(&editor.fragmentCounter, false, &gpuTimes);
+        if (!gpuTimes.empty()) editor.stats.fragments = gpuTimes.back().value;
+    }
+    editor.frame++;
   }
+  if (editor.recording) camerapath_save(&editor.flythrough, editor.flythroughPath);
+  scenesaver_wait(&editor.saver);
+  renderthread_stop(&editor.renderThread);
+  gputimer_shutdown(&editor.gpuTimer);
+  if (GLAD_GL_VERSION_4_6) gputimer_shutdown(&editor.fragmentCounter);
+  staticbatch_shutdown(&g_staticBatch, &scene);
+  residency_shutdown(&g_residency);
   delete_scene(&scene);
+  gpuresources_release(&gpu, sceneTarget);
+  for (ExtraView &ev : g_extraViews) gpuresources_release(&gpu, ev.target);
+  occlusion_shutdown(&g_occlusion);
+  gpucull_shutdown(&g_gpuCull);
+  postprocess_shutdown(&g_post, &gpu);
+  swraster_shutdown(&g_software);
+  vkbackend_shutdown(&g_vulkan);
+  framegraph_shutdown(&g_frameGraph);
+  gpuresources_shutdown(&gpu);
+  jobs_shutdown(&g_jobs);
   destroyImGui();
 
   glfwDestroyWindow(window);
@@ -0,0 +1,99 @@
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool mappedfile_open(MappedFile *mf, const std::string &path)
+{
+    mf->data = nullptr;
+    mf->size = 0;
+    mf->file = nullptr;
+    mf->mapping = nullptr;
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    mf->data = (const unsigned char*)view;
+    mf->size = (size_t)size.QuadPart;
+    mf->file = file;
+    mf->mapping = mapping;
+    return true;
+}
+
+void mappedfile_close(MappedFile *mf)
+{
+    if (mf->data) UnmapViewOfFile(mf->data);
+    if (mf->mapping) CloseHandle((HANDLE)mf->mapping);
+    if (mf->file) CloseHandle((HANDLE)mf->file);
+    mf->data = nullptr;
+    mf->size = 0;
+    mf->file = nullptr;
+    mf->mapping = nullptr;
+}
+
+#else
+
+bool mappedfile_open(MappedFile *mf, const std::string &path)
+{
+    mf->data = nullptr;
+    mf->size = 0;
+    mf->fd = open(path.c_str(), O_RDONLY);
+    if (mf->fd < 0) return false;
+
+    struct stat st;
+    if (fstat(mf->fd, &st) != 0 || st.st_size == 0) {
+        close(mf->fd);
+        mf->fd = -1;
+        return false;
+    }
+    void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, mf->fd, 0);
+    if (p == MAP_FAILED) {
+        close(mf->fd);
+        mf->fd = -1;
+        return false;
+    }
+    // whole-file sequential reads are the common case
+    madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    mf->data = (const unsigned char*)p;
+    mf->size = (size_t)st.st_size;
+    return true;
+}
+
+void mappedfile_close(MappedFile *mf)
+{
+    if (mf->data) munmap((void*)mf->data, mf->size);
+    if (mf->fd >= 0) close(mf->fd);
+    mf->data = nullptr;
+    mf->size = 0;
+    mf->fd = -1;
+}
+
+#endif
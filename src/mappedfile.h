@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file.
+struct MappedFile
+{
+    const unsigned char *data;
+    size_t size;
+#ifdef _WIN32
+    void *file;
+    void *mapping;
+#else
+    int fd;
+#endif
+};
+
+bool mappedfile_open(MappedFile *mf, const std::string &path);
+
+void mappedfile_close(MappedFile *mf);
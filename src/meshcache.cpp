@@ -0,0 +1,141 @@
+#include "meshcache.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <map>
+
+#include "gpuresources.h"
+#include "mappedfile.h"
+#include "objloader.h"
+
+static const char MESH_MAGIC[8] = {'M', 'Y', 'G', 'L', 'M', 'S', 'H', 0};
+static const uint32_t MESH_VERSION = 1;
+
+// Cache file: this header, then the vertices as floats.
+struct MeshFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t floatsPerVertex;
+    uint32_t vertexCount;
+    int32_t aoRays;
+    int64_t sourceTime;     // the OBJ's modification time when baked
+};
+
+static std::string cache_path(const std::string &dir, const std::string &objPath)
+{
+    std::string name = objPath;
+    for (char &c : name) {
+        if (c == '/' || c == '\\' || c == ':') c = '_';
+    }
+    return dir + "/" + name + ".mesh";
+}
+
+static int64_t source_time(const std::string &path)
+{
+    std::error_code ec;
+    auto t = std::filesystem::last_write_time(path, ec);
+    return ec ? 0 : (int64_t)t.time_since_epoch().count();
+}
+
+static bool load_cached(const std::string &file, int64_t sourceTime, int aoRays, std::vector<float> *vertices)
+{
+    MappedFile mf;
+    if (!mappedfile_open(&mf, file)) return false;
+    MeshFileHeader header;
+    bool ok = mf.size >= sizeof(header);
+    if (ok) {
+        std::memcpy(&header, mf.data, sizeof(header));
+        ok = std::memcmp(header.magic, MESH_MAGIC, sizeof(MESH_MAGIC)) == 0
+          && header.version == MESH_VERSION
+          && header.floatsPerVertex == MESH_VERTEX_FLOATS
+          && header.aoRays == aoRays
+          && header.sourceTime == sourceTime
+          && mf.size == sizeof(header) + (size_t)header.vertexCount * MESH_VERTEX_FLOATS * sizeof(float);
+    }
+    if (ok) {
+        vertices->resize((size_t)header.vertexCount * MESH_VERTEX_FLOATS);
+        std::memcpy(vertices->data(), mf.data + sizeof(header), vertices->size() * sizeof(float));
+    }
+    mappedfile_close(&mf);
+    return ok;
+}
+
+static void save_cached(const std::string &file, int64_t sourceTime, int aoRays, const std::vector<float> &vertices)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(file).parent_path(), ec);
+    FILE *f = std::fopen(file.c_str(), "wb");
+    if (!f) {
+        std::cerr << "Can't write mesh cache " << file << "\n";
+        return;
+    }
+    MeshFileHeader header = {};
+    std::memcpy(header.magic, MESH_MAGIC, sizeof(header.magic));
+    header.version = MESH_VERSION;
+    header.floatsPerVertex = MESH_VERTEX_FLOATS;
+    header.vertexCount = (uint32_t)(vertices.size() / MESH_VERTEX_FLOATS);
+    header.aoRays = aoRays;
+    header.sourceTime = sourceTime;
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1
+           && std::fwrite(vertices.data(), sizeof(float), vertices.size(), f) == vertices.size();
+    if ((std::fclose(f) != 0) || !ok) std::remove(file.c_str());
+}
+
+// load_obj's position + normal, with occlusion 1.
+static std::vector<float> load_unbaked(const std::string &objPath)
+{
+    const std::vector<float> obj = load_obj(objPath);
+    std::vector<float> vertices;
+    vertices.reserve(obj.size() / 6 * MESH_VERTEX_FLOATS);
+    for (size_t v = 0; v + 6 <= obj.size(); v += 6) {
+        vertices.insert(vertices.end(), obj.begin() + v, obj.begin() + v + 6);
+        vertices.push_back(1.0f);
+    }
+    return vertices;
+}
+
+std::vector<float> meshcache_load(MeshCache *mc, const std::string &objPath)
+{
+    const std::string file = cache_path(mc->dir, objPath);
+    const int64_t sourceTime = source_time(objPath);
+    std::vector<float> vertices;
+    if (load_cached(file, sourceTime, mc->aoRays, &vertices)) {
+        mc->stats.hits++;
+        return vertices;
+    }
+
+    vertices = load_unbaked(objPath);
+    if (vertices.empty()) return vertices;
+    aobake_run(mc->jobs, vertices.data(), (int)(vertices.size() / MESH_VERTEX_FLOATS), mc->aoRays, &mc->stats.ao);
+    mc->stats.baked++;
+    save_cached(file, sourceTime, mc->aoRays, vertices);
+    return vertices;
+}
+
+std::vector<float> meshcache_read(const std::string &dir, int aoRays, const std::string &objPath)
+{
+    std::vector<float> vertices;
+    if (load_cached(cache_path(dir, objPath), source_time(objPath), aoRays, &vertices)) return vertices;
+    return load_unbaked(objPath);
+}
+
+void meshcache_weld(const float *vertices, int vertexCount, int keyFloats,
+                    std::vector<uint32_t> *remap, std::vector<uint32_t> *firsts)
+{
+    // floats past keyFloats stay 0 and never tell two vertices apart
+    std::map<std::array<float, MESH_VERTEX_FLOATS>, uint32_t> unique;
+    remap->resize(vertexCount);
+    firsts->clear();
+    for (int v = 0; v < vertexCount; v++) {
+        std::array<float, MESH_VERTEX_FLOATS> key = {};
+        std::copy_n(vertices + (size_t)v * MESH_VERTEX_FLOATS, keyFloats, key.begin());
+        auto found = unique.emplace(key, (uint32_t)firsts->size());
+        if (found.second) firsts->push_back((uint32_t)v);
+        (*remap)[v] = found.first->second;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "aobake.h"
+#include "jobs.h"
+
+// Binary cache of OBJ meshes in the mesh vertex layout (gpuresources.h),
+// with their ambient occlusion baked (aobake.h). An entry is used while the
+// OBJ is unchanged and was baked with the same ray count; otherwise the OBJ
+// is parsed and baked again and the entry rewritten. Files live in dir,
+// keyed by OBJ path.
+
+struct MeshCacheStats
+{
+    int hits;
+    int baked;
+    AoBakeStats ao;     // summed over this session's bakes
+};
+
+struct MeshCache
+{
+    std::string dir = "mesh_cache";
+    int aoRays = 64;            // per vertex; 0 leaves occlusion at 1
+    JobPool *jobs = nullptr;    // bakes on the calling thread without one
+    MeshCacheStats stats = {};
+};
+
+// Main thread: may bake on `jobs`, so not from inside a job run.
+std::vector<float> meshcache_load(MeshCache *mc, const std::string &objPath);
+
+// Any thread, never bakes: the cached entry if it is current, else the OBJ
+// with occlusion at 1.
+std::vector<float> meshcache_read(const std::string &dir, int aoRays, const std::string &objPath);
+
+// Merges vertices of the mesh layout whose first `keyFloats` floats match
+// exactly, so shading is unchanged. `remap` gets each vertex's merged
+// number, `firsts` the first vertex of each merged one, in that order.
+void meshcache_weld(const float *vertices, int vertexCount, int keyFloats,
+                    std::vector<uint32_t> *remap, std::vector<uint32_t> *firsts);
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Triangulated, non-indexed: px py pz nx ny nz per vertex.
+std::vector<float> load_obj(const std::string& path);
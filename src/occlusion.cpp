@@ -0,0 +1,187 @@
+#include "occlusion.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+
+static GLuint take_query(OcclusionCuller *occ)
+{
+    if (occ->freeQueries.empty()) {
+        GLuint q;
+        glGenQueries(1, &q);
+        return q;
+    }
+    GLuint q = occ->freeQueries.back();
+    occ->freeQueries.pop_back();
+    return q;
+}
+
+static void set_hidden(OcclusionCuller *occ, uint32_t object, bool hidden)
+{
+    if (object >= occ->hidden.size()) {
+        if (!hidden) return;
+        occ->hidden.resize(object + 1, 0);
+    }
+    occ->hidden[object] = hidden;
+}
+
+// Unit cube as triangles, in the lit program's position + normal layout.
+static void create_box(OcclusionCuller *occ)
+{
+    static const float corners[8][3] = {
+        {0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0},
+        {0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1},
+    };
+    static const int faces[6][4] = {
+        {0, 1, 2, 3}, {5, 4, 7, 6}, {4, 0, 3, 7},
+        {1, 5, 6, 2}, {3, 2, 6, 7}, {4, 5, 1, 0},
+    };
+    float vertices[36 * 6] = {};
+    int v = 0;
+    for (const int *f : faces) {
+        const int tri[6] = {f[0], f[1], f[2], f[0], f[2], f[3]};
+        for (int k : tri) {
+            vertices[v * 6 + 0] = corners[k][0];
+            vertices[v * 6 + 1] = corners[k][1];
+            vertices[v * 6 + 2] = corners[k][2];
+            v++;
+        }
+    }
+    glGenVertexArrays(1, &occ->boxVao);
+    glBindVertexArray(occ->boxVao);
+    glGenBuffers(1, &occ->boxVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, occ->boxVbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+}
+
+void occlusion_begin_frame(OcclusionCuller *occ, glm::vec3 eye, float nearClip, uint64_t renumbered)
+{
+    if (renumbered != occ->renumbered) {
+        occlusion_reset(occ);
+        occ->renumbered = renumbered;
+    }
+    occ->frame++;
+    occ->eye = eye;
+    occ->nearClip = nearClip;
+    occ->stats = {};
+
+    // results arrive in order, so stop at the first one that isn't there yet
+    while (occ->pendingHead < occ->pending.size()) {
+        const OcclusionPending &p = occ->pending[occ->pendingHead];
+        GLuint available = 0;
+        glGetQueryObjectuiv(p.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;
+        GLuint passed = 0;
+        glGetQueryObjectuiv(p.query, GL_QUERY_RESULT, &passed);
+        set_hidden(occ, p.object, !passed);
+        occ->stats.culled += !passed;
+        occ->freeQueries.push_back(p.query);
+        occ->pendingHead++;
+    }
+    if (occ->pendingHead == occ->pending.size()) {
+        occ->pending.clear();
+        occ->pendingHead = 0;
+    } else if (occ->pendingHead > 1024 && occ->pendingHead * 2 > occ->pending.size()) {
+        occ->pending.erase(occ->pending.begin(), occ->pending.begin() + occ->pendingHead);
+        occ->pendingHead = 0;
+    }
+}
+
+GLuint occlusion_visible_query(OcclusionCuller *occ, uint32_t object)
+{
+    // staggered so only a fraction of the visible set is queried per frame
+    if ((occ->frame + object) % occ->visibleInterval != 0) return 0;
+    GLuint q = take_query(occ);
+    occ->pending.push_back({q, object});
+    occ->stats.visibleQueries++;
+    return q;
+}
+
+void occlusion_flush(OcclusionCuller *occ)
+{
+    if (occ->deferred.empty()) return;
+    if (!occ->boxVao) create_box(occ);
+
+    // boxes only test depth: they must neither show nor hide anything
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glBindVertexArray(occ->boxVao);
+    GLuint prog = 0;
+    for (OcclusionDeferred &d : occ->deferred) {
+        // padded so flat meshes still cover pixels and depth ties pass
+        glm::vec3 size = d.boundsMax - d.boundsMin;
+        glm::vec3 pad(0.001f * glm::length(size) + 1e-4f);
+        glm::vec3 lo = d.boundsMin - pad, hi = d.boundsMax + pad;
+
+        // with the eye in (or the near plane cutting into) the box, its
+        // faces can't speak for what's inside
+        glm::mat4 inv = glm::inverse(d.data->model);
+        glm::vec3 e = glm::vec3(inv * glm::vec4(occ->eye, 1.0f));
+        float margin = occ->nearClip * std::max(glm::length(glm::vec3(inv[0])),
+                                       std::max(glm::length(glm::vec3(inv[1])), glm::length(glm::vec3(inv[2]))));
+        if (e.x > lo.x - margin && e.y > lo.y - margin && e.z > lo.z - margin &&
+            e.x < hi.x + margin && e.y < hi.y + margin && e.z < hi.z + margin) {
+            d.query = 0;
+            set_hidden(occ, d.data->object, false);
+            continue;
+        }
+
+        if (d.prog != prog) {
+            prog = d.prog;
+            glUseProgram(prog);
+        }
+        glm::mat4 box = glm::scale(glm::translate(d.data->model, lo), hi - lo);
+        glUniformMatrix4fv(d.locModel, 1, GL_FALSE, glm::value_ptr(box));
+        d.query = take_query(occ);
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, d.query);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+        occ->pending.push_back({d.query, d.data->object});
+        occ->stats.tested++;
+    }
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_TRUE);
+
+    // the GPU waits for each box's result itself, the CPU never does
+    GLuint vao = 0;
+    for (const OcclusionDeferred &d : occ->deferred) {
+        if (d.prog != prog) {
+            prog = d.prog;
+            glUseProgram(prog);
+        }
+        if (d.vao != vao) {
+            vao = d.vao;
+            glBindVertexArray(vao);
+        }
+        glUniformMatrix4fv(d.locModel, 1, GL_FALSE, glm::value_ptr(d.data->model));
+        glUniform3fv(d.locObjCol, 1, glm::value_ptr(d.data->color));
+        if (d.query) glBeginConditionalRender(d.query, GL_QUERY_WAIT);
+        glDrawArrays(GL_TRIANGLES, d.draw.first, d.draw.count);
+        if (d.query) glEndConditionalRender();
+    }
+    occ->deferred.clear();
+}
+
+void occlusion_reset(OcclusionCuller *occ)
+{
+    occ->hidden.clear();
+    // late results would land on the wrong objects; the queries can be reused
+    for (size_t i = occ->pendingHead; i < occ->pending.size(); i++) occ->freeQueries.push_back(occ->pending[i].query);
+    occ->pending.clear();
+    occ->pendingHead = 0;
+}
+
+void occlusion_shutdown(OcclusionCuller *occ)
+{
+    occlusion_reset(occ);
+    if (!occ->freeQueries.empty()) glDeleteQueries((GLsizei)occ->freeQueries.size(), occ->freeQueries.data());
+    occ->freeQueries.clear();
+    if (occ->boxVao) glDeleteVertexArrays(1, &occ->boxVao);
+    if (occ->boxVbo) glDeleteBuffers(1, &occ->boxVbo);
+    occ->boxVao = occ->boxVbo = 0;
+}
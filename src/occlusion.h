@@ -0,0 +1,93 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "cmdbuffer.h"
+
+// Hardware occlusion culling with temporal coherence, after CHC++.
+//
+// Objects that were visible last time are drawn first, as usual, and are
+// assumed to still be visible; every few frames one of their real draws is
+// wrapped in a query to notice when that stops being true. Objects last
+// found hidden aren't drawn straight away: once the visible ones have laid
+// down depth, their bounding boxes are rasterized with color and depth
+// writes off, each inside a GL_ANY_SAMPLES_PASSED query, and their real
+// draws are issued under glBeginConditionalRender so the GPU drops them if
+// no sample of the box passed. The CPU never waits for a result; they are
+// read back a frame or more later, whenever available, only to update who
+// counts as visible. A wrong guess therefore costs time, never pixels.
+//
+// Queries and the box geometry belong to the context that replays, so each
+// context drawing the scene keeps its own culler.
+
+struct OcclusionDeferred
+{
+    GLuint prog;
+    GLint locModel, locObjCol;
+    GLuint vao;
+    glm::vec3 boundsMin, boundsMax;
+    const CmdDrawData *data;
+    CmdDraw draw;
+    GLuint query;       // box query, 0 to draw unconditionally
+};
+
+struct OcclusionPending
+{
+    GLuint query;
+    uint32_t object;
+};
+
+struct OcclusionStats
+{
+    int visibleQueries;     // real draws wrapped in a query
+    int tested;             // believed hidden, drawn behind a box test
+    int culled;             // box results read back this frame with no samples
+};
+
+struct OcclusionCuller
+{
+    bool enabled = false;
+    int visibleInterval = 8;        // frames between queries of a visible object
+
+    int64_t frame = 0;
+    uint64_t renumbered = 0;        // Scene::renumbered the results belong to
+    glm::vec3 eye;
+    float nearClip;
+    std::vector<uint8_t> hidden;    // per object index, from the last result
+    std::vector<GLuint> freeQueries;
+    std::vector<OcclusionPending> pending;  // oldest first, from pendingHead on
+    size_t pendingHead = 0;
+    std::vector<OcclusionDeferred> deferred;
+    GLuint boxVao = 0, boxVbo = 0;
+    OcclusionStats stats = {};
+};
+
+// Reads back whichever results have arrived, without waiting, and starts a
+// frame seen from `eye`. Resets first if the scene's objects were renumbered
+// (Scene::renumbered) since the last frame.
+void occlusion_begin_frame(OcclusionCuller *occ, glm::vec3 eye, float nearClip, uint64_t renumbered);
+
+inline bool occlusion_hidden(const OcclusionCuller *occ, uint32_t object)
+{
+    return object < occ->hidden.size() && occ->hidden[object];
+}
+
+// Query to wrap a visible object's draw in, or 0 if it isn't due one.
+GLuint occlusion_visible_query(OcclusionCuller *occ, uint32_t object);
+
+inline void occlusion_defer(OcclusionCuller *occ, const OcclusionDeferred &d) { occ->deferred.push_back(d); }
+
+// Box tests and conditional draws for everything deferred this frame.
+// Expects the depth of the visible objects to be in place.
+void occlusion_flush(OcclusionCuller *occ);
+
+// Forgets every result; occlusion_begin_frame calls it when objects were
+// renumbered.
+void occlusion_reset(OcclusionCuller *occ);
+
+// Deletes the GL objects; the owning context must be current.
+void occlusion_shutdown(OcclusionCuller *occ);
@@ -8,34 +8,69 @@ void orbitcamera_initialize(OrbitCamera *camera){
     camera->fov       = glm::radians(60.0f);
     camera->nearClip  = 0.1f;
     camera->farClip   = 100.0f;
+    camera->orthographic = false;
+    camera->aspect    = 1.0f;
+    camera->dirty     = true;
 }
 
-glm::vec3 orbitcamera_position(OrbitCamera *cam){
+void orbitcamera_invalidate(OrbitCamera *cam){
+    cam->dirty = true;
+}
+
+void orbitcamera_update(OrbitCamera *cam, float aspect){
+    if (!cam->dirty && aspect == cam->aspect) return;
+    cam->dirty = false;
+    cam->aspect = aspect;
+
     float x = cam->distance * cosf(cam->pitch) * sinf(cam->yaw);
     float y = cam->distance * sinf(cam->pitch);
     float z = cam->distance * cosf(cam->pitch) * cosf(cam->yaw);
-    return cam->target + glm::vec3(x, y, z);
-}
+    cam->position = cam->target + glm::vec3(x, y, z);
 
-glm::mat4 orbitcamera_view(OrbitCamera *cam)
-{
-    glm::vec3 position = orbitcamera_position(cam);
-
-    return glm::lookAt(
-        position,
+    cam->view = glm::lookAt(
+        cam->position,
         cam->target,
         glm::vec3(0.0f, 1.0f, 0.0f)
     );
+    if (cam->orthographic) {
+        float h = cam->distance * tanf(cam->fov * 0.5f);
+        cam->proj = glm::ortho(-h * aspect, h * aspect, -h, h, cam->nearClip, cam->farClip);
+    } else {
+        cam->proj = glm::perspective(
+            cam->fov,
+            aspect,
+            cam->nearClip,
+            cam->farClip
+        );
+    }
+    cam->viewProj = cam->proj * cam->view;
+    cam->invViewProj = glm::inverse(cam->viewProj);
+    frustum_from_matrix(&cam->frustum, cam->viewProj);
+}
+
+void orbitcamera_ray(OrbitCamera *cam, glm::vec2 ndc, glm::vec3 *origin, glm::vec3 *dir){
+    orbitcamera_update(cam, cam->aspect);
+    glm::vec4 nearPoint = cam->invViewProj * glm::vec4(ndc.x, ndc.y, -1.0f, 1.0f);
+    glm::vec4 farPoint = cam->invViewProj * glm::vec4(ndc.x, ndc.y, 1.0f, 1.0f);
+    *origin = glm::vec3(nearPoint) / nearPoint.w;
+    *dir = glm::normalize(glm::vec3(farPoint) / farPoint.w - *origin);
+}
+
+glm::vec3 orbitcamera_position(OrbitCamera *cam){
+    orbitcamera_update(cam, cam->aspect);
+    return cam->position;
+}
+
+glm::mat4 orbitcamera_view(OrbitCamera *cam)
+{
+    orbitcamera_update(cam, cam->aspect);
+    return cam->view;
 }
 
 glm::mat4 orbitcamera_proj(OrbitCamera *cam, float aspect)
 {
-    return glm::perspective(
-        cam->fov,
-        aspect,
-        cam->nearClip,
-        cam->farClip
-    );
+    orbitcamera_update(cam, aspect);
+    return cam->proj;
 }
 
 void orbitcamera_rotate(
@@ -44,6 +79,8 @@ void orbitcamera_rotate(
     float deltaY,
     float sensitivity)
 {
+    if (deltaX == 0.0f && deltaY == 0.0f) return;
+    cam->dirty = true;
     cam->yaw   -= deltaX * sensitivity;
     cam->pitch -= deltaY * sensitivity;
 
@@ -57,6 +94,7 @@ void orbitcamera_zoom(
     float scrollDelta,
     float zoomSpeed)
 {
+    cam->dirty = true;
     cam->distance -= scrollDelta * zoomSpeed;
     cam->distance = glm::max(cam->distance, 0.1f);
 }
@@ -1,7 +1,11 @@
+#pragma once
+
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "frustum.h"
+
 struct OrbitCamera
 {
     glm::vec3 target;   // point we orbit around
@@ -9,13 +13,38 @@ struct OrbitCamera
     float yaw;          // radians
     float pitch;        // radians
 
-    float fov;          // radians
+    float fov;          // radians; orthographic: the same view height at `distance`
+    bool orthographic;
     float nearClip;
     float farClip;
+
+    // Derived from the fields above by orbitcamera_update; only valid after it.
+    bool dirty;
+    float aspect;
+    glm::vec3 position;
+    glm::mat4 view;
+    glm::mat4 proj;
+    glm::mat4 viewProj;
+    glm::mat4 invViewProj;
+    Frustum frustum;
 };
 
 void orbitcamera_initialize(OrbitCamera *camera);
 
+// Call after writing any of the fields above directly; rotate and zoom do it
+// themselves.
+void orbitcamera_invalidate(OrbitCamera *cam);
+
+// Recomputes the derived matrices and frustum if the camera changed since
+// the last call or the aspect ratio differs. Otherwise does nothing.
+void orbitcamera_update(OrbitCamera *cam, float aspect);
+
+// World-space ray through a point in normalized device coordinates (-1..1),
+// using the cached inverse view-projection.
+void orbitcamera_ray(OrbitCamera *cam, glm::vec2 ndc, glm::vec3 *origin, glm::vec3 *dir);
+
+// These read the cache, updating it first if needed.
+
 glm::vec3 orbitcamera_position(OrbitCamera *cam);
 
 glm::mat4 orbitcamera_view(OrbitCamera *cam);
@@ -0,0 +1,225 @@
+#include "postprocess.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <initializer_list>
+
+#include "shader.h"
+
+static GLuint load_program(const char *fsPath, std::initializer_list<const char*> samplers)
+{
+    GLuint prog = createProgram("assets/shaders/post.vs", fsPath);
+    if (!prog) return 0;
+    // texture units follow the sampler order, constant for the program's lifetime
+    glUseProgram(prog);
+    int unit = 0;
+    for (const char *s : samplers) glUniform1i(glGetUniformLocation(prog, s), unit++);
+    glUseProgram(0);
+    return prog;
+}
+
+static void release_programs(PostProcess *pp, GpuResources *gpu)
+{
+    for (GLuint prog : {pp->ssaoProg, pp->upsampleProg, pp->brightProg, pp->blurProg, pp->tonemapProg, pp->fxaaProg})
+        gpuresources_release(gpu, GPU_RESOURCE_PROGRAM, prog);
+    pp->ssaoProg = pp->upsampleProg = pp->brightProg = pp->blurProg = pp->tonemapProg = pp->fxaaProg = 0;
+}
+
+// All of them or none: if one fails, pp keeps the programs it had.
+static void load_programs(PostProcess *pp, GpuResources *gpu)
+{
+    const GLuint progs[] = {
+        load_program("assets/shaders/ssao.fs", {"uDepth"}),
+        load_program("assets/shaders/ssao_upsample.fs", {"uAo", "uAoZ", "uDepth"}),
+        load_program("assets/shaders/bloom_bright.fs", {"uHdr"}),
+        load_program("assets/shaders/blur.fs", {"uSrc"}),
+        load_program("assets/shaders/tonemap.fs", {"uHdr", "uAo", "uBloom"}),
+        load_program("assets/shaders/fxaa.fs", {"uColor"}),
+    };
+    bool ok = true;
+    for (GLuint prog : progs) ok = ok && prog;
+    if (!ok) {
+        for (GLuint prog : progs) {
+            if (prog) glDeleteProgram(prog);
+        }
+        return;
+    }
+    release_programs(pp, gpu);
+    pp->ssaoProg = progs[0];
+    pp->upsampleProg = progs[1];
+    pp->brightProg = progs[2];
+    pp->blurProg = progs[3];
+    pp->tonemapProg = progs[4];
+    pp->fxaaProg = progs[5];
+    for (GLuint prog : progs) gpuresources_track(gpu, GPU_RESOURCE_PROGRAM, prog);
+}
+
+void postprocess_initialize(PostProcess *pp, GpuResources *gpu)
+{
+    load_programs(pp, gpu);
+    glGenVertexArrays(1, &pp->vao);
+    gpuresources_track(gpu, GPU_RESOURCE_VERTEX_ARRAY, pp->vao);
+}
+
+void postprocess_reload_shaders(PostProcess *pp, GpuResources *gpu)
+{
+    load_programs(pp, gpu);
+}
+
+static void bind_textures(const FrameGraph *fg, std::initializer_list<FgTexture> textures)
+{
+    int unit = 0;
+    for (FgTexture t : textures) {
+        glActiveTexture(GL_TEXTURE0 + unit++);
+        glBindTexture(GL_TEXTURE_2D, framegraph_texture(fg, t));
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+static void draw_fullscreen(const PostProcess *pp)
+{
+    const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glBindVertexArray(pp->vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    if (depthTest) glEnable(GL_DEPTH_TEST);
+}
+
+static void ssao_pass(FrameGraph *fg, void *user)
+{
+    const PostView *v = (const PostView*)user;
+    const GLuint prog = v->pp->ssaoProg;
+    glUseProgram(prog);
+    glUniformMatrix4fv(glGetUniformLocation(prog, "uProj"), 1, GL_FALSE, glm::value_ptr(v->proj));
+    glUniformMatrix4fv(glGetUniformLocation(prog, "uInvProj"), 1, GL_FALSE, glm::value_ptr(v->invProj));
+    glUniform1f(glGetUniformLocation(prog, "uRadius"), v->pp->ssaoRadius);
+    glUniform1f(glGetUniformLocation(prog, "uStrength"), v->pp->ssaoStrength);
+    bind_textures(fg, {v->depth});
+    draw_fullscreen(v->pp);
+}
+
+static void ssao_upsample_pass(FrameGraph *fg, void *user)
+{
+    const PostView *v = (const PostView*)user;
+    const GLuint prog = v->pp->upsampleProg;
+    glUseProgram(prog);
+    glUniformMatrix4fv(glGetUniformLocation(prog, "uInvProj"), 1, GL_FALSE, glm::value_ptr(v->invProj));
+    bind_textures(fg, {v->ao, v->aoZ, v->depth});
+    draw_fullscreen(v->pp);
+}
+
+static void bloom_bright_pass(FrameGraph *fg, void *user)
+{
+    const PostView *v = (const PostView*)user;
+    const GLuint prog = v->pp->brightProg;
+    glUseProgram(prog);
+    glUniform1f(glGetUniformLocation(prog, "uThreshold"), v->pp->bloomThreshold);
+    bind_textures(fg, {v->hdr});
+    draw_fullscreen(v->pp);
+}
+
+static void blur_pass(FrameGraph *fg, void *user)
+{
+    const PostBlur *b = (const PostBlur*)user;
+    const GLuint prog = b->view->pp->blurProg;
+    glUseProgram(prog);
+    glUniform2fv(glGetUniformLocation(prog, "uDirection"), 1, glm::value_ptr(b->direction));
+    bind_textures(fg, {b->src});
+    draw_fullscreen(b->view->pp);
+}
+
+static void tonemap_pass(FrameGraph *fg, void *user)
+{
+    const PostView *v = (const PostView*)user;
+    const PostProcess *pp = v->pp;
+    const GLuint prog = pp->tonemapProg;
+    glUseProgram(prog);
+    glUniform1i(glGetUniformLocation(prog, "uUseAo"), pp->ssao);
+    glUniform1i(glGetUniformLocation(prog, "uUseBloom"), pp->bloom);
+    glUniform1f(glGetUniformLocation(prog, "uBloomStrength"), pp->bloomStrength);
+    glUniform1f(glGetUniformLocation(prog, "uExposure"), pp->exposure);
+    glUniform1i(glGetUniformLocation(prog, "uOperator"), pp->tonemapper);
+    glUniform1i(glGetUniformLocation(prog, "uLumaAlpha"), pp->fxaa);
+    // unused inputs bind texture 0, the shader doesn't sample them
+    bind_textures(fg, {v->hdr});
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, pp->ssao ? framegraph_texture(fg, v->aoFull) : 0);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, pp->bloom ? framegraph_texture(fg, v->bloom) : 0);
+    glActiveTexture(GL_TEXTURE0);
+    draw_fullscreen(pp);
+}
+
+static void fxaa_pass(FrameGraph *fg, void *user)
+{
+    const PostView *v = (const PostView*)user;
+    glUseProgram(v->pp->fxaaProg);
+    bind_textures(fg, {v->ldr});
+    draw_fullscreen(v->pp);
+}
+
+void postprocess_add_passes(const PostProcess *pp, PostView *view, FrameGraph *fg, FgTexture hdr, FgTexture depth,
+                            FgTexture output, const glm::mat4 &proj)
+{
+    const FgTextureDesc full = fg->textures[hdr].desc;
+    const int hw = std::max(1, full.w / 2), hh = std::max(1, full.h / 2);
+    view->pp = pp;
+    view->proj = proj;
+    view->invProj = glm::inverse(proj);
+    view->hdr = hdr;
+    view->depth = depth;
+
+    if (pp->ssao) {
+        view->ao = framegraph_create_texture(fg, "ssao", {hw, hh, GL_R8});
+        view->aoZ = framegraph_create_texture(fg, "ssao depth", {hw, hh, GL_R32F});
+        int pass = framegraph_add_pass(fg, "ssao", ssao_pass, view);
+        framegraph_read(fg, pass, depth);
+        framegraph_write(fg, pass, view->ao);
+        framegraph_write(fg, pass, view->aoZ);
+
+        view->aoFull = framegraph_create_texture(fg, "ssao full", {full.w, full.h, GL_R8});
+        pass = framegraph_add_pass(fg, "ssao upsample", ssao_upsample_pass, view);
+        framegraph_read(fg, pass, view->ao);
+        framegraph_read(fg, pass, view->aoZ);
+        framegraph_read(fg, pass, depth);
+        framegraph_write(fg, pass, view->aoFull);
+    }
+
+    if (pp->bloom) {
+        view->bloom = framegraph_create_texture(fg, "bloom", {hw, hh, GL_RGBA16F});
+        int pass = framegraph_add_pass(fg, "bloom bright", bloom_bright_pass, view);
+        framegraph_read(fg, pass, hdr);
+        framegraph_write(fg, pass, view->bloom);
+        const int blurs = 2 * std::clamp(pp->bloomBlurs, 1, POST_MAX_BLURS);
+        for (int i = 0; i < blurs; i++) {
+            PostBlur *b = &view->blurs[i];
+            *b = {view, view->bloom, i % 2 ? glm::vec2(0.0f, 1.0f) : glm::vec2(1.0f, 0.0f)};
+            view->bloom = framegraph_create_texture(fg, "bloom", {hw, hh, GL_RGBA16F});
+            pass = framegraph_add_pass(fg, "bloom blur", blur_pass, b);
+            framegraph_read(fg, pass, b->src);
+            framegraph_write(fg, pass, view->bloom);
+        }
+    }
+
+    view->ldr = pp->fxaa ? framegraph_create_texture(fg, "tonemapped", {full.w, full.h, GL_RGBA8}) : output;
+    int pass = framegraph_add_pass(fg, "tonemap", tonemap_pass, view);
+    framegraph_read(fg, pass, hdr);
+    if (pp->ssao) framegraph_read(fg, pass, view->aoFull);
+    if (pp->bloom) framegraph_read(fg, pass, view->bloom);
+    framegraph_write(fg, pass, view->ldr);
+
+    if (pp->fxaa) {
+        pass = framegraph_add_pass(fg, "fxaa", fxaa_pass, view);
+        framegraph_read(fg, pass, view->ldr);
+        framegraph_write(fg, pass, output);
+    }
+}
+
+void postprocess_shutdown(PostProcess *pp, GpuResources *gpu)
+{
+    release_programs(pp, gpu);
+    gpuresources_release(gpu, GPU_RESOURCE_VERTEX_ARRAY, pp->vao);
+    pp->vao = 0;
+}
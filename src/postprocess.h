@@ -0,0 +1,80 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "framegraph.h"
+#include "gpuresources.h"
+
+// Post-processing chain, as frame graph passes after a scene pass that drew
+// HDR color (GL_RGBA16F) and depth:
+//
+//   ssao, ssao upsample   half-res occlusion from depth, then a depth-aware
+//                         upsample to full resolution
+//   bloom bright, blur    half-res bright pass, then separable blurs
+//   tonemap               occlusion, bloom and exposure, to display range
+//   fxaa                  edge blur, a cheap stand-in for multisampling
+//
+// Disabled effects add no passes. Each blur writes a fresh transient of the
+// same size and format, so the graph ping-pongs them between two pooled
+// textures, and the half-res targets alias across views of the same size.
+
+enum Tonemapper
+{
+    TONEMAP_CLAMP,
+    TONEMAP_REINHARD,
+    TONEMAP_ACES,
+};
+
+constexpr int POST_MAX_BLURS = 4;   // horizontal + vertical rounds of the bloom blur
+
+struct PostProcess
+{
+    bool enabled = false;           // off: scenes draw straight into their targets
+    int tonemapper = TONEMAP_ACES;
+    float exposure = 1.0f;
+    bool fxaa = true;
+    bool ssao = false;
+    float ssaoRadius = 0.5f;        // world units
+    float ssaoStrength = 1.0f;
+    bool bloom = false;
+    float bloomThreshold = 1.0f;
+    float bloomStrength = 0.3f;
+    int bloomBlurs = 2;
+
+    GLuint ssaoProg = 0, upsampleProg = 0, brightProg = 0, blurProg = 0, tonemapProg = 0, fxaaProg = 0;
+    GLuint vao = 0;                 // attribute-less, see post.vs
+};
+
+struct PostView;
+
+struct PostBlur
+{
+    PostView *view;
+    FgTexture src;
+    glm::vec2 direction;
+};
+
+// One view's chain; passes point into it, so the caller keeps it alive
+// until the graph has run.
+struct PostView
+{
+    const PostProcess *pp;
+    glm::mat4 proj, invProj;
+    FgTexture hdr, depth;
+    FgTexture ao, aoZ, aoFull;      // half-res occlusion, its depth, upsampled
+    FgTexture bloom;                // last blur's output
+    FgTexture ldr;                  // tonemapped, luma in alpha, when fxaa follows
+    PostBlur blurs[2 * POST_MAX_BLURS];
+};
+
+void postprocess_initialize(PostProcess *pp, GpuResources *gpu);
+
+void postprocess_reload_shaders(PostProcess *pp, GpuResources *gpu);
+
+// Adds the passes of the enabled effects; the last one writes `output`.
+// `proj` is the projection the scene was drawn with.
+void postprocess_add_passes(const PostProcess *pp, PostView *view, FrameGraph *fg, FgTexture hdr, FgTexture depth,
+                            FgTexture output, const glm::mat4 &proj);
+
+void postprocess_shutdown(PostProcess *pp, GpuResources *gpu);
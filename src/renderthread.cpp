@@ -0,0 +1,382 @@
+#include "renderthread.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+#include "gputimer.h"
+
+// vertex arrays of meshes that stopped being drawn are dropped after this
+static const int64_t VAO_IDLE_FRAMES = 240;
+
+// The other slot than the newest snapshot's.
+static int display_slot(const RenderThread *rt)
+{
+    return (rt->newest + 1) % RENDER_SNAPSHOT_COUNT;
+}
+
+// Drops the references a finished snapshot held. Main thread.
+static void release_snapshot(RenderThread *rt, RenderSnapshot *snap)
+{
+    for (GLuint b : snap->buffers) gpuresources_release(rt->gpu, GPU_RESOURCE_BUFFER, b);
+    for (GLuint p : snap->programs) gpuresources_release(rt->gpu, GPU_RESOURCE_PROGRAM, p);
+    snap->buffers.clear();
+    snap->programs.clear();
+}
+
+// --- render thread ------------------------------------------------------------
+
+// Vertex arrays aren't shared between contexts, so the render thread keeps
+// its own per mesh over the shared vertex buffer.
+static GLuint vertex_array(void *user, const CmdBindGeometry &g)
+{
+    RenderThread *rt = (RenderThread*)user;
+    auto it = rt->vaos.find(g.mesh.value);
+    if (it != rt->vaos.end() && it->second.vbo == g.vbo && it->second.ebo == g.ebo) {
+        it->second.lastUsed = rt->drawing;
+        return it->second.vao;
+    }
+    if (it != rt->vaos.end()) glDeleteVertexArrays(1, &it->second.vao);
+
+    RenderThreadVao v = {0, g.vbo, g.ebo, rt->drawing};
+    glGenVertexArrays(1, &v.vao);
+    glBindVertexArray(v.vao);
+    if (g.vbo) {
+        // impostors have no vertex buffer and an empty vertex array
+        glBindBuffer(GL_ARRAY_BUFFER, g.vbo);
+        if (g.ebo) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g.ebo);
+        gpuresources_vertex_layout(g.stride);
+    }
+    rt->vaos[g.mesh.value] = v;
+    return v.vao;
+}
+
+static void evict_vertex_arrays(RenderThread *rt, int64_t frame)
+{
+    for (auto it = rt->vaos.begin(); it != rt->vaos.end();) {
+        if (frame - it->second.lastUsed > VAO_IDLE_FRAMES) {
+            glDeleteVertexArrays(1, &it->second.vao);
+            it = rt->vaos.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+static void draw_snapshot(RenderThread *rt, RenderSnapshot *snap, GLuint fbo, GLuint ubo)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, snap->w, snap->h);
+    glEnable(GL_DEPTH_TEST);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), &snap->camera, GL_STREAM_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, ubo);
+
+    rt->drawing = snap->frame;
+    OcclusionCuller *occ = nullptr;
+    if (snap->occlusion) {
+        occ = &rt->occlusionCuller;
+        occlusion_begin_frame(occ, glm::vec3(snap->camera.viewPos), snap->nearClip, snap->renumbered);
+    }
+    cmdlist_replay(&snap->commands, snap->lightPos, vertex_array, rt, occ, snap->depthProg);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+static void render_loop(RenderThread *rt)
+{
+    glfwMakeContextCurrent(rt->context);
+
+    GLuint fbo[RENDER_SNAPSHOT_COUNT], depth[RENDER_SNAPSHOT_COUNT];
+    int size[RENDER_SNAPSHOT_COUNT][2] = {};
+    glGenFramebuffers(RENDER_SNAPSHOT_COUNT, fbo);
+    glGenRenderbuffers(RENDER_SNAPSHOT_COUNT, depth);
+    GLuint ubo;
+    glGenBuffers(1, &ubo);
+    GpuTimer timer;
+    gputimer_initialize(&timer);
+    std::vector<GpuTiming> timings;
+    const bool canCount = GLAD_GL_VERSION_4_6 != 0;
+    GpuTimer fragments;
+    if (canCount) gputimer_initialize(&fragments, GL_FRAGMENT_SHADER_INVOCATIONS);
+    std::vector<GpuTiming> counts;
+
+    for (;;) {
+        int slot = -1;
+        GLsync released = 0;
+        {
+            std::unique_lock<std::mutex> lock(rt->mutex);
+            rt->cv.wait(lock, [rt]() { return rt->quit || rt->submitted > rt->completed; });
+            if (rt->quit) break;
+            // oldest pending first, snapshots are never skipped
+            for (int s = 0; s < RENDER_SNAPSHOT_COUNT; s++) {
+                int64_t f = rt->snapshots[s].frame;
+                if (f > rt->completed && (slot < 0 || f < rt->snapshots[slot].frame)) slot = s;
+            }
+            released = rt->released[slot];
+            rt->released[slot] = 0;
+        }
+        RenderSnapshot *snap = &rt->snapshots[slot];
+        const double t0 = glfwGetTime();
+
+        // the main thread may still be sampling this texture on the GPU
+        if (released) {
+            glWaitSync(released, 0, GL_TIMEOUT_IGNORED);
+            glDeleteSync(released);
+        }
+        if (size[slot][0] != snap->w || size[slot][1] != snap->h) {
+            size[slot][0] = snap->w;
+            size[slot][1] = snap->h;
+            glBindTexture(GL_TEXTURE_2D, rt->color[slot]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, snap->w, snap->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            glBindRenderbuffer(GL_RENDERBUFFER, depth[slot]);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, snap->w, snap->h);
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo[slot]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, rt->color[slot], 0);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth[slot]);
+            GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+            if (status != GL_FRAMEBUFFER_COMPLETE) std::cerr << "Render thread target incomplete: " << status << "\n";
+        }
+
+        const bool counting = canCount && snap->countFragments;
+        gputimer_begin(&timer, snap->frame);
+        if (counting) gputimer_begin(&fragments, snap->frame);
+        draw_snapshot(rt, snap, fbo[slot], ubo);
+        if (counting) gputimer_end(&fragments);
+        gputimer_end(&timer);
+        GLsync done = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        // fences are only visible to other contexts once flushed
+        glFlush();
+
+        if (snap->frame % 60 == 0) evict_vertex_arrays(rt, snap->frame);
+        timings.clear();
+        gputimer_collect(&timer, false, &timings);
+        counts.clear();
+        if (canCount) gputimer_collect(&fragments, false, &counts);
+
+        {
+            std::lock_guard<std::mutex> lock(rt->mutex);
+            rt->done[slot] = done;
+            rt->completed = snap->frame;
+            rt->submitMs = (glfwGetTime() - t0) * 1000.0;
+            if (!timings.empty()) rt->gpuMs = timings.back().ms;
+            rt->occlusionStats = snap->occlusion ? rt->occlusionCuller.stats : OcclusionStats{};
+            if (!counts.empty()) rt->fragments = counts.back().value;
+        }
+        rt->cv.notify_all();
+    }
+
+    glFinish();
+    for (auto &v : rt->vaos) glDeleteVertexArrays(1, &v.second.vao);
+    rt->vaos.clear();
+    occlusion_shutdown(&rt->occlusionCuller);
+    gputimer_shutdown(&timer);
+    if (canCount) gputimer_shutdown(&fragments);
+    glDeleteBuffers(1, &ubo);
+    glDeleteRenderbuffers(RENDER_SNAPSHOT_COUNT, depth);
+    glDeleteFramebuffers(RENDER_SNAPSHOT_COUNT, fbo);
+    glfwMakeContextCurrent(nullptr);
+}
+
+// --- main thread --------------------------------------------------------------
+
+bool renderthread_start(RenderThread *rt, GLFWwindow *mainWindow, GpuResources *gpu)
+{
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    rt->context = glfwCreateWindow(1, 1, "render thread", nullptr, mainWindow);
+    glfwDefaultWindowHints();
+    if (!rt->context) return false;
+
+    rt->gpu = gpu;
+    rt->running = true;
+    rt->quit = false;
+    rt->submitted = -1;
+    rt->completed = -1;
+    rt->newest = 0;
+    rt->displayed = -1;
+    rt->submitMs = 0.0;
+    rt->gpuMs = 0.0;
+    rt->occlusionStats = {};
+    rt->fragments = 0;
+
+    glGenTextures(RENDER_SNAPSHOT_COUNT, rt->color);
+    for (int s = 0; s < RENDER_SNAPSHOT_COUNT; s++) {
+        rt->snapshots[s].frame = -1;
+        rt->snapshots[s].latchedInput = -1.0;
+        rt->done[s] = 0;
+        rt->released[s] = 0;
+        glBindTexture(GL_TEXTURE_2D, rt->color[s]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        gpuresources_track(gpu, GPU_RESOURCE_TEXTURE, rt->color[s]);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    // objects must be complete before another context uses them
+    glFinish();
+
+    rt->thread = std::thread(render_loop, rt);
+    return true;
+}
+
+void renderthread_stop(RenderThread *rt)
+{
+    if (!rt->running) return;
+    {
+        std::lock_guard<std::mutex> lock(rt->mutex);
+        rt->quit = true;
+    }
+    rt->cv.notify_all();
+    rt->thread.join();
+    rt->running = false;
+
+    for (int s = 0; s < RENDER_SNAPSHOT_COUNT; s++) {
+        if (rt->done[s]) glDeleteSync(rt->done[s]);
+        if (rt->released[s]) glDeleteSync(rt->released[s]);
+        release_snapshot(rt, &rt->snapshots[s]);
+        cmdlist_reset(&rt->snapshots[s].commands, 0);
+        gpuresources_release(rt->gpu, GPU_RESOURCE_TEXTURE, rt->color[s]);
+    }
+    glfwDestroyWindow(rt->context);
+    rt->context = nullptr;
+}
+
+void renderthread_submit(RenderThread *rt, Scene *scene, JobPool *jobs, int64_t frame, int w, int h,
+                         double *cullMs, double *recordMs)
+{
+    const int slot = (rt->newest + 1) % RENDER_SNAPSHOT_COUNT;
+    RenderSnapshot *snap = &rt->snapshots[slot];
+    {
+        // the slot's previous snapshot has to be drawn before it is reused
+        std::unique_lock<std::mutex> lock(rt->mutex);
+        rt->cv.wait(lock, [rt, snap]() { return rt->completed >= snap->frame; });
+    }
+    release_snapshot(rt, snap);
+
+    OrbitCamera *cam = &scene->orbitCamera;
+    w = std::max(w, 1);
+    h = std::max(h, 1);
+    orbitcamera_update(cam, (float)w / (float)h);
+    scene->view.height = h;
+    const double t0 = glfwGetTime();
+    scene_cull(scene);
+    const double t1 = glfwGetTime();
+    scene_record(scene, jobs, &snap->commands);
+    *cullMs = (t1 - t0) * 1000.0;
+    *recordMs = (glfwGetTime() - t1) * 1000.0;
+
+    snap->w = w;
+    snap->h = h;
+    snap->camera.view = cam->view;
+    snap->camera.proj = cam->proj;
+    snap->camera.viewPos = glm::vec4(cam->position, 1.0f);
+    snap->nearClip = cam->nearClip;
+    snap->lightPos = scene->animLight;
+    snap->occlusion = rt->occlusion;
+    snap->renumbered = scene->renumbered;
+    snap->countFragments = rt->countFragments;
+    snap->latchedInput = rt->latchedInput;
+    snap->depthProg = scene_depth_program(scene);
+    if (snap->depthProg) snap->programs.push_back(snap->depthProg);
+
+    for (const CmdBuffer &cb : snap->commands.buffers) {
+        for (const CmdSegment &seg : cb.segments) {
+            snap->buffers.push_back(seg.vbo);
+            if (seg.ebo) snap->buffers.push_back(seg.ebo);
+            snap->programs.push_back(seg.prog);
+        }
+    }
+    std::sort(snap->buffers.begin(), snap->buffers.end());
+    snap->buffers.erase(std::unique(snap->buffers.begin(), snap->buffers.end()), snap->buffers.end());
+    std::sort(snap->programs.begin(), snap->programs.end());
+    snap->programs.erase(std::unique(snap->programs.begin(), snap->programs.end()), snap->programs.end());
+    for (GLuint b : snap->buffers) gpuresources_retain(rt->gpu, GPU_RESOURCE_BUFFER, b);
+    for (GLuint p : snap->programs) gpuresources_retain(rt->gpu, GPU_RESOURCE_PROGRAM, p);
+
+    {
+        std::lock_guard<std::mutex> lock(rt->mutex);
+        snap->frame = frame;
+        rt->submitted = frame;
+    }
+    rt->newest = slot;
+    rt->cv.notify_all();
+}
+
+GLuint renderthread_display_texture(const RenderThread *rt)
+{
+    const int slot = display_slot(rt);
+    return rt->snapshots[slot].frame >= 0 ? rt->color[slot] : 0;
+}
+
+double renderthread_display_input(const RenderThread *rt)
+{
+    const int slot = display_slot(rt);
+    return rt->snapshots[slot].frame >= 0 ? rt->snapshots[slot].latchedInput : -1.0;
+}
+
+// Runs `fn` with `context` current, GL sync objects only act on the context
+// they are issued in.
+template <typename Fn>
+static void with_context(GLFWwindow *context, Fn fn)
+{
+    GLFWwindow *current = glfwGetCurrentContext();
+    if (context && context != current) glfwMakeContextCurrent(context);
+    fn();
+    if (context && context != current) glfwMakeContextCurrent(current);
+}
+
+void renderthread_acquire(RenderThread *rt, GLFWwindow *sampler)
+{
+    const int slot = display_slot(rt);
+    const int64_t frame = rt->snapshots[slot].frame;
+    if (frame < 0) return;
+
+    GLsync done;
+    {
+        std::unique_lock<std::mutex> lock(rt->mutex);
+        rt->cv.wait(lock, [rt, frame]() { return rt->completed >= frame; });
+        done = rt->done[slot];
+        rt->done[slot] = 0;
+    }
+    // a second acquire of the same snapshot has nothing left to wait for
+    if (done) {
+        if (sampler) {
+            with_context(sampler, [done]() { glWaitSync(done, 0, GL_TIMEOUT_IGNORED); });
+        } else {
+            while (glClientWaitSync(done, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+        }
+        glDeleteSync(done);
+    }
+    rt->displayed = slot;
+}
+
+void renderthread_release(RenderThread *rt, GLFWwindow *sampler)
+{
+    if (rt->displayed < 0) return;
+    GLsync fence = 0;
+    with_context(sampler, [&fence]() {
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+    });
+    {
+        std::lock_guard<std::mutex> lock(rt->mutex);
+        if (rt->released[rt->displayed]) glDeleteSync(rt->released[rt->displayed]);
+        rt->released[rt->displayed] = fence;
+    }
+    rt->displayed = -1;
+}
+
+void renderthread_stats(RenderThread *rt, double *submitMs, double *gpuMs, OcclusionStats *occlusion,
+                        uint64_t *fragments)
+{
+    std::lock_guard<std::mutex> lock(rt->mutex);
+    *submitMs = rt->submitMs;
+    *gpuMs = rt->gpuMs;
+    *occlusion = rt->occlusionStats;
+    *fragments = rt->fragments;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "cmdbuffer.h"
+#include "gpuresources.h"
+#include "jobs.h"
+#include "occlusion.h"
+#include "scene.h"
+
+// Scene pass on its own thread.
+//
+// The main thread keeps the UI, simulation and presentation; every frame it
+// culls and records what is visible into the command list of a
+// RenderSnapshot and hands it over. The render thread draws it with a hidden context that shares
+// objects with the main window, into a color texture the UI then shows.
+// Snapshots and output textures are double-buffered: while the main thread
+// builds frame N, the render thread draws N-1, so the scene on screen is at
+// most one frame behind and frame time tends to max(main, render) instead
+// of their sum.
+//
+// The render thread never touches Scene or GpuResources. Snapshots carry raw
+// GL names, and hold a reference on every buffer and program they use until
+// the render thread is done with them, so deferred deletion still applies.
+// Objects that can't be shared between contexts (framebuffers, vertex
+// arrays, queries) are created and destroyed by the render thread itself.
+
+constexpr int RENDER_SNAPSHOT_COUNT = 2;
+
+struct RenderSnapshot
+{
+    int64_t frame;
+    int w, h;
+    CameraBlock camera;
+    float nearClip;
+    glm::vec3 lightPos;
+    bool occlusion;     // replay through the render thread's occlusion culler
+    uint64_t renumbered;    // Scene::renumbered when recorded
+    GLuint depthProg;   // depth pre-pass program, 0 for none (in `programs`)
+    bool countFragments;
+    double latchedInput;    // arrival of the input it shows, < 0 if none
+    CmdList commands;
+
+    // referenced for the render thread, released once it is done
+    std::vector<GLuint> buffers;
+    std::vector<GLuint> programs;
+};
+
+struct RenderThreadVao
+{
+    GLuint vao;
+    GLuint vbo, ebo;
+    int64_t lastUsed;
+};
+
+struct RenderThread
+{
+    GLFWwindow *context;    // hidden, shares objects with the main window
+    GpuResources *gpu;
+    std::thread thread;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool running = false;
+    bool quit;
+    int64_t submitted;      // last snapshot handed over, -1 if none
+    int64_t completed;      // last snapshot fully submitted to the GPU
+    RenderSnapshot snapshots[RENDER_SNAPSHOT_COUNT];
+    int newest;             // slot of the last submitted snapshot
+    GLuint color[RENDER_SNAPSHOT_COUNT];        // shared output textures
+    GLsync done[RENDER_SNAPSHOT_COUNT];         // render thread finished drawing
+    GLsync released[RENDER_SNAPSHOT_COUNT];     // main thread finished sampling
+    double submitMs;        // render thread CPU time of the last snapshot
+    double gpuMs;
+    OcclusionStats occlusionStats;
+    uint64_t fragments;     // fragment shader invocations, if counted
+    bool occlusion = false; // main thread: occlusion culling for new snapshots
+    bool countFragments = false;    // main thread: needs GL 4.6
+    double latchedInput = -1.0;     // main thread: input applied to new snapshots
+    int displayed;          // slot acquired for display, -1 if none
+
+    // render thread only
+    std::unordered_map<uint32_t, RenderThreadVao> vaos;  // by MeshHandle value
+    int64_t drawing;        // snapshot being replayed
+    OcclusionCuller occlusionCuller;
+};
+
+// Creates the shared context (must be on the main thread, like every GLFW
+// window) and starts the thread. Returns false if the context can't be made.
+bool renderthread_start(RenderThread *rt, GLFWwindow *mainWindow, GpuResources *gpu);
+
+// Waits for the render thread to finish, then frees everything it owned.
+void renderthread_stop(RenderThread *rt);
+
+// Culls the scene with the camera at w x h, records the visible draws
+// across `jobs` and hands them over as snapshot `frame`. Blocks only while
+// the render thread is still on frame - 2.
+void renderthread_submit(RenderThread *rt, Scene *scene, JobPool *jobs, int64_t frame, int w, int h,
+                         double *cullMs, double *recordMs);
+
+// Output texture of the last snapshot before the newest one, or 0 before
+// there is one. Call renderthread_acquire before anything samples it.
+GLuint renderthread_display_texture(const RenderThread *rt);
+
+// Arrival time of the input applied to the snapshot renderthread_display_texture
+// shows, < 0 if it had none.
+double renderthread_display_input(const RenderThread *rt);
+
+// Waits until the texture from renderthread_display_texture is complete
+// and makes `sampler`, the context of the window that shows it, wait for it
+// on the GPU. A null sampler (window not created yet) waits on the CPU.
+void renderthread_acquire(RenderThread *rt, GLFWwindow *sampler);
+
+// After `sampler`'s last draw that samples the displayed texture: lets the
+// render thread reuse it once the GPU is done with it.
+void renderthread_release(RenderThread *rt, GLFWwindow *sampler);
+
+// Render thread CPU time, GPU time, occlusion culling and fragment shader
+// invocations of its latest snapshot.
+void renderthread_stats(RenderThread *rt, double *submitMs, double *gpuMs, OcclusionStats *occlusion,
+                        uint64_t *fragments);
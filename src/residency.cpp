@@ -0,0 +1,173 @@
+#include "residency.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "meshcache.h"
+
+// Buffers that can be evicted: the ones whose vertices the mesh cache holds.
+static bool managed(const Mesh &m)
+{
+    return !m.ebo && !m.name.empty();
+}
+
+// --- worker -------------------------------------------------------------------
+
+static void read_meshes(ResidencyJob *job)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    for (ResidencyLoad &load : job->loads) load.vertices = meshcache_read(job->meshCacheDir, job->aoRays, load.name);
+    job->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// --- main thread --------------------------------------------------------------
+
+static void start(MeshResidency *mr, Scene *scene)
+{
+    ResidencyJob &job = mr->job;
+    // the pools aren't thread-safe, so resolve names here
+    job.loads.resize(mr->wanted.size());
+    for (size_t k = 0; k < mr->wanted.size(); k++) {
+        job.loads[k].mesh = mr->wanted[k];
+        job.loads[k].name = gpuresources_mesh(scene->gpu, mr->wanted[k])->name;
+        job.loads[k].vertices.clear();
+        mr->pending.insert(mr->wanted[k].value);
+    }
+    job.meshCacheDir = scene->meshCache.dir;
+    job.aoRays = scene->meshCache.aoRays;
+
+    mr->busy = true;
+    mr->thread = std::thread([mr]() {
+        read_meshes(&mr->job);
+        mr->busy = false;
+    });
+}
+
+static void mark_seen(MeshResidency *mr, MeshHandle h)
+{
+    const uint32_t slot = handle_index(h);
+    if (slot < mr->lastSeen.size()) mr->lastSeen[slot] = mr->frame;
+}
+
+// Restores what the worker read, oldest first, within the upload budget.
+static void upload_ready(MeshResidency *mr, GpuResources *gpu)
+{
+    size_t uploaded = 0;
+    while (mr->readyNext < mr->ready.size()) {
+        ResidencyLoad &load = mr->ready[mr->readyNext];
+        const size_t bytes = load.vertices.size() * sizeof(float);
+        if (uploaded && uploaded + bytes > mr->uploadBudget) break;
+        mr->readyNext++;
+        mr->pending.erase(load.mesh.value);
+
+        Mesh *m = gpuresources_mesh(gpu, load.mesh);
+        if (m && !m->resident) {
+            const int vertexCount = (int)(load.vertices.size() / MESH_VERTEX_FLOATS);
+            if (gpuresources_restore_mesh(gpu, load.mesh, load.vertices.data(), vertexCount)) {
+                uploaded += bytes;
+                mr->stats.restores++;
+            } else {
+                // e.g. the OBJ changed on disk since it was loaded
+                std::cerr << "Can't restore mesh " << load.name << " from the mesh cache\n";
+                mr->failed.insert(load.mesh.value);
+            }
+        }
+        load.vertices = std::vector<float>();
+    }
+    if (mr->readyNext == mr->ready.size()) {
+        mr->ready.clear();
+        mr->readyNext = 0;
+    }
+    mr->stats.uploadedBytes = uploaded;
+}
+
+void residency_update(MeshResidency *mr, Scene *scene, const SceneViewport *const *views, int count,
+                      bool everything)
+{
+    GpuResources *gpu = scene->gpu;
+    const ResourcePool<Mesh, MeshTag> &pool = gpu->meshes;
+    mr->frame++;
+
+    if (!mr->busy.load() && mr->thread.joinable()) {
+        mr->thread.join();
+        for (ResidencyLoad &load : mr->job.loads) mr->ready.push_back(std::move(load));
+        mr->job.loads.clear();
+        mr->stats.loadMs = mr->job.seconds * 1000.0;
+    }
+
+    if (mr->lastSeen.size() < pool.slots.size()) mr->lastSeen.resize(pool.slots.size(), 0);
+    if (everything) {
+        for (uint32_t i = 0; i < pool.items.size(); i++) mr->lastSeen[pool.itemSlot[i]] = mr->frame;
+    } else {
+        // objects mostly share a handful of meshes, so skip repeats
+        const SceneObjects *o = &scene->objects;
+        const size_t objects = scene_object_count(scene);
+        for (int v = 0; v < count; v++) {
+            MeshHandle last;
+            for (uint32_t i : views[v]->visible) {
+                if (i >= objects) continue;
+                const MeshHandle h = cow_get(o->mesh, i);
+                if (h == last) continue;
+                last = h;
+                mark_seen(mr, h);
+            }
+        }
+    }
+
+    upload_ready(mr, gpu);
+
+    mr->wanted.clear();
+    mr->candidates.clear();
+    ResidencyStats &st = mr->stats;
+    st.resident = st.evicted = 0;
+    st.residentBytes = st.evictedBytes = 0;
+    for (uint32_t i = 0; i < pool.items.size(); i++) {
+        const Mesh &m = pool.items[i];
+        if (!managed(m)) continue;
+        const int64_t seen = mr->lastSeen[pool.itemSlot[i]];
+        const MeshHandle h = pool_handle_at(&pool, i);
+        if (m.resident) {
+            st.resident++;
+            st.residentBytes += m.bytes;
+            if (seen < mr->frame) mr->candidates.push_back({seen, h});
+        } else {
+            st.evicted++;
+            st.evictedBytes += m.bytes;
+            if (seen == mr->frame && !mr->pending.count(h.value) && !mr->failed.count(h.value))
+                mr->wanted.push_back(h);
+        }
+    }
+
+    if (mr->budget && st.residentBytes > mr->budget) {
+        // least recently visible first
+        std::sort(mr->candidates.begin(), mr->candidates.end(),
+                  [](const std::pair<int64_t, MeshHandle> &a, const std::pair<int64_t, MeshHandle> &b) {
+                      return a.first < b.first;
+                  });
+        for (const auto &c : mr->candidates) {
+            if (st.residentBytes <= mr->budget) break;
+            const size_t bytes = gpuresources_evict_mesh(gpu, c.second);
+            st.resident--;
+            st.residentBytes -= bytes;
+            st.evicted++;
+            st.evictedBytes += bytes;
+            st.evictions++;
+        }
+    }
+    st.overBudget = mr->budget && st.residentBytes > mr->budget;
+
+    if (!mr->busy.load() && !mr->thread.joinable() && !mr->wanted.empty()) start(mr, scene);
+    st.loading = (int)mr->pending.size();
+}
+
+void residency_shutdown(MeshResidency *mr)
+{
+    if (mr->thread.joinable()) mr->thread.join();
+    mr->job = ResidencyJob();
+    mr->ready.clear();
+    mr->readyNext = 0;
+    mr->pending.clear();
+    mr->failed.clear();
+    mr->lastSeen.clear();
+}
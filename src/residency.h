@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "scene.h"
+
+// Keeps the buffers of the scene's meshes under a GPU memory budget.
+//
+// Only meshes loaded from OBJ files are managed: their vertices can always
+// be read back from the mesh cache (see meshcache.h), so the buffers of the
+// ones no view has seen for longest are evicted once the resident bytes go
+// over the budget. The handle stays valid and objects keep it; evicted
+// meshes are culled and picked from their bounds as usual, but not drawn.
+// When one becomes visible again, a worker thread reads it from the cache
+// and the main thread re-uploads it, at most uploadBudget bytes a frame
+// (but always at least one mesh).
+//
+// Static batches and impostors don't need their source meshes on the GPU,
+// so objects drawn through them let their meshes go too.
+
+// One mesh read back by the worker.
+struct ResidencyLoad
+{
+    MeshHandle mesh;
+    std::string name;
+    std::vector<float> vertices;    // mesh layout, empty if the read failed
+};
+
+// One worker run: names are filled on the main thread, vertices by the worker.
+struct ResidencyJob
+{
+    std::string meshCacheDir;
+    int aoRays = 0;
+    std::vector<ResidencyLoad> loads;
+    double seconds = 0.0;
+};
+
+struct ResidencyStats
+{
+    int resident;           // managed meshes with buffers
+    size_t residentBytes;
+    int evicted;            // managed meshes without, right now
+    size_t evictedBytes;
+    int loading;            // requested, not uploaded yet
+    uint64_t evictions;     // totals
+    uint64_t restores;
+    size_t uploadedBytes;   // this frame
+    double loadMs;          // worker time of the last run
+    bool overBudget;        // even after evicting everything not visible
+};
+
+struct MeshResidency
+{
+    size_t budget = 0;                  // bytes of managed meshes, 0: no limit
+    size_t uploadBudget = 4 << 20;      // bytes restored per frame
+
+    std::thread thread;
+    std::atomic<bool> busy{false};
+    ResidencyJob job;
+    std::vector<ResidencyLoad> ready;   // read, waiting for upload budget
+    size_t readyNext = 0;
+    std::unordered_set<uint32_t> pending;   // handle values being read or uploaded
+    std::unordered_set<uint32_t> failed;    // cache entry unusable, not requested again
+
+    int64_t frame = 0;
+    std::vector<int64_t> lastSeen;      // by mesh slot (handles.h), frame last visible
+    std::vector<MeshHandle> wanted;     // scratch: visible but evicted
+    std::vector<std::pair<int64_t, MeshHandle>> candidates;    // scratch: eviction order
+
+    ResidencyStats stats = {};
+};
+
+// Call once per frame on the main thread, after the last cull of `views`
+// and before the next recording. Marks the meshes of their visible objects
+// as used (every managed mesh with `everything`, for culling the CPU
+// doesn't see), uploads what the worker has read, evicts down to the
+// budget and starts reading the visible meshes that are missing.
+void residency_update(MeshResidency *mr, Scene *scene, const SceneViewport *const *views, int count,
+                      bool everything);
+
+// Waits for the worker. Evicted meshes stay evicted; their handles are
+// released with the scene as usual.
+void residency_shutdown(MeshResidency *mr);
@@ -0,0 +1,548 @@
+#include "scene.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/euler_angles.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include "shader.h"
+
+glm::mat4 renderobject_model(glm::vec3 position, glm::vec3 rotation, glm::vec3 scale){
+    glm::mat4 trans = glm::translate(glm::mat4(1.0), position);
+    glm::vec3 eulerRad = glm::radians(rotation);
+    glm::mat4 rot = glm::eulerAngleXYZ(eulerRad.x, eulerRad.y, eulerRad.z);
+    glm::mat4 scl = glm::scale(glm::mat4(1.0), scale);
+    return trans * rot * scl;
+}
+
+glm::mat4 renderobject_model(const SceneObjects *objects, size_t index){
+    return renderobject_model(
+        cow_get(objects->position, index),
+        cow_get(objects->rotation, index),
+        cow_get(objects->scale, index));
+}
+
+// Blends two angles in degrees the short way round.
+static float mix_degrees(float a, float b, float t){
+    float d = std::fmod(b - a, 360.0f);
+    if (d > 180.0f) d -= 360.0f;
+    else if (d < -180.0f) d += 360.0f;
+    return a + d * t;
+}
+
+glm::mat4 scene_render_model(const Scene *scene, size_t index){
+    const SceneObjects *o = &scene->objects;
+    if (scene->prevPosition.size != o->position.size) return renderobject_model(o, index);
+
+    const float t = scene->simAlpha;
+    glm::vec3 r0 = cow_get(scene->prevRotation, index);
+    glm::vec3 r1 = cow_get(o->rotation, index);
+    return renderobject_model(
+        glm::mix(cow_get(scene->prevPosition, index), cow_get(o->position, index), t),
+        glm::vec3(mix_degrees(r0.x, r1.x, t), mix_degrees(r0.y, r1.y, t), mix_degrees(r0.z, r1.z, t)),
+        cow_get(o->scale, index));
+}
+
+MeshHandle scene_acquire_mesh(Scene *scene, const std::string &modelPath){
+    // objects loaded from the same file share one mesh
+    MeshHandle mesh = gpuresources_find_mesh(scene->gpu, modelPath);
+    if (handle_is_null(mesh)) {
+        std::vector<float> vertices = meshcache_load(&scene->meshCache, modelPath);
+        mesh = gpuresources_create_mesh(scene->gpu, modelPath, vertices.data(),
+                                        (int)(vertices.size() / MESH_VERTEX_FLOATS));
+    } else {
+        gpuresources_retain(scene->gpu, mesh);
+    }
+    return mesh;
+}
+
+void create_render_object(Scene *scene, std::string modelPath, glm::vec3 position, glm::vec3 rotation, glm::vec3 scale, glm::vec3 color){
+    MeshHandle mesh = scene_acquire_mesh(scene, modelPath);
+    gpuresources_retain(scene->gpu, scene->prog);
+
+    SceneObjects *o = &scene->objects;
+    cow_push(&o->name, modelPath);
+    cow_push(&o->prog, scene->prog);
+    cow_push(&o->mesh, mesh);
+    cow_push(&o->position, position);
+    cow_push(&o->rotation, rotation);
+    cow_push(&o->scale, scale);
+    cow_push(&o->color, color);
+    cow_push(&o->isStatic, (uint8_t)0);
+}
+
+void remove_render_object(Scene *scene, int index){
+    SceneObjects *o = &scene->objects;
+    gpuresources_release(scene->gpu, cow_get(o->prog, index));
+    gpuresources_release(scene->gpu, cow_get(o->mesh, index));
+
+    cow_swap_remove(&o->name, index);
+    cow_swap_remove(&o->prog, index);
+    cow_swap_remove(&o->mesh, index);
+    cow_swap_remove(&o->position, index);
+    cow_swap_remove(&o->rotation, index);
+    cow_swap_remove(&o->scale, index);
+    cow_swap_remove(&o->color, index);
+    cow_swap_remove(&o->isStatic, index);
+
+    if (scene->selected >= (int)scene_object_count(scene))
+        scene->selected = (int)scene_object_count(scene) - 1;
+    scene->renumbered++;
+}
+
+void scene_clear_objects(Scene *scene){
+    SceneObjects *o = &scene->objects;
+    for (size_t i = 0; i < scene_object_count(scene); i++) {
+        gpuresources_release(scene->gpu, cow_get(o->prog, i));
+        gpuresources_release(scene->gpu, cow_get(o->mesh, i));
+    }
+    cow_clear(&o->name);
+    cow_clear(&o->prog);
+    cow_clear(&o->mesh);
+    cow_clear(&o->position);
+    cow_clear(&o->rotation);
+    cow_clear(&o->scale);
+    cow_clear(&o->color);
+    cow_clear(&o->isStatic);
+    cow_clear(&scene->prevPosition);
+    cow_clear(&scene->prevRotation);
+    scene->selected = -1;
+    scene->renumbered++;
+}
+
+// Per-view constants of scene_cull_views.
+struct ViewCull{
+    SceneViewport *view;
+    const Frustum *frustum;
+    glm::vec3 eye;
+    float pixelScale;   // projected diameter in pixels is radius * pixelScale / distance
+    float orthoDist2;   // squared distance to use for every object, 0 for perspective
+};
+
+static bool sphere_outside_box(glm::vec3 c, float r, glm::vec3 lo, glm::vec3 hi){
+    return c.x + r < lo.x || c.y + r < lo.y || c.z + r < lo.z ||
+           c.x - r > hi.x || c.y - r > hi.y || c.z - r > hi.z;
+}
+
+void scene_cull_views(Scene *scene, SceneViewport *const *views, int count){
+    const SceneObjects *o = &scene->objects;
+    count = std::min(count, SCENE_MAX_VIEWS);
+
+    // box around the corners of every view volume, only worth testing
+    // first when there is more than one
+    ViewCull cull[SCENE_MAX_VIEWS];
+    glm::vec3 boxMin(INFINITY), boxMax(-INFINITY);
+    for (int v = 0; v < count; v++) {
+        SceneViewport *view = views[v];
+        const OrbitCamera *cam = view->camera;
+        view->visible.clear();
+        view->visibleChunks.clear();
+        view->visibleImpostors.clear();
+        cull[v] = {view, &cam->frustum, cam->position, view->height / std::tan(cam->fov * 0.5f),
+                   cam->orthographic ? cam->distance * cam->distance : 0.0f};
+        for (int c = 0; c < 8; c++) {
+            glm::vec4 p = cam->invViewProj * glm::vec4(c & 1 ? 1.0f : -1.0f, c & 2 ? 1.0f : -1.0f,
+                                                       c & 4 ? 1.0f : -1.0f, 1.0f);
+            glm::vec3 corner = glm::vec3(p) / p.w;
+            boxMin = glm::min(boxMin, corner);
+            boxMax = glm::max(boxMax, corner);
+        }
+    }
+    const bool useBox = count > 1;
+
+    // objects mostly share a handful of meshes, so remember the last lookup
+    MeshHandle lastMesh;
+    float meshRadius = 0.0f;
+    GLuint meshAtlas = 0;
+    const bool batched = scene->staticBatched;
+    const bool impostors = scene->impostors.enabled;
+    const float switch2 = scene->impostors.switchPixels * scene->impostors.switchPixels;
+    for (size_t c = 0; c < cow_chunk_count(scene_object_count(scene)); c++) {
+        const MeshHandle *mesh = cow_chunk_data(o->mesh, c);
+        const glm::vec3 *position = cow_chunk_data(o->position, c);
+        const glm::vec3 *scale = cow_chunk_data(o->scale, c);
+        const uint8_t *isStatic = cow_chunk_data(o->isStatic, c);
+        const size_t base = c * COW_CHUNK_SIZE;
+        for (size_t k = 0; k < cow_chunk_len(o->position, c); k++) {
+            if (batched && isStatic[k]) continue;
+            if (mesh[k].value != lastMesh.value) {
+                Mesh *m = gpuresources_mesh(scene->gpu, mesh[k]);
+                lastMesh = mesh[k];
+                meshRadius = m ? m->radius : 0.0f;
+                meshAtlas = impostors ? impostor_atlas(&scene->impostors, mesh[k]) : 0;
+            }
+            glm::vec3 s = glm::abs(scale[k]);
+            float radius = meshRadius * std::max(s.x, std::max(s.y, s.z));
+            if (useBox && sphere_outside_box(position[k], radius, boxMin, boxMax)) continue;
+            for (int v = 0; v < count; v++) {
+                const ViewCull &vc = cull[v];
+                if (!frustum_sphere_visible(vc.frustum, position[k], radius)) continue;
+                const glm::vec3 d = position[k] - vc.eye;
+                const float pixels = radius * vc.pixelScale;
+                const float dist2 = vc.orthoDist2 > 0.0f ? vc.orthoDist2 : glm::dot(d, d);
+                if (meshAtlas && pixels * pixels < switch2 * dist2)
+                    vc.view->visibleImpostors.push_back((uint32_t)(base + k));
+                else
+                    vc.view->visible.push_back((uint32_t)(base + k));
+            }
+        }
+    }
+
+    if (!batched) return;
+    for (uint32_t c = 0; c < scene->staticChunks.size(); c++) {
+        const StaticChunk &chunk = scene->staticChunks[c];
+        if (useBox && sphere_outside_box(chunk.center, chunk.radius, boxMin, boxMax)) continue;
+        for (int v = 0; v < count; v++) {
+            if (frustum_sphere_visible(cull[v].frustum, chunk.center, chunk.radius))
+                cull[v].view->visibleChunks.push_back(c);
+        }
+    }
+}
+
+void scene_cull(Scene *scene){
+    SceneViewport *view = &scene->view;
+    scene_cull_views(scene, &view, 1);
+}
+
+// Distance along the ray to the object's bounding sphere, or infinity.
+static float pick_distance(Scene *scene, uint32_t i, glm::vec3 origin, glm::vec3 dir){
+    const SceneObjects *o = &scene->objects;
+    Mesh *m = gpuresources_mesh(scene->gpu, cow_get(o->mesh, i));
+    if (!m) return INFINITY;
+    glm::vec3 s = glm::abs(cow_get(o->scale, i));
+    float radius = m->radius * std::max(s.x, std::max(s.y, s.z));
+
+    // dir is unit length
+    glm::vec3 oc = origin - cow_get(o->position, i);
+    float b = glm::dot(oc, dir);
+    float c = glm::dot(oc, oc) - radius * radius;
+    float disc = b * b - c;
+    if (disc < 0.0f) return INFINITY;
+    float t = -b - std::sqrt(disc);
+    if (t < 0.0f) t = -b + std::sqrt(disc);   // origin inside the sphere
+    return t >= 0.0f ? t : INFINITY;
+}
+
+int scene_pick(Scene *scene, const SceneViewport *view, glm::vec3 origin, glm::vec3 dir){
+    const SceneObjects *o = &scene->objects;
+    int best = -1;
+    float bestT = INFINITY;
+    for (const std::vector<uint32_t> *list : {&view->visible, &view->visibleImpostors}) {
+        for (uint32_t i : *list) {
+            if (i >= scene_object_count(scene)) continue;
+            float t = pick_distance(scene, i, origin, dir);
+            if (t < bestT) {
+                bestT = t;
+                best = (int)i;
+            }
+        }
+    }
+    // batched objects aren't in view->visible
+    if (scene->staticBatched) {
+        for (uint32_t i = 0; i < scene_object_count(scene); i++) {
+            if (!cow_get(o->isStatic, i)) continue;
+            float t = pick_distance(scene, i, origin, dir);
+            if (t < bestT) {
+                bestT = t;
+                best = (int)i;
+            }
+        }
+    }
+    return best;
+}
+
+// Below this many draws a range isn't worth handing to another thread.
+static const size_t RECORD_MIN_DRAWS = 2048;
+
+// Draw sort key, most significant first: depth bucket (4 bits), program
+// and mesh slot (20 bits each), then 16 bits of depth that only order draws
+// inside a segment. Depth is logarithmic between the clip planes, so
+// buckets near the camera are thin.
+static const int KEY_DEPTH_BITS = 16;
+static const int KEY_BUCKET_BITS = 4;
+
+static uint64_t draw_key(ProgramHandle prog, MeshHandle mesh, uint32_t depth){
+    return (uint64_t)(depth >> (KEY_DEPTH_BITS - KEY_BUCKET_BITS)) << 60 |
+           (uint64_t)handle_index(prog) << 40 | (uint64_t)handle_index(mesh) << 20 | depth;
+}
+
+static uint64_t segment_key(uint64_t key){
+    return key >> KEY_DEPTH_BITS;
+}
+
+struct KeyDepth{
+    glm::vec3 eye, forward;
+    float nearClip, logRange;
+};
+
+static KeyDepth key_depth_setup(const OrbitCamera *cam){
+    return {cam->position, glm::vec3(-cam->view[0][2], -cam->view[1][2], -cam->view[2][2]),
+            cam->nearClip, std::log(cam->farClip / cam->nearClip)};
+}
+
+// Quantized log view depth of p, for the key.
+static uint32_t key_depth(const KeyDepth &kd, glm::vec3 p){
+    float d = std::max(glm::dot(p - kd.eye, kd.forward), kd.nearClip);
+    float t = std::min(std::log(d / kd.nearClip) / kd.logRange, 1.0f);
+    return (uint32_t)(t * ((1u << KEY_DEPTH_BITS) - 1));
+}
+
+void scene_record_draws(const Scene *scene, const SceneViewport *view, size_t begin, size_t end, CmdBuffer *cb){
+    const SceneObjects *o = &scene->objects;
+
+    // handles make the key, so sorting needs no pool lookups
+    const KeyDepth kd = key_depth_setup(view->camera);
+    std::vector<std::pair<uint64_t, uint32_t>> &items = cb->scratch;
+    items.clear();
+    for (size_t v = begin; v < end; v++) {
+        const uint32_t i = view->visible[v];
+        const uint32_t depth = scene->sortFrontToBack ? key_depth(kd, cow_get(o->position, i)) : 0;
+        items.push_back({draw_key(cow_get(o->prog, i), cow_get(o->mesh, i), depth), i});
+    }
+    std::sort(items.begin(), items.end());
+
+    uint64_t key = 0;
+    bool drawable = false;
+    int vertexCount = 0;
+    for (size_t k = 0; k < items.size(); k++) {
+        const uint32_t i = items[k].second;
+        if (k == 0 || segment_key(items[k].first) != key) {
+            key = segment_key(items[k].first);
+            ProgramHandle ph = cow_get(o->prog, i);
+            MeshHandle mh = cow_get(o->mesh, i);
+            const Program *program = gpuresources_program(scene->gpu, ph);
+            const Mesh *mesh = gpuresources_mesh(scene->gpu, mh);
+            // evicted meshes come back once the residency manager restores
+            // them; empty ones have no buffer to draw from
+            drawable = program && mesh && mesh->resident && mesh->vbo;
+            if (!drawable) continue;
+            vertexCount = mesh->vertexCount;
+            cmdbuffer_begin_segment(cb, key, program->prog, mesh->vbo);
+            cmdbuffer_bind_program(cb, {ph, program->prog});
+            cmdbuffer_bind_geometry(cb, {mh, mesh->vao, mesh->vbo, mesh->ebo, mesh->stride,
+                                         mesh->boundsMin, mesh->boundsMax});
+        }
+        if (!drawable) continue;
+        cmdbuffer_draw_data(cb, {scene_render_model(scene, i), cow_get(o->color, i), i});
+        cmdbuffer_draw(cb, {0, vertexCount});
+    }
+    cmdbuffer_finish(cb);
+}
+
+// A segment per visible chunk, keyed like any other draw so it sorts in
+// with them. Vertices are already in world space and carry their color.
+static void record_static_chunks(const Scene *scene, const SceneViewport *view, CmdBuffer *cb){
+    const Program *program = gpuresources_program(scene->gpu, scene->staticProg);
+    if (!program || view->visibleChunks.empty()) return;
+    const CmdDrawData identity = {glm::mat4(1.0f), glm::vec3(1.0f), UINT32_MAX};
+    const KeyDepth kd = key_depth_setup(view->camera);
+    for (uint32_t c : view->visibleChunks) {
+        const StaticChunk &chunk = scene->staticChunks[c];
+        const Mesh *mesh = gpuresources_mesh(scene->gpu, chunk.mesh);
+        if (!mesh) continue;
+        const uint32_t depth = scene->sortFrontToBack ? key_depth(kd, chunk.center) : 0;
+        cmdbuffer_begin_segment(cb, segment_key(draw_key(scene->staticProg, chunk.mesh, depth)),
+                                program->prog, mesh->vbo, mesh->ebo);
+        cmdbuffer_bind_program(cb, {scene->staticProg, program->prog});
+        cmdbuffer_bind_geometry(cb, {chunk.mesh, mesh->vao, mesh->vbo, mesh->ebo, mesh->stride,
+                                     mesh->boundsMin, mesh->boundsMax});
+        cmdbuffer_draw_data(cb, identity);
+        cmdbuffer_draw_indexed(cb, {0, mesh->indexCount});
+    }
+    cmdbuffer_finish(cb);
+}
+
+// Impostors grouped by mesh, CMD_IMPOSTOR_BATCH instances per draw. They
+// sort after everything else in the far depth bucket.
+static void record_impostors(const Scene *scene, const SceneViewport *view, CmdBuffer *cb){
+    const Program *program = gpuresources_program(scene->gpu, scene->impostors.drawProg);
+    if (!program || view->visibleImpostors.empty()) return;
+    const SceneObjects *o = &scene->objects;
+
+    std::vector<std::pair<uint64_t, uint32_t>> &items = cb->scratch;
+    items.clear();
+    for (uint32_t i : view->visibleImpostors) items.push_back({cow_get(o->mesh, i).value, i});
+    std::sort(items.begin(), items.end());
+
+    const uint32_t farDepth = (1u << KEY_DEPTH_BITS) - 1;
+    const CmdBindGeometry quad = {MeshHandle(), scene->impostors.vao, 0, 0, 0, glm::vec3(0.0f), glm::vec3(0.0f)};
+    glm::vec4 instances[CMD_IMPOSTOR_BATCH * CMD_IMPOSTOR_VEC4S];
+    for (size_t k = 0; k < items.size();) {
+        const MeshHandle mh = cow_get(o->mesh, items[k].second);
+        const Mesh *mesh = gpuresources_mesh(scene->gpu, mh);
+        const GLuint atlas = impostor_atlas(&scene->impostors, mh);
+        cmdbuffer_begin_segment(cb, segment_key(draw_key(scene->impostors.drawProg, mh, farDepth)), program->prog, 0);
+        cmdbuffer_bind_program(cb, {scene->impostors.drawProg, program->prog});
+        cmdbuffer_bind_geometry(cb, quad);
+        int count = 0;
+        for (; k < items.size() && items[k].first == mh.value; k++) {
+            const uint32_t i = items[k].second;
+            const glm::vec3 s = glm::abs(cow_get(o->scale, i));
+            const float radius = (mesh ? mesh->radius : 0.0f) * std::max(s.x, std::max(s.y, s.z));
+            const glm::quat q = glm::quat_cast(glm::mat3(renderobject_model(glm::vec3(0.0f), cow_get(o->rotation, i),
+                                                                             glm::vec3(1.0f))));
+            glm::vec4 *dst = instances + count * CMD_IMPOSTOR_VEC4S;
+            dst[0] = glm::vec4(cow_get(o->position, i), radius);
+            dst[1] = glm::vec4(q.x, q.y, q.z, q.w);
+            dst[2] = glm::vec4(cow_get(o->color, i), 0.0f);
+            if (++count == CMD_IMPOSTOR_BATCH) {
+                cmdbuffer_draw_impostors(cb, atlas, instances, count);
+                count = 0;
+            }
+        }
+        if (count) cmdbuffer_draw_impostors(cb, atlas, instances, count);
+    }
+    cmdbuffer_finish(cb);
+}
+
+// Tasks of view v are [firstTask[v], firstTask[v + 1]): drawTasks[v]
+// ranges of its visible objects, then one for chunks and impostors.
+struct RecordJob{
+    const Scene *scene;
+    const SceneViewport *const *views;
+    CmdList *const *lists;
+    int firstTask[SCENE_MAX_VIEWS + 1];
+    int drawTasks[SCENE_MAX_VIEWS];
+    size_t perTask[SCENE_MAX_VIEWS];
+};
+
+static void record_task(void *context, int task){
+    RecordJob *job = (RecordJob*)context;
+    int v = 0;
+    while (task >= job->firstTask[v + 1]) v++;
+    const SceneViewport *view = job->views[v];
+    const int local = task - job->firstTask[v];
+    CmdBuffer *cb = &job->lists[v]->buffers[local];
+    if (local == job->drawTasks[v]) {
+        record_static_chunks(job->scene, view, cb);
+        record_impostors(job->scene, view, cb);
+        return;
+    }
+    const size_t n = view->visible.size();
+    const size_t begin = std::min(n, local * job->perTask[v]);
+    const size_t end = std::min(n, begin + job->perTask[v]);
+    scene_record_draws(job->scene, view, begin, end, cb);
+}
+
+void scene_record_views(const Scene *scene, JobPool *jobs, const SceneViewport *const *views,
+                        CmdList *const *lists, int count){
+    count = std::min(count, SCENE_MAX_VIEWS);
+    RecordJob job;
+    job.scene = scene;
+    job.views = views;
+    job.lists = lists;
+    job.firstTask[0] = 0;
+    for (int v = 0; v < count; v++) {
+        const size_t n = views[v]->visible.size();
+        const size_t wanted = (n + RECORD_MIN_DRAWS - 1) / RECORD_MIN_DRAWS;
+        const int tasks = (int)std::max<size_t>(1, std::min<size_t>(jobs_thread_count(jobs), wanted));
+        cmdlist_reset(lists[v], tasks + 1);
+        job.drawTasks[v] = tasks;
+        job.perTask[v] = (n + tasks - 1) / tasks;
+        job.firstTask[v + 1] = job.firstTask[v] + tasks + 1;
+    }
+    jobs_run(jobs, job.firstTask[count], record_task, &job);
+}
+
+void scene_record(const Scene *scene, JobPool *jobs, CmdList *list){
+    const SceneViewport *view = &scene->view;
+    scene_record_views(scene, jobs, &view, &list, 1);
+}
+
+void scene_snapshot(Scene *scene, SceneSnapshot *out){
+    out->objects = scene->objects;   // chunk pointers only
+    out->lightPos = scene->lightPos;
+    out->orbitCamera = scene->orbitCamera;
+
+    // the pools aren't thread-safe, so resolve names while we're still on
+    // the main thread
+    out->meshNames.clear();
+    const ResourcePool<Mesh, MeshTag> &meshes = scene->gpu->meshes;
+    for (uint32_t i = 0; i < meshes.items.size(); i++)
+        out->meshNames[pool_handle_at(&meshes, i).value] = meshes.items[i].name;
+}
+
+static GLuint load_lit_program(){
+    GLuint prog = createProgram("assets/shaders/lit_shader.vs", "assets/shaders/lit_shader.fs");
+    bindUniformBlock(prog, "Camera", CAMERA_BLOCK_BINDING);
+    return prog;
+}
+
+// Pre-transformed vertices with a color each; uModel stays identity so
+// gl_Position is computed exactly as in lit_shader.vs.
+static GLuint load_static_program(){
+    GLuint prog = createProgram("assets/shaders/lit_static.vs", "assets/shaders/lit_shader.fs");
+    bindUniformBlock(prog, "Camera", CAMERA_BLOCK_BINDING);
+    return prog;
+}
+
+// Same vertex shader as the lit program, whose gl_Position is invariant, so
+// the pre-pass depth matches exactly and GL_EQUAL can be used after it.
+static GLuint load_depth_program(){
+    GLuint prog = createProgram("assets/shaders/lit_shader.vs", "assets/shaders/depth_only.fs");
+    bindUniformBlock(prog, "Camera", CAMERA_BLOCK_BINDING);
+    return prog;
+}
+
+void scene_upload_camera(Scene *scene, const OrbitCamera *cam){
+    CameraBlock block;
+    block.view = cam->view;
+    block.proj = cam->proj;
+    block.viewPos = glm::vec4(cam->position, 1.0f);
+
+    // re-specifying the store lets the driver hand out fresh memory instead
+    // of waiting for last frame's draws to finish reading it
+    glBindBuffer(GL_UNIFORM_BUFFER, scene->cameraUbo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(block), &block, GL_STREAM_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, scene->cameraUbo);
+}
+
+GLuint scene_depth_program(Scene *scene){
+    if (!scene->depthPrepass) return 0;
+    const Program *p = gpuresources_program(scene->gpu, scene->depthProg);
+    return p ? p->prog : 0;
+}
+
+void scene_reload_shaders(Scene *scene){
+    gpuresources_swap_program(scene->gpu, scene->prog, load_lit_program());
+    gpuresources_swap_program(scene->gpu, scene->depthProg, load_depth_program());
+    gpuresources_swap_program(scene->gpu, scene->staticProg, load_static_program());
+    impostor_reload_shaders(&scene->impostors, scene->gpu);
+}
+
+void create_scene(Scene* scene, GpuResources *gpu){
+    scene->gpu = gpu;
+    scene->prog = gpuresources_create_program(gpu, load_lit_program());
+    scene->depthProg = gpuresources_create_program(gpu, load_depth_program());
+    scene->staticProg = gpuresources_create_program(gpu, load_static_program());
+
+    glGenBuffers(1, &scene->cameraUbo);
+    glBindBuffer(GL_UNIFORM_BUFFER, scene->cameraUbo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), nullptr, GL_STREAM_DRAW);
+    gpuresources_track(gpu, GPU_RESOURCE_BUFFER, scene->cameraUbo, sizeof(CameraBlock));
+    scene->selected = -1;
+    orbitcamera_initialize(&scene->orbitCamera);
+    scene->lightPos = glm::vec3(1.2f, 1.5f, 1.0f);
+    scene->animLight = scene->lightPos;
+    scene->simAlpha = 0.0f;
+    scene->renumbered = 0;
+    scene->sortFrontToBack = true;
+    scene->depthPrepass = false;
+    scene->staticBatching = false;
+    scene->staticBatched = false;
+    impostor_initialize(&scene->impostors, gpu);
+    scene->view.camera = &scene->orbitCamera;
+    scene->view.height = 1;
+}
+
+void delete_scene(Scene* scene){
+    scene_clear_objects(scene);
+    gpuresources_release(scene->gpu, scene->prog);
+    gpuresources_release(scene->gpu, scene->depthProg);
+    gpuresources_release(scene->gpu, scene->staticProg);
+    impostor_shutdown(&scene->impostors, scene->gpu);
+    gpuresources_release(scene->gpu, GPU_RESOURCE_BUFFER, scene->cameraUbo);
+}
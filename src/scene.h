@@ -0,0 +1,192 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "orbitcamera.h"
+#include "gpuresources.h"
+#include "cowarray.h"
+#include "frustum.h"
+#include "cmdbuffer.h"
+#include "jobs.h"
+#include "impostor.h"
+#include "meshcache.h"
+
+// Per-object components, one chunked copy-on-write column each. Index i in
+// every column is the same object. Read with cow_get, write with cow_mut so
+// a snapshot that shares the chunk keeps seeing the old value.
+struct SceneObjects{
+    CowArray<std::string> name;
+    CowArray<ProgramHandle> prog;
+    CowArray<MeshHandle> mesh;
+    CowArray<glm::vec3> position;
+    CowArray<glm::vec3> rotation;   // degrees
+    CowArray<glm::vec3> scale;
+    CowArray<glm::vec3> color;
+    CowArray<uint8_t> isStatic;     // 1: never moves, may be baked into a static batch
+};
+
+// Static objects of one program in one grid cell, pre-transformed into a
+// single indexed mesh (see staticbatch.h).
+struct StaticChunk{
+    MeshHandle mesh;
+    glm::vec3 center;
+    float radius;
+    uint32_t objects;
+};
+
+// Uniform buffer binding of the per-frame Camera block (see lit_shader.vs).
+constexpr GLuint CAMERA_BLOCK_BINDING = 0;
+
+// std140 layout of the Camera block.
+struct CameraBlock{
+    glm::mat4 view;
+    glm::mat4 proj;
+    glm::vec4 viewPos;  // xyz
+};
+
+// Most views scene_cull_views and scene_record_views take at once.
+constexpr int SCENE_MAX_VIEWS = 4;
+
+// One camera onto the scene and what scene_cull found visible from it.
+// scene->view looks through scene->orbitCamera; extra views (the editor's
+// top and side windows) bring their own camera.
+struct SceneViewport{
+    OrbitCamera *camera;    // updated for this frame's aspect before culling
+    int height;             // target height in pixels, for the impostor switch
+    std::vector<uint32_t> visible;
+    std::vector<uint32_t> visibleChunks;
+    std::vector<uint32_t> visibleImpostors;
+};
+
+struct Scene{
+    GpuResources *gpu;
+    ProgramHandle prog;
+    ProgramHandle depthProg;    // lit_shader.vs positions only, for the pre-pass
+    ProgramHandle staticProg;   // lit program over pre-transformed, colored vertices
+    GLuint cameraUbo;
+    SceneObjects objects;
+    OrbitCamera orbitCamera;
+    glm::vec3 lightPos;
+    glm::vec3 animLight;
+    int selected;
+    SceneViewport view;             // through orbitCamera
+    bool sortFrontToBack;           // record nearer depth buckets first
+    bool depthPrepass;              // lay down depth before shading
+
+    // Static batching: the batcher fills staticChunks and sets staticBatched
+    // once they cover every static object; until then those are drawn one
+    // by one like the rest.
+    bool staticBatching;
+    bool staticBatched;
+    std::vector<StaticChunk> staticChunks;
+
+    // Objects projecting smaller than impostors.switchPixels in a view are
+    // drawn as impostors there.
+    Impostors impostors;
+
+    // Where scene_acquire_mesh gets vertices and baked occlusion from.
+    MeshCache meshCache;
+
+    // Transforms as of the previous simulation tick, only kept while
+    // something moves objects every tick (see simulation.h). Rendering
+    // blends towards objects.* by simAlpha.
+    CowArray<glm::vec3> prevPosition;
+    CowArray<glm::vec3> prevRotation;
+    float simAlpha;
+
+    // Bumped whenever object indices change meaning (clear, load, generate,
+    // removal), for state kept per object index such as occlusion results.
+    uint64_t renumbered;
+};
+
+// Frozen copy of a scene that another thread may read while the live one
+// keeps changing. Taking one is O(chunks + meshes), not O(objects).
+struct SceneSnapshot{
+    SceneObjects objects;
+    std::unordered_map<uint32_t, std::string> meshNames;  // MeshHandle value -> path
+    glm::vec3 lightPos;
+    OrbitCamera orbitCamera;
+};
+
+inline size_t scene_object_count(const Scene *scene){
+    return scene->objects.position.size;
+}
+
+glm::mat4 renderobject_model(glm::vec3 position, glm::vec3 rotation, glm::vec3 scale);
+
+glm::mat4 renderobject_model(const SceneObjects *objects, size_t index);
+
+// Model matrix to draw with: interpolated between the last two simulation
+// ticks when the previous transforms are available.
+glm::mat4 scene_render_model(const Scene *scene, size_t index);
+
+// Shared mesh for an OBJ path, loaded on first use. Adds one reference.
+MeshHandle scene_acquire_mesh(Scene *scene, const std::string &modelPath);
+
+void create_render_object(Scene *scene, std::string modelPath, glm::vec3 position, glm::vec3 rotation, glm::vec3 scale, glm::vec3 color);
+
+// Safe to call mid-frame: the GL objects are only destroyed once the GPU
+// is done with every frame that could still reference them. The last object
+// takes the removed one's index.
+void remove_render_object(Scene *scene, int index);
+
+void scene_clear_objects(Scene *scene);
+
+// Fills view->visible with the indices of objects whose bounding sphere
+// touches the view's frustum, in object order. While static batches are in
+// use, static objects are left out and the chunks go into visibleChunks.
+// Objects small enough on screen to be impostors (and that have an atlas)
+// go into visibleImpostors instead. Set the view's height and update its
+// camera first.
+//
+// All views are culled in one pass over the objects: the mesh lookup, the
+// bounds and a test against a box around every view's frustum are done
+// once per object, only the frustum and impostor tests once per view.
+void scene_cull_views(Scene *scene, SceneViewport *const *views, int count);
+
+// scene_cull_views for scene->view alone.
+void scene_cull(Scene *scene);
+
+// Nearest object whose bounding sphere the ray hits, or -1. Only considers
+// what the last cull found visible in `view` (impostors included), plus
+// every batched static object.
+int scene_pick(Scene *scene, const SceneViewport *view, glm::vec3 origin, glm::vec3 dir);
+
+// Records draws for view->visible[begin, end) into cb, one segment per
+// program and mesh. With sortFrontToBack the segments are also split by a
+// coarse view-depth bucket that sorts ahead of the state, and draws within
+// a segment go nearest first. Only reads the scene, so ranges can be
+// recorded on several threads at once.
+void scene_record_draws(const Scene *scene, const SceneViewport *view, size_t begin, size_t end, CmdBuffer *cb);
+
+// Records every view into its own list in one run of the pool: each view's
+// visible objects split into ranges, plus one buffer for its static chunks
+// and instanced impostor draws.
+void scene_record_views(const Scene *scene, JobPool *jobs, const SceneViewport *const *views,
+                        CmdList *const *lists, int count);
+
+// scene_record_views for scene->view alone.
+void scene_record(const Scene *scene, JobPool *jobs, CmdList *list);
+
+void scene_snapshot(Scene *scene, SceneSnapshot *out);
+
+// Writes the camera's cached matrices into the Camera block and binds it.
+// Call after orbitcamera_update, once per view and frame.
+void scene_upload_camera(Scene *scene, const OrbitCamera *cam);
+
+// Program for the depth pre-pass, 0 unless depthPrepass is on.
+GLuint scene_depth_program(Scene *scene);
+
+// Recompiles the lit programs in place; objects keep their handle.
+void scene_reload_shaders(Scene *scene);
+
+// Empty scene with the lit program and a default camera and light;
+// objects come from scene_load_file or create_render_object.
+void create_scene(Scene* scene, GpuResources *gpu);
+
+void delete_scene(Scene* scene);
@@ -0,0 +1,559 @@
+#include "scenefile.h"
+
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+
+#include "mappedfile.h"
+
+static const char SCENE_MAGIC[8] = {'M', 'Y', 'G', 'L', 'S', 'C', 'N', 0};
+static const uint32_t SCENE_VERSION = 1;
+static const uint64_t SCENE_ALIGN = 64;
+
+enum SceneSectionId : uint32_t
+{
+    SECTION_META = 1,
+    SECTION_MESH_PATH_OFFSETS,
+    SECTION_MESH_PATHS,
+    SECTION_MESH,
+    SECTION_POSITION,
+    SECTION_ROTATION,
+    SECTION_SCALE,
+    SECTION_COLOR,
+    SECTION_NAME_OFFSETS,
+    SECTION_NAMES,
+    SECTION_STATIC,             // optional, all dynamic when absent
+    SECTION_COUNT_PLUS_ONE
+};
+
+struct SceneFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t sectionCount;
+    uint64_t objectCount;
+    uint64_t fileSize;
+};
+
+struct SceneFileSection
+{
+    uint32_t id;
+    uint32_t elementSize;
+    uint64_t offset;    // from start of file, SCENE_ALIGN aligned
+    uint64_t count;     // elements
+};
+
+static_assert(sizeof(glm::vec3) == 12, "scene files store tightly packed vec3");
+static_assert(sizeof(SceneFileHeader) == 32, "");
+static_assert(sizeof(SceneFileSection) == 24, "");
+
+static double seconds_since(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static bool has_extension(const std::string &path, const char *ext)
+{
+    size_t n = std::strlen(ext);
+    return path.size() >= n && path.compare(path.size() - n, n, ext) == 0;
+}
+
+void scene_capture(const SceneSnapshot *snap, SceneData *out)
+{
+    const SceneObjects &o = snap->objects;
+    const size_t n = o.position.size;
+
+    out->meta.lightPos = snap->lightPos;
+    out->meta.cameraTarget = snap->orbitCamera.target;
+    out->meta.cameraDistance = snap->orbitCamera.distance;
+    out->meta.cameraYaw = snap->orbitCamera.yaw;
+    out->meta.cameraPitch = snap->orbitCamera.pitch;
+
+    out->meshPaths.clear();
+    out->mesh.resize(n);
+    out->position.resize(n);
+    out->rotation.resize(n);
+    out->scale.resize(n);
+    out->color.resize(n);
+    out->isStatic.resize(n);
+    out->nameOffsets.resize(n + 1);
+    out->names.clear();
+
+    // mesh handles -> dense indices into the path table
+    std::unordered_map<uint32_t, uint32_t> meshIndex;
+    for (size_t c = 0; c < cow_chunk_count(n); c++) {
+        const size_t base = c * COW_CHUNK_SIZE;
+        const size_t len = cow_chunk_len(o.position, c);
+        const MeshHandle *mesh = cow_chunk_data(o.mesh, c);
+        const std::string *name = cow_chunk_data(o.name, c);
+        for (size_t k = 0; k < len; k++) {
+            auto it = meshIndex.find(mesh[k].value);
+            if (it == meshIndex.end()) {
+                auto nameIt = snap->meshNames.find(mesh[k].value);
+                it = meshIndex.emplace(mesh[k].value, (uint32_t)out->meshPaths.size()).first;
+                out->meshPaths.push_back(nameIt != snap->meshNames.end() ? nameIt->second : std::string());
+            }
+            out->mesh[base + k] = it->second;
+            out->nameOffsets[base + k] = (uint32_t)out->names.size();
+            out->names.insert(out->names.end(), name[k].begin(), name[k].end());
+        }
+        std::copy_n(cow_chunk_data(o.position, c), len, out->position.data() + base);
+        std::copy_n(cow_chunk_data(o.rotation, c), len, out->rotation.data() + base);
+        std::copy_n(cow_chunk_data(o.scale, c), len, out->scale.data() + base);
+        std::copy_n(cow_chunk_data(o.color, c), len, out->color.data() + base);
+        std::copy_n(cow_chunk_data(o.isStatic, c), len, out->isStatic.data() + base);
+    }
+    out->nameOffsets[n] = (uint32_t)out->names.size();
+}
+
+// --- binary -----------------------------------------------------------------
+
+struct SectionSource
+{
+    uint32_t id;
+    uint32_t elementSize;
+    const void *data;
+    uint64_t count;
+};
+
+static bool write_binary(const SceneData *data, const std::string &path)
+{
+    std::vector<uint32_t> meshPathOffsets;
+    std::vector<char> meshPaths;
+    for (const std::string &p : data->meshPaths) {
+        meshPathOffsets.push_back((uint32_t)meshPaths.size());
+        meshPaths.insert(meshPaths.end(), p.begin(), p.end());
+    }
+    meshPathOffsets.push_back((uint32_t)meshPaths.size());
+
+    const uint64_t n = data->mesh.size();
+    const SectionSource sources[] = {
+        {SECTION_META, sizeof(SceneMeta), &data->meta, 1},
+        {SECTION_MESH_PATH_OFFSETS, 4, meshPathOffsets.data(), meshPathOffsets.size()},
+        {SECTION_MESH_PATHS, 1, meshPaths.data(), meshPaths.size()},
+        {SECTION_MESH, 4, data->mesh.data(), n},
+        {SECTION_POSITION, 12, data->position.data(), n},
+        {SECTION_ROTATION, 12, data->rotation.data(), n},
+        {SECTION_SCALE, 12, data->scale.data(), n},
+        {SECTION_COLOR, 12, data->color.data(), n},
+        {SECTION_NAME_OFFSETS, 4, data->nameOffsets.data(), data->nameOffsets.size()},
+        {SECTION_NAMES, 1, data->names.data(), data->names.size()},
+        {SECTION_STATIC, 1, data->isStatic.data(), data->isStatic.size()},
+    };
+    const uint32_t sectionCount = sizeof(sources) / sizeof(sources[0]);
+
+    auto align = [](uint64_t v) { return (v + SCENE_ALIGN - 1) & ~(SCENE_ALIGN - 1); };
+
+    SceneFileSection table[sectionCount];
+    uint64_t offset = align(sizeof(SceneFileHeader) + sizeof(table));
+    for (uint32_t i = 0; i < sectionCount; i++) {
+        table[i].id = sources[i].id;
+        table[i].elementSize = sources[i].elementSize;
+        table[i].offset = offset;
+        table[i].count = sources[i].count;
+        offset = align(offset + sources[i].count * sources[i].elementSize);
+    }
+
+    SceneFileHeader header;
+    std::memcpy(header.magic, SCENE_MAGIC, sizeof(header.magic));
+    header.version = SCENE_VERSION;
+    header.sectionCount = sectionCount;
+    header.objectCount = n;
+    header.fileSize = offset;
+
+    FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+
+    static const char zeros[SCENE_ALIGN] = {};
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1
+           && std::fwrite(table, sizeof(table), 1, f) == 1;
+    uint64_t written = sizeof(header) + sizeof(table);
+    for (uint32_t i = 0; ok && i < sectionCount; i++) {
+        ok = std::fwrite(zeros, 1, table[i].offset - written, f) == table[i].offset - written;
+        written = table[i].offset;
+        uint64_t bytes = sources[i].count * sources[i].elementSize;
+        if (ok && bytes) ok = std::fwrite(sources[i].data, 1, bytes, f) == bytes;
+        written += bytes;
+    }
+    if (ok) ok = std::fwrite(zeros, 1, header.fileSize - written, f) == header.fileSize - written;
+    ok = (std::fclose(f) == 0) && ok;
+    return ok;
+}
+
+static uint32_t section_element_size(SceneSectionId id)
+{
+    switch (id) {
+    case SECTION_META:                  return sizeof(SceneMeta);
+    case SECTION_MESH_PATHS:
+    case SECTION_NAMES:
+    case SECTION_STATIC:                return 1;
+    case SECTION_POSITION:
+    case SECTION_ROTATION:
+    case SECTION_SCALE:
+    case SECTION_COLOR:                 return sizeof(glm::vec3);
+    default:                            return 4;
+    }
+}
+
+// String offsets: start at 0, never decrease, end within `bytes`.
+static bool offsets_valid(const uint32_t *offsets, uint64_t count, uint64_t bytes)
+{
+    if (offsets[0] != 0) return false;
+    for (uint64_t i = 1; i < count; i++) {
+        if (offsets[i] < offsets[i - 1]) return false;
+    }
+    return offsets[count - 1] <= bytes;
+}
+
+// Validates the header and section table and points `view` into the mapping.
+static bool view_binary(const MappedFile *mf, SceneView *view, const std::string &path)
+{
+    if (mf->size < sizeof(SceneFileHeader)) return false;
+    const SceneFileHeader *header = (const SceneFileHeader*)mf->data;
+    if (std::memcmp(header->magic, SCENE_MAGIC, sizeof(SCENE_MAGIC)) != 0 || header->version != SCENE_VERSION) {
+        std::cerr << "Not a scene file (or unsupported version): " << path << "\n";
+        return false;
+    }
+    if (header->fileSize != mf->size
+        || sizeof(SceneFileHeader) + (uint64_t)header->sectionCount * sizeof(SceneFileSection) > mf->size) {
+        std::cerr << "Truncated scene file: " << path << "\n";
+        return false;
+    }
+
+    const SceneFileSection *table = (const SceneFileSection*)(mf->data + sizeof(SceneFileHeader));
+    const void *sections[SECTION_COUNT_PLUS_ONE] = {};
+    uint64_t counts[SECTION_COUNT_PLUS_ONE] = {};
+    for (uint32_t i = 0; i < header->sectionCount; i++) {
+        const SceneFileSection &s = table[i];
+        // division, not multiplication: a huge count must not wrap around
+        if (s.offset % SCENE_ALIGN != 0 || s.offset > mf->size
+            || (s.elementSize && s.count > (mf->size - s.offset) / s.elementSize)) {
+            std::cerr << "Corrupt section table in " << path << "\n";
+            return false;
+        }
+        if (s.id > 0 && s.id < SECTION_COUNT_PLUS_ONE) {   // unknown sections are skipped
+            if (s.elementSize != section_element_size((SceneSectionId)s.id)) {
+                std::cerr << "Unexpected element size for section " << s.id << " in " << path << "\n";
+                return false;
+            }
+            sections[s.id] = mf->data + s.offset;
+            counts[s.id] = s.count;
+        }
+    }
+
+    const uint64_t n = header->objectCount;
+    bool ok = counts[SECTION_META] == 1
+           && counts[SECTION_MESH_PATH_OFFSETS] >= 1
+           && counts[SECTION_MESH] == n
+           && counts[SECTION_POSITION] == n
+           && counts[SECTION_ROTATION] == n
+           && counts[SECTION_SCALE] == n
+           && counts[SECTION_COLOR] == n
+           && counts[SECTION_NAME_OFFSETS] == n + 1
+           && (counts[SECTION_STATIC] == 0 || counts[SECTION_STATIC] == n);
+    if (ok) {
+        // instantiate slices strings between neighbouring offsets
+        ok = offsets_valid((const uint32_t*)sections[SECTION_MESH_PATH_OFFSETS], counts[SECTION_MESH_PATH_OFFSETS],
+                           counts[SECTION_MESH_PATHS])
+          && offsets_valid((const uint32_t*)sections[SECTION_NAME_OFFSETS], n + 1, counts[SECTION_NAMES]);
+    }
+    if (!ok) {
+        std::cerr << "Missing or inconsistent sections in " << path << "\n";
+        return false;
+    }
+
+    view->meta = *(const SceneMeta*)sections[SECTION_META];
+    view->objectCount = n;
+    view->meshCount = (uint32_t)counts[SECTION_MESH_PATH_OFFSETS] - 1;
+    view->meshPathOffsets = (const uint32_t*)sections[SECTION_MESH_PATH_OFFSETS];
+    view->meshPaths = (const char*)sections[SECTION_MESH_PATHS];
+    view->mesh = (const uint32_t*)sections[SECTION_MESH];
+    view->position = (const glm::vec3*)sections[SECTION_POSITION];
+    view->rotation = (const glm::vec3*)sections[SECTION_ROTATION];
+    view->scale = (const glm::vec3*)sections[SECTION_SCALE];
+    view->color = (const glm::vec3*)sections[SECTION_COLOR];
+    view->isStatic = counts[SECTION_STATIC] ? (const uint8_t*)sections[SECTION_STATIC] : nullptr;
+    view->nameOffsets = (const uint32_t*)sections[SECTION_NAME_OFFSETS];
+    view->names = (const char*)sections[SECTION_NAMES];
+    return true;
+}
+
+// --- text -------------------------------------------------------------------
+//
+//   light <x y z>
+//   camera <target x y z> <distance> <yaw> <pitch>
+//   mesh <path>                         (indexed in order of appearance)
+//   object <mesh> <position x y z> <rotation x y z> <scale x y z> <color r g b> <name...>
+//   static                              (marks the object above as static)
+
+// Shortest representation that reads back to the same float, so text saves
+// are lossless without printing 0.2 as 0.200000003.
+static void put_floats(FILE *f, const float *v, int count)
+{
+    char buf[32];
+    for (int i = 0; i < count; i++) {
+        std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), v[i]);
+        std::fputc(' ', f);
+        std::fwrite(buf, 1, r.ptr - buf, f);
+    }
+}
+
+static bool write_text(const SceneData *data, const std::string &path)
+{
+    FILE *f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+
+    const SceneMeta &m = data->meta;
+    std::fprintf(f, "# mygl scene\n");
+    std::fputs("light", f);
+    put_floats(f, &m.lightPos.x, 3);
+    std::fputs("\ncamera", f);
+    put_floats(f, &m.cameraTarget.x, 3);
+    put_floats(f, &m.cameraDistance, 1);
+    put_floats(f, &m.cameraYaw, 1);
+    put_floats(f, &m.cameraPitch, 1);
+    std::fputc('\n', f);
+    for (const std::string &p : data->meshPaths)
+        std::fprintf(f, "mesh %s\n", p.c_str());
+
+    for (size_t i = 0; i < data->mesh.size(); i++) {
+        std::fprintf(f, "object %u ", data->mesh[i]);
+        put_floats(f, &data->position[i].x, 3);
+        std::fputc(' ', f);
+        put_floats(f, &data->rotation[i].x, 3);
+        std::fputc(' ', f);
+        put_floats(f, &data->scale[i].x, 3);
+        std::fputc(' ', f);
+        put_floats(f, &data->color[i].x, 3);
+        int nameLen = (int)(data->nameOffsets[i + 1] - data->nameOffsets[i]);
+        std::fprintf(f, "  %.*s\n", nameLen, data->names.data() + data->nameOffsets[i]);
+        if (i < data->isStatic.size() && data->isStatic[i]) std::fputs("static\n", f);
+    }
+    return std::fclose(f) == 0;
+}
+
+static bool read_text(const std::string &path, SceneData *data)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) return false;
+
+    data->meta.lightPos = glm::vec3(1.2f, 1.5f, 1.0f);
+    data->meta.cameraTarget = glm::vec3(0.0f);
+    data->meta.cameraDistance = 5.0f;
+    data->meta.cameraYaw = 0.0f;
+    data->meta.cameraPitch = 0.0f;
+    data->nameOffsets.assign(1, 0);
+
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(file, line)) {
+        lineNo++;
+        if (line.empty() || line[0] == '#') continue;
+
+        std::istringstream iss(line);
+        std::string type;
+        iss >> type;
+        SceneMeta &m = data->meta;
+        bool ok = true;
+        if (type == "light") {
+            ok = (bool)(iss >> m.lightPos.x >> m.lightPos.y >> m.lightPos.z);
+        } else if (type == "camera") {
+            ok = (bool)(iss >> m.cameraTarget.x >> m.cameraTarget.y >> m.cameraTarget.z
+                            >> m.cameraDistance >> m.cameraYaw >> m.cameraPitch);
+        } else if (type == "mesh") {
+            std::string p;
+            std::getline(iss >> std::ws, p);
+            data->meshPaths.push_back(p);
+        } else if (type == "object") {
+            uint32_t mesh;
+            glm::vec3 p, r, s, c;
+            ok = (bool)(iss >> mesh >> p.x >> p.y >> p.z >> r.x >> r.y >> r.z
+                            >> s.x >> s.y >> s.z >> c.x >> c.y >> c.z);
+            if (ok) {
+                std::string name;
+                std::getline(iss >> std::ws, name);
+                data->mesh.push_back(mesh);
+                data->position.push_back(p);
+                data->rotation.push_back(r);
+                data->scale.push_back(s);
+                data->color.push_back(c);
+                data->isStatic.push_back(0);
+                data->names.insert(data->names.end(), name.begin(), name.end());
+                data->nameOffsets.push_back((uint32_t)data->names.size());
+            }
+        } else if (type == "static") {
+            ok = !data->isStatic.empty();
+            if (ok) data->isStatic.back() = 1;
+        }
+        if (!ok) std::cerr << path << ":" << lineNo << ": malformed '" << type << "' line\n";
+    }
+    return true;
+}
+
+static void view_data(const SceneData *data, std::vector<uint32_t> *pathOffsets, std::vector<char> *paths, SceneView *view)
+{
+    pathOffsets->clear();
+    paths->clear();
+    for (const std::string &p : data->meshPaths) {
+        pathOffsets->push_back((uint32_t)paths->size());
+        paths->insert(paths->end(), p.begin(), p.end());
+    }
+    pathOffsets->push_back((uint32_t)paths->size());
+
+    view->meta = data->meta;
+    view->objectCount = data->mesh.size();
+    view->meshCount = (uint32_t)data->meshPaths.size();
+    view->meshPathOffsets = pathOffsets->data();
+    view->meshPaths = paths->data();
+    view->mesh = data->mesh.data();
+    view->position = data->position.data();
+    view->rotation = data->rotation.data();
+    view->scale = data->scale.data();
+    view->color = data->color.data();
+    view->isStatic = data->isStatic.data();
+    view->nameOffsets = data->nameOffsets.data();
+    view->names = data->names.data();
+}
+
+// --- shared -----------------------------------------------------------------
+
+static void instantiate(Scene *scene, const SceneView *view)
+{
+    scene_clear_objects(scene);
+
+    const uint64_t n = view->objectCount;
+
+    // one reference per object, taken in bulk per mesh
+    std::vector<uint32_t> uses(view->meshCount, 0);
+    for (uint64_t i = 0; i < n; i++) {
+        if (view->mesh[i] < view->meshCount) uses[view->mesh[i]]++;
+    }
+    std::vector<MeshHandle> meshes(view->meshCount);
+    for (uint32_t m = 0; m < view->meshCount; m++) {
+        if (uses[m] == 0) continue;
+        std::string p(view->meshPaths + view->meshPathOffsets[m], view->meshPathOffsets[m + 1] - view->meshPathOffsets[m]);
+        meshes[m] = scene_acquire_mesh(scene, p);
+        gpuresources_retain(scene->gpu, meshes[m], (int)uses[m] - 1);
+    }
+    gpuresources_retain(scene->gpu, scene->prog, (int)n);
+
+    SceneObjects *o = &scene->objects;
+    cow_assign(&o->position, view->position, n);
+    cow_assign(&o->rotation, view->rotation, n);
+    cow_assign(&o->scale, view->scale, n);
+    cow_assign(&o->color, view->color, n);
+    cow_reset(&o->name, n);
+    cow_reset(&o->prog, n);
+    cow_reset(&o->mesh, n);
+    if (view->isStatic) cow_assign(&o->isStatic, view->isStatic, n);
+    else cow_reset(&o->isStatic, n);
+    for (uint64_t i = 0; i < n; i++) {
+        cow_mut(&o->name, i).assign(view->names + view->nameOffsets[i], view->nameOffsets[i + 1] - view->nameOffsets[i]);
+        cow_mut(&o->prog, i) = scene->prog;
+        cow_mut(&o->mesh, i) = view->mesh[i] < view->meshCount ? meshes[view->mesh[i]] : MeshHandle();
+    }
+
+    scene->lightPos = view->meta.lightPos;
+    scene->orbitCamera.target = view->meta.cameraTarget;
+    scene->orbitCamera.distance = view->meta.cameraDistance;
+    scene->orbitCamera.yaw = view->meta.cameraYaw;
+    scene->orbitCamera.pitch = view->meta.cameraPitch;
+    orbitcamera_invalidate(&scene->orbitCamera);
+    scene->selected = n > 0 ? 0 : -1;
+}
+
+bool scenefile_write(const SceneData *data, const std::string &path)
+{
+    // write next to the target and rename, so a crash mid-save never leaves
+    // a half-written scene behind
+    std::string tmp = path + ".tmp";
+    bool ok = has_extension(path, ".scnb") ? write_binary(data, tmp) : write_text(data, tmp);
+    if (!ok) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    return !ec;
+}
+
+bool scene_load_file(Scene *scene, const std::string &path)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    SceneView view;
+
+    if (has_extension(path, ".scnb")) {
+        MappedFile mf;
+        if (!mappedfile_open(&mf, path)) {
+            std::cerr << "Failed to open scene file: " << path << "\n";
+            return false;
+        }
+        bool ok = view_binary(&mf, &view, path);
+        if (ok) instantiate(scene, &view);
+        mappedfile_close(&mf);
+        if (!ok) return false;
+    } else {
+        SceneData data;
+        if (!read_text(path, &data)) {
+            std::cerr << "Failed to open scene file: " << path << "\n";
+            return false;
+        }
+        std::vector<uint32_t> pathOffsets;
+        std::vector<char> paths;
+        view_data(&data, &pathOffsets, &paths, &view);
+        instantiate(scene, &view);
+    }
+
+    std::cout << "Loaded " << scene_object_count(scene) << " objects from " << path
+              << " in " << seconds_since(t0) * 1000.0 << " ms\n";
+    return true;
+}
+
+bool scenesaver_start(SceneSaver *saver, Scene *scene, const std::string &path)
+{
+    if (saver->busy.load()) return false;
+    if (saver->thread.joinable()) saver->thread.join();
+
+    // The snapshot is the only part that touches the live scene and it only
+    // copies chunk pointers; flattening, formatting and disk I/O all happen
+    // on the worker while editing continues.
+    auto t0 = std::chrono::steady_clock::now();
+    SceneSnapshot *snap = new SceneSnapshot;
+    scene_snapshot(scene, snap);
+    saver->snapshotSeconds = seconds_since(t0);
+
+    saver->busy = true;
+    saver->path = path;
+    saver->thread = std::thread([saver, snap, path]() {
+        auto t0 = std::chrono::steady_clock::now();
+        SceneData data;
+        scene_capture(snap, &data);
+        delete snap;
+        bool ok = scenefile_write(&data, path);
+        saver->ok = ok;
+        saver->seconds = seconds_since(t0);
+        if (!ok) std::cerr << "Failed to save scene: " << path << "\n";
+        saver->busy = false;
+    });
+    return true;
+}
+
+void scenesaver_wait(SceneSaver *saver)
+{
+    if (saver->thread.joinable()) saver->thread.join();
+}
+
+void scenesaver_autosave(SceneSaver *saver, Scene *scene, double now)
+{
+    if (saver->autosaveInterval <= 0.0 || saver->autosavePath.empty()) return;
+    if (now - saver->lastAutosave < saver->autosaveInterval) return;
+    if (scenesaver_start(saver, scene, saver->autosavePath))
+        saver->lastAutosave = now;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "scene.h"
+
+// Scene files, picked by extension:
+//
+// *.scnb  binary. A header, a section table, then one 64-byte aligned block
+//         per section. Per-object data is stored SoA (positions, rotations,
+//         scales, colors, mesh indices, static flags, packed names), so
+//         loading maps the file and reads the arrays in place; nothing is
+//         parsed per object.
+//         Little-endian only.
+// *.scn   text. One line per object, meant for diffs and hand edits.
+
+struct SceneMeta
+{
+    glm::vec3 lightPos;
+    glm::vec3 cameraTarget;
+    float cameraDistance;
+    float cameraYaw;
+    float cameraPitch;
+};
+
+// Owning SoA copy of everything a scene file stores.
+struct SceneData
+{
+    SceneMeta meta;
+    std::vector<std::string> meshPaths;
+    std::vector<uint32_t> mesh;        // index into meshPaths
+    std::vector<glm::vec3> position;
+    std::vector<glm::vec3> rotation;   // degrees
+    std::vector<glm::vec3> scale;
+    std::vector<glm::vec3> color;
+    std::vector<uint8_t> isStatic;
+    std::vector<uint32_t> nameOffsets; // objects + 1 entries into names
+    std::vector<char> names;
+};
+
+// Non-owning view of the same arrays, either into a mapped file or a SceneData.
+struct SceneView
+{
+    SceneMeta meta;
+    uint64_t objectCount;
+    uint32_t meshCount;
+    const uint32_t *meshPathOffsets;   // meshCount + 1
+    const char *meshPaths;
+    const uint32_t *mesh;
+    const glm::vec3 *position;
+    const glm::vec3 *rotation;
+    const glm::vec3 *scale;
+    const glm::vec3 *color;
+    const uint8_t *isStatic;           // null in files older than the flag
+    const uint32_t *nameOffsets;       // objectCount + 1
+    const char *names;
+};
+
+// Writes in the background from a SceneSnapshot taken on the calling thread.
+struct SceneSaver
+{
+    std::thread thread;
+    std::atomic<bool> busy{false};
+    std::string path;
+    bool ok = false;
+    double seconds = 0.0;           // worker time of the last save
+    double snapshotSeconds = 0.0;   // main-thread time of the last save
+
+    std::string autosavePath = "autosave.scnb";
+    double autosaveInterval = 30.0; // seconds, <= 0 disables
+    double lastAutosave = 0.0;
+};
+
+// Flattens a snapshot into contiguous arrays. Safe on any thread.
+void scene_capture(const SceneSnapshot *snap, SceneData *out);
+
+bool scenefile_write(const SceneData *data, const std::string &path);
+
+// Replaces every object in the scene. Returns false (scene untouched) if the
+// file can't be read.
+bool scene_load_file(Scene *scene, const std::string &path);
+
+// Returns false without doing anything if a save is still running.
+bool scenesaver_start(SceneSaver *saver, Scene *scene, const std::string &path);
+
+void scenesaver_wait(SceneSaver *saver);
+
+// Call once per frame; starts a background save to autosavePath every
+// autosaveInterval seconds (skipped while another save is running).
+void scenesaver_autosave(SceneSaver *saver, Scene *scene, double now);
@@ -0,0 +1,171 @@
+#include "scenegen.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
+
+static const char *MODELS[] = {
+    "assets/models/buildings.obj",
+    "assets/models/Planet.obj",
+    "assets/models/funnything.obj",
+};
+static const char *MODEL_NAMES[] = {"buildings", "Planet", "funnything"};
+static const int MODEL_COUNT = 3;
+
+static const char *LAYOUT_NAMES[SCENEGEN_LAYOUT_COUNT] = {"grid", "random", "clustered"};
+
+static const uint32_t CLUSTER_SIZE = 1000;
+
+// Motion is a pure function of index and time, so nothing per object has to
+// be stored besides the height it bobs around.
+static float spin_degrees(size_t i, float t)
+{
+    return std::fmod(i * 137.5f + t * 45.0f, 360.0f);
+}
+
+static float bob_offset(size_t i, float t, float spacing)
+{
+    return 0.25f * spacing * std::sin(t * 2.0f + i * 2.4f);
+}
+
+const char* scenegen_layout_name(SceneGenLayout layout)
+{
+    return layout < SCENEGEN_LAYOUT_COUNT ? LAYOUT_NAMES[layout] : "?";
+}
+
+bool scenegen_parse_layout(const char *name, SceneGenLayout *out)
+{
+    for (int i = 0; i < SCENEGEN_LAYOUT_COUNT; i++) {
+        if (std::strcmp(name, LAYOUT_NAMES[i]) == 0) {
+            *out = (SceneGenLayout)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+float scenegen_extent(const SceneGenParams *params)
+{
+    return 0.5f * params->spacing * std::sqrt((float)params->count);
+}
+
+void scenegen_generate(SceneGen *gen, Scene *scene)
+{
+    const SceneGenParams *p = &gen->params;
+    const uint32_t n = p->count;
+    const float extent = scenegen_extent(p);
+
+    // acquired before clearing so regenerating doesn't reload the models
+    MeshHandle meshes[MODEL_COUNT];
+    float unitScale[MODEL_COUNT];
+    for (int m = 0; m < MODEL_COUNT; m++) {
+        meshes[m] = scene_acquire_mesh(scene, MODELS[m]);
+        Mesh *mesh = gpuresources_mesh(scene->gpu, meshes[m]);
+        // every model is normalised to the same size relative to the spacing
+        unitScale[m] = mesh && mesh->radius > 0.0f ? 0.35f * p->spacing / mesh->radius : 1.0f;
+    }
+    scene_clear_objects(scene);
+
+    std::mt19937 rng(p->seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_real_distribution<float> across(-extent, extent);
+    std::normal_distribution<float> spread(0.0f, p->spacing * 4.0f);
+
+    std::vector<glm::vec3> clusters;
+    if (p->layout == SCENEGEN_CLUSTERED) {
+        clusters.resize(std::max(1u, (n + CLUSTER_SIZE - 1) / CLUSTER_SIZE));
+        for (glm::vec3 &c : clusters) c = glm::vec3(across(rng), 2.0f * p->spacing * unit(rng), across(rng));
+    }
+    const uint32_t side = (uint32_t)std::ceil(std::sqrt((float)n));
+
+    std::vector<uint8_t> model(n);
+    std::vector<glm::vec3> position(n), rotation(n), scale(n), color(n);
+    uint32_t uses[MODEL_COUNT] = {};
+    for (uint32_t i = 0; i < n; i++) {
+        switch (p->layout) {
+        case SCENEGEN_GRID:
+            model[i] = i % MODEL_COUNT;
+            position[i] = glm::vec3(
+                (i % side + 0.5f - side * 0.5f) * p->spacing,
+                0.0f,
+                (i / side + 0.5f - side * 0.5f) * p->spacing);
+            break;
+        case SCENEGEN_RANDOM:
+            model[i] = rng() % MODEL_COUNT;
+            position[i] = glm::vec3(across(rng), 2.0f * p->spacing * unit(rng), across(rng));
+            break;
+        case SCENEGEN_CLUSTERED:
+        default: {
+            model[i] = rng() % MODEL_COUNT;
+            const glm::vec3 &c = clusters[i / CLUSTER_SIZE % clusters.size()];
+            position[i] = c + glm::vec3(spread(rng), 0.25f * spread(rng), spread(rng));
+            break;
+        }
+        }
+        uses[model[i]]++;
+        rotation[i] = glm::vec3(0.0f, spin_degrees(i, 0.0f), 0.0f);
+        color[i] = glm::vec3(0.3f) + 0.7f * glm::vec3(unit(rng), unit(rng), unit(rng));
+    }
+
+    // one reference per object, taken in bulk per mesh
+    for (int m = 0; m < MODEL_COUNT; m++) {
+        if (uses[m] == 0) gpuresources_release(scene->gpu, meshes[m]);
+        else gpuresources_retain(scene->gpu, meshes[m], (int)uses[m] - 1);
+    }
+    gpuresources_retain(scene->gpu, scene->prog, (int)n);
+    for (uint32_t i = 0; i < n; i++) scale[i] = glm::vec3(unitScale[model[i]]);
+
+    SceneObjects *o = &scene->objects;
+    cow_assign(&o->position, position.data(), n);
+    cow_assign(&o->rotation, rotation.data(), n);
+    cow_assign(&o->scale, scale.data(), n);
+    cow_assign(&o->color, color.data(), n);
+    cow_reset(&o->name, n);
+    cow_reset(&o->prog, n);
+    cow_reset(&o->mesh, n);
+    std::vector<uint8_t> isStatic(n, p->markStatic && !p->motion ? 1 : 0);
+    cow_assign(&o->isStatic, isStatic.data(), n);
+    for (uint32_t i = 0; i < n; i++) {
+        cow_mut(&o->name, i) = std::string(MODEL_NAMES[model[i]]) + " " + std::to_string(i);
+        cow_mut(&o->prog, i) = scene->prog;
+        cow_mut(&o->mesh, i) = meshes[model[i]];
+    }
+
+    gen->baseHeight.resize(n);
+    for (uint32_t i = 0; i < n; i++) gen->baseHeight[i] = position[i].y;
+}
+
+void scenegen_frame_camera(const SceneGen *gen, Scene *scene)
+{
+    const float extent = scenegen_extent(&gen->params);
+    const float spacing = gen->params.spacing;
+    OrbitCamera *cam = &scene->orbitCamera;
+    cam->target = glm::vec3(0.0f);
+    cam->distance = 1.5f * extent + 2.0f * spacing;
+    cam->yaw = glm::radians(45.0f);
+    cam->pitch = glm::radians(35.0f);
+    cam->nearClip = std::max(0.1f, cam->distance * 0.001f);
+    cam->farClip = cam->distance + 2.0f * extent + 4.0f * spacing;
+    orbitcamera_invalidate(cam);
+}
+
+void scenegen_update(SceneGen *gen, Scene *scene, float t)
+{
+    if (!gen->params.motion) return;
+    const size_t n = scene_object_count(scene);
+    if (n != gen->baseHeight.size()) return;
+
+    SceneObjects *o = &scene->objects;
+    const float spacing = gen->params.spacing;
+    for (size_t c = 0; c < cow_chunk_count(n); c++) {
+        glm::vec3 *position = cow_chunk_mut(&o->position, c);
+        glm::vec3 *rotation = cow_chunk_mut(&o->rotation, c);
+        const size_t base = c * COW_CHUNK_SIZE;
+        for (size_t k = 0; k < cow_chunk_len(o->position, c); k++) {
+            position[k].y = gen->baseHeight[base + k] + bob_offset(base + k, t, spacing);
+            rotation[k].y = spin_degrees(base + k, t);
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "scene.h"
+
+// Procedural stress scenes: N instances of the bundled models, for measuring
+// how the editor scales with object count.
+
+enum SceneGenLayout
+{
+    SCENEGEN_GRID,        // square grid on the ground plane
+    SCENEGEN_RANDOM,      // uniform in a flat box
+    SCENEGEN_CLUSTERED,   // gaussian blobs of ~1000 objects
+    SCENEGEN_LAYOUT_COUNT
+};
+
+struct SceneGenParams
+{
+    uint32_t count = 1000;
+    SceneGenLayout layout = SCENEGEN_GRID;
+    float spacing = 3.0f;   // average distance between neighbours
+    uint32_t seed = 1;
+    bool motion = false;    // objects bob and spin; see scenegen_update
+    bool markStatic = false;    // generated objects are static, unless they move
+};
+
+struct SceneGen
+{
+    SceneGenParams params;
+    std::vector<float> baseHeight;  // per generated object, for motion
+};
+
+const char* scenegen_layout_name(SceneGenLayout layout);
+
+// Accepts the names returned by scenegen_layout_name.
+bool scenegen_parse_layout(const char *name, SceneGenLayout *out);
+
+// Half the width of the area the layout covers.
+float scenegen_extent(const SceneGenParams *params);
+
+// Replaces every object in the scene with gen->params.count generated ones.
+void scenegen_generate(SceneGen *gen, Scene *scene);
+
+// Points the camera at the whole generated area and pushes the far plane out
+// far enough to see all of it.
+void scenegen_frame_camera(const SceneGen *gen, Scene *scene);
+
+// Animates the generated objects when params.motion is set. Does nothing once
+// objects have been added or removed since scenegen_generate.
+void scenegen_update(SceneGen *gen, Scene *scene, float t);
@@ -0,0 +1,106 @@
+#include "shader.h"
+
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+std::string read_text_file(const std::string& path) {
+    std::ifstream in(path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+GLuint compileShader(GLenum type, const char* src) {
+  GLuint s = glCreateShader(type);
+  glShaderSource(s, 1, &src, nullptr);
+  glCompileShader(s);
+
+  GLint ok = 0;
+  glGetShaderiv(s, GL_COMPILE_STATUS, &ok);
+  if (!ok) {
+    GLint len = 0;
+    glGetShaderiv(s, GL_INFO_LOG_LENGTH, &len);
+    std::string log(len, '\0');
+    glGetShaderInfoLog(s, len, nullptr, log.data());
+    std::cerr << "Shader compile error:\n" << log << "\n";
+    glDeleteShader(s);
+    return 0;
+  }
+  return s;
+}
+
+GLuint linkProgram(GLuint vs, GLuint fs) {
+  if (!vs || !fs) {
+    if (vs) glDeleteShader(vs);
+    if (fs) glDeleteShader(fs);
+    return 0;
+  }
+  GLuint p = glCreateProgram();
+  glAttachShader(p, vs);
+  glAttachShader(p, fs);
+  glLinkProgram(p);
+
+  GLint ok = 0;
+  glGetProgramiv(p, GL_LINK_STATUS, &ok);
+  if (!ok) {
+    GLint len = 0;
+    glGetProgramiv(p, GL_INFO_LOG_LENGTH, &len);
+    std::string log(len, '\0');
+    glGetProgramInfoLog(p, len, nullptr, log.data());
+    std::cerr << "Program link error:\n" << log << "\n";
+  }
+
+  glDetachShader(p, vs);
+  glDetachShader(p, fs);
+  glDeleteShader(vs);
+  glDeleteShader(fs);
+  if (!ok) {
+    glDeleteProgram(p);
+    return 0;
+  }
+  return p;
+}
+
+GLuint createProgram(std::string vsPath, std::string fsPath){
+    std::string vsString = read_text_file(vsPath);
+    const char* vsSrc = vsString.c_str();
+    std::string fsString = read_text_file(fsPath);
+    const char* fsSrc = fsString.c_str();
+    return linkProgram(compileShader(GL_VERTEX_SHADER, vsSrc),
+                              compileShader(GL_FRAGMENT_SHADER, fsSrc));
+}
+
+void bindUniformBlock(GLuint prog, const char* name, GLuint binding){
+    if (!prog) return;
+    GLuint index = glGetUniformBlockIndex(prog, name);
+    if (index != GL_INVALID_INDEX) glUniformBlockBinding(prog, index, binding);
+}
+
+GLuint createComputeProgram(std::string path, const std::string &defines){
+    std::string src = read_text_file(path);
+    size_t eol = src.find('\n');
+    src.insert(eol == std::string::npos ? src.size() : eol + 1, defines);
+    GLuint cs = compileShader(GL_COMPUTE_SHADER, src.c_str());
+    if (!cs) return 0;
+
+    GLuint p = glCreateProgram();
+    glAttachShader(p, cs);
+    glLinkProgram(p);
+    GLint ok = 0;
+    glGetProgramiv(p, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        GLint len = 0;
+        glGetProgramiv(p, GL_INFO_LOG_LENGTH, &len);
+        std::string log(len, '\0');
+        glGetProgramInfoLog(p, len, nullptr, log.data());
+        std::cerr << "Program link error (" << path << "):\n" << log << "\n";
+    }
+    glDetachShader(p, cs);
+    glDeleteShader(cs);
+    if (!ok) {
+        glDeleteProgram(p);
+        return 0;
+    }
+    return p;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <string>
+
+std::string read_text_file(const std::string& path);
+
+// 0 if it doesn't compile; the log goes to stderr.
+GLuint compileShader(GLenum type, const char* src);
+
+// Links and then deletes both shaders. 0 if either is 0 or linking fails.
+GLuint linkProgram(GLuint vs, GLuint fs);
+
+// 0 on any compile or link error, so callers can keep what they had.
+GLuint createProgram(std::string vsPath, std::string fsPath);
+
+// GLSL 330 has no layout(binding = N) for uniform blocks, so this assigns the
+// binding point after linking. Does nothing if the program lacks the block.
+void bindUniformBlock(GLuint prog, const char* name, GLuint binding);
+
+// Compute program from one file. `defines` ("#define X\n" lines, may be
+// empty) go right after the #version line, so several passes can share a
+// source. 0 on any compile or link error.
+GLuint createComputeProgram(std::string path, const std::string &defines);
@@ -0,0 +1,72 @@
+#include "simulation.h"
+
+#include <algorithm>
+#include <cmath>
+
+static glm::vec3 light_at(const Scene *scene, double t)
+{
+    const float a = (float)t;
+    return scene->lightPos + glm::vec3(std::cos(a) * 0.4f, 0.0f, std::sin(a) * 0.4f);
+}
+
+void simulation_evaluate(Scene *scene, SceneGen *gen, double t)
+{
+    scene->animLight = light_at(scene, t);
+    scenegen_update(gen, scene, (float)t);
+}
+
+void simulation_initialize(Simulation *sim, Scene *scene)
+{
+    sim->accumulator = 0.0;
+    sim->ticks = 0;
+    sim->ticksLastFrame = 0;
+    sim->droppedSeconds = 0.0;
+    sim->current.time = 0.0;
+    sim->current.animLight = light_at(scene, 0.0);
+    sim->previous = sim->current;
+    scene->animLight = sim->current.animLight;
+    scene->simAlpha = 0.0f;
+}
+
+static void tick(Simulation *sim, Scene *scene, SceneGen *gen)
+{
+    sim->previous = sim->current;
+    SimState *s = &sim->current;
+    s->time += sim->step;
+    s->animLight = light_at(scene, s->time);
+
+    // moving objects keep the previous tick so rendering can interpolate
+    // them. The copy goes into the previous arrays' own chunks: sharing
+    // them would make the update below clone every chunk, every tick.
+    if (gen->params.motion && scene_object_count(scene) == gen->baseHeight.size()) {
+        cow_copy_values(&scene->prevPosition, scene->objects.position);
+        cow_copy_values(&scene->prevRotation, scene->objects.rotation);
+        scenegen_update(gen, scene, (float)s->time);
+    } else if (scene->prevPosition.size) {
+        cow_clear(&scene->prevPosition);
+        cow_clear(&scene->prevRotation);
+    }
+    sim->ticks++;
+}
+
+void simulation_advance(Simulation *sim, Scene *scene, SceneGen *gen, double frameSeconds)
+{
+    sim->accumulator += std::max(frameSeconds, 0.0);
+    sim->ticksLastFrame = 0;
+    while (sim->accumulator >= sim->step && sim->ticksLastFrame < sim->maxStepsPerFrame) {
+        tick(sim, scene, gen);
+        sim->accumulator -= sim->step;
+        sim->ticksLastFrame++;
+    }
+    // too far behind: drop the backlog rather than spend every later frame
+    // catching up
+    if (sim->accumulator >= sim->step) {
+        double keep = std::fmod(sim->accumulator, sim->step);
+        sim->droppedSeconds += sim->accumulator - keep;
+        sim->accumulator = keep;
+    }
+
+    float alpha = sim->interpolate ? (float)simulation_alpha(sim) : 1.0f;
+    scene->simAlpha = alpha;
+    scene->animLight = glm::mix(sim->previous.animLight, sim->current.animLight, alpha);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+#include "scene.h"
+#include "scenegen.h"
+
+// Fixed-timestep simulation, decoupled from the render rate.
+//
+// Each frame adds its wall time to an accumulator and runs as many ticks of
+// `step` seconds as fit; rendering then interpolates between the last two
+// ticks by the leftover fraction (alpha). The simulation rate is independent
+// of the frame rate: rendering at 144 Hz against a 30 Hz simulation runs no
+// extra ticks, and a slow tick is capped at maxStepsPerFrame instead of
+// piling up more work every frame.
+
+struct SimState
+{
+    double time;            // simulated seconds
+    glm::vec3 animLight;
+};
+
+struct Simulation
+{
+    double step = 1.0 / 60.0;
+    int maxStepsPerFrame = 8;
+    bool interpolate = true;
+
+    double accumulator = 0.0;
+    SimState previous;
+    SimState current;
+    uint64_t ticks = 0;
+    int ticksLastFrame = 0;
+    double droppedSeconds = 0.0;    // wall time skipped by the cap
+};
+
+// Everything that depends on simulated time, evaluated directly at `t`.
+// Also what --play and --bench use, with their own fixed timestep.
+void simulation_evaluate(Scene *scene, SceneGen *gen, double t);
+
+void simulation_initialize(Simulation *sim, Scene *scene);
+
+// Runs the ticks covering `frameSeconds` of wall time, then sets the
+// interpolated render state on the scene (animLight, simAlpha).
+void simulation_advance(Simulation *sim, Scene *scene, SceneGen *gen, double frameSeconds);
+
+inline double simulation_alpha(const Simulation *sim) { return sim->accumulator / sim->step; }
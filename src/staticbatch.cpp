@@ -0,0 +1,320 @@
+#include "staticbatch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+
+#include "meshcache.h"
+
+// Average number of objects per cell on a full build.
+static const uint32_t OBJECTS_PER_CELL = 512;
+
+// Edits touching more static objects than this (or a quarter of them) in
+// one frame start a full build.
+static const uint32_t FULL_BUILD_MIN_CHANGES = 4096;
+
+
+static void copy_columns(StaticBatchColumns *out, const SceneObjects *o)
+{
+    out->prog = o->prog;
+    out->mesh = o->mesh;
+    out->position = o->position;
+    out->rotation = o->rotation;
+    out->scale = o->scale;
+    out->color = o->color;
+    out->isStatic = o->isStatic;
+}
+
+// Program slot in the top 16 bits, then the cell's grid coordinates.
+static uint64_t cell_key(ProgramHandle prog, glm::vec3 p, float cellSize)
+{
+    glm::vec3 c = glm::clamp(glm::floor(p / cellSize), -32768.0f, 32767.0f);
+    return (uint64_t)(handle_index(prog) & 0xffff) << 48 | (uint64_t)(uint16_t)(int)c.x << 32 |
+           (uint64_t)(uint16_t)(int)c.y << 16 | (uint64_t)(uint16_t)(int)c.z;
+}
+
+template <typename T>
+static const T* chunk_or_null(const CowArray<T> &a, size_t c)
+{
+    return c < a.chunks.size() ? a.chunks[c].get()->data() : nullptr;
+}
+
+// Adds the cells of static objects that differ between sb->seen and `o` to
+// sb->dirty. Returns how many static objects changed.
+static uint32_t find_dirty(StaticBatcher *sb, const SceneObjects *o)
+{
+    const StaticBatchColumns &s = sb->seen;
+    const size_t oldN = s.position.size;
+    const size_t newN = o->position.size;
+    uint32_t changed = 0;
+    for (size_t c = 0; c < cow_chunk_count(std::max(oldN, newN)); c++) {
+        if (chunk_or_null(s.position, c) == chunk_or_null(o->position, c)
+            && chunk_or_null(s.rotation, c) == chunk_or_null(o->rotation, c)
+            && chunk_or_null(s.scale, c) == chunk_or_null(o->scale, c)
+            && chunk_or_null(s.color, c) == chunk_or_null(o->color, c)
+            && chunk_or_null(s.mesh, c) == chunk_or_null(o->mesh, c)
+            && chunk_or_null(s.prog, c) == chunk_or_null(o->prog, c)
+            && chunk_or_null(s.isStatic, c) == chunk_or_null(o->isStatic, c)
+            && cow_chunk_len(s.position, c) == cow_chunk_len(o->position, c))
+            continue;
+
+        const size_t end = std::min((c + 1) * COW_CHUNK_SIZE, std::max(oldN, newN));
+        for (size_t i = c * COW_CHUNK_SIZE; i < end; i++) {
+            const bool oldStatic = i < oldN && cow_get(s.isStatic, i);
+            const bool newStatic = i < newN && cow_get(o->isStatic, i);
+            if (!oldStatic && !newStatic) continue;
+            if (oldStatic && newStatic
+                && cow_get(s.position, i) == cow_get(o->position, i)
+                && cow_get(s.rotation, i) == cow_get(o->rotation, i)
+                && cow_get(s.scale, i) == cow_get(o->scale, i)
+                && cow_get(s.color, i) == cow_get(o->color, i)
+                && cow_get(s.mesh, i) == cow_get(o->mesh, i)
+                && cow_get(s.prog, i) == cow_get(o->prog, i))
+                continue;
+            if (oldStatic) sb->dirty.insert(cell_key(cow_get(s.prog, i), cow_get(s.position, i), sb->cellSize));
+            if (newStatic) sb->dirty.insert(cell_key(cow_get(o->prog, i), cow_get(o->position, i), sb->cellSize));
+            changed++;
+        }
+    }
+    return changed;
+}
+
+// Cell edge giving about OBJECTS_PER_CELL static objects per cell, spread
+// over the ground plane like the editor's scenes are.
+static float choose_cell_size(const SceneObjects *o)
+{
+    glm::vec3 lo(INFINITY), hi(-INFINITY);
+    uint32_t count = 0;
+    for (size_t c = 0; c < cow_chunk_count(o->position.size); c++) {
+        const glm::vec3 *position = cow_chunk_data(o->position, c);
+        const uint8_t *isStatic = cow_chunk_data(o->isStatic, c);
+        for (size_t k = 0; k < cow_chunk_len(o->position, c); k++) {
+            if (!isStatic[k]) continue;
+            lo = glm::min(lo, position[k]);
+            hi = glm::max(hi, position[k]);
+            count++;
+        }
+    }
+    if (count == 0) return 1.0f;
+    const float cells = (float)std::max(1u, count / OBJECTS_PER_CELL);
+    const glm::vec3 extent = glm::max(hi - lo, glm::vec3(1.0f));
+    return std::max(1.0f, std::sqrt(extent.x * extent.z / cells));
+}
+
+// --- worker -------------------------------------------------------------------
+
+// Source mesh for a path, loaded and welded on first use. Vertices are only
+// merged when position and normal match exactly, so shading is unchanged.
+static const StaticBatchSource* source_mesh(std::unordered_map<std::string, StaticBatchSource> *sources,
+                                            const StaticBatchJob *job, const std::string &path)
+{
+    auto it = sources->find(path);
+    if (it != sources->end()) return &it->second;
+
+    StaticBatchSource &src = (*sources)[path];
+    std::vector<float> raw = meshcache_read(job->meshCacheDir, job->aoRays, path);
+    std::vector<uint32_t> firsts;
+    meshcache_weld(raw.data(), (int)(raw.size() / MESH_VERTEX_FLOATS), MESH_VERTEX_FLOATS, &src.indices, &firsts);
+    for (uint32_t v : firsts) {
+        const float *p = raw.data() + (size_t)v * MESH_VERTEX_FLOATS;
+        src.vertices.insert(src.vertices.end(), p, p + MESH_VERTEX_FLOATS);
+    }
+    return &src;
+}
+
+static void bake(StaticBatchJob *job, std::unordered_map<std::string, StaticBatchSource> *sources)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    const StaticBatchColumns &col = job->columns;
+
+    // cells asked for stay in the output even if they emptied out
+    std::map<uint64_t, std::vector<uint32_t>> members;
+    for (uint64_t key : job->keys) members[key];
+    for (size_t c = 0; c < cow_chunk_count(col.position.size); c++) {
+        const uint8_t *isStatic = cow_chunk_data(col.isStatic, c);
+        const ProgramHandle *prog = cow_chunk_data(col.prog, c);
+        const glm::vec3 *position = cow_chunk_data(col.position, c);
+        const size_t base = c * COW_CHUNK_SIZE;
+        for (size_t k = 0; k < cow_chunk_len(col.position, c); k++) {
+            if (!isStatic[k]) continue;
+            const uint64_t key = cell_key(prog[k], position[k], job->cellSize);
+            if (job->full) {
+                members[key].push_back((uint32_t)(base + k));
+            } else {
+                auto it = members.find(key);
+                if (it != members.end()) it->second.push_back((uint32_t)(base + k));
+            }
+        }
+    }
+
+    job->cells.clear();
+    for (auto &m : members) {
+        StaticBatchCell cell;
+        cell.key = m.first;
+        cell.objects = 0;
+        glm::vec3 lo(INFINITY), hi(-INFINITY);
+        for (uint32_t i : m.second) {
+            auto name = job->meshNames.find(cow_get(col.mesh, i).value);
+            if (name == job->meshNames.end()) continue;
+            const StaticBatchSource *src = source_mesh(sources, job, name->second);
+            const glm::mat4 model = renderobject_model(cow_get(col.position, i), cow_get(col.rotation, i),
+                                                       cow_get(col.scale, i));
+            const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+            const glm::vec3 color = cow_get(col.color, i);
+
+            const uint32_t base = (uint32_t)(cell.vertices.size() / BATCH_VERTEX_FLOATS);
+            for (size_t v = 0; v < src->vertices.size(); v += MESH_VERTEX_FLOATS) {
+                const float *in = src->vertices.data() + v;
+                glm::vec3 p = glm::vec3(model * glm::vec4(in[0], in[1], in[2], 1.0f));
+                glm::vec3 n = glm::normalize(normalMatrix * glm::vec3(in[3], in[4], in[5]));
+                const float out[BATCH_VERTEX_FLOATS] = {p.x, p.y, p.z, n.x, n.y, n.z, color.x, color.y, color.z,
+                                                        in[MESH_VERTEX_FLOATS - 1]};
+                cell.vertices.insert(cell.vertices.end(), out, out + BATCH_VERTEX_FLOATS);
+                lo = glm::min(lo, p);
+                hi = glm::max(hi, p);
+            }
+            for (uint32_t index : src->indices) cell.indices.push_back(base + index);
+            cell.objects++;
+        }
+        cell.center = cell.indices.empty() ? glm::vec3(0.0f) : 0.5f * (lo + hi);
+        cell.radius = cell.indices.empty() ? 0.0f : 0.5f * glm::length(hi - lo);
+        job->cells.push_back(std::move(cell));
+    }
+    job->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// --- main thread --------------------------------------------------------------
+
+static void publish(StaticBatcher *sb, Scene *scene)
+{
+    scene->staticChunks.clear();
+    sb->stats.chunks = 0;
+    sb->stats.objects = 0;
+    sb->stats.bytes = 0;
+    for (const auto &c : sb->chunks) {
+        scene->staticChunks.push_back(c.second);
+        sb->stats.chunks++;
+        sb->stats.objects += c.second.objects;
+        if (const Mesh *m = gpuresources_mesh(scene->gpu, c.second.mesh)) sb->stats.bytes += m->bytes;
+    }
+}
+
+static void clear_chunks(StaticBatcher *sb, Scene *scene)
+{
+    for (const auto &c : sb->chunks) gpuresources_release(scene->gpu, c.second.mesh);
+    sb->chunks.clear();
+    publish(sb, scene);
+    scene->view.visibleChunks.clear();
+}
+
+// Swaps the baked cells in; the old meshes go through deferred deletion,
+// so frames still in flight keep drawing them.
+static void apply(StaticBatcher *sb, Scene *scene)
+{
+    StaticBatchJob &job = sb->job;
+    if (job.full) clear_chunks(sb, scene);
+    for (const StaticBatchCell &cell : job.cells) {
+        auto it = sb->chunks.find(cell.key);
+        if (it != sb->chunks.end()) {
+            gpuresources_release(scene->gpu, it->second.mesh);
+            sb->chunks.erase(it);
+        }
+        if (cell.indices.empty()) continue;
+        MeshHandle mesh = gpuresources_create_indexed_mesh(
+            scene->gpu, cell.vertices.data(), (int)(cell.vertices.size() / BATCH_VERTEX_FLOATS),
+            cell.indices.data(), (int)cell.indices.size());
+        sb->chunks[cell.key] = {mesh, cell.center, cell.radius, cell.objects};
+    }
+    if (job.full) scene->staticBatched = true;
+    publish(sb, scene);
+}
+
+static void start(StaticBatcher *sb, Scene *scene, bool full)
+{
+    StaticBatchJob &job = sb->job;
+    copy_columns(&job.columns, &scene->objects);
+
+    // the pools aren't thread-safe, so resolve paths here
+    job.meshNames.clear();
+    const ResourcePool<Mesh, MeshTag> &meshes = scene->gpu->meshes;
+    for (uint32_t i = 0; i < meshes.items.size(); i++) {
+        if (!meshes.items[i].name.empty()) job.meshNames[pool_handle_at(&meshes, i).value] = meshes.items[i].name;
+    }
+    job.meshCacheDir = scene->meshCache.dir;
+    job.aoRays = scene->meshCache.aoRays;
+    job.keys.assign(sb->dirty.begin(), sb->dirty.end());
+    sb->dirty.clear();
+    job.full = full;
+    job.cellSize = sb->cellSize;
+
+    sb->busy = true;
+    sb->thread = std::thread([sb]() {
+        bake(&sb->job, &sb->sources);
+        sb->busy = false;
+    });
+}
+
+void staticbatch_update(StaticBatcher *sb, Scene *scene)
+{
+    if (!sb->busy.load() && sb->thread.joinable()) {
+        sb->thread.join();
+        if (scene->staticBatching) apply(sb, scene);
+        sb->job.columns = StaticBatchColumns();     // stop sharing chunks
+        sb->job.cells.clear();
+        sb->stats.builds++;
+        sb->stats.buildMs = sb->job.seconds * 1000.0;
+    }
+    sb->stats.building = sb->busy.load();
+
+    if (!scene->staticBatching) {
+        if (!sb->chunks.empty()) clear_chunks(sb, scene);
+        sb->active = false;
+        sb->seen = StaticBatchColumns();
+        sb->dirty.clear();
+        scene->staticBatched = false;
+        return;
+    }
+
+    if (sb->active) {
+        const uint32_t changed = find_dirty(sb, &scene->objects);
+        if (changed > std::max(FULL_BUILD_MIN_CHANGES, sb->stats.objects / 4)) {
+            // e.g. a new scene: rebake everything with a fresh cell size
+            sb->active = false;
+            sb->dirty.clear();
+            scene->staticBatched = false;
+        }
+    }
+    copy_columns(&sb->seen, &scene->objects);
+    if (sb->busy.load()) return;
+
+    if (!sb->active) {
+        sb->cellSize = choose_cell_size(&scene->objects);
+        sb->active = true;
+        scene->staticBatched = false;
+        start(sb, scene, true);
+        sb->stats.building = true;
+    } else if (!sb->dirty.empty()) {
+        start(sb, scene, false);
+        sb->stats.building = true;
+    }
+}
+
+void staticbatch_finish(StaticBatcher *sb, Scene *scene)
+{
+    staticbatch_update(sb, scene);
+    while (sb->thread.joinable()) {
+        while (sb->busy.load()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        staticbatch_update(sb, scene);
+    }
+}
+
+void staticbatch_shutdown(StaticBatcher *sb, Scene *scene)
+{
+    if (sb->thread.joinable()) sb->thread.join();
+    clear_chunks(sb, scene);
+    sb->active = false;
+    sb->seen = StaticBatchColumns();
+    sb->job = StaticBatchJob();
+    scene->staticBatched = false;
+}
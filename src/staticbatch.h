@@ -0,0 +1,115 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "scene.h"
+
+// Static geometry batching: objects flagged static are grouped by program
+// and by cell of a uniform grid, and every group is baked into one indexed
+// mesh whose vertices are already in world space and carry the object's
+// color. A few hundred objects then cost one draw, and whole cells are
+// frustum culled by their bounds.
+//
+// Source meshes are welded into indexed form once per path. Baking runs on
+// a worker thread from a copy of the columns (chunk pointers only, see
+// cowarray.h); the main thread just creates the finished buffers. The
+// batcher keeps its own copy of the columns too, so every frame a changed
+// chunk shows up as a pointer mismatch and only its objects are compared
+// to find which cells to re-bake. Until a re-bake lands, the cell draws
+// its old contents.
+//
+// The cell size is picked on a full build from the extent of the static
+// objects. Edits that touch a large part of them (loading, regenerating)
+// start a full build instead, and the objects are drawn one by one until
+// it is done.
+
+// Columns the batches depend on, compared by chunk pointer.
+struct StaticBatchColumns
+{
+    CowArray<ProgramHandle> prog;
+    CowArray<MeshHandle> mesh;
+    CowArray<glm::vec3> position;
+    CowArray<glm::vec3> rotation;
+    CowArray<glm::vec3> scale;
+    CowArray<glm::vec3> color;
+    CowArray<uint8_t> isStatic;
+};
+
+// Welded copy of a source mesh: position + normal, 6 floats per vertex.
+struct StaticBatchSource
+{
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+};
+
+struct StaticBatchCell
+{
+    uint64_t key;
+    uint32_t objects;
+    std::vector<float> vertices;    // batch layout, see gpuresources.h
+    std::vector<uint32_t> indices;
+    glm::vec3 center;
+    float radius;
+};
+
+// One worker run: the input is filled on the main thread, the output by
+// the worker.
+struct StaticBatchJob
+{
+    StaticBatchColumns columns;
+    std::unordered_map<uint32_t, std::string> meshNames;   // MeshHandle value -> path
+    std::string meshCacheDir;       // baked occlusion comes from here, see meshcache.h
+    int aoRays = 0;
+    std::vector<uint64_t> keys;     // cells to bake; all of them if full
+    bool full = false;
+    float cellSize = 1.0f;
+
+    std::vector<StaticBatchCell> cells;
+    double seconds = 0.0;
+};
+
+struct StaticBatchStats
+{
+    int chunks;
+    uint32_t objects;       // baked into the chunks
+    size_t bytes;
+    int builds;
+    double buildMs;         // worker time of the last build
+    bool building;
+};
+
+struct StaticBatcher
+{
+    std::thread thread;
+    std::atomic<bool> busy{false};
+    StaticBatchJob job;
+    std::unordered_map<std::string, StaticBatchSource> sources;    // worker only
+
+    bool active = false;        // chunks describe the scene, modulo dirty cells
+    float cellSize = 1.0f;
+    StaticBatchColumns seen;    // as of the last update
+    std::unordered_set<uint64_t> dirty;
+    std::unordered_map<uint64_t, StaticChunk> chunks;   // by cell key
+
+    StaticBatchStats stats = {};
+};
+
+// Call once per frame on the main thread. Follows scene->staticBatching:
+// picks up finished work, finds the cells edits touched and starts a bake
+// when the worker is idle. Keeps scene->staticChunks and staticBatched up
+// to date.
+void staticbatch_update(StaticBatcher *sb, Scene *scene);
+
+// Blocks until the chunks cover the scene as it is, e.g. before measuring.
+void staticbatch_finish(StaticBatcher *sb, Scene *scene);
+
+// Waits for the worker and releases every chunk mesh.
+void staticbatch_shutdown(StaticBatcher *sb, Scene *scene);
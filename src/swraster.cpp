@@ -0,0 +1,378 @@
+#include "swraster.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SWRASTER_SSE2 1
+#endif
+
+#include "scene.h"
+
+static const int SW_TASKS_PER_THREAD = 4;  // geometry tasks, for balance across uneven objects
+static const float SW_GUARD_BAND = 8.0f;    // clip x and y at this many viewport half-widths
+static const int SW_MAX_CLIPPED = 3 + 5;    // a triangle clipped by the near and four guard planes
+
+struct ClipVertex
+{
+    glm::vec4 clip;
+    glm::vec3 world;
+    glm::vec3 normal;
+    float ao;
+};
+
+// Inside where dot(plane, clip) >= 0: near, then the guard band.
+static const glm::vec4 CLIP_PLANES[5] = {
+    glm::vec4(0.0f, 0.0f, 1.0f, 1.0f),
+    glm::vec4(1.0f, 0.0f, 0.0f, SW_GUARD_BAND),
+    glm::vec4(-1.0f, 0.0f, 0.0f, SW_GUARD_BAND),
+    glm::vec4(0.0f, 1.0f, 0.0f, SW_GUARD_BAND),
+    glm::vec4(0.0f, -1.0f, 0.0f, SW_GUARD_BAND),
+};
+
+static double elapsed_ms(std::chrono::steady_clock::time_point since)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+static ClipVertex lerp_vertex(const ClipVertex &a, const ClipVertex &b, float t)
+{
+    return {a.clip + (b.clip - a.clip) * t, a.world + (b.world - a.world) * t,
+            a.normal + (b.normal - a.normal) * t, a.ao + (b.ao - a.ao) * t};
+}
+
+// Outside bits: 0..4 the clip planes, 5..9 the view volume's sides and far.
+static unsigned outcode(const glm::vec4 &c)
+{
+    unsigned code = 0;
+    for (int p = 0; p < 5; p++) {
+        if (glm::dot(CLIP_PLANES[p], c) < 0.0f) code |= 1u << p;
+    }
+    if (c.x > c.w) code |= 1u << 5;
+    if (c.x < -c.w) code |= 1u << 6;
+    if (c.y > c.w) code |= 1u << 7;
+    if (c.y < -c.w) code |= 1u << 8;
+    if (c.z > c.w) code |= 1u << 9;
+    return code;
+}
+
+static void setup_triangle(SoftwareRasterizer *sr, SwBinTask *bt, const ClipVertex *v0, const ClipVertex *v1,
+                           const ClipVertex *v2, glm::vec3 color)
+{
+    const ClipVertex *v[3] = {v0, v1, v2};
+    SwTriangle t;
+    double x[3], y[3];
+    float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+    for (int i = 0; i < 3; i++) {
+        const float invW = 1.0f / v[i]->clip.w;
+        x[i] = (v[i]->clip.x * invW * 0.5 + 0.5) * sr->w;
+        y[i] = (v[i]->clip.y * invW * 0.5 + 0.5) * sr->h;
+        minX = std::min(minX, (float)x[i]);
+        maxX = std::max(maxX, (float)x[i]);
+        minY = std::min(minY, (float)y[i]);
+        maxY = std::max(maxY, (float)y[i]);
+        t.z[i] = v[i]->clip.z * invW * 0.5f + 0.5f;
+        t.invW[i] = invW;
+        t.world[i] = v[i]->world * invW;
+        t.normal[i] = v[i]->normal * invW;
+        t.ao[i] = v[i]->ao * invW;
+    }
+    // pixel centers are at +0.5; the edge functions reject the bounds' spare pixels
+    t.x0 = std::max(0, (int)std::floor(minX));
+    t.y0 = std::max(0, (int)std::floor(minY));
+    t.x1 = std::min(sr->w - 1, (int)std::ceil(maxX));
+    t.y1 = std::min(sr->h - 1, (int)std::ceil(maxY));
+    if (t.x0 > t.x1 || t.y0 > t.y1) return;
+
+    // edge i faces vertex i; dividing by the doubled area makes both windings
+    // positive inside, as nothing is back-face culled
+    double a[3], b[3], c[3];
+    for (int i = 0; i < 3; i++) {
+        const int j = (i + 1) % 3, k = (i + 2) % 3;
+        a[i] = y[j] - y[k];
+        b[i] = x[k] - x[j];
+        c[i] = -a[i] * x[j] - b[i] * y[j];
+    }
+    const double area = a[0] * x[0] + b[0] * y[0] + c[0];
+    if (std::fabs(area) < 1e-12) return;
+    for (int i = 0; i < 3; i++) {
+        t.a[i] = (float)(a[i] / area);
+        t.b[i] = (float)(b[i] / area);
+        t.c[i] = c[i] / area;
+        t.inclusive[i] = t.a[i] > 0.0f || (t.a[i] == 0.0f && t.b[i] < 0.0f);
+    }
+    t.color = color;
+
+    const uint32_t index = (uint32_t)bt->triangles.size();
+    bt->triangles.push_back(t);
+    for (int ty = t.y0 / SWRASTER_TILE; ty <= t.y1 / SWRASTER_TILE; ty++) {
+        for (int tx = t.x0 / SWRASTER_TILE; tx <= t.x1 / SWRASTER_TILE; tx++)
+            bt->bins[ty * sr->tilesX + tx].push_back(index);
+    }
+}
+
+// Sutherland-Hodgman against the planes the triangle crosses, then a fan.
+static void clip_triangle(SoftwareRasterizer *sr, SwBinTask *bt, const ClipVertex *tri, unsigned crossed,
+                          glm::vec3 color)
+{
+    ClipVertex bufA[SW_MAX_CLIPPED], bufB[SW_MAX_CLIPPED];
+    ClipVertex *in = bufA, *out = bufB;
+    int count = 3;
+    std::copy(tri, tri + 3, in);
+    for (int p = 0; p < 5 && count >= 3; p++) {
+        if (!(crossed & (1u << p))) continue;
+        int n = 0;
+        for (int i = 0; i < count; i++) {
+            const ClipVertex &a = in[i], &b = in[(i + 1) % count];
+            const float da = glm::dot(CLIP_PLANES[p], a.clip), db = glm::dot(CLIP_PLANES[p], b.clip);
+            if (da >= 0.0f) out[n++] = a;
+            if ((da >= 0.0f) != (db >= 0.0f)) out[n++] = lerp_vertex(a, b, da / (da - db));
+        }
+        std::swap(in, out);
+        count = n;
+    }
+    for (int i = 1; i + 1 < count; i++) setup_triangle(sr, bt, &in[0], &in[i], &in[i + 1], color);
+}
+
+static void bin_task(void *context, int task)
+{
+    SoftwareRasterizer *sr = (SoftwareRasterizer*)context;
+    SwBinTask *bt = &sr->tasks[task];
+    bt->triangles.clear();
+    for (std::vector<uint32_t> &bin : bt->bins) bin.clear();
+
+    const Scene *scene = sr->scene;
+    const size_t n = sr->visible.size(), tasks = sr->tasks.size();
+    for (size_t v = n * task / tasks; v < n * (task + 1) / tasks; v++) {
+        const uint32_t index = sr->visible[v];
+        const SwMesh &mesh = sr->meshes.find(cow_get(scene->objects.mesh, index).value)->second;
+        const glm::mat4 model = scene_render_model(scene, index);
+        const glm::mat4 mvp = sr->viewProj * model;
+        const glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(model)));
+        const glm::vec3 color = cow_get(scene->objects.color, index);
+
+        const size_t vertexCount = mesh.vertices.size() / MESH_VERTEX_FLOATS;
+        for (size_t first = 0; first + 3 <= vertexCount; first += 3) {
+            ClipVertex tri[3];
+            unsigned all = ~0u, any = 0;
+            for (int k = 0; k < 3; k++) {
+                const float *src = &mesh.vertices[(first + k) * MESH_VERTEX_FLOATS];
+                const glm::vec4 p(src[0], src[1], src[2], 1.0f);
+                tri[k].clip = mvp * p;
+                const unsigned code = outcode(tri[k].clip);
+                all &= code;
+                any |= code;
+            }
+            if (all) continue;      // wholly outside one plane
+            for (int k = 0; k < 3; k++) {
+                const float *src = &mesh.vertices[(first + k) * MESH_VERTEX_FLOATS];
+                tri[k].world = glm::vec3(model * glm::vec4(src[0], src[1], src[2], 1.0f));
+                tri[k].normal = normalMatrix * glm::vec3(src[3], src[4], src[5]);
+                tri[k].ao = src[MESH_VERTEX_FLOATS - 1];
+            }
+            if (any & 0x1fu) clip_triangle(sr, bt, tri, any & 0x1fu, color);
+            else setup_triangle(sr, bt, &tri[0], &tri[1], &tri[2], color);
+        }
+    }
+}
+
+static uint32_t to_unorm8(float c)
+{
+    return (uint32_t)(std::min(std::max(c, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+// lit_shader.fs with a white light.
+static uint32_t shade(const SoftwareRasterizer *sr, const SwTriangle &t, float b0, float b1, float b2)
+{
+    const float w = 1.0f / (b0 * t.invW[0] + b1 * t.invW[1] + b2 * t.invW[2]);
+    const glm::vec3 world = (t.world[0] * b0 + t.world[1] * b1 + t.world[2] * b2) * w;
+    const glm::vec3 N = glm::normalize(t.normal[0] * b0 + t.normal[1] * b1 + t.normal[2] * b2);
+    const float ao = (t.ao[0] * b0 + t.ao[1] * b1 + t.ao[2] * b2) * w;
+    const glm::vec3 L = glm::normalize(sr->light - world);
+    const float diff = std::max(glm::dot(N, L), 0.0f);
+    const glm::vec3 V = glm::normalize(sr->eye - world);
+    const glm::vec3 H = glm::normalize(L + V);
+    const float spec = std::pow(std::max(glm::dot(N, H), 0.0f), 64.0f);
+    const glm::vec3 color = t.color * (0.15f * ao + diff + 0.6f * spec);
+    return to_unorm8(color.x) | to_unorm8(color.y) << 8 | to_unorm8(color.z) << 16 | 0xff000000u;
+}
+
+// Covered pixels of a row of four starting at edge values e and depth z,
+// that also pass the depth test against d. Fills each lane's barycentrics
+// and depth.
+static int quad_mask(const SwTriangle &t, const float *e, float z, float dz, const float *d,
+                     float bary[3][4], float depth[4])
+{
+#ifdef SWRASTER_SSE2
+    const __m128 lane = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    const __m128 zero = _mm_setzero_ps();
+    __m128 cover = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (int i = 0; i < 3; i++) {
+        const __m128 ev = _mm_add_ps(_mm_set1_ps(e[i]), _mm_mul_ps(_mm_set1_ps(t.a[i]), lane));
+        cover = _mm_and_ps(cover, t.inclusive[i] ? _mm_cmpge_ps(ev, zero) : _mm_cmpgt_ps(ev, zero));
+        _mm_storeu_ps(bary[i], ev);
+    }
+    const __m128 zv = _mm_add_ps(_mm_set1_ps(z), _mm_mul_ps(_mm_set1_ps(dz), lane));
+    _mm_storeu_ps(depth, zv);
+    return _mm_movemask_ps(_mm_and_ps(cover, _mm_cmplt_ps(zv, _mm_load_ps(d))));
+#else
+    int mask = 0;
+    for (int l = 0; l < 4; l++) {
+        bool covered = true;
+        for (int i = 0; i < 3; i++) {
+            bary[i][l] = e[i] + t.a[i] * l;
+            covered = covered && (t.inclusive[i] ? bary[i][l] >= 0.0f : bary[i][l] > 0.0f);
+        }
+        depth[l] = z + dz * l;
+        if (covered && depth[l] < d[l]) mask |= 1 << l;
+    }
+    return mask;
+#endif
+}
+
+static uint64_t raster_triangle(SoftwareRasterizer *sr, const SwTriangle &t, float *tileDepth, int px0, int py0,
+                                int px1, int py1)
+{
+    // four-pixel steps from a multiple of four, so depth loads stay aligned
+    const int xs = std::max(t.x0, px0) & ~3, xe = std::min(t.x1, px1);
+    const int ys = std::max(t.y0, py0), ye = std::min(t.y1, py1);
+    const float dz = t.a[0] * t.z[0] + t.a[1] * t.z[1] + t.a[2] * t.z[2];
+    uint64_t shaded = 0;
+    for (int y = ys; y <= ye; y++) {
+        float rowE[3];
+        for (int i = 0; i < 3; i++) rowE[i] = (float)(t.a[i] * (xs + 0.5) + t.b[i] * (y + 0.5) + t.c[i]);
+        const float rowZ = rowE[0] * t.z[0] + rowE[1] * t.z[1] + rowE[2] * t.z[2];
+        float *depthRow = tileDepth + (y - py0) * SWRASTER_TILE - px0;
+        uint32_t *colorRow = &sr->color[(size_t)y * sr->w];
+        for (int x = xs; x <= xe; x += 4) {
+            const float step = (float)(x - xs);
+            const float e[3] = {rowE[0] + t.a[0] * step, rowE[1] + t.a[1] * step, rowE[2] + t.a[2] * step};
+            float bary[3][4], depth[4];
+            int mask = quad_mask(t, e, rowZ + dz * step, dz, depthRow + x, bary, depth);
+            if (xe - x < 3) mask &= (1 << (xe - x + 1)) - 1;
+            for (int l = 0; l < 4; l++) {
+                if (!(mask & (1 << l))) continue;
+                depthRow[x + l] = depth[l];
+                colorRow[x + l] = shade(sr, t, bary[0][l], bary[1][l], bary[2][l]);
+                shaded++;
+            }
+        }
+    }
+    return shaded;
+}
+
+static void raster_tile(void *context, int tile)
+{
+    SoftwareRasterizer *sr = (SoftwareRasterizer*)context;
+    const int px0 = tile % sr->tilesX * SWRASTER_TILE, py0 = tile / sr->tilesX * SWRASTER_TILE;
+    const int px1 = std::min(px0 + SWRASTER_TILE, sr->w) - 1, py1 = std::min(py0 + SWRASTER_TILE, sr->h) - 1;
+    alignas(16) float depth[SWRASTER_TILE * SWRASTER_TILE];
+    std::fill(depth, depth + SWRASTER_TILE * SWRASTER_TILE, 1.0f);
+    for (int y = py0; y <= py1; y++) {
+        uint32_t *row = &sr->color[(size_t)y * sr->w];
+        std::fill(row + px0, row + px1 + 1, 0u);
+    }
+
+    uint64_t shaded = 0;
+    for (const SwBinTask &bt : sr->tasks) {
+        for (uint32_t index : bt.bins[tile])
+            shaded += raster_triangle(sr, bt.triangles[index], depth, px0, py0, px1, py1);
+    }
+    sr->tilePixels[tile] = shaded;
+}
+
+static void run(SoftwareRasterizer *sr, int tasks, JobFn fn)
+{
+    if (sr->jobs) jobs_run(sr->jobs, tasks, fn, sr);
+    else for (int t = 0; t < tasks; t++) fn(sr, t);
+}
+
+// Main thread: reads new meshes through the cache, never bakes.
+static const SwMesh* acquire_mesh(SoftwareRasterizer *sr, const Scene *scene, MeshHandle handle)
+{
+    const Mesh *m = gpuresources_mesh(scene->gpu, handle);
+    if (!m) return nullptr;
+    auto found = sr->meshes.find(handle.value);
+    if (found != sr->meshes.end() && found->second.name == m->name) return &found->second;
+    SwMesh &mesh = sr->meshes[handle.value];
+    mesh.name = m->name;
+    mesh.vertices = meshcache_read(scene->meshCache.dir, scene->meshCache.aoRays, m->name);
+    mesh.radius = m->radius;
+    return &mesh;
+}
+
+void swraster_initialize(SoftwareRasterizer *sr, JobPool *jobs)
+{
+    sr->jobs = jobs;
+}
+
+void swraster_draw(SoftwareRasterizer *sr, const Scene *scene, const OrbitCamera *camera, int w, int h)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    if (w != sr->w || h != sr->h) {
+        sr->w = w;
+        sr->h = h;
+        sr->tilesX = (w + SWRASTER_TILE - 1) / SWRASTER_TILE;
+        sr->tilesY = (h + SWRASTER_TILE - 1) / SWRASTER_TILE;
+        sr->color.assign((size_t)w * h, 0u);
+        sr->tilePixels.assign((size_t)sr->tilesX * sr->tilesY, 0);
+    }
+    const int tiles = sr->tilesX * sr->tilesY;
+    const int taskCount = sr->jobs ? SW_TASKS_PER_THREAD * jobs_thread_count(sr->jobs) : 1;
+    sr->tasks.resize(taskCount);
+    for (SwBinTask &bt : sr->tasks) bt.bins.resize(tiles);
+    sr->scene = scene;
+    sr->viewProj = camera->viewProj;
+    sr->eye = camera->position;
+    sr->light = scene->animLight;
+
+    // like scene_cull, on the source transforms
+    const SceneObjects *o = &scene->objects;
+    sr->visible.clear();
+    MeshHandle lastMesh = {};
+    const SwMesh *mesh = nullptr;
+    for (size_t c = 0; c < cow_chunk_count(scene_object_count(scene)); c++) {
+        const MeshHandle *meshes = cow_chunk_data(o->mesh, c);
+        const glm::vec3 *position = cow_chunk_data(o->position, c);
+        const glm::vec3 *scale = cow_chunk_data(o->scale, c);
+        const size_t base = c * COW_CHUNK_SIZE;
+        for (size_t k = 0; k < cow_chunk_len(o->position, c); k++) {
+            if (meshes[k].value != lastMesh.value || !mesh) {
+                mesh = acquire_mesh(sr, scene, meshes[k]);
+                lastMesh = meshes[k];
+            }
+            if (!mesh) continue;
+            const glm::vec3 s = glm::abs(scale[k]);
+            const float radius = mesh->radius * std::max(s.x, std::max(s.y, s.z));
+            if (frustum_sphere_visible(&camera->frustum, position[k], radius))
+                sr->visible.push_back((uint32_t)(base + k));
+        }
+    }
+    run(sr, taskCount, bin_task);
+    sr->stats.setupMs = elapsed_ms(t0);
+
+    auto t1 = std::chrono::steady_clock::now();
+    run(sr, tiles, raster_tile);
+    sr->stats.rasterMs = elapsed_ms(t1);
+
+    sr->stats.objects = (int)sr->visible.size();
+    sr->stats.triangles = 0;
+    sr->stats.binned = 0;
+    sr->stats.pixels = 0;
+    for (const SwBinTask &bt : sr->tasks) {
+        sr->stats.triangles += (int)bt.triangles.size();
+        for (const std::vector<uint32_t> &bin : bt.bins) sr->stats.binned += bin.size();
+    }
+    for (uint64_t p : sr->tilePixels) sr->stats.pixels += p;
+}
+
+void swraster_shutdown(SoftwareRasterizer *sr)
+{
+    sr->meshes.clear();
+    sr->color.clear();
+    sr->tasks.clear();
+    sr->visible.clear();
+    sr->w = sr->h = 0;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "jobs.h"
+
+struct Scene;
+struct OrbitCamera;
+
+// Draws a scene on the CPU with lit_shader.fs's lighting, for machines with
+// no GPU to speak of. Every object is drawn as its full mesh: static chunks
+// and impostors are GPU-side only.
+//
+// Objects are frustum culled on the calling thread. Their triangles are
+// transformed, clipped and binned into SWRASTER_TILE square tiles on the job
+// pool, then the tiles are shaded on it, each against its own depth buffer.
+// Edge functions and the depth test run four pixels at a time (SSE2 where
+// available).
+
+constexpr int SWRASTER_TILE = 64;
+
+// A clipped triangle, set up for rasterizing.
+struct SwTriangle
+{
+    float a[3], b[3];       // edge functions in pixels, scaled to barycentrics
+    double c[3];
+    uint8_t inclusive[3];   // top-left edges own the pixels exactly on them
+    int x0, y0, x1, y1;     // pixel bounds, inside the image
+    float z[3];             // window depth, linear in screen space
+    float invW[3];
+    glm::vec3 world[3];     // these three times invW, for perspective correction
+    glm::vec3 normal[3];
+    float ao[3];
+    glm::vec3 color;
+};
+
+// Triangles set up by one geometry task, and which tiles they touch.
+struct SwBinTask
+{
+    std::vector<SwTriangle> triangles;
+    std::vector<std::vector<uint32_t>> bins;    // per tile, in submission order
+};
+
+struct SwMesh
+{
+    std::string name;
+    std::vector<float> vertices;    // mesh layout (gpuresources.h)
+    float radius;
+};
+
+struct SwRasterStats
+{
+    int objects;            // drawn after culling
+    int triangles;          // after clipping
+    uint64_t binned;        // triangle-tile pairs
+    uint64_t pixels;        // shaded, so including overdraw
+    double setupMs;         // cull, transform and binning
+    double rasterMs;
+};
+
+struct SoftwareRasterizer
+{
+    bool enabled = false;
+    JobPool *jobs = nullptr;
+
+    std::unordered_map<uint32_t, SwMesh> meshes;    // MeshHandle value -> vertices
+    std::vector<uint32_t> color;    // RGBA8 like GL: bottom row first
+    int w = 0, h = 0;
+    int tilesX = 0, tilesY = 0;
+
+    // this draw, for the jobs
+    const Scene *scene = nullptr;
+    glm::mat4 viewProj;
+    glm::vec3 eye, light;
+    std::vector<uint32_t> visible;
+    std::vector<SwBinTask> tasks;
+    std::vector<uint64_t> tilePixels;
+
+    SwRasterStats stats = {};
+};
+
+void swraster_initialize(SoftwareRasterizer *sr, JobPool *jobs);
+
+// Draws `camera`'s view of the scene into sr->color at w x h, cleared to
+// transparent black. Main thread, not from inside a job run.
+void swraster_draw(SoftwareRasterizer *sr, const Scene *scene, const OrbitCamera *camera, int w, int h);
+
+void swraster_shutdown(SoftwareRasterizer *sr);
@@ -0,0 +1,149 @@
+#include "undo.h"
+
+#include <cstring>
+
+static CowArray<glm::vec3>* property_column(SceneObjects *objects, UndoProperty property)
+{
+    switch (property) {
+    case UNDO_POSITION: return &objects->position;
+    case UNDO_ROTATION: return &objects->rotation;
+    case UNDO_SCALE:    return &objects->scale;
+    case UNDO_COLOR:    return &objects->color;
+    }
+    return &objects->position;
+}
+
+static size_t record_bytes(uint32_t count)
+{
+    return (size_t)count * (sizeof(uint32_t) + 2 * sizeof(glm::vec3));
+}
+
+static bool overlaps(const UndoRecord &r, size_t begin, size_t end)
+{
+    return r.offset < end && begin < r.offset + r.bytes;
+}
+
+// Writes the values of one side (before or after) of a record back into the scene.
+static void apply(UndoJournal *journal, Scene *scene, const UndoRecord &r, bool useAfter)
+{
+    const unsigned char *base = journal->ring.data() + r.offset;
+    const uint32_t *indices = (const uint32_t*)base;
+    const glm::vec3 *values = (const glm::vec3*)(base + r.count * sizeof(uint32_t));
+    if (useAfter) values += r.count;
+
+    CowArray<glm::vec3> *column = property_column(&scene->objects, r.property);
+    const size_t n = column->size;
+    for (uint32_t i = 0; i < r.count; i++) {
+        if (indices[i] < n) cow_mut(column, indices[i]) = values[i];
+    }
+}
+
+void undo_initialize(UndoJournal *journal, size_t budgetBytes)
+{
+    journal->ring.assign(budgetBytes, 0);
+    journal->ring.shrink_to_fit();
+    undo_clear(journal);
+}
+
+void undo_clear(UndoJournal *journal)
+{
+    journal->records.clear();
+    journal->cursor = 0;
+    journal->editOpen = false;
+}
+
+size_t undo_used_bytes(const UndoJournal *journal)
+{
+    size_t used = 0;
+    for (const UndoRecord &r : journal->records) used += r.bytes;
+    return used;
+}
+
+bool undo_push(
+    UndoJournal *journal,
+    UndoProperty property,
+    const uint32_t *indices,
+    const glm::vec3 *before,
+    const glm::vec3 *after,
+    uint32_t count)
+{
+    if (count == 0) return true;
+
+    // a new edit forks history
+    journal->records.resize(journal->cursor);
+
+    const size_t bytes = record_bytes(count);
+    const size_t capacity = journal->ring.size();
+    if (bytes > capacity) {
+        undo_clear(journal);
+        return false;
+    }
+
+    // Records sit back to back in ring order, so the oldest is always the
+    // next one after the newest. If the new record doesn't fit before the
+    // end of the ring, everything between the head and the end is evicted
+    // and we wrap to 0.
+    size_t head = 0;
+    if (!journal->records.empty()) {
+        const UndoRecord &last = journal->records.back();
+        head = last.offset + last.bytes;
+    }
+    if (head + bytes > capacity) {
+        while (!journal->records.empty() && journal->records.front().offset >= head)
+            journal->records.pop_front();
+        head = 0;
+    }
+    while (!journal->records.empty() && overlaps(journal->records.front(), head, head + bytes))
+        journal->records.pop_front();
+
+    unsigned char *dst = journal->ring.data() + head;
+    std::memcpy(dst, indices, count * sizeof(uint32_t));
+    dst += count * sizeof(uint32_t);
+    std::memcpy(dst, before, count * sizeof(glm::vec3));
+    dst += count * sizeof(glm::vec3);
+    std::memcpy(dst, after, count * sizeof(glm::vec3));
+
+    journal->records.push_back({head, bytes, property, count});
+    journal->cursor = journal->records.size();
+    return true;
+}
+
+void undo_begin_edit(UndoJournal *journal, Scene *scene, UndoProperty property, uint32_t index, glm::vec3 before)
+{
+    if (journal->editOpen) {
+        if (journal->editProperty == property && journal->editIndex == index) return;
+        undo_end_edit(journal, scene);
+    }
+    journal->editOpen = true;
+    journal->editProperty = property;
+    journal->editIndex = index;
+    journal->editBefore = before;
+}
+
+void undo_end_edit(UndoJournal *journal, Scene *scene)
+{
+    if (!journal->editOpen) return;
+    journal->editOpen = false;
+    if (journal->editIndex >= scene_object_count(scene)) return;
+
+    glm::vec3 after = cow_get(*property_column(&scene->objects, journal->editProperty), journal->editIndex);
+    if (after == journal->editBefore) return;
+    undo_push(journal, journal->editProperty, &journal->editIndex, &journal->editBefore, &after, 1);
+}
+
+bool undo_undo(UndoJournal *journal, Scene *scene)
+{
+    undo_end_edit(journal, scene);
+    if (journal->cursor == 0) return false;
+    journal->cursor--;
+    apply(journal, scene, journal->records[journal->cursor], false);
+    return true;
+}
+
+bool undo_redo(UndoJournal *journal, Scene *scene)
+{
+    if (journal->cursor == journal->records.size()) return false;
+    apply(journal, scene, journal->records[journal->cursor], true);
+    journal->cursor++;
+    return true;
+}
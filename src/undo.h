@@ -0,0 +1,84 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "scene.h"
+
+// Undo/redo of per-object property edits.
+//
+// Each entry is one property over any number of objects, stored SoA in a
+// byte ring of fixed capacity: uint32 indices[n], vec3 before[n],
+// vec3 after[n]. New entries evict the oldest ones when the ring is full,
+// so memory never exceeds the budget. Undoing applies `before` in a single
+// tight loop, whatever the object count.
+//
+// Entries refer to objects by index, so anything that reorders or removes
+// objects must call undo_clear.
+
+enum UndoProperty
+{
+    UNDO_POSITION,
+    UNDO_ROTATION,
+    UNDO_SCALE,
+    UNDO_COLOR,
+};
+
+struct UndoRecord
+{
+    size_t offset;      // into ring
+    size_t bytes;
+    UndoProperty property;
+    uint32_t count;
+};
+
+struct UndoJournal
+{
+    std::vector<unsigned char> ring;
+    std::deque<UndoRecord> records;   // oldest first
+    size_t cursor;                    // records[0, cursor) undoable, [cursor, end) redoable
+
+    // continuous edit (drag) in progress; becomes one entry when it ends
+    bool editOpen;
+    UndoProperty editProperty;
+    uint32_t editIndex;
+    glm::vec3 editBefore;
+};
+
+void undo_initialize(UndoJournal *journal, size_t budgetBytes);
+
+void undo_clear(UndoJournal *journal);
+
+inline size_t undo_budget(const UndoJournal *journal) { return journal->ring.size(); }
+
+size_t undo_used_bytes(const UndoJournal *journal);
+
+inline size_t undo_count(const UndoJournal *journal) { return journal->cursor; }
+
+inline size_t undo_redo_count(const UndoJournal *journal) { return journal->records.size() - journal->cursor; }
+
+// Records an edit that has already been applied to the scene. Drops any redo
+// history. Returns false if the entry is larger than the whole budget.
+bool undo_push(
+    UndoJournal *journal,
+    UndoProperty property,
+    const uint32_t *indices,
+    const glm::vec3 *before,
+    const glm::vec3 *after,
+    uint32_t count);
+
+// Continuous edits (ImGui drags, gizmo drags) coalesce into one entry:
+// call begin with the value from before the change every time the widget
+// reports a change, and end once nothing is being dragged any more. Calls
+// for the edit that is already open are ignored; an edit of a different
+// property or object closes the open one first. End pushes a single entry
+// if the value actually changed.
+void undo_begin_edit(UndoJournal *journal, Scene *scene, UndoProperty property, uint32_t index, glm::vec3 before);
+void undo_end_edit(UndoJournal *journal, Scene *scene);
+
+bool undo_undo(UndoJournal *journal, Scene *scene);
+bool undo_redo(UndoJournal *journal, Scene *scene);
@@ -0,0 +1,993 @@
+#include "vkbackend.h"
+
+#ifdef MYGL_VULKAN
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+#include "scene.h"
+
+// SPIR-V from glslc -mfmt=num at build time, see CMakeLists.txt
+static const uint32_t LIT_VS[] = {
+#include "vk_lit.vs.inc"
+};
+static const uint32_t LIT_STATIC_VS[] = {
+#include "vk_lit_static.vs.inc"
+};
+static const uint32_t LIT_FS[] = {
+#include "vk_lit.fs.inc"
+};
+
+static const VkFormat COLOR_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+static const VkFormat DEPTH_FORMAT = VK_FORMAT_D32_SFLOAT;
+
+struct VulkanBuffer
+{
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    void *mapped;       // host-visible ones stay mapped
+};
+
+struct VulkanMesh
+{
+    GLuint vbo;         // the GL buffer it was copied from; a new one means a new mesh
+    int stride;
+    VulkanBuffer vertices;
+    VulkanBuffer indices;
+};
+
+// Matches Camera in vk_lit.vs, std140.
+struct CameraUniforms
+{
+    glm::mat4 view;
+    glm::mat4 proj;
+    glm::vec4 viewPos;
+    glm::vec4 lightPos;
+};
+
+// Matches Draw in vk_lit.vs, std430.
+struct DrawUniforms
+{
+    glm::mat4 model;
+    glm::vec4 color;
+};
+
+// What one frame in flight owns; reused once the timeline reaches `value`.
+struct VulkanFrame
+{
+    uint64_t value;     // signalled by its last submission, 0 before the first
+    VkCommandPool pool;
+    VkCommandBuffer primary;
+    std::vector<VkCommandPool> taskPools;       // one per recording task
+    std::vector<VkCommandBuffer> secondaries;
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSet set;
+    VulkanBuffer camera;
+    VulkanBuffer draws;
+    uint32_t drawCapacity;
+    VulkanBuffer readback;
+    int w, h;           // of the image in readback
+};
+
+// Replaced mesh buffers, destroyed once the frames that used them are done.
+struct VulkanRetired
+{
+    uint64_t value;
+    VulkanBuffer buffer;
+};
+
+struct VkBackendState
+{
+    VkInstance instance;
+    VkPhysicalDevice physical;
+    VkDevice device;
+    uint32_t queueFamily;
+    VkQueue queue;
+    VkPhysicalDeviceMemoryProperties memory;
+
+    VkRenderPass renderPass;
+    VkDescriptorSetLayout setLayout;
+    VkPipelineLayout layout;
+    VkPipeline meshPipeline;        // MESH_VERTEX_FLOATS
+    VkPipeline batchPipeline;       // BATCH_VERTEX_FLOATS
+    VkCommandPool uploadPool;
+    VkSemaphore timeline;
+    uint64_t submitted;             // submissions so far; the n-th signals n
+
+    int w, h;
+    VkImage color, depth;
+    VkDeviceMemory colorMemory, depthMemory;
+    VkImageView colorView, depthView;
+    VkFramebuffer framebuffer;
+
+    VulkanFrame frames[VKBACKEND_FRAMES];
+    std::unordered_map<uint32_t, VulkanMesh> meshes;    // MeshHandle value
+    std::vector<VulkanRetired> retired;
+
+    // this draw, for the recording tasks
+    CmdList *list;
+    VulkanFrame *frame;
+    std::vector<uint32_t> drawBase;     // first draw slot of each segment in list->order
+    std::vector<int> taskDraws;
+};
+
+static bool check(VkResult result, const char *what)
+{
+    if (result == VK_SUCCESS) return true;
+    std::cerr << "Vulkan: " << what << " failed (" << (int)result << ")\n";
+    return false;
+}
+
+static double elapsed_ms(std::chrono::steady_clock::time_point since)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+static uint32_t memory_type(const VkBackendState *vk, uint32_t bits, VkMemoryPropertyFlags props)
+{
+    for (uint32_t i = 0; i < vk->memory.memoryTypeCount; i++) {
+        if ((bits & (1u << i)) && (vk->memory.memoryTypes[i].propertyFlags & props) == props) return i;
+    }
+    return UINT32_MAX;
+}
+
+static bool allocate(VkBackendState *vk, const VkMemoryRequirements &req, VkMemoryPropertyFlags props,
+                     VkDeviceMemory *memory)
+{
+    VkMemoryAllocateInfo info = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+    info.allocationSize = req.size;
+    info.memoryTypeIndex = memory_type(vk, req.memoryTypeBits, props);
+    if (info.memoryTypeIndex == UINT32_MAX) {
+        std::cerr << "Vulkan: no memory type with properties " << props << "\n";
+        return false;
+    }
+    return check(vkAllocateMemory(vk->device, &info, nullptr, memory), "vkAllocateMemory");
+}
+
+static void destroy_buffer(VkBackendState *vk, VulkanBuffer *b)
+{
+    if (b->mapped) vkUnmapMemory(vk->device, b->memory);
+    vkDestroyBuffer(vk->device, b->buffer, nullptr);
+    vkFreeMemory(vk->device, b->memory, nullptr);
+    *b = {};
+}
+
+static bool create_buffer(VkBackendState *vk, VkDeviceSize size, VkBufferUsageFlags usage,
+                          VkMemoryPropertyFlags props, VulkanBuffer *b)
+{
+    *b = {};
+    VkBufferCreateInfo info = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    info.size = std::max<VkDeviceSize>(size, 16);
+    info.usage = usage;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (!check(vkCreateBuffer(vk->device, &info, nullptr, &b->buffer), "vkCreateBuffer")) return false;
+    VkMemoryRequirements req;
+    vkGetBufferMemoryRequirements(vk->device, b->buffer, &req);
+    bool ok = allocate(vk, req, props, &b->memory)
+           && check(vkBindBufferMemory(vk->device, b->buffer, b->memory, 0), "vkBindBufferMemory");
+    if (ok && (props & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
+        ok = check(vkMapMemory(vk->device, b->memory, 0, VK_WHOLE_SIZE, 0, &b->mapped), "vkMapMemory");
+    b->size = size;
+    if (!ok) destroy_buffer(vk, b);
+    return ok;
+}
+
+// Host-visible and coherent, cached where the device has it.
+static bool create_host_buffer(VkBackendState *vk, VkDeviceSize size, VkBufferUsageFlags usage, VulkanBuffer *b)
+{
+    const VkMemoryPropertyFlags visible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    VkBufferCreateInfo probe = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    probe.size = std::max<VkDeviceSize>(size, 16);
+    probe.usage = usage;
+    VkBuffer buffer;
+    bool cached = false;
+    if (vkCreateBuffer(vk->device, &probe, nullptr, &buffer) == VK_SUCCESS) {
+        VkMemoryRequirements req;
+        vkGetBufferMemoryRequirements(vk->device, buffer, &req);
+        cached = memory_type(vk, req.memoryTypeBits, visible | VK_MEMORY_PROPERTY_HOST_CACHED_BIT) != UINT32_MAX;
+        vkDestroyBuffer(vk->device, buffer, nullptr);
+    }
+    return create_buffer(vk, size, usage, cached ? visible | VK_MEMORY_PROPERTY_HOST_CACHED_BIT : visible, b);
+}
+
+static bool create_image(VkBackendState *vk, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect,
+                         VkImage *image, VkDeviceMemory *memory, VkImageView *view)
+{
+    VkImageCreateInfo info = {VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+    info.imageType = VK_IMAGE_TYPE_2D;
+    info.format = format;
+    info.extent = {(uint32_t)vk->w, (uint32_t)vk->h, 1};
+    info.mipLevels = 1;
+    info.arrayLayers = 1;
+    info.samples = VK_SAMPLE_COUNT_1_BIT;
+    info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    info.usage = usage;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (!check(vkCreateImage(vk->device, &info, nullptr, image), "vkCreateImage")) return false;
+    VkMemoryRequirements req;
+    vkGetImageMemoryRequirements(vk->device, *image, &req);
+    if (!allocate(vk, req, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memory)) return false;
+    if (!check(vkBindImageMemory(vk->device, *image, *memory, 0), "vkBindImageMemory")) return false;
+
+    VkImageViewCreateInfo viewInfo = {VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+    viewInfo.image = *image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange = {aspect, 0, 1, 0, 1};
+    return check(vkCreateImageView(vk->device, &viewInfo, nullptr, view), "vkCreateImageView");
+}
+
+static void destroy_target(VkBackendState *vk)
+{
+    vkDestroyFramebuffer(vk->device, vk->framebuffer, nullptr);
+    vkDestroyImageView(vk->device, vk->colorView, nullptr);
+    vkDestroyImageView(vk->device, vk->depthView, nullptr);
+    vkDestroyImage(vk->device, vk->color, nullptr);
+    vkDestroyImage(vk->device, vk->depth, nullptr);
+    vkFreeMemory(vk->device, vk->colorMemory, nullptr);
+    vkFreeMemory(vk->device, vk->depthMemory, nullptr);
+    vk->framebuffer = VK_NULL_HANDLE;
+    vk->colorView = vk->depthView = VK_NULL_HANDLE;
+    vk->color = vk->depth = VK_NULL_HANDLE;
+    vk->colorMemory = vk->depthMemory = VK_NULL_HANDLE;
+    vk->w = vk->h = 0;
+}
+
+// One color and one depth image, shared by the frames in flight: the render
+// pass's dependencies order each frame after the last one's copy.
+static bool create_target(VkBackendState *vk, int w, int h)
+{
+    vk->w = w;
+    vk->h = h;
+    bool ok = create_image(vk, COLOR_FORMAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                           VK_IMAGE_ASPECT_COLOR_BIT, &vk->color, &vk->colorMemory, &vk->colorView)
+           && create_image(vk, DEPTH_FORMAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT,
+                           &vk->depth, &vk->depthMemory, &vk->depthView);
+    if (ok) {
+        const VkImageView attachments[2] = {vk->colorView, vk->depthView};
+        VkFramebufferCreateInfo info = {VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO};
+        info.renderPass = vk->renderPass;
+        info.attachmentCount = 2;
+        info.pAttachments = attachments;
+        info.width = (uint32_t)w;
+        info.height = (uint32_t)h;
+        info.layers = 1;
+        ok = check(vkCreateFramebuffer(vk->device, &info, nullptr, &vk->framebuffer), "vkCreateFramebuffer");
+    }
+    if (!ok) destroy_target(vk);
+    return ok;
+}
+
+static bool create_render_pass(VkBackendState *vk)
+{
+    VkAttachmentDescription attachments[2] = {};
+    attachments[0].format = COLOR_FORMAT;
+    attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+    attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachments[0].finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    attachments[1] = attachments[0];
+    attachments[1].format = DEPTH_FORMAT;
+    attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    const VkAttachmentReference colorRef = {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+    const VkAttachmentReference depthRef = {1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+    VkSubpassDescription subpass = {};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorRef;
+    subpass.pDepthStencilAttachment = &depthRef;
+
+    // in: after the previous frame's drawing and copy; out: before this one's copy
+    VkSubpassDependency dependencies[2] = {};
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                                   VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                                   VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                                    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    VkRenderPassCreateInfo info = {VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
+    info.attachmentCount = 2;
+    info.pAttachments = attachments;
+    info.subpassCount = 1;
+    info.pSubpasses = &subpass;
+    info.dependencyCount = 2;
+    info.pDependencies = dependencies;
+    return check(vkCreateRenderPass(vk->device, &info, nullptr, &vk->renderPass), "vkCreateRenderPass");
+}
+
+static VkShaderModule create_shader(VkBackendState *vk, const uint32_t *code, size_t bytes)
+{
+    VkShaderModuleCreateInfo info = {VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+    info.codeSize = bytes;
+    info.pCode = code;
+    VkShaderModule module = VK_NULL_HANDLE;
+    check(vkCreateShaderModule(vk->device, &info, nullptr, &module), "vkCreateShaderModule");
+    return module;
+}
+
+// The lit shader over one vertex layout (gpuresources.h). No culling, like
+// the GL path; viewport and scissor are set per command buffer.
+static bool create_pipeline(VkBackendState *vk, VkShaderModule vs, VkShaderModule fs, int stride, VkPipeline *pipeline)
+{
+    VkPipelineShaderStageCreateInfo stages[2] = {};
+    stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = vs;
+    stages[0].pName = "main";
+    stages[1] = stages[0];
+    stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = fs;
+
+    const VkVertexInputBindingDescription binding = {0, (uint32_t)(stride * sizeof(float)), VK_VERTEX_INPUT_RATE_VERTEX};
+    VkVertexInputAttributeDescription attributes[4];
+    uint32_t attributeCount = 0;
+    attributes[attributeCount++] = {0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0};
+    attributes[attributeCount++] = {1, 0, VK_FORMAT_R32G32B32_SFLOAT, 3 * sizeof(float)};
+    if (stride == BATCH_VERTEX_FLOATS)
+        attributes[attributeCount++] = {2, 0, VK_FORMAT_R32G32B32_SFLOAT, 6 * sizeof(float)};
+    attributes[attributeCount++] = {3, 0, VK_FORMAT_R32_SFLOAT, (uint32_t)((stride - 1) * sizeof(float))};
+    VkPipelineVertexInputStateCreateInfo input = {VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+    input.vertexBindingDescriptionCount = 1;
+    input.pVertexBindingDescriptions = &binding;
+    input.vertexAttributeDescriptionCount = attributeCount;
+    input.pVertexAttributeDescriptions = attributes;
+
+    VkPipelineInputAssemblyStateCreateInfo assembly = {VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
+    assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkPipelineViewportStateCreateInfo viewport = {VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO};
+    viewport.viewportCount = 1;
+    viewport.scissorCount = 1;
+    VkPipelineRasterizationStateCreateInfo raster = {VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO};
+    raster.polygonMode = VK_POLYGON_MODE_FILL;
+    raster.cullMode = VK_CULL_MODE_NONE;
+    raster.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    raster.lineWidth = 1.0f;
+    VkPipelineMultisampleStateCreateInfo multisample = {VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO};
+    multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    VkPipelineDepthStencilStateCreateInfo depth = {VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO};
+    depth.depthTestEnable = VK_TRUE;
+    depth.depthWriteEnable = VK_TRUE;
+    depth.depthCompareOp = VK_COMPARE_OP_LESS;
+    VkPipelineColorBlendAttachmentState blendAttachment = {};
+    blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                     VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    VkPipelineColorBlendStateCreateInfo blend = {VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO};
+    blend.attachmentCount = 1;
+    blend.pAttachments = &blendAttachment;
+    const VkDynamicState dynamicStates[2] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamic = {VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO};
+    dynamic.dynamicStateCount = 2;
+    dynamic.pDynamicStates = dynamicStates;
+
+    VkGraphicsPipelineCreateInfo info = {VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
+    info.stageCount = 2;
+    info.pStages = stages;
+    info.pVertexInputState = &input;
+    info.pInputAssemblyState = &assembly;
+    info.pViewportState = &viewport;
+    info.pRasterizationState = &raster;
+    info.pMultisampleState = &multisample;
+    info.pDepthStencilState = &depth;
+    info.pColorBlendState = &blend;
+    info.pDynamicState = &dynamic;
+    info.layout = vk->layout;
+    info.renderPass = vk->renderPass;
+    info.subpass = 0;
+    return check(vkCreateGraphicsPipelines(vk->device, VK_NULL_HANDLE, 1, &info, nullptr, pipeline),
+                 "vkCreateGraphicsPipelines");
+}
+
+static bool create_pipelines(VkBackendState *vk)
+{
+    VkDescriptorSetLayoutBinding bindings[2] = {};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    VkDescriptorSetLayoutCreateInfo setInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+    setInfo.bindingCount = 2;
+    setInfo.pBindings = bindings;
+    if (!check(vkCreateDescriptorSetLayout(vk->device, &setInfo, nullptr, &vk->setLayout),
+               "vkCreateDescriptorSetLayout"))
+        return false;
+    VkPipelineLayoutCreateInfo layoutInfo = {VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &vk->setLayout;
+    if (!check(vkCreatePipelineLayout(vk->device, &layoutInfo, nullptr, &vk->layout), "vkCreatePipelineLayout"))
+        return false;
+
+    VkShaderModule litVs = create_shader(vk, LIT_VS, sizeof(LIT_VS));
+    VkShaderModule staticVs = create_shader(vk, LIT_STATIC_VS, sizeof(LIT_STATIC_VS));
+    VkShaderModule fs = create_shader(vk, LIT_FS, sizeof(LIT_FS));
+    bool ok = litVs && staticVs && fs
+           && create_pipeline(vk, litVs, fs, MESH_VERTEX_FLOATS, &vk->meshPipeline)
+           && create_pipeline(vk, staticVs, fs, BATCH_VERTEX_FLOATS, &vk->batchPipeline);
+    vkDestroyShaderModule(vk->device, litVs, nullptr);
+    vkDestroyShaderModule(vk->device, staticVs, nullptr);
+    vkDestroyShaderModule(vk->device, fs, nullptr);
+    return ok;
+}
+
+static bool create_frame(VkBackendState *vk, VulkanFrame *f, int tasks)
+{
+    VkCommandPoolCreateInfo poolInfo = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = vk->queueFamily;
+    if (!check(vkCreateCommandPool(vk->device, &poolInfo, nullptr, &f->pool), "vkCreateCommandPool")) return false;
+    VkCommandBufferAllocateInfo alloc = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+    alloc.commandPool = f->pool;
+    alloc.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc.commandBufferCount = 1;
+    if (!check(vkAllocateCommandBuffers(vk->device, &alloc, &f->primary), "vkAllocateCommandBuffers")) return false;
+
+    // command pools are externally synchronized, so one per task
+    f->taskPools.assign(tasks, VK_NULL_HANDLE);
+    f->secondaries.assign(tasks, VK_NULL_HANDLE);
+    for (int t = 0; t < tasks; t++) {
+        if (!check(vkCreateCommandPool(vk->device, &poolInfo, nullptr, &f->taskPools[t]), "vkCreateCommandPool"))
+            return false;
+        alloc.commandPool = f->taskPools[t];
+        alloc.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        if (!check(vkAllocateCommandBuffers(vk->device, &alloc, &f->secondaries[t]), "vkAllocateCommandBuffers"))
+            return false;
+    }
+
+    const VkDescriptorPoolSize sizes[2] = {{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1},
+                                           {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1}};
+    VkDescriptorPoolCreateInfo descriptorInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    descriptorInfo.maxSets = 1;
+    descriptorInfo.poolSizeCount = 2;
+    descriptorInfo.pPoolSizes = sizes;
+    if (!check(vkCreateDescriptorPool(vk->device, &descriptorInfo, nullptr, &f->descriptorPool),
+               "vkCreateDescriptorPool"))
+        return false;
+    return create_host_buffer(vk, sizeof(CameraUniforms), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, &f->camera);
+}
+
+static void destroy_frame(VkBackendState *vk, VulkanFrame *f)
+{
+    vkDestroyCommandPool(vk->device, f->pool, nullptr);
+    for (VkCommandPool pool : f->taskPools) vkDestroyCommandPool(vk->device, pool, nullptr);
+    vkDestroyDescriptorPool(vk->device, f->descriptorPool, nullptr);
+    destroy_buffer(vk, &f->camera);
+    destroy_buffer(vk, &f->draws);
+    destroy_buffer(vk, &f->readback);
+    *f = VulkanFrame{};
+}
+
+static void wait_timeline(VkBackendState *vk, uint64_t value)
+{
+    if (value == 0) return;
+    VkSemaphoreWaitInfo info = {VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
+    info.semaphoreCount = 1;
+    info.pSemaphores = &vk->timeline;
+    info.pValues = &value;
+    check(vkWaitSemaphores(vk->device, &info, UINT64_MAX), "vkWaitSemaphores");
+}
+
+static void release_retired(VkBackendState *vk)
+{
+    uint64_t done = 0;
+    vkGetSemaphoreCounterValue(vk->device, vk->timeline, &done);
+    size_t kept = 0;
+    for (VulkanRetired &r : vk->retired) {
+        if (r.value <= done) destroy_buffer(vk, &r.buffer);
+        else vk->retired[kept++] = r;
+    }
+    vk->retired.resize(kept);
+}
+
+static void retire_mesh(VkBackendState *vk, VulkanMesh *m)
+{
+    // the frames in flight may still draw it
+    vk->retired.push_back({vk->submitted, m->vertices});
+    if (m->indices.buffer) vk->retired.push_back({vk->submitted, m->indices});
+    m->vertices = {};
+    m->indices = {};
+}
+
+// Copies a mesh's GL buffers into device-local ones, through a staging
+// buffer. Load time only, so it waits for the copy.
+static bool upload_mesh(VulkanBackend *vb, const Mesh *mesh, VulkanMesh *out)
+{
+    VkBackendState *vk = vb->vk;
+    const VkDeviceSize vertexBytes = (VkDeviceSize)mesh->vertexCount * mesh->stride * sizeof(float);
+    const VkDeviceSize indexBytes = mesh->ebo ? (VkDeviceSize)mesh->indexCount * sizeof(uint32_t) : 0;
+    VulkanBuffer staging;
+    if (!create_host_buffer(vk, vertexBytes + indexBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, &staging)) return false;
+    glBindBuffer(GL_COPY_READ_BUFFER, mesh->vbo);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)vertexBytes, staging.mapped);
+    if (indexBytes) {
+        glBindBuffer(GL_COPY_READ_BUFFER, mesh->ebo);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)indexBytes, (char*)staging.mapped + vertexBytes);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    *out = {mesh->vbo, mesh->stride, {}, {}};
+    const VkBufferUsageFlags dst = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bool ok = create_buffer(vk, vertexBytes, dst | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &out->vertices)
+           && (!indexBytes || create_buffer(vk, indexBytes, dst | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &out->indices));
+    VkCommandBuffer cb = VK_NULL_HANDLE;
+    if (ok) {
+        VkCommandBufferAllocateInfo alloc = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        alloc.commandPool = vk->uploadPool;
+        alloc.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        alloc.commandBufferCount = 1;
+        ok = check(vkAllocateCommandBuffers(vk->device, &alloc, &cb), "vkAllocateCommandBuffers");
+    }
+    if (ok) {
+        VkCommandBufferBeginInfo begin = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+        begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(cb, &begin);
+        VkBufferCopy copy = {0, 0, vertexBytes};
+        vkCmdCopyBuffer(cb, staging.buffer, out->vertices.buffer, 1, &copy);
+        if (indexBytes) {
+            copy = {vertexBytes, 0, indexBytes};
+            vkCmdCopyBuffer(cb, staging.buffer, out->indices.buffer, 1, &copy);
+        }
+        vkEndCommandBuffer(cb);
+        VkSubmitInfo submit = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+        submit.commandBufferCount = 1;
+        submit.pCommandBuffers = &cb;
+        ok = check(vkQueueSubmit(vk->queue, 1, &submit, VK_NULL_HANDLE), "vkQueueSubmit");
+        if (ok) vkQueueWaitIdle(vk->queue);
+        vkFreeCommandBuffers(vk->device, vk->uploadPool, 1, &cb);
+    }
+    destroy_buffer(vk, &staging);
+    if (!ok) {
+        destroy_buffer(vk, &out->vertices);
+        destroy_buffer(vk, &out->indices);
+        return false;
+    }
+    vb->stats.meshes++;
+    vb->stats.meshBytes += vertexBytes + indexBytes;
+    return true;
+}
+
+// Every segment binds its geometry first (see cmdbuffer.h), so peeking at
+// its leading commands finds it.
+static const CmdBindGeometry* segment_geometry(const CmdBuffer &cb, const CmdSegment &seg)
+{
+    const unsigned char *p = cb.bytes.data() + seg.begin;
+    const unsigned char *end = cb.bytes.data() + seg.end;
+    while (p < end) {
+        uint32_t type;
+        std::memcpy(&type, p, sizeof(type));
+        p += sizeof(type);
+        if (type == CMD_BIND_GEOMETRY) return (const CmdBindGeometry*)p;
+        if (type != CMD_BIND_PROGRAM) return nullptr;
+        p += sizeof(CmdBindProgram);
+    }
+    return nullptr;
+}
+
+// Main thread: makes sure every mesh the list draws is on the device, so
+// the recording tasks only read the table.
+static void prepare_meshes(VulkanBackend *vb, const Scene *scene, const CmdList *list)
+{
+    VkBackendState *vk = vb->vk;
+    uint32_t lastMesh = UINT32_MAX;
+    for (const CmdSegmentRef &ref : list->order) {
+        const CmdBuffer &cb = list->buffers[ref.buffer];
+        const CmdBindGeometry *g = segment_geometry(cb, cb.segments[ref.segment]);
+        if (!g || g->mesh.value == lastMesh) continue;
+        lastMesh = g->mesh.value;
+        auto found = vk->meshes.find(g->mesh.value);
+        if (found != vk->meshes.end() && found->second.vbo == g->vbo) continue;
+        if (found != vk->meshes.end()) {
+            retire_mesh(vk, &found->second);
+            vk->meshes.erase(found);
+        }
+        const Mesh *mesh = gpuresources_mesh(scene->gpu, g->mesh);
+        VulkanMesh uploaded;
+        if (mesh && mesh->vbo == g->vbo && upload_mesh(vb, mesh, &uploaded)) vk->meshes[g->mesh.value] = uploaded;
+    }
+}
+
+static void record_task(void *context, int task)
+{
+    VulkanBackend *vb = (VulkanBackend*)context;
+    VkBackendState *vk = vb->vk;
+    const VulkanFrame *f = vk->frame;
+    const CmdList *list = vk->list;
+    VkCommandBuffer cb = f->secondaries[task];
+
+    VkCommandBufferInheritanceInfo inheritance = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+    inheritance.renderPass = vk->renderPass;
+    inheritance.subpass = 0;
+    inheritance.framebuffer = vk->framebuffer;
+    VkCommandBufferBeginInfo begin = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    begin.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    begin.pInheritanceInfo = &inheritance;
+    vkBeginCommandBuffer(cb, &begin);
+    const VkViewport viewport = {0.0f, 0.0f, (float)vk->w, (float)vk->h, 0.0f, 1.0f};
+    const VkRect2D scissor = {{0, 0}, {(uint32_t)vk->w, (uint32_t)vk->h}};
+    vkCmdSetViewport(cb, 0, 1, &viewport);
+    vkCmdSetScissor(cb, 0, 1, &scissor);
+    vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vk->layout, 0, 1, &f->set, 0, nullptr);
+
+    DrawUniforms *draws = (DrawUniforms*)f->draws.mapped;
+    const size_t n = list->order.size(), tasks = f->secondaries.size();
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    int drawn = 0;
+    for (size_t r = n * task / tasks; r < n * (task + 1) / tasks; r++) {
+        const CmdSegmentRef &ref = list->order[r];
+        const CmdBuffer &buffer = list->buffers[ref.buffer];
+        const CmdSegment &seg = buffer.segments[ref.segment];
+        const unsigned char *p = buffer.bytes.data() + seg.begin;
+        const unsigned char *end = buffer.bytes.data() + seg.end;
+        const VulkanMesh *mesh = nullptr;
+        uint32_t slot = vk->drawBase[r], current = 0;
+        while (p < end) {
+            uint32_t type;
+            std::memcpy(&type, p, sizeof(type));
+            p += sizeof(type);
+            switch (type) {
+            case CMD_BIND_PROGRAM:
+                // the pipeline follows the vertex layout
+                p += sizeof(CmdBindProgram);
+                break;
+            case CMD_BIND_GEOMETRY: {
+                const CmdBindGeometry *c = (const CmdBindGeometry*)p;
+                auto found = vk->meshes.find(c->mesh.value);
+                mesh = found != vk->meshes.end() ? &found->second : nullptr;
+                if (mesh) {
+                    VkPipeline want = mesh->stride == BATCH_VERTEX_FLOATS ? vk->batchPipeline : vk->meshPipeline;
+                    if (want != pipeline) {
+                        pipeline = want;
+                        vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                    }
+                    const VkDeviceSize offset = 0;
+                    vkCmdBindVertexBuffers(cb, 0, 1, &mesh->vertices.buffer, &offset);
+                    if (mesh->indices.buffer) vkCmdBindIndexBuffer(cb, mesh->indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+                }
+                p += sizeof(*c);
+                break;
+            }
+            case CMD_DRAW_DATA: {
+                const CmdDrawData *c = (const CmdDrawData*)p;
+                draws[slot] = {c->model, glm::vec4(c->color, 1.0f)};
+                current = slot++;
+                p += sizeof(*c);
+                break;
+            }
+            case CMD_DRAW: {
+                const CmdDraw *c = (const CmdDraw*)p;
+                if (mesh) {
+                    vkCmdDraw(cb, (uint32_t)c->count, 1, (uint32_t)c->first, current);
+                    drawn++;
+                }
+                p += sizeof(*c);
+                break;
+            }
+            case CMD_DRAW_INDEXED: {
+                const CmdDrawIndexed *c = (const CmdDrawIndexed*)p;
+                if (mesh && mesh->indices.buffer) {
+                    vkCmdDrawIndexed(cb, (uint32_t)c->count, 1, (uint32_t)c->first, 0, current);
+                    drawn++;
+                }
+                p += sizeof(*c);
+                break;
+            }
+            case CMD_DRAW_IMPOSTORS:
+                p += cmdbuffer_impostor_bytes((const CmdDrawImpostors*)p);
+                break;
+            default:
+                p = end;
+                break;
+            }
+        }
+    }
+    vkEndCommandBuffer(cb);
+    vk->taskDraws[task] = drawn;
+}
+
+void vkbackend_initialize(VulkanBackend *vb, JobPool *jobs)
+{
+    vb->jobs = jobs;
+    vb->available = false;
+    VkBackendState *vk = new VkBackendState{};
+    vb->vk = vk;
+
+    VkApplicationInfo app = {VK_STRUCTURE_TYPE_APPLICATION_INFO};
+    app.pApplicationName = "mygl";
+    app.apiVersion = VK_API_VERSION_1_2;
+    VkInstanceCreateInfo instanceInfo = {VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO};
+    instanceInfo.pApplicationInfo = &app;
+    if (vkCreateInstance(&instanceInfo, nullptr, &vk->instance) != VK_SUCCESS) {
+        std::cerr << "Vulkan: no instance, the backend is off\n";
+        vkbackend_shutdown(vb);
+        return;
+    }
+
+    // the first 1.2 device with graphics and timeline semaphores; set
+    // VK_ICD_FILENAMES to pick lavapipe
+    uint32_t count = 0;
+    vkEnumeratePhysicalDevices(vk->instance, &count, nullptr);
+    std::vector<VkPhysicalDevice> devices(count);
+    vkEnumeratePhysicalDevices(vk->instance, &count, devices.data());
+    for (VkPhysicalDevice d : devices) {
+        VkPhysicalDeviceProperties props;
+        vkGetPhysicalDeviceProperties(d, &props);
+        if (props.apiVersion < VK_API_VERSION_1_2) continue;
+        VkPhysicalDeviceVulkan12Features features12 = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+        VkPhysicalDeviceFeatures2 features = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+        features.pNext = &features12;
+        vkGetPhysicalDeviceFeatures2(d, &features);
+        if (!features12.timelineSemaphore) continue;
+        uint32_t families = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(d, &families, nullptr);
+        std::vector<VkQueueFamilyProperties> familyProps(families);
+        vkGetPhysicalDeviceQueueFamilyProperties(d, &families, familyProps.data());
+        for (uint32_t q = 0; q < families && !vk->physical; q++) {
+            if (familyProps[q].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+                vk->physical = d;
+                vk->queueFamily = q;
+                vb->device = props.deviceName;
+            }
+        }
+        if (vk->physical) break;
+    }
+    if (!vk->physical) {
+        std::cerr << "Vulkan: no 1.2 device with timeline semaphores, the backend is off\n";
+        vkbackend_shutdown(vb);
+        return;
+    }
+
+    const float priority = 1.0f;
+    VkDeviceQueueCreateInfo queueInfo = {VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO};
+    queueInfo.queueFamilyIndex = vk->queueFamily;
+    queueInfo.queueCount = 1;
+    queueInfo.pQueuePriorities = &priority;
+    VkPhysicalDeviceVulkan12Features enabled12 = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+    enabled12.timelineSemaphore = VK_TRUE;
+    VkDeviceCreateInfo deviceInfo = {VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
+    deviceInfo.pNext = &enabled12;
+    deviceInfo.queueCreateInfoCount = 1;
+    deviceInfo.pQueueCreateInfos = &queueInfo;
+    if (!check(vkCreateDevice(vk->physical, &deviceInfo, nullptr, &vk->device), "vkCreateDevice")) {
+        vkbackend_shutdown(vb);
+        return;
+    }
+    vkGetDeviceQueue(vk->device, vk->queueFamily, 0, &vk->queue);
+    vkGetPhysicalDeviceMemoryProperties(vk->physical, &vk->memory);
+
+    VkSemaphoreTypeCreateInfo timelineInfo = {VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+    timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineInfo.initialValue = 0;
+    VkSemaphoreCreateInfo semaphoreInfo = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+    semaphoreInfo.pNext = &timelineInfo;
+    VkCommandPoolCreateInfo uploadInfo = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    uploadInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    uploadInfo.queueFamilyIndex = vk->queueFamily;
+    bool ok = check(vkCreateSemaphore(vk->device, &semaphoreInfo, nullptr, &vk->timeline), "vkCreateSemaphore")
+           && check(vkCreateCommandPool(vk->device, &uploadInfo, nullptr, &vk->uploadPool), "vkCreateCommandPool")
+           && create_render_pass(vk)
+           && create_pipelines(vk);
+    const int tasks = jobs ? jobs_thread_count(jobs) : 1;
+    for (VulkanFrame &f : vk->frames) ok = ok && create_frame(vk, &f, tasks);
+    if (!ok) {
+        vkbackend_shutdown(vb);
+        return;
+    }
+    vk->taskDraws.assign(tasks, 0);
+    vb->stats.secondaries = tasks;
+    vb->available = true;
+    std::cout << "Vulkan: " << vb->device << "\n";
+}
+
+const void* vkbackend_draw(VulkanBackend *vb, const Scene *scene, const OrbitCamera *camera, CmdList *list,
+                           int w, int h)
+{
+    VkBackendState *vk = vb->vk;
+    if (!vb->available) return nullptr;
+    auto t0 = std::chrono::steady_clock::now();
+    if (w != vk->w || h != vk->h) {
+        vkDeviceWaitIdle(vk->device);
+        destroy_target(vk);
+        if (!create_target(vk, w, h)) return nullptr;
+    }
+
+    // this frame's resources were last used VKBACKEND_FRAMES submissions ago
+    VulkanFrame *f = &vk->frames[vk->submitted % VKBACKEND_FRAMES];
+    wait_timeline(vk, f->value);
+    release_retired(vk);
+    vb->stats.waitMs = elapsed_ms(t0);
+
+    auto t1 = std::chrono::steady_clock::now();
+    cmdlist_sort(list);
+    prepare_meshes(vb, scene, list);
+
+    // each segment gets as many draw slots as it could hold draw data
+    vk->drawBase.resize(list->order.size() + 1);
+    uint32_t slots = 0;
+    for (size_t r = 0; r < list->order.size(); r++) {
+        const CmdSegment &seg = list->buffers[list->order[r].buffer].segments[list->order[r].segment];
+        vk->drawBase[r] = slots;
+        slots += (seg.end - seg.begin) / (uint32_t)(sizeof(uint32_t) + sizeof(CmdDrawData));
+    }
+    vk->drawBase[list->order.size()] = slots;
+    if (slots > f->drawCapacity || !f->draws.buffer) {
+        destroy_buffer(vk, &f->draws);
+        const uint32_t capacity = std::max(slots, std::max(2 * f->drawCapacity, 1024u));
+        if (!create_host_buffer(vk, (VkDeviceSize)capacity * sizeof(DrawUniforms),
+                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &f->draws))
+            return nullptr;
+        f->drawCapacity = capacity;
+    }
+    CameraUniforms *cam = (CameraUniforms*)f->camera.mapped;
+    cam->view = camera->view;
+    cam->proj = camera->proj;
+    cam->viewPos = glm::vec4(camera->position, 1.0f);
+    cam->lightPos = glm::vec4(scene->animLight, 1.0f);
+
+    vkResetDescriptorPool(vk->device, f->descriptorPool, 0);
+    VkDescriptorSetAllocateInfo setAlloc = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    setAlloc.descriptorPool = f->descriptorPool;
+    setAlloc.descriptorSetCount = 1;
+    setAlloc.pSetLayouts = &vk->setLayout;
+    if (!check(vkAllocateDescriptorSets(vk->device, &setAlloc, &f->set), "vkAllocateDescriptorSets")) return nullptr;
+    const VkDescriptorBufferInfo bufferInfo[2] = {{f->camera.buffer, 0, sizeof(CameraUniforms)},
+                                                  {f->draws.buffer, 0, VK_WHOLE_SIZE}};
+    VkWriteDescriptorSet writes[2] = {};
+    for (int i = 0; i < 2; i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = f->set;
+        writes[i].dstBinding = (uint32_t)i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = i ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        writes[i].pBufferInfo = &bufferInfo[i];
+    }
+    vkUpdateDescriptorSets(vk->device, 2, writes, 0, nullptr);
+
+    vkResetCommandPool(vk->device, f->pool, 0);
+    for (VkCommandPool pool : f->taskPools) vkResetCommandPool(vk->device, pool, 0);
+    vk->list = list;
+    vk->frame = f;
+    const int tasks = (int)f->secondaries.size();
+    if (vb->jobs) jobs_run(vb->jobs, tasks, record_task, vb);
+    else record_task(vb, 0);
+    vb->stats.recordMs = elapsed_ms(t1);
+    vb->stats.draws = 0;
+    for (int d : vk->taskDraws) vb->stats.draws += d;
+
+    auto t2 = std::chrono::steady_clock::now();
+    const VkDeviceSize imageBytes = (VkDeviceSize)w * h * 4;
+    if (f->readback.size != imageBytes) {
+        destroy_buffer(vk, &f->readback);
+        if (!create_host_buffer(vk, imageBytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT, &f->readback)) return nullptr;
+    }
+    VkCommandBuffer cb = f->primary;
+    VkCommandBufferBeginInfo begin = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(cb, &begin);
+    // the GL scene pass clears to zero too
+    VkClearValue clears[2] = {};
+    clears[1].depthStencil = {1.0f, 0};
+    VkRenderPassBeginInfo pass = {VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
+    pass.renderPass = vk->renderPass;
+    pass.framebuffer = vk->framebuffer;
+    pass.renderArea = {{0, 0}, {(uint32_t)w, (uint32_t)h}};
+    pass.clearValueCount = 2;
+    pass.pClearValues = clears;
+    vkCmdBeginRenderPass(cb, &pass, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    vkCmdExecuteCommands(cb, (uint32_t)tasks, f->secondaries.data());
+    vkCmdEndRenderPass(cb);
+    VkBufferImageCopy copy = {};
+    copy.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    copy.imageExtent = {(uint32_t)w, (uint32_t)h, 1};
+    vkCmdCopyImageToBuffer(cb, vk->color, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, f->readback.buffer, 1, &copy);
+    VkMemoryBarrier toHost = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    toHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &toHost, 0, nullptr,
+                         0, nullptr);
+    vkEndCommandBuffer(cb);
+
+    const uint64_t value = vk->submitted + 1;
+    VkTimelineSemaphoreSubmitInfo timelineSubmit = {VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+    timelineSubmit.signalSemaphoreValueCount = 1;
+    timelineSubmit.pSignalSemaphoreValues = &value;
+    VkSubmitInfo submit = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submit.pNext = &timelineSubmit;
+    submit.commandBufferCount = 1;
+    submit.pCommandBuffers = &cb;
+    submit.signalSemaphoreCount = 1;
+    submit.pSignalSemaphores = &vk->timeline;
+    if (!check(vkQueueSubmit(vk->queue, 1, &submit, VK_NULL_HANDLE), "vkQueueSubmit")) return nullptr;
+    vk->submitted = value;
+    f->value = value;
+    f->w = w;
+    f->h = h;
+    vb->stats.submitMs = elapsed_ms(t2);
+
+    // the oldest frame in flight, done by now or soon
+    if (vk->submitted < VKBACKEND_FRAMES) return nullptr;
+    const uint64_t shown = vk->submitted - (VKBACKEND_FRAMES - 1);
+    VulkanFrame *done = &vk->frames[(shown - 1) % VKBACKEND_FRAMES];
+    if (done->w != w || done->h != h) return nullptr;
+    auto t3 = std::chrono::steady_clock::now();
+    wait_timeline(vk, shown);
+    vb->stats.waitMs += elapsed_ms(t3);
+    return done->readback.mapped;
+}
+
+void vkbackend_shutdown(VulkanBackend *vb)
+{
+    VkBackendState *vk = vb->vk;
+    if (!vk) return;
+    if (vk->device) {
+        vkDeviceWaitIdle(vk->device);
+        for (VulkanFrame &f : vk->frames) destroy_frame(vk, &f);
+        for (auto &entry : vk->meshes) {
+            destroy_buffer(vk, &entry.second.vertices);
+            destroy_buffer(vk, &entry.second.indices);
+        }
+        for (VulkanRetired &r : vk->retired) destroy_buffer(vk, &r.buffer);
+        destroy_target(vk);
+        vkDestroyPipeline(vk->device, vk->meshPipeline, nullptr);
+        vkDestroyPipeline(vk->device, vk->batchPipeline, nullptr);
+        vkDestroyPipelineLayout(vk->device, vk->layout, nullptr);
+        vkDestroyDescriptorSetLayout(vk->device, vk->setLayout, nullptr);
+        vkDestroyRenderPass(vk->device, vk->renderPass, nullptr);
+        vkDestroyCommandPool(vk->device, vk->uploadPool, nullptr);
+        vkDestroySemaphore(vk->device, vk->timeline, nullptr);
+        vkDestroyDevice(vk->device, nullptr);
+    }
+    if (vk->instance) vkDestroyInstance(vk->instance, nullptr);
+    delete vk;
+    vb->vk = nullptr;
+    vb->available = false;
+    vb->enabled = false;
+}
+
+#else
+
+void vkbackend_initialize(VulkanBackend *vb, JobPool *jobs)
+{
+    vb->jobs = jobs;
+    vb->available = false;
+}
+
+const void* vkbackend_draw(VulkanBackend*, const Scene*, const OrbitCamera*, CmdList*, int, int)
+{
+    return nullptr;
+}
+
+void vkbackend_shutdown(VulkanBackend *vb)
+{
+    vb->available = false;
+    vb->enabled = false;
+}
+
+#endif
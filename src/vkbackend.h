@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "cmdbuffer.h"
+#include "jobs.h"
+
+struct Scene;
+struct OrbitCamera;
+struct VkBackendState;      // the Vulkan objects, vkbackend.cpp only
+
+// Scene pass through Vulkan, for the same CmdList the GL path replays
+// (built with -DMYGL_VULKAN=ON; runs on lavapipe). It draws offscreen and
+// hands the image back for the GL window to show.
+//
+// The lit shader's two vertex layouts are pipelines built at startup. Per
+// frame, the list's segments are split across the job pool in key order
+// and each task records a secondary command buffer from its own pool;
+// per-draw data goes to a storage buffer indexed by the draw's instance,
+// bound through a descriptor set allocated from a pool reset every frame.
+// VKBACKEND_FRAMES frames are in flight, paced by a timeline semaphore, so
+// the image returned is that many frames minus one old.
+//
+// Impostors, occlusion culling and the depth pre-pass are GL only.
+
+constexpr int VKBACKEND_FRAMES = 2;
+
+struct VkBackendStats
+{
+    int draws;
+    int meshes;             // uploaded, from their GL buffers
+    size_t meshBytes;
+    int secondaries;        // command buffers recorded in parallel per frame
+    double recordMs;        // list to command buffers, across the pool
+    double submitMs;        // primary buffer, submit and readback
+    double waitMs;          // for the timeline, before reusing a frame's resources
+};
+
+struct VulkanBackend
+{
+    bool available = false;
+    bool enabled = false;
+    std::string device;     // physical device name
+    JobPool *jobs = nullptr;
+    VkBackendState *vk = nullptr;
+    VkBackendStats stats = {};
+};
+
+// Creates the device, pipelines and per-frame resources; leaves available
+// false when there is no Vulkan 1.2 device with timeline semaphores, or
+// the build has no Vulkan.
+void vkbackend_initialize(VulkanBackend *vb, JobPool *jobs);
+
+// Main thread. Draws `list`, recorded for `camera`, at w x h. Returns the
+// RGBA8 pixels of the frame submitted VKBACKEND_FRAMES - 1 draws ago,
+// bottom row first like GL, or null when there is none at this size yet.
+// They stay valid until the next draw.
+const void* vkbackend_draw(VulkanBackend *vb, const Scene *scene, const OrbitCamera *camera, CmdList *list,
+                           int w, int h);
+
+void vkbackend_shutdown(VulkanBackend *vb);
@@ -0,0 +1,197 @@
+// Compares two per-frame timing CSVs written by `mygl --play` and flags
+// regressions.
+//
+//   perfcompare <baseline.csv> <candidate.csv> [--threshold PERCENT]
+//               [--tolerance COLUMN=PERCENT]... [--slack COLUMN=AMOUNT]...
+//
+// Every *_ms column and the allocs column is summarised (median, p95) in
+// both runs. A column regresses when the candidate's median or p95 is more
+// than its tolerance (--tolerance, else --threshold, default 5) above the
+// baseline's and also more than its slack (--slack, default 0) above it in
+// absolute terms. Against a baseline of 0 only the slack applies, so a
+// column of counts can grow from 0 by a few without reading as infinite.
+// Frames hashed in both runs (image_hash) must match exactly.
+// Exits with 1 if anything regressed or an image differs, 2 on bad input.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Run
+{
+    std::vector<std::string> meta;                       // '#' lines
+    std::vector<std::string> columns;
+    std::map<std::string, std::vector<double>> values;   // per column
+    std::vector<std::string> hashes;                     // per frame, "" if not hashed
+};
+
+struct Summary
+{
+    double median;
+    double p95;
+};
+
+static std::vector<std::string> split(const std::string &line)
+{
+    std::vector<std::string> out;
+    std::stringstream ss(line);
+    std::string field;
+    while (std::getline(ss, field, ',')) out.push_back(field);
+    return out;
+}
+
+static bool read_run(const char *path, Run *run)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "can't read " << path << "\n";
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty()) continue;
+        if (line[0] == '#') {
+            run->meta.push_back(line);
+        } else if (run->columns.empty()) {
+            run->columns = split(line);
+        } else {
+            std::vector<std::string> fields = split(line);
+            fields.resize(run->columns.size());
+            for (size_t i = 0; i < fields.size(); i++) {
+                if (run->columns[i] == "image_hash") run->hashes.push_back(fields[i]);
+                else run->values[run->columns[i]].push_back(std::strtod(fields[i].c_str(), nullptr));
+            }
+        }
+    }
+    if (run->columns.empty()) {
+        std::cerr << path << ": no header\n";
+        return false;
+    }
+    return true;
+}
+
+static Summary summarise(std::vector<double> v)
+{
+    Summary s = {};
+    if (v.empty()) return s;
+    std::sort(v.begin(), v.end());
+    s.median = v[v.size() / 2];
+    s.p95 = v[std::min(v.size() - 1, (size_t)(v.size() * 0.95))];
+    return s;
+}
+
+static double change_percent(double base, double cand)
+{
+    if (base > 0.0) return (cand - base) / base * 100.0;
+    return cand > base ? INFINITY : 0.0;
+}
+
+static bool regressed_by(double base, double cand, double allowedPercent, double slack)
+{
+    if (cand - base <= slack) return false;
+    return base <= 0.0 || change_percent(base, cand) > allowedPercent;
+}
+
+// Percent, or the absolute difference when the baseline is 0.
+static std::string format_change(double base, double cand)
+{
+    char text[32];
+    if (base > 0.0) std::snprintf(text, sizeof(text), "%+7.1f%%", change_percent(base, cand));
+    else std::snprintf(text, sizeof(text), "%+8g", cand - base);
+    return text;
+}
+
+static bool compared_column(const std::string &col)
+{
+    return col == "allocs" || (col.size() > 3 && col.compare(col.size() - 3, 3, "_ms") == 0);
+}
+
+int main(int argc, char **argv)
+{
+    double threshold = 5.0;
+    std::map<std::string, double> tolerance;
+    std::map<std::string, double> slack;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--threshold" && i + 1 < argc) {
+            threshold = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--tolerance" && i + 1 < argc) {
+            std::string spec = argv[++i];
+            size_t eq = spec.find('=');
+            if (eq == std::string::npos) {
+                std::cerr << "--tolerance expects COLUMN=PERCENT\n";
+                return 2;
+            }
+            tolerance[spec.substr(0, eq)] = std::strtod(spec.c_str() + eq + 1, nullptr);
+        } else if (arg == "--slack" && i + 1 < argc) {
+            std::string spec = argv[++i];
+            size_t eq = spec.find('=');
+            if (eq == std::string::npos) {
+                std::cerr << "--slack expects COLUMN=AMOUNT\n";
+                return 2;
+            }
+            slack[spec.substr(0, eq)] = std::strtod(spec.c_str() + eq + 1, nullptr);
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (files.size() != 2) {
+        std::cerr << "usage: perfcompare <baseline.csv> <candidate.csv> [--threshold PERCENT] [--tolerance COLUMN=PERCENT]... [--slack COLUMN=AMOUNT]...\n";
+        return 2;
+    }
+
+    Run base, cand;
+    if (!read_run(files[0], &base) || !read_run(files[1], &cand)) return 2;
+
+    // timings of different scenes or paths can't be compared
+    if (base.meta != cand.meta) {
+        std::cout << "warning: runs differ in what was measured\n";
+        for (const std::string &m : base.meta) std::cout << "  baseline  " << m << "\n";
+        for (const std::string &m : cand.meta) std::cout << "  candidate " << m << "\n";
+    }
+    size_t baseFrames = base.values[base.columns[0]].size();
+    size_t candFrames = cand.values[cand.columns[0]].size();
+    if (baseFrames != candFrames)
+        std::cout << "warning: " << baseFrames << " vs " << candFrames << " frames\n";
+    if (base.values.count("visible") && cand.values.count("visible") && base.values["visible"] != cand.values["visible"])
+        std::cout << "warning: visible object counts differ, culling changed\n";
+
+    std::printf("%-10s %10s %10s %8s %10s %10s %8s\n", "", "median", "", "", "p95", "", "");
+    std::printf("%-10s %10s %10s %8s %10s %10s %8s\n", "column", "base", "cand", "change", "base", "cand", "change");
+    int regressions = 0;
+    for (const std::string &col : base.columns) {
+        if (!compared_column(col) || !cand.values.count(col)) continue;
+        Summary b = summarise(base.values[col]);
+        Summary c = summarise(cand.values[col]);
+        double allowed = tolerance.count(col) ? tolerance[col] : threshold;
+        double extra = slack.count(col) ? slack[col] : 0.0;
+        bool regressed = regressed_by(b.median, c.median, allowed, extra) || regressed_by(b.p95, c.p95, allowed, extra);
+        regressions += regressed;
+        std::printf("%-10s %10.3f %10.3f %8s %10.3f %10.3f %8s%s\n", col.c_str(),
+            b.median, c.median, format_change(b.median, c.median).c_str(),
+            b.p95, c.p95, format_change(b.p95, c.p95).c_str(), regressed ? "  REGRESSION" : "");
+    }
+
+    int hashed = 0, mismatched = 0;
+    for (size_t f = 0; f < base.hashes.size() && f < cand.hashes.size(); f++) {
+        if (base.hashes[f].empty() || cand.hashes[f].empty()) continue;
+        hashed++;
+        if (base.hashes[f] != cand.hashes[f]) {
+            if (mismatched++ < 10) std::printf("IMAGE MISMATCH at frame %zu\n", f);
+        }
+    }
+    if (hashed) std::printf("%d of %d hashed frames identical\n", hashed - mismatched, hashed);
+
+    if (regressions) std::printf("%d column(s) regressed beyond tolerance\n", regressions);
+    if (regressions || mismatched) return 1;
+    std::printf("no regressions\n");
+    return 0;
+}